@@ -54,6 +54,7 @@
 #ifndef OPENVDB_AX_AST_HAS_BEEN_INCLUDED
 #define OPENVDB_AX_AST_HAS_BEEN_INCLUDED
 
+#include "Arena.h"
 #include "Tokens.h"
 
 #include <openvdb/version.h>
@@ -174,6 +175,12 @@ struct Node
     Node() = default;
     virtual ~Node() = default;
 
+    /// @brief  Nodes are allocated from the NodeArena active on the calling
+    ///         thread, or from the heap if no arena is active.
+    /// @note   See ast::NodeArena
+    static void* operator new(std::size_t size) { return NodeArena::allocate(size); }
+    static void operator delete(void* ptr) noexcept { NodeArena::deallocate(ptr); }
+
     /// @brief  The deep copy method for a Node
     /// @return A deep copy of the current node and all its children
     virtual Node* copy() const = 0;
@@ -467,9 +474,9 @@ struct StatementList : public Statement
     /// @copybrief Node::replacechild()
     inline bool replacechild(const size_t i, Node* node) override final {
         if (mList.size() <= i) return false;
-        Expression* expr = dynamic_cast<Expression*>(node);
-        if (!expr) return false;
-        mList[i].reset(expr);
+        Statement* stmnt = dynamic_cast<Statement*>(node);
+        if (!stmnt) return false;
+        mList[i].reset(stmnt);
         mList[i]->setParent(this);
         return true;
     }
@@ -556,9 +563,9 @@ struct Block : public Statement
     /// @copybrief Node::replacechild()
     inline bool replacechild(const size_t i, Node* node) override final {
         if (mList.size() <= i) return false;
-        Expression* expr = dynamic_cast<Expression*>(node);
-        if (!expr) return false;
-        mList[i].reset(expr);
+        Statement* stmnt = dynamic_cast<Statement*>(node);
+        if (!stmnt) return false;
+        mList[i].reset(stmnt);
         mList[i]->setParent(this);
         return true;
     }
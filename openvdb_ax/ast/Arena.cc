@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file ast/Arena.cc
+
+#include "Arena.h"
+
+#include <atomic>
+#include <cassert>
+#include <new>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace ast {
+
+namespace {
+
+thread_local NodeArena* sActiveArena = nullptr;
+
+constexpr size_t sAlignment = alignof(std::max_align_t);
+
+inline size_t alignSize(const size_t size)
+{
+    return (size + sAlignment - 1) & ~(sAlignment - 1);
+}
+
+}
+
+/// @brief  Every chunk and every allocation are prefixed with a header padded
+///   to the maximum alignment, so that the memory which follows is suitably
+///   aligned for any node.
+struct alignas(std::max_align_t) NodeArena::Chunk
+{
+    /// @brief  The number of live allocations within this chunk, plus one
+    ///   while its arena is still allocating from it
+    std::atomic<size_t> mRefs;
+
+    static Chunk* create(const size_t size)
+    {
+        void* memory = ::operator new(sizeof(Chunk) + size);
+        Chunk* chunk = new (memory) Chunk;
+        chunk->mRefs.store(1, std::memory_order_relaxed);
+        return chunk;
+    }
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+
+    void release()
+    {
+        if (mRefs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        this->~Chunk();
+        ::operator delete(static_cast<void*>(this));
+    }
+};
+
+struct alignas(std::max_align_t) NodeArena::Header
+{
+    /// @brief  The chunk which owns the allocation, or a nullptr if the
+    ///   allocation was made from the heap
+    Chunk* mChunk;
+};
+
+NodeArena::Scope::Scope(NodeArena& arena)
+    : mPrevious(sActiveArena)
+{
+    sActiveArena = &arena;
+}
+
+NodeArena::Scope::~Scope()
+{
+    sActiveArena = mPrevious;
+}
+
+NodeArena::NodeArena(const size_t chunkSize)
+    : mChunkSize(alignSize(chunkSize))
+    , mChunks(0)
+    , mChunk(nullptr)
+    , mPos(nullptr)
+    , mEnd(nullptr) {}
+
+NodeArena::~NodeArena()
+{
+    assert(sActiveArena != this);
+    if (mChunk) mChunk->release();
+}
+
+NodeArena* NodeArena::active()
+{
+    return sActiveArena;
+}
+
+void* NodeArena::allocate(const size_t size)
+{
+    const size_t bytes = sizeof(Header) + alignSize(size);
+    NodeArena* arena = sActiveArena;
+    if (arena && bytes <= arena->mChunkSize / 4) {
+        return arena->allocateFromChunk(bytes);
+    }
+
+    Header* header = new (::operator new(bytes)) Header;
+    header->mChunk = nullptr;
+    return header + 1;
+}
+
+void NodeArena::deallocate(void* ptr) noexcept
+{
+    if (!ptr) return;
+    Header* header = static_cast<Header*>(ptr) - 1;
+    if (header->mChunk) header->mChunk->release();
+    else ::operator delete(static_cast<void*>(header));
+}
+
+void* NodeArena::allocateFromChunk(const size_t bytes)
+{
+    if (!mChunk || static_cast<size_t>(mEnd - mPos) < bytes) {
+        // release the arena's reference to the current chunk. It will be
+        // freed once all allocations within it have been freed
+        if (mChunk) mChunk->release();
+        mChunk = Chunk::create(mChunkSize);
+        mPos = mChunk->data();
+        mEnd = mPos + mChunkSize;
+        ++mChunks;
+    }
+
+    Header* header = new (mPos) Header;
+    mPos += bytes;
+    header->mChunk = mChunk;
+    mChunk->mRefs.fetch_add(1, std::memory_order_relaxed);
+    return header + 1;
+}
+
+} // namespace ast
+} // namespace ax
+
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
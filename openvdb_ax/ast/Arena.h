@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file ast/Arena.h
+///
+/// @brief  A chunked allocator for AST nodes. Trees are built from thousands
+///   of small node allocations which, when made within the scope of a
+///   NodeArena, are packed together into large chunks of memory rather than
+///   individually allocated from the heap.
+///
+
+#ifndef OPENVDB_AX_AST_ARENA_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_AST_ARENA_HAS_BEEN_INCLUDED
+
+#include <openvdb/version.h>
+
+#include <cstddef>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace ast {
+
+/// @brief  An allocator for AST nodes which hands out memory from large chunks.
+///         All AST nodes are allocated with NodeArena::allocate() which uses
+///         the arena active on the calling thread, or the heap if no arena is
+///         active. An arena is made active with a NodeArena::Scope.
+/// @note   Nodes do not need to be destroyed before the arena which allocated
+///         them. Each chunk tracks its live allocations and is freed once all
+///         nodes within it have been destroyed and the arena has moved on to
+///         another chunk (or been destroyed). Nodes can therefore be used and
+///         destroyed like any other node, on any thread. Memory of destroyed
+///         nodes is not reused, so arenas are best suited to building trees
+///         which are mostly destroyed together, e.g. during parsing or when
+///         copying a tree.
+/// @warning  An arena must only be active on one thread at a time.
+///
+/// @code
+///     NodeArena arena;
+///     {
+///         NodeArena::Scope scope(arena);
+///         copy.reset(tree.copy()); // nodes of the copy are allocated by arena
+///     }
+/// @endcode
+class NodeArena
+{
+public:
+    /// @brief  Makes an arena the source of node allocations on the current
+    ///         thread for the lifetime of the scope. Scopes can be nested, in
+    ///         which case the previously active arena is restored on
+    ///         destruction.
+    struct Scope
+    {
+        explicit Scope(NodeArena& arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        NodeArena* mPrevious;
+    };
+
+    /// @brief  Construct an arena which allocates chunks of a given size.
+    ///         Allocations larger than a quarter of the chunk size are always
+    ///         made from the heap.
+    /// @param  chunkSize  The size in bytes of each chunk
+    explicit NodeArena(const size_t chunkSize = 64 * 1024);
+    ~NodeArena();
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    /// @brief  Allocate memory for a node from the arena active on the calling
+    ///         thread, or from the heap if no arena is active.
+    /// @param  size  The number of bytes to allocate
+    static void* allocate(const size_t size);
+
+    /// @brief  Free memory returned from NodeArena::allocate
+    /// @param  ptr  The memory to free. Can be a nullptr
+    static void deallocate(void* ptr) noexcept;
+
+    /// @return  The arena active on the calling thread, or a nullptr
+    static NodeArena* active();
+
+    /// @return  The number of chunks this arena has allocated
+    size_t chunks() const { return mChunks; }
+
+private:
+    struct Chunk;
+    struct Header;
+
+    void* allocateFromChunk(const size_t bytes);
+
+    const size_t mChunkSize;
+    size_t mChunks;
+    Chunk* mChunk;
+    char* mPos;
+    char* mEnd;
+};
+
+} // namespace ast
+} // namespace ax
+
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_AST_ARENA_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
@@ -75,8 +75,14 @@ openvdb::ax::ast::parse(const char* code, openvdb::ax::Logger& logger)
 
     YY_BUFFER_STATE buffer = ax_scan_string(code);
 
+    // allocate the nodes of the tree together. The arena can be destroyed
+    // once parsing is complete, the nodes keep their memory alive
+    openvdb::ax::ast::NodeArena arena;
     openvdb::ax::ast::Tree* tree(nullptr);
-    axparse(&tree);
+    {
+        openvdb::ax::ast::NodeArena::Scope scope(arena);
+        axparse(&tree);
+    }
     axlog = nullptr;
 
     openvdb::ax::ast::Tree::ConstPtr ptr(const_cast<const openvdb::ax::ast::Tree*>(tree));
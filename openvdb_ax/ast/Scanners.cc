@@ -33,8 +33,13 @@
 #include "Scanners.h"
 #include "Visitor.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace openvdb {
 OPENVDB_USE_VERSION_NAMESPACE
@@ -287,6 +292,355 @@ void variableDependencies(const ast::Variable& var,
     }
 }
 
+/// @brief  Visits nodes in the same order as UseVisitor<true>, i.e. DO loop
+///   bodies are traversed before their conditions. The last attribute visited
+///   for any token is the same attribute returned by lastUse().
+template <typename NodeT, typename OpT>
+struct UseOrderVisitor :
+    public ast::VisitNodeType<NodeT, OpT,
+        UseOrderVisitor<NodeT, OpT>>
+{
+    using BaseT = ast::VisitNodeType<NodeT, OpT,
+        UseOrderVisitor<NodeT, OpT>>;
+    using BaseT::traverse;
+    using BaseT::visit;
+
+    UseOrderVisitor(const OpT& op) : BaseT(op) {}
+    ~UseOrderVisitor() = default;
+
+    bool traverse(const ast::Loop* loop)
+    {
+        if (!loop) return true;
+        if (loop->loopType() == ast::tokens::DO) {
+            if (!this->traverse(loop->body())) return false;
+            if (!this->traverse(loop->condition())) return false;
+        }
+        else {
+            if (!this->traverse(loop->initial())) return false;
+            if (!this->traverse(loop->condition())) return false;
+            if (!this->traverse(loop->iteration())) return false;
+            if (!this->traverse(loop->body())) return false;
+        }
+        if (!this->visit(loop)) return false;
+        return true;
+    }
+};
+
+/// @brief  A graph representation of the dependency rules implemented by
+///   variableDependencies(). Every node in the AST has a vertex which represents
+///   the collection of all variables in its branch. Every Attribute and Local
+///   additionally has a vertex which represents the resolution of its
+///   dependencies. The dependencies of a variable are then the attributes which
+///   are labelled on any vertex reachable from its resolution vertex. This allows
+///   the dependencies of every attribute to be computed together in time
+///   proportional to the size of the graph rather than once per attribute.
+struct DependencyGraph
+{
+    static constexpr size_t Invalid = std::numeric_limits<size_t>::max();
+
+    DependencyGraph(const ast::Tree& tree)
+    {
+        std::vector<const ast::Node*> nodes;
+        ast::linearize(tree, nodes);
+
+        mEdges.resize(nodes.size());
+        mLabels.resize(nodes.size(), Invalid);
+        mBranches.reserve(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            mBranches[nodes[i]] = i;
+        }
+
+        // connect every branch vertex to its children and to the resolution
+        // vertex of any Attribute or Local
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const ast::Node* node = nodes[i];
+            for (size_t j = 0; j < node->children(); ++j) {
+                const ast::Node* child = node->child(j);
+                if (child) mEdges[i].emplace_back(mBranches.at(child));
+            }
+            if (node->nodetype() == ast::Node::AttributeNode) {
+                const auto* attrib = static_cast<const ast::Attribute*>(node);
+                mLabels[i] = this->attributeIndex(attrib->tokenname());
+                const size_t vertex = this->addResolution(attrib);
+                mEdges[i].emplace_back(vertex);
+            }
+            else if (node->nodetype() == ast::Node::LocalNode) {
+                const size_t vertex =
+                    this->addResolution(static_cast<const ast::Variable*>(node));
+                mEdges[i].emplace_back(vertex);
+            }
+        }
+
+        // a variable depends on everything its previous occurrences depend on.
+        // Occurrences are ordered as they are by variableDependencies()
+
+        std::unordered_map<std::string, size_t> attributes, locals;
+        auto chain = [&](const ast::Variable& var) -> bool {
+            if (var.nodetype() == ast::Node::ExternalVariableNode) return true;
+            const size_t vertex = mResolutions.at(&var);
+            auto& previous = (var.nodetype() == ast::Node::AttributeNode) ?
+                attributes[static_cast<const ast::Attribute&>(var).tokenname()] :
+                locals[var.name()];
+            if (previous != 0) mEdges[vertex].emplace_back(previous - 1);
+            previous = vertex + 1;
+            this->addUsage(var, vertex);
+            return true;
+        };
+
+        VariableDependencyVisitor<ast::Variable, decltype(chain)> visitor(chain);
+        visitor.traverse(&tree);
+    }
+
+    /// @brief  Populate the dependencies of every attribute in the tree, where
+    ///   the dependencies of an attribute are the dependencies of its last use
+    void dependencies(const ast::Tree& tree,
+        std::unordered_map<std::string, std::vector<std::string>>& dependencies)
+    {
+        std::unordered_map<std::string, const ast::Attribute*> last;
+        auto collect = [&](const ast::Attribute& attrib) -> bool {
+            last[attrib.tokenname()] = &attrib;
+            return true;
+        };
+
+        UseOrderVisitor<ast::Attribute, decltype(collect)> visitor(collect);
+        visitor.traverse(&tree);
+        if (last.empty()) return;
+
+        const size_t words = (mTokens.size() + 63) / 64;
+        std::vector<size_t> components;
+        std::vector<uint64_t> bits;
+        this->resolve(words, components, bits);
+
+        for (const auto& use : last) {
+            std::vector<std::string>& deps = dependencies[use.first];
+            const size_t component = components[mResolutions.at(use.second)];
+            const uint64_t* set = bits.data() + (component * words);
+            for (size_t i = 0; i < mTokens.size(); ++i) {
+                if (set[i / 64] & (uint64_t(1) << (i % 64))) {
+                    deps.emplace_back(mTokens[i]);
+                }
+            }
+            std::sort(deps.begin(), deps.end());
+        }
+    }
+
+private:
+
+    size_t attributeIndex(const std::string& token)
+    {
+        auto iter = mIndices.find(token);
+        if (iter != mIndices.end()) return iter->second;
+        mIndices[token] = mTokens.size();
+        mTokens.emplace_back(token);
+        return mTokens.size() - 1;
+    }
+
+    size_t addResolution(const ast::Variable* var)
+    {
+        const size_t vertex = mEdges.size();
+        mEdges.emplace_back();
+        mLabels.emplace_back(Invalid);
+        mResolutions[var] = vertex;
+        return vertex;
+    }
+
+    /// @brief  Walk the parents of a variable occurrence, linking its resolution
+    ///   vertex to the branches which it depends on. This follows the rules of
+    ///   variableDependencies().
+    void addUsage(const ast::Variable& use, const size_t vertex)
+    {
+        auto link = [&](const ast::Node* branch) {
+            if (branch) mEdges[vertex].emplace_back(mBranches.at(branch));
+        };
+        auto self = [&]() {
+            if (use.nodetype() != ast::Node::AttributeNode) return;
+            mLabels[vertex] = this->attributeIndex(
+                static_cast<const ast::Attribute&>(use).tokenname());
+        };
+
+        const ast::Node* child = &use;
+        // track writable for conditionals
+        bool written = false;
+        while (const ast::Node* parent = child->parent()) {
+            const ast::Node::NodeType type = parent->nodetype();
+            if (type == ast::Node::CrementNode) {
+                written = true;
+                self();
+            }
+            else if (type == ast::Node::ConditionalStatementNode) {
+                const ast::Expression* condition =
+                    static_cast<const ast::ConditionalStatement*>(parent)->condition();
+                if (written && child != condition) link(condition);
+            }
+            else if (type == ast::Node::TernaryOperatorNode) {
+                const ast::Expression* condition =
+                    static_cast<const ast::TernaryOperator*>(parent)->condition();
+                if (written && child != condition) link(condition);
+            }
+            else if (type == ast::Node::LoopNode) {
+                const ast::Statement* condition =
+                    static_cast<const ast::Loop*>(parent)->condition();
+                if (written && condition && child != condition) {
+                    // if the condition is a comma operator the last element determines flow
+                    if (condition->nodetype() == ast::Node::NodeType::CommaOperatorNode) {
+                        const ast::CommaOperator*
+                            comma = static_cast<const ast::CommaOperator*>(condition);
+                        if (!comma->empty()) link(comma->child(comma->size()-1));
+                    }
+                    else {
+                        link(condition);
+                    }
+                }
+            }
+            else if (type == ast::Node::AssignExpressionNode) {
+                const ast::AssignExpression* assignment =
+                    static_cast<const ast::AssignExpression*>(parent);
+                if (assignment->lhs() == child) {
+                    written = true;
+                    if (assignment->isCompound()) self();
+                    link(assignment->rhs());
+                }
+            }
+            else if (type == ast::Node::DeclareLocalNode) {
+                const ast::DeclareLocal* declareLocal =
+                    static_cast<const ast::DeclareLocal*>(parent);
+                if (declareLocal->local() == child && declareLocal->hasInit()) {
+                    written = true;
+                    link(declareLocal->init());
+                }
+            }
+            else if (type == ast::Node::FunctionCallNode) {
+                written = true;
+                // the branch of the call links to all of its arguments
+                link(parent);
+            }
+            child = parent;
+        }
+    }
+
+    /// @brief  Compute the strongly connected components of the graph using an
+    ///   iterative version of Tarjan's algorithm. Components are found in
+    ///   reverse topological order, so the set of attributes reachable from
+    ///   each component can be accumulated as soon as it's found.
+    void resolve(const size_t words,
+        std::vector<size_t>& components,
+        std::vector<uint64_t>& bits) const
+    {
+        const size_t size = mEdges.size();
+        std::vector<size_t> index(size, Invalid), low(size);
+        std::vector<bool> onstack(size, false);
+        std::vector<size_t> stack;
+        std::vector<std::pair<size_t, size_t>> frames;
+        components.assign(size, Invalid);
+
+        size_t counter = 0, count = 0;
+
+        auto push = [&](const size_t v) {
+            index[v] = low[v] = counter++;
+            stack.emplace_back(v);
+            onstack[v] = true;
+            frames.emplace_back(v, 0);
+        };
+
+        for (size_t root = 0; root < size; ++root) {
+            if (index[root] != Invalid) continue;
+            push(root);
+            while (!frames.empty()) {
+                const size_t v = frames.back().first;
+                const size_t edge = frames.back().second;
+                if (edge < mEdges[v].size()) {
+                    ++frames.back().second;
+                    const size_t w = mEdges[v][edge];
+                    if (index[w] == Invalid) push(w);
+                    else if (onstack[w]) low[v] = std::min(low[v], index[w]);
+                    continue;
+                }
+
+                frames.pop_back();
+                if (!frames.empty()) {
+                    const size_t u = frames.back().first;
+                    low[u] = std::min(low[u], low[v]);
+                }
+                if (low[v] != index[v]) continue;
+
+                // v is the root of a component - pop it and accumulate the
+                // labels of its members and of all components it reaches
+
+                bits.resize(bits.size() + words, 0);
+                uint64_t* set = bits.data() + (count * words);
+                const size_t begin = stack.size() - 1 -
+                    (std::find(stack.rbegin(), stack.rend(), v) - stack.rbegin());
+                for (size_t i = begin; i < stack.size(); ++i) {
+                    components[stack[i]] = count;
+                    onstack[stack[i]] = false;
+                }
+                for (size_t i = begin; i < stack.size(); ++i) {
+                    const size_t w = stack[i];
+                    if (mLabels[w] != Invalid) {
+                        set[mLabels[w] / 64] |= (uint64_t(1) << (mLabels[w] % 64));
+                    }
+                    for (const size_t next : mEdges[w]) {
+                        const size_t component = components[next];
+                        if (component == count) continue;
+                        assert(component < count);
+                        const uint64_t* other = bits.data() + (component * words);
+                        for (size_t j = 0; j < words; ++j) set[j] |= other[j];
+                    }
+                }
+                stack.resize(begin);
+                ++count;
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> mEdges;
+    std::vector<size_t> mLabels;
+    std::unordered_map<const ast::Node*, size_t> mBranches;
+    std::unordered_map<const ast::Variable*, size_t> mResolutions;
+    std::unordered_map<std::string, size_t> mIndices;
+    std::vector<std::string> mTokens;
+};
+
+constexpr size_t DependencyGraph::Invalid;
+
+/// @brief  Reduce the chain of parents common to the uses of an attribute,
+///   starting from the root, to those shared with a further use. The chain
+///   of the first use initializes the common parents.
+inline void intersectParents(const ast::Attribute& attrib,
+    std::vector<const ast::Node*>& common,
+    const bool first)
+{
+    std::vector<const ast::Node*> parents;
+    for (const ast::Node* parent = attrib.parent(); parent;
+        parent = parent->parent()) {
+        parents.emplace_back(parent);
+    }
+    std::reverse(parents.begin(), parents.end());
+
+    if (first) {
+        common.swap(parents);
+        return;
+    }
+
+    auto mismatch = std::mismatch(common.begin(), common.end(),
+        parents.begin(), parents.end());
+    common.erase(mismatch.first, common.end());
+}
+
+/// @brief  Returns the innermost Block of the parents common to the uses of
+///   an attribute which is not nested within a loop
+inline const ast::Block* usageBlock(const std::vector<const ast::Node*>& common)
+{
+    const ast::Block* block = nullptr;
+    for (const ast::Node* parent : common) {
+        if (parent->nodetype() == ast::Node::LoopNode) break;
+        if (parent->nodetype() == ast::Node::BlockNode) {
+            block = static_cast<const ast::Block*>(parent);
+        }
+    }
+    return block;
+}
 
 } // anonymous namespace
 
@@ -335,7 +689,8 @@ void catalogueVariables(const ast::Node& node,
         std::vector<const ast::Variable*>* writeOnly,
         std::vector<const ast::Variable*>* readWrite,
         const bool locals,
-        const bool attributes)
+        const bool attributes,
+        const ArgumentWriteQuery& writesToArgument)
 {
     std::vector<const ast::Variable*> vars;
 
@@ -351,6 +706,9 @@ void catalogueVariables(const ast::Node& node,
         const ast::Node* child = var;
         const ast::Node* parent = child->parent();
         bool read = false, write = false;
+        // whether the current child may still evaluate to the variable's
+        // address, i.e. hasn't been copied into a new value
+        bool direct = true;
         while (parent && !(write && read)) {
             const ast::Node::NodeType type = parent->nodetype();
             // crement operations read and write
@@ -384,15 +742,36 @@ void catalogueVariables(const ast::Node& node,
                 }
             }
             else if (type == ast::Node::FunctionCallNode) {
-                // @todo  We currently can't detect if attributes are being passed by
-                //   pointer and being modified automatically. This is a major limitation
-                //   as it means any attribute passed into any function directly must
-                //   be marked as writeable
-                read = write = true;
+                // Arguments are always read. Only arguments which evaluate to
+                // the variable itself can be modified by the function. Without
+                // a query, assume that any such argument is written to
+                read = true;
+                if (direct) {
+                    if (!writesToArgument) write = true;
+                    else {
+                        const ast::FunctionCall* call =
+                            static_cast<const ast::FunctionCall*>(parent);
+                        size_t i = 0;
+                        while (call->child(i) != child) ++i;
+                        assert(i < call->children());
+                        if (writesToArgument(*call, i)) write = true;
+                    }
+                }
             }
             else {
                 read = true;
             }
+
+            if (direct) {
+                // assignments, crements, ternaries and commas can forward the
+                // variable itself. All other expressions produce new values
+                direct = type == ast::Node::CrementNode ||
+                    type == ast::Node::TernaryOperatorNode ||
+                    type == ast::Node::CommaOperatorNode ||
+                    (type == ast::Node::AssignExpressionNode &&
+                        static_cast<const ast::AssignExpression*>(parent)->lhs() == child);
+            }
+
             child = parent;
             parent = child->parent();
         }
@@ -407,7 +786,8 @@ void catalogueVariables(const ast::Node& node,
 void catalogueAttributeTokens(const ast::Node& node,
         std::vector<std::string>* readOnly,
         std::vector<std::string>* writeOnly,
-        std::vector<std::string>* readWrite)
+        std::vector<std::string>* readWrite,
+        const ArgumentWriteQuery& writesToArgument)
 {
     std::vector<const ast::Variable*> readOnlyVars;
     std::vector<const ast::Variable*> writeOnlyVars;
@@ -417,7 +797,8 @@ void catalogueAttributeTokens(const ast::Node& node,
         (writeOnly ? &writeOnlyVars : nullptr),
         (readWrite ? &readWriteVars : nullptr),
         false, // locals
-        true); // attributes
+        true, // attributes
+        writesToArgument);
 
     // fill a single map with the access patterns for all attributes
     // .first = read, .second = write
@@ -556,6 +937,102 @@ void attributeDependencyTokens(const ast::Tree& tree,
     dependencies.erase(iter, dependencies.end());
 }
 
+void attributeDependencyTokens(const ast::Tree& tree,
+        std::unordered_map<std::string, std::vector<std::string>>& dependencies)
+{
+    DependencyGraph graph(tree);
+    graph.dependencies(tree, dependencies);
+}
+
+void overwrittenAttributeTokens(const ast::Tree& tree,
+        std::vector<std::string>& overwritten)
+{
+    const ast::Block* block = tree.child(0);
+    assert(block);
+
+    // attributes which have been accessed in any way before the current
+    // top level statement
+    std::unordered_set<std::string> used;
+
+    for (size_t i = 0; i < block->size(); ++i) {
+        const ast::Statement* statement = block->child(i);
+        if (!statement) continue;
+
+        // Attribute values are written back on return, so the initial value of
+        // any attribute not yet assigned may be observed past this point
+
+        bool returns = false;
+        visitNodeType<ast::Keyword>(*statement,
+            [&](const ast::Keyword& keyword) -> bool {
+                returns = keyword.keyword() == tokens::RETURN;
+                return !returns;
+            });
+        if (returns) break;
+
+        // Only consider direct, non compound assignments i.e. @a = ...;
+        // Component assignments (@a.x = ...) only partially overwrite the
+        // attribute and are treated as uses
+
+        const ast::Attribute* target = nullptr;
+        if (statement->nodetype() == ast::Node::AssignExpressionNode) {
+            const ast::AssignExpression* assignment =
+                static_cast<const ast::AssignExpression*>(statement);
+            const ast::Expression* lhs = assignment->lhs();
+            if (!assignment->isCompound() &&
+                lhs->nodetype() == ast::Node::AttributeNode) {
+                target = static_cast<const ast::Attribute*>(lhs);
+            }
+        }
+
+        visitNodeType<ast::Attribute>(*statement,
+            [&](const ast::Attribute& attrib) -> bool {
+                if (&attrib != target) used.insert(attrib.tokenname());
+                return true;
+            });
+
+        if (target && used.insert(target->tokenname()).second) {
+            overwritten.emplace_back(target->tokenname());
+        }
+    }
+}
+
+const ast::Block* attributeUsageBlock(const ast::Node& node, const std::string& token)
+{
+    // the chain of parents common to every use, starting from the root
+    std::vector<const ast::Node*> common;
+    bool used = false;
+
+    visitNodeType<ast::Attribute>(node,
+        [&](const ast::Attribute& attrib) -> bool {
+            if (attrib.tokenname() != token) return true;
+            intersectParents(attrib, common, !used);
+            used = true;
+            return true;
+        });
+
+    if (!used) return nullptr;
+    return usageBlock(common);
+}
+
+void attributeUsageBlock(const ast::Node& node,
+        std::unordered_map<std::string, const ast::Block*>& blocks)
+{
+    // the chains of parents common to every use of each attribute
+    std::unordered_map<std::string, std::vector<const ast::Node*>> common;
+
+    visitNodeType<ast::Attribute>(node,
+        [&](const ast::Attribute& attrib) -> bool {
+            const auto inserted = common.emplace(attrib.tokenname(),
+                std::vector<const ast::Node*>());
+            intersectParents(attrib, inserted.first->second, inserted.second);
+            return true;
+        });
+
+    for (const auto& uses : common) {
+        blocks[uses.first] = usageBlock(uses.second);
+    }
+}
+
 const ast::Variable* firstUse(const ast::Node& node, const std::string& tokenOrName)
 {
     UseVisitor<true> visitor(tokenOrName);
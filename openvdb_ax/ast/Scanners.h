@@ -44,7 +44,10 @@
 
 #include <openvdb/version.h>
 
+#include <functional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace openvdb {
 OPENVDB_USE_VERSION_NAMESPACE
@@ -84,13 +87,33 @@ bool writesToAttribute(const ast::Node& node,
 ///
 bool callsFunction(const ast::Node& node, const std::string& name);
 
-/// @brief todo
+/// @brief  A callback which returns whether the function called by a given
+///         FunctionCall node may modify its argument at a given index. Used to
+///         refine the access patterns of variables passed to functions.
+using ArgumentWriteQuery =
+    std::function<bool(const ast::FunctionCall&, const size_t)>;
+
+/// @brief  Parse all variables into three vectors which represent how they
+///         are accessed within the syntax tree. See catalogueAttributeTokens.
+/// @note   Variables passed directly to functions are always read from. If no
+///         writesToArgument query is provided they are also assumed to be
+///         written to.
+///
+/// @param node        The AST to analyze
+/// @param readOnly    The list of variables which are only read from
+/// @param writeOnly   The list of variables which are only written too
+/// @param readWrite   The list of variables which are both read from and written too
+/// @param locals      Whether to catalogue local variables
+/// @param attributes  Whether to catalogue attributes
+/// @param writesToArgument  An optional query for function call arguments
+///
 void catalogueVariables(const ast::Node& node,
         std::vector<const ast::Variable*>* readOnly,
         std::vector<const ast::Variable*>* writeOnly,
         std::vector<const ast::Variable*>* readWrite,
         const bool locals = true,
-        const bool attributes = true);
+        const bool attributes = true,
+        const ArgumentWriteQuery& writesToArgument = ArgumentWriteQuery());
 
 /// @brief  Parse all attributes into three unique vectors which represent how they
 ///         are accessed within the syntax tree. Read only attributes are stored
@@ -104,11 +127,14 @@ void catalogueVariables(const ast::Node& node,
 /// @param readOnly   The unique list of attributes which are only read from
 /// @param writeOnly  The unique list of attributes which are only written too
 /// @param readWrite  The unique list of attributes which both read from and written too
+/// @param writesToArgument  An optional query for function call arguments. See
+///                   catalogueVariables
 ///
 void catalogueAttributeTokens(const ast::Node& node,
         std::vector<std::string>* readOnly,
         std::vector<std::string>* writeOnly,
-        std::vector<std::string>* readWrite);
+        std::vector<std::string>* readWrite,
+        const ArgumentWriteQuery& writesToArgument = ArgumentWriteQuery());
 
 /// @brief  Populate a list of attribute names which the given attribute depends on
 void attributeDependencyTokens(const ast::Tree& tree,
@@ -116,6 +142,53 @@ void attributeDependencyTokens(const ast::Tree& tree,
         const tokens::CoreType type,
         std::vector<std::string>& dependencies);
 
+/// @brief  Populate the dependencies of every attribute used in the given AST.
+///         For each attribute token, the result is identical to calling the
+///         above function for that attribute, however all dependencies are
+///         resolved in a single pass over the tree. Prefer this method when
+///         the dependencies of more than one attribute are required.
+///
+/// @param tree          The AST to analyze
+/// @param dependencies  A map of attribute tokens to their sorted dependencies
+///
+void attributeDependencyTokens(const ast::Tree& tree,
+        std::unordered_map<std::string, std::vector<std::string>>& dependencies);
+
+/// @brief  Populate a list of attribute tokens whose initial values can never
+///         be observed. These are attributes which are unconditionally assigned
+///         to (for example @code @a = 1; @endcode) in the top level block before
+///         any other use of them and before any return statement. Such
+///         attributes do not need to be read prior to execution.
+///
+/// @param tree         The AST to analyze
+/// @param overwritten  The unique list of overwritten attribute tokens
+///
+void overwrittenAttributeTokens(const ast::Tree& tree,
+        std::vector<std::string>& overwritten);
+
+/// @brief  Returns the innermost Block which contains every use of a given
+///         attribute and which is executed at most once per execution of the
+///         given AST. Blocks nested within loops are ignored, in which case
+///         the Block containing the outermost loop is returned. Returns a
+///         nullptr if the attribute is not used.
+///
+/// @param node   The AST to analyze
+/// @param token  The token of the attribute to search for
+///
+const ast::Block* attributeUsageBlock(const ast::Node& node, const std::string& token);
+
+/// @brief  Populate the usage Blocks of every attribute used in the given AST.
+///         For each attribute token, the result is identical to calling the
+///         above function for that attribute, however all Blocks are found
+///         in a single pass over the tree. Prefer this method when the usage
+///         Blocks of more than one attribute are required.
+///
+/// @param node    The AST to analyze
+/// @param blocks  A map of attribute tokens to their usage Blocks
+///
+void attributeUsageBlock(const ast::Node& node,
+        std::unordered_map<std::string, const ast::Block*>& blocks);
+
 /// @brief  For an AST node of a given type, search for and call a custom
 ///         const operator() which takes a const reference to every occurrence
 ///         of the specified node type.
@@ -0,0 +1,632 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file ast/Serialize.cc
+
+#include "Serialize.h"
+#include "Arena.h"
+
+#include <openvdb/Exceptions.h>
+
+#include <cassert>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace ast {
+
+namespace {
+
+/// @brief  The first bytes of all serialized trees
+constexpr char sMagic[4] = { 'A', 'X', 'S', 'T' };
+/// @brief  Node type value written in place of absent optional child nodes
+constexpr uint8_t sNullNode = 0xFF;
+
+enum Flags : uint32_t
+{
+    /// @brief Line and column numbers follow the type of each node
+    Locations = 1 << 0,
+    /// @brief The data was written on a big endian host
+    BigEndian = 1 << 1
+};
+
+inline bool isBigEndian()
+{
+    const uint16_t value = 1;
+    char byte;
+    std::memcpy(&byte, &value, 1);
+    return byte == 0;
+}
+
+/// @brief  Serializes nodes in pre-order into a buffer, collecting the unique
+///   strings which they reference into a separate table
+struct Writer
+{
+    Writer(const ax::Logger* logger) : mLogger(logger) {}
+
+    template <typename T>
+    inline void write(const T value)
+    {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        mData.insert(mData.end(), bytes, bytes + sizeof(T));
+    }
+
+    /// @brief  Write an unsigned integer using as few bytes as possible, 7 bits
+    ///   at a time with the top bit of each byte marking further bytes
+    inline void varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            mData.emplace_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        mData.emplace_back(static_cast<char>(value));
+    }
+
+    inline void string(const std::string& str)
+    {
+        const auto iter =
+            mStringIndices.emplace(str, static_cast<uint32_t>(mStrings.size()));
+        if (iter.second) mStrings.emplace_back(&(iter.first->first));
+        this->varint(iter.first->second);
+    }
+
+    void node(const ast::Node* node)
+    {
+        if (!node) {
+            this->write<uint8_t>(sNullNode);
+            return;
+        }
+
+        // enforce the limit of the reader, so that trees which can't be read
+        // back are rejected when written
+        if (++mDepth > MaxSerializedDepth) {
+            OPENVDB_THROW(IoError, "Unable to serialize an AST which exceeds the "
+                "maximum depth of " << MaxSerializedDepth << " nodes.");
+        }
+
+        ++mNodes;
+        const Node::NodeType type = node->nodetype();
+        this->write<uint8_t>(static_cast<uint8_t>(type));
+
+        if (mLogger) {
+            const ax::Logger::CodeLocation location = mLogger->getNodeLocation(node);
+            this->varint(location.first);
+            this->varint(location.second);
+        }
+
+        switch (type) {
+            case Node::TreeNode :
+            case Node::ConditionalStatementNode :
+            case Node::TernaryOperatorNode :
+            case Node::ArrayUnpackNode : {
+                break;
+            }
+            case Node::StatementListNode :
+            case Node::BlockNode :
+            case Node::CommaOperatorNode :
+            case Node::ArrayPackNode : {
+                this->varint(node->children());
+                break;
+            }
+            case Node::LoopNode : {
+                this->write<uint8_t>(static_cast<const Loop*>(node)->loopType());
+                break;
+            }
+            case Node::KeywordNode : {
+                this->write<uint8_t>(static_cast<const Keyword*>(node)->keyword());
+                break;
+            }
+            case Node::AssignExpressionNode : {
+                this->write<uint8_t>(static_cast<const AssignExpression*>(node)->operation());
+                break;
+            }
+            case Node::CrementNode : {
+                const Crement* crement = static_cast<const Crement*>(node);
+                this->write<uint8_t>(crement->operation());
+                this->write<uint8_t>(crement->post());
+                break;
+            }
+            case Node::UnaryOperatorNode : {
+                this->write<uint8_t>(static_cast<const UnaryOperator*>(node)->operation());
+                break;
+            }
+            case Node::BinaryOperatorNode : {
+                this->write<uint8_t>(static_cast<const BinaryOperator*>(node)->operation());
+                break;
+            }
+            case Node::CastNode : {
+                this->write<uint8_t>(static_cast<const Cast*>(node)->type());
+                break;
+            }
+            case Node::AttributeNode : {
+                const Attribute* attrib = static_cast<const Attribute*>(node);
+                this->string(attrib->name());
+                this->write<uint8_t>(attrib->type());
+                this->write<uint8_t>(attrib->inferred());
+                break;
+            }
+            case Node::FunctionCallNode : {
+                const FunctionCall* call = static_cast<const FunctionCall*>(node);
+                this->string(call->name());
+                this->varint(call->numArgs());
+                break;
+            }
+            case Node::ExternalVariableNode : {
+                const ExternalVariable* external = static_cast<const ExternalVariable*>(node);
+                this->string(external->name());
+                this->write<uint8_t>(external->type());
+                break;
+            }
+            case Node::DeclareLocalNode : {
+                this->write<uint8_t>(static_cast<const DeclareLocal*>(node)->type());
+                break;
+            }
+            case Node::LocalNode : {
+                this->string(static_cast<const Local*>(node)->name());
+                break;
+            }
+            case Node::ValueBoolNode : {
+                this->write(static_cast<const Value<bool>*>(node)->asContainerType());
+                break;
+            }
+            case Node::ValueInt16Node : {
+                this->varint(static_cast<const Value<int16_t>*>(node)->asContainerType());
+                break;
+            }
+            case Node::ValueInt32Node : {
+                this->varint(static_cast<const Value<int32_t>*>(node)->asContainerType());
+                break;
+            }
+            case Node::ValueInt64Node : {
+                this->varint(static_cast<const Value<int64_t>*>(node)->asContainerType());
+                break;
+            }
+            case Node::ValueFloatNode : {
+                this->write(static_cast<const Value<float>*>(node)->asContainerType());
+                break;
+            }
+            case Node::ValueDoubleNode : {
+                this->write(static_cast<const Value<double>*>(node)->asContainerType());
+                break;
+            }
+            case Node::ValueStrNode : {
+                this->string(static_cast<const Value<std::string>*>(node)->value());
+                break;
+            }
+            default : {
+                OPENVDB_THROW(IoError, "Unable to serialize AST node \""
+                    << node->nodename() << "\"");
+            }
+        }
+
+        for (size_t i = 0; i < node->children(); ++i) {
+            this->node(node->child(i));
+        }
+        --mDepth;
+    }
+
+    const ax::Logger* mLogger;
+    std::vector<char> mData;
+    std::unordered_map<std::string, uint32_t> mStringIndices;
+    std::vector<const std::string*> mStrings;
+    uint32_t mNodes = 0;
+    uint32_t mDepth = 0;
+};
+
+/// @brief  Reconstructs nodes from serialized data, validating every read
+///   against the bounds of the data and the expected types of children
+struct Reader
+{
+    Reader(const char* data, const size_t size)
+        : mIter(data), mEnd(data + size) {}
+
+    template <typename T>
+    inline T read()
+    {
+        if (static_cast<size_t>(mEnd - mIter) < sizeof(T)) {
+            OPENVDB_THROW(IoError, "Unexpected end of serialized AST data.");
+        }
+        T value;
+        std::memcpy(&value, mIter, sizeof(T));
+        mIter += sizeof(T);
+        return value;
+    }
+
+    inline uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (uint32_t shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = this->read<uint8_t>();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        OPENVDB_THROW(IoError, "Invalid integer in serialized AST data.");
+    }
+
+    template <typename TokenT>
+    inline TokenT token(const TokenT last)
+    {
+        const uint8_t value = this->read<uint8_t>();
+        if (value > static_cast<uint8_t>(last)) {
+            OPENVDB_THROW(IoError, "Invalid token in serialized AST data.");
+        }
+        return static_cast<TokenT>(value);
+    }
+
+    inline const std::string& string()
+    {
+        const uint64_t idx = this->varint();
+        if (idx >= mStrings.size()) {
+            OPENVDB_THROW(IoError, "Invalid string in serialized AST data.");
+        }
+        return mStrings[idx];
+    }
+
+    inline uint32_t size()
+    {
+        // every node is at least a single byte, reject sizes which can't be
+        // satisfied by the remaining data before allocating for them
+        const uint64_t size = this->varint();
+        if (size > static_cast<size_t>(mEnd - mIter)) {
+            OPENVDB_THROW(IoError, "Invalid list size in serialized AST data.");
+        }
+        return static_cast<uint32_t>(size);
+    }
+
+    template <typename NodeT>
+    inline std::unique_ptr<NodeT> child(const bool optional = false)
+    {
+        Node::UniquePtr node = this->node();
+        if (!node) {
+            if (!optional) {
+                OPENVDB_THROW(IoError, "Missing node in serialized AST data.");
+            }
+            return nullptr;
+        }
+        NodeT* typed = dynamic_cast<NodeT*>(node.get());
+        if (!typed) {
+            OPENVDB_THROW(IoError, "Unexpected node \"" << node->nodename()
+                << "\" in serialized AST data.");
+        }
+        node.release();
+        return std::unique_ptr<NodeT>(typed);
+    }
+
+    template <typename NodeT>
+    inline std::vector<NodeT*> list(const uint32_t size)
+    {
+        std::vector<std::unique_ptr<NodeT>> nodes;
+        nodes.reserve(size);
+        for (uint32_t i = 0; i < size; ++i) {
+            nodes.emplace_back(this->child<NodeT>());
+        }
+        std::vector<NodeT*> released;
+        released.reserve(size);
+        for (auto& node : nodes) released.emplace_back(node.release());
+        return released;
+    }
+
+    Node::UniquePtr node()
+    {
+        const uint8_t type = this->read<uint8_t>();
+        if (type == sNullNode) return nullptr;
+        if (type > static_cast<uint8_t>(Node::ValueStrNode)) {
+            OPENVDB_THROW(IoError, "Invalid node type in serialized AST data.");
+        }
+        if (++mDepth > MaxSerializedDepth) {
+            OPENVDB_THROW(IoError, "Serialized AST data exceeds the maximum "
+                "depth of " << MaxSerializedDepth << " nodes.");
+        }
+
+        ++mNodes;
+        ax::Logger::CodeLocation location(0, 0);
+        if (mLocations) {
+            location.first = this->varint();
+            location.second = this->varint();
+        }
+
+        Node::UniquePtr node;
+
+        switch (static_cast<Node::NodeType>(type)) {
+            case Node::TreeNode : {
+                auto block = this->child<Block>();
+                node.reset(new Tree(block.release()));
+                break;
+            }
+            case Node::StatementListNode : {
+                node.reset(new StatementList(this->list<Statement>(this->size())));
+                break;
+            }
+            case Node::BlockNode : {
+                node.reset(new Block(this->list<Statement>(this->size())));
+                break;
+            }
+            case Node::ConditionalStatementNode : {
+                auto condition = this->child<Expression>();
+                auto trueBranch = this->child<Block>();
+                auto falseBranch = this->child<Block>(/*optional*/true);
+                node.reset(new ConditionalStatement(condition.release(),
+                    trueBranch.release(), falseBranch.release()));
+                break;
+            }
+            case Node::CommaOperatorNode : {
+                node.reset(new CommaOperator(this->list<Expression>(this->size())));
+                break;
+            }
+            case Node::LoopNode : {
+                const tokens::LoopToken loop = this->token(tokens::WHILE);
+                auto condition = this->child<Statement>();
+                auto body = this->child<Block>();
+                auto init = this->child<Statement>(/*optional*/true);
+                auto iter = this->child<Expression>(/*optional*/true);
+                node.reset(new Loop(loop, condition.release(), body.release(),
+                    init.release(), iter.release()));
+                break;
+            }
+            case Node::KeywordNode : {
+                node.reset(new Keyword(this->token(tokens::CONTINUE)));
+                break;
+            }
+            case Node::AssignExpressionNode : {
+                const tokens::OperatorToken op = this->token(tokens::BITOREQUALS);
+                auto lhs = this->child<Expression>();
+                auto rhs = this->child<Expression>();
+                node.reset(new AssignExpression(lhs.release(), rhs.release(), op));
+                break;
+            }
+            case Node::CrementNode : {
+                const Crement::Operation op = this->token(Crement::Decrement);
+                const bool post = this->read<uint8_t>();
+                auto expr = this->child<Expression>();
+                node.reset(new Crement(expr.release(), op, post));
+                break;
+            }
+            case Node::UnaryOperatorNode : {
+                const tokens::OperatorToken op = this->token(tokens::BITOREQUALS);
+                auto expr = this->child<Expression>();
+                node.reset(new UnaryOperator(expr.release(), op));
+                break;
+            }
+            case Node::BinaryOperatorNode : {
+                const tokens::OperatorToken op = this->token(tokens::BITOREQUALS);
+                auto left = this->child<Expression>();
+                auto right = this->child<Expression>();
+                node.reset(new BinaryOperator(left.release(), right.release(), op));
+                break;
+            }
+            case Node::TernaryOperatorNode : {
+                auto condition = this->child<Expression>();
+                auto trueBranch = this->child<Expression>(/*optional*/true);
+                auto falseBranch = this->child<Expression>();
+                node.reset(new TernaryOperator(condition.release(),
+                    trueBranch.release(), falseBranch.release()));
+                break;
+            }
+            case Node::CastNode : {
+                const tokens::CoreType type = this->token(tokens::UNKNOWN);
+                auto expr = this->child<Expression>();
+                node.reset(new Cast(expr.release(), type));
+                break;
+            }
+            case Node::AttributeNode : {
+                const std::string& name = this->string();
+                const tokens::CoreType type = this->token(tokens::UNKNOWN);
+                const bool inferred = this->read<uint8_t>();
+                node.reset(new Attribute(name, type, inferred));
+                break;
+            }
+            case Node::FunctionCallNode : {
+                const std::string& name = this->string();
+                node.reset(new FunctionCall(name, this->list<Expression>(this->size())));
+                break;
+            }
+            case Node::ExternalVariableNode : {
+                const std::string& name = this->string();
+                node.reset(new ExternalVariable(name, this->token(tokens::UNKNOWN)));
+                break;
+            }
+            case Node::DeclareLocalNode : {
+                const tokens::CoreType type = this->token(tokens::UNKNOWN);
+                auto local = this->child<Local>();
+                auto init = this->child<Expression>(/*optional*/true);
+                node.reset(new DeclareLocal(type, local.release(), init.release()));
+                break;
+            }
+            case Node::ArrayPackNode : {
+                node.reset(new ArrayPack(this->list<Expression>(this->size())));
+                break;
+            }
+            case Node::ArrayUnpackNode : {
+                auto component0 = this->child<Expression>();
+                auto component1 = this->child<Expression>(/*optional*/true);
+                auto expr = this->child<Expression>();
+                node.reset(new ArrayUnpack(expr.release(),
+                    component0.release(), component1.release()));
+                break;
+            }
+            case Node::LocalNode : {
+                node.reset(new Local(this->string()));
+                break;
+            }
+            case Node::ValueBoolNode : {
+                node.reset(new Value<bool>(this->read<Value<bool>::ContainerType>()));
+                break;
+            }
+            case Node::ValueInt16Node : {
+                node.reset(new Value<int16_t>(this->varint()));
+                break;
+            }
+            case Node::ValueInt32Node : {
+                node.reset(new Value<int32_t>(this->varint()));
+                break;
+            }
+            case Node::ValueInt64Node : {
+                node.reset(new Value<int64_t>(this->varint()));
+                break;
+            }
+            case Node::ValueFloatNode : {
+                node.reset(new Value<float>(this->read<Value<float>::ContainerType>()));
+                break;
+            }
+            case Node::ValueDoubleNode : {
+                node.reset(new Value<double>(this->read<Value<double>::ContainerType>()));
+                break;
+            }
+            case Node::ValueStrNode : {
+                node.reset(new Value<std::string>(this->string()));
+                break;
+            }
+        }
+
+        assert(node);
+        if (mLocations) mNodeLocations.emplace_back(node.get(), location);
+        --mDepth;
+        return node;
+    }
+
+    const char* mIter;
+    const char* const mEnd;
+    bool mLocations = false;
+    std::vector<std::string> mStrings;
+    std::vector<std::pair<const Node*, ax::Logger::CodeLocation>> mNodeLocations;
+    uint32_t mNodes = 0;
+    uint32_t mDepth = 0;
+};
+
+}
+
+void serialize(const ast::Tree& tree, std::ostream& os, const ax::Logger* logger)
+{
+    Writer writer(logger);
+    writer.node(&tree);
+
+    uint32_t flags = 0;
+    if (logger) flags |= Locations;
+    if (isBigEndian()) flags |= BigEndian;
+
+    os.write(sMagic, sizeof(sMagic));
+    const uint32_t header[4] = {
+        SerializeVersion, flags, writer.mNodes,
+        static_cast<uint32_t>(writer.mStrings.size())
+    };
+    os.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    Writer strings(nullptr);
+    for (const std::string* str : writer.mStrings) {
+        strings.varint(str->size());
+        strings.mData.insert(strings.mData.end(), str->begin(), str->end());
+    }
+
+    os.write(strings.mData.data(), strings.mData.size());
+    os.write(writer.mData.data(), writer.mData.size());
+}
+
+openvdb::ax::ast::Tree::ConstPtr
+deserialize(const char* data, const size_t size, ax::Logger& logger)
+{
+    Reader reader(data, size);
+
+    if (size < sizeof(sMagic) ||
+        std::memcmp(data, sMagic, sizeof(sMagic)) != 0) {
+        OPENVDB_THROW(IoError, "Data is not a serialized AST.");
+    }
+    reader.mIter += sizeof(sMagic);
+
+    const uint32_t version = reader.read<uint32_t>();
+    const uint32_t flags = reader.read<uint32_t>();
+    if (static_cast<bool>(flags & BigEndian) != isBigEndian()) {
+        OPENVDB_THROW(IoError, "Serialized AST data was written on a host "
+            "with a different byte order.");
+    }
+    if (version != SerializeVersion) {
+        OPENVDB_THROW(IoError, "Unsupported serialized AST version "
+            << version << ", expected version " << SerializeVersion << ".");
+    }
+    reader.mLocations = flags & Locations;
+
+    const uint32_t nodes = reader.read<uint32_t>();
+    const uint32_t strings = reader.read<uint32_t>();
+    if (strings > size) {
+        OPENVDB_THROW(IoError, "Serialized AST data is corrupt.");
+    }
+    reader.mStrings.reserve(strings);
+    for (uint32_t i = 0; i < strings; ++i) {
+        const uint32_t length = reader.size();
+        reader.mStrings.emplace_back(reader.mIter, length);
+        reader.mIter += length;
+    }
+
+    // allocate the nodes of the tree together, as with parsed trees
+    Tree::UniquePtr tree;
+    {
+        NodeArena arena;
+        NodeArena::Scope scope(arena);
+        reader.mNodeLocations.reserve(reader.mLocations ? nodes : 0);
+        tree = reader.child<Tree>();
+    }
+
+    if (reader.mIter != reader.mEnd || reader.mNodes != nodes) {
+        OPENVDB_THROW(IoError, "Serialized AST data is corrupt.");
+    }
+
+    for (const auto& location : reader.mNodeLocations) {
+        logger.addNodeLocation(location.first, location.second);
+    }
+
+    Tree::ConstPtr ptr(tree.release());
+    logger.setSourceTree(ptr);
+    return ptr;
+}
+
+openvdb::ax::ast::Tree::Ptr
+deserialize(const char* data, const size_t size)
+{
+    openvdb::ax::Logger logger;
+    openvdb::ax::ast::Tree::ConstPtr constTree = deserialize(data, size, logger);
+    return std::const_pointer_cast<openvdb::ax::ast::Tree>(constTree);
+}
+
+} // namespace ast
+} // namespace ax
+
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
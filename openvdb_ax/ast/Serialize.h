@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file ast/Serialize.h
+///
+/// @brief  Methods for writing and reading abstract syntax trees to and from a
+///   compact binary format. Serialized trees can be shipped in place of AX
+///   code and loaded without invoking the parser.
+///
+/// @details The format is a small header followed by a table of all unique
+///   strings in the tree (names and string literals) and the nodes of the
+///   tree in depth first, pre-order. Each node is a single byte type followed
+///   by, optionally, its line and column number in the source code and its
+///   data. Integers are variable length encoded, so most take a single
+///   byte. Nodes are read directly from a contiguous block of memory with no
+///   alignment requirements, so serialized trees may be memory mapped.
+///   Serialized data is only readable with the same format version and
+///   on hosts with the same byte order as the host it was written on.
+///
+
+#ifndef OPENVDB_AX_AST_SERIALIZE_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_AST_SERIALIZE_HAS_BEEN_INCLUDED
+
+#include "AST.h"
+#include "../compiler/Logger.h"
+
+#include <openvdb/version.h>
+
+#include <iosfwd>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace ast {
+
+/// @brief  The current version of the binary AST format. Data written with a
+///         different version cannot be deserialized.
+constexpr uint32_t SerializeVersion = 1;
+
+/// @brief  The maximum depth of the nodes of a tree which can be serialized
+///         and deserialized. Nodes are read recursively, so this bounds the
+///         stack used when reading untrusted data.
+constexpr uint32_t MaxSerializedDepth = 4096;
+
+/// @brief  Write a tree to a stream in the binary AST format.
+/// @note   A runtime exception (openvdb::IoError) is thrown if the tree is
+///         deeper than MaxSerializedDepth, as it could not be deserialized.
+///
+/// @param tree    The tree to serialize
+/// @param os      The stream to write to. Should be opened in binary mode
+/// @param logger  An optional logger which was used to parse the tree. If
+///                provided, the line and column numbers of every node are
+///                also serialized
+///
+void serialize(const ast::Tree& tree, std::ostream& os,
+    const ax::Logger* logger = nullptr);
+
+/// @brief  Construct an abstract syntax tree from data written with
+///         ast::serialize(). If the data contains line and column numbers,
+///         these are added to the logger so that errors and warnings in later
+///         stages of compilation can report locations, as they would for a
+///         parsed tree.
+/// @note   A runtime exception (openvdb::IoError) is thrown if the data is not
+///         a valid or compatible serialized tree.
+///
+/// @return A shared pointer to a valid const AST
+///
+/// @param data    Pointer to the start of the serialized data
+/// @param size    The size of the serialized data in bytes
+/// @param logger  The logger to populate with node locations
+///
+openvdb::ax::ast::Tree::ConstPtr
+deserialize(const char* data, const size_t size, ax::Logger& logger);
+
+/// @brief  Construct an abstract syntax tree from data written with
+///         ast::serialize().
+/// @note   A runtime exception (openvdb::IoError) is thrown if the data is not
+///         a valid or compatible serialized tree.
+///
+/// @return A shared pointer to a valid AST
+///
+/// @param data    Pointer to the start of the serialized data
+/// @param size    The size of the serialized data in bytes
+///
+openvdb::ax::ast::Tree::Ptr
+deserialize(const char* data, const size_t size);
+
+} // namespace ast
+} // namespace ax
+
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_AST_SERIALIZE_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
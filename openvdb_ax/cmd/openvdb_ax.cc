@@ -43,6 +43,7 @@
 #include <openvdb_ax/compiler/Compiler.h>
 #include <openvdb_ax/compiler/AttributeRegistry.h>
 #include <openvdb_ax/compiler/CompilerOptions.h>
+#include <openvdb_ax/compiler/ObjectBundle.h>
 #include <openvdb_ax/compiler/PointExecutable.h>
 #include <openvdb_ax/compiler/VolumeExecutable.h>
 #include <openvdb_ax/compiler/Logger.h>
@@ -64,13 +65,18 @@ const char* gProgName = "";
 void usage [[noreturn]] (int exitStatus = EXIT_FAILURE)
 {
     std::cerr <<
-    "Usage: " << gProgName << " [input.vdb [output.vdb] | analyze] [-s \"string\" | -f file.txt] [OPTIONS]\n" <<
+    "Usage: " << gProgName << " [input.vdb [output.vdb] | analyze] [-s \"string\" | -f file.txt | -b file.axb] [OPTIONS]\n" <<
     "Which: executes a string or file containing a code snippet on an input.vdb file\n\n" <<
     "Options:\n" <<
     "    -s snippet       execute code snippet on the input.vdb file\n" <<
     "    -f file.txt      execute text file containing a code snippet on the input.vdb file\n" <<
+    "    -b file.axb      execute an object bundle written with --emit-bundle on the input.vdb file. May\n" <<
+    "                     be provided twice to execute both a points and a volumes bundle\n" <<
     "    -v               verbose (print timing and diagnostics)\n" <<
     "    --opt level      set an optimization level on the generated IR [NONE, O0, O1, O2, Os, Oz, O3]\n" <<
+    "    --target cpu     set the target cpu of the generated code [HOST, GENERIC, AVX2, AVX512]\n" <<
+    "    --fast-math lvl  set the floating point optimization level [NONE, CONTRACT, RELAXED, FAST]\n" <<
+    "    --vector-library lib  set the vector math library of vectorized math functions [NONE, AX, SVML]\n" <<
     "    --werror         set warnings as errors\n" <<
     "    --max-errors n   sets the maximum number of error messages to n, a value of 0 (default) allows all error messages\n" <<
     "    analyze          parse the provided code and enter analysis mode\n" <<
@@ -80,6 +86,13 @@ void usage [[noreturn]] (int exitStatus = EXIT_FAILURE)
     "      --try-compile [points|volumes] \n" <<
     "                        attempt to compile the provided code for points or volumes, or both if no\n" <<
     "                        additional option is provided, reporting any failures or success.\n" <<
+    "      --emit-obj points|volumes file.o\n" <<
+    "                        compile the provided code for points or volumes and write the optimized\n" <<
+    "                        relocatable object code to file.o\n" <<
+    "      --emit-bundle points|volumes file.axb\n" <<
+    "                        compile the provided code for points or volumes and write an object bundle\n" <<
+    "                        to file.axb. Bundles hold the object code and the attribute and external\n" <<
+    "                        variable bindings required to execute it without recompiling (see -b)\n" <<
     "    functions        enter function mode to query available function information\n" <<
     "      --list [name]     list all available functions, their documentation and their signatures.\n" <<
     "                        optionally only list functions which whose name includes a provided string.\n" <<
@@ -104,18 +117,30 @@ struct ProgOptions
 
     // Execute options
     std::unique_ptr<std::string> mInputCode = nullptr;
+    std::vector<std::string> mInputBundleFiles;
     std::string mInputVDBFile = "";
     std::string mOutputVDBFile = "";
     bool mVerbose = false;
     openvdb::ax::CompilerOptions::OptLevel mOptLevel =
         openvdb::ax::CompilerOptions::OptLevel::O3;
+    openvdb::ax::CompilerOptions::TargetCPU mTargetCPU =
+        openvdb::ax::CompilerOptions::TargetCPU::HOST;
+    openvdb::ax::CompilerOptions::FastMath mFastMath =
+        openvdb::ax::CompilerOptions::FastMath::NONE;
+    openvdb::ax::CompilerOptions::VectorLibrary mVectorLibrary =
+        openvdb::ax::CompilerOptions::VectorLibrary::NONE;
 
     // Analyze options
     bool mPrintAST = false;
     bool mReprint = false;
     bool mAttribRegPrint = false;
     bool mInitCompile = false;
+    bool mTryCompile = false;
     Compilation mCompileFor = All;
+    Compilation mEmitObjFor = All;
+    std::string mEmitObjFile = "";
+    Compilation mEmitBundleFor = All;
+    std::string mEmitBundleFile = "";
 
     // Function Options
     bool mFunctionList = false;
@@ -134,11 +159,12 @@ inline std::string modeString(const ProgOptions::Mode mode)
 }
 
 ProgOptions::Compilation
-tryCompileStringToCompilation(const std::string& str)
+tryCompileStringToCompilation(const std::string& str,
+    const std::string& option = "--try-compile")
 {
     if (str == "points")   return ProgOptions::Points;
     if (str == "volumes")  return ProgOptions::Volumes;
-    OPENVDB_LOG_FATAL("invalid option given for --try-compile level");
+    OPENVDB_LOG_FATAL("invalid option given for " << option << " level");
     usage();
 }
 
@@ -170,6 +196,73 @@ optLevelToString(const openvdb::ax::CompilerOptions::OptLevel level)
     }
 }
 
+openvdb::ax::CompilerOptions::TargetCPU
+targetStringToCPU(const std::string& str)
+{
+    if (str == "HOST")    return openvdb::ax::CompilerOptions::TargetCPU::HOST;
+    if (str == "GENERIC") return openvdb::ax::CompilerOptions::TargetCPU::GENERIC;
+    if (str == "AVX2")    return openvdb::ax::CompilerOptions::TargetCPU::AVX2;
+    if (str == "AVX512")  return openvdb::ax::CompilerOptions::TargetCPU::AVX512;
+    OPENVDB_LOG_FATAL("invalid option given for --target cpu");
+    usage();
+}
+
+inline std::string
+targetCPUToString(const openvdb::ax::CompilerOptions::TargetCPU target)
+{
+    switch (target) {
+        case  openvdb::ax::CompilerOptions::TargetCPU::HOST : return "HOST";
+        case  openvdb::ax::CompilerOptions::TargetCPU::GENERIC : return "GENERIC";
+        case  openvdb::ax::CompilerOptions::TargetCPU::AVX2 : return "AVX2";
+        case  openvdb::ax::CompilerOptions::TargetCPU::AVX512 : return "AVX512";
+        default : return "";
+    }
+}
+
+openvdb::ax::CompilerOptions::FastMath
+fastMathStringToLevel(const std::string& str)
+{
+    if (str == "NONE")     return openvdb::ax::CompilerOptions::FastMath::NONE;
+    if (str == "CONTRACT") return openvdb::ax::CompilerOptions::FastMath::CONTRACT;
+    if (str == "RELAXED")  return openvdb::ax::CompilerOptions::FastMath::RELAXED;
+    if (str == "FAST")     return openvdb::ax::CompilerOptions::FastMath::FAST;
+    OPENVDB_LOG_FATAL("invalid option given for --fast-math level");
+    usage();
+}
+
+inline std::string
+fastMathLevelToString(const openvdb::ax::CompilerOptions::FastMath level)
+{
+    switch (level) {
+        case  openvdb::ax::CompilerOptions::FastMath::NONE : return "NONE";
+        case  openvdb::ax::CompilerOptions::FastMath::CONTRACT : return "CONTRACT";
+        case  openvdb::ax::CompilerOptions::FastMath::RELAXED : return "RELAXED";
+        case  openvdb::ax::CompilerOptions::FastMath::FAST : return "FAST";
+        default : return "";
+    }
+}
+
+openvdb::ax::CompilerOptions::VectorLibrary
+vectorLibraryStringToLibrary(const std::string& str)
+{
+    if (str == "NONE") return openvdb::ax::CompilerOptions::VectorLibrary::NONE;
+    if (str == "AX")   return openvdb::ax::CompilerOptions::VectorLibrary::AX;
+    if (str == "SVML") return openvdb::ax::CompilerOptions::VectorLibrary::SVML;
+    OPENVDB_LOG_FATAL("invalid option given for --vector-library lib");
+    usage();
+}
+
+inline std::string
+vectorLibraryToString(const openvdb::ax::CompilerOptions::VectorLibrary lib)
+{
+    switch (lib) {
+        case  openvdb::ax::CompilerOptions::VectorLibrary::NONE : return "NONE";
+        case  openvdb::ax::CompilerOptions::VectorLibrary::AX : return "AX";
+        case  openvdb::ax::CompilerOptions::VectorLibrary::SVML : return "SVML";
+        default : return "";
+    }
+}
+
 void loadSnippetFile(const std::string& fileName, std::string& textString)
 {
     std::ifstream in(fileName.c_str(), std::ios::in | std::ios::binary);
@@ -346,6 +439,9 @@ main(int argc, char *argv[])
                 multiSnippet |= static_cast<bool>(opts.mInputCode);
                 opts.mInputCode.reset(new std::string());
                 loadSnippetFile(argv[i], *opts.mInputCode);
+            } else if (parser.check(i, "-b")) {
+                ++i;
+                opts.mInputBundleFiles.emplace_back(argv[i]);
             } else if (parser.check(i, "-v", 0)) {
                 opts.mVerbose = true;
             } else if (parser.check(i, "--max-errors")) {
@@ -371,13 +467,31 @@ main(int argc, char *argv[])
                 opts.mAttribRegPrint = true;
             } else if (parser.check(i, "--try-compile", 0)) {
                 opts.mInitCompile = true;
+                opts.mTryCompile = true;
                 if (i + 1 >= argc) continue;
                 if (argv[i+1][0] == '-') continue;
                 ++i;
                 opts.mCompileFor = tryCompileStringToCompilation(argv[i]);
+            } else if (parser.check(i, "--emit-obj", 2)) {
+                opts.mInitCompile = true;
+                opts.mEmitObjFor = tryCompileStringToCompilation(argv[++i], "--emit-obj");
+                opts.mEmitObjFile = argv[++i];
+            } else if (parser.check(i, "--emit-bundle", 2)) {
+                opts.mInitCompile = true;
+                opts.mEmitBundleFor = tryCompileStringToCompilation(argv[++i], "--emit-bundle");
+                opts.mEmitBundleFile = argv[++i];
             } else if (parser.check(i, "--opt")) {
                 ++i;
                 opts.mOptLevel = optStringToLevel(argv[i]);
+            } else if (parser.check(i, "--target")) {
+                ++i;
+                opts.mTargetCPU = targetStringToCPU(argv[i]);
+            } else if (parser.check(i, "--fast-math")) {
+                ++i;
+                opts.mFastMath = fastMathStringToLevel(argv[i]);
+            } else if (parser.check(i, "--vector-library")) {
+                ++i;
+                opts.mVectorLibrary = vectorLibraryStringToLibrary(argv[i]);
             } else if (arg == "-h" || arg == "-help" || arg == "--help") {
                 usage(EXIT_SUCCESS);
             } else {
@@ -430,7 +544,9 @@ main(int argc, char *argv[])
             if (opts.mPrintAST) axlog("|ast out");
             if (opts.mReprint)  axlog("|reprint out");
             if (opts.mAttribRegPrint) axlog("|registry out");
-            if (opts.mInitCompile)  axlog("|compilation");
+            if (opts.mTryCompile)  axlog("|compilation");
+            if (!opts.mEmitObjFile.empty())  axlog("|object out");
+            if (!opts.mEmitBundleFile.empty())  axlog("|bundle out");
             axlog("|)");
         }
         axlog('\n');
@@ -438,6 +554,9 @@ main(int argc, char *argv[])
         if (opts.mMode == ProgOptions::Execute) {
             axlog("  vdb in  : \"" << opts.mInputVDBFile  << "\"\n");
             axlog("  vdb out : \"" << opts.mOutputVDBFile << "\"\n");
+            for (const std::string& file : opts.mInputBundleFiles) {
+                axlog("  bundle  : \"" << file << "\"\n");
+            }
         }
         if (opts.mMode == ProgOptions::Execute ||
             opts.mMode == ProgOptions::Analyze) {
@@ -464,7 +583,21 @@ main(int argc, char *argv[])
         axlog(std::flush);
     }
 
-    if (opts.mMode != ProgOptions::Functions) {
+    if (!opts.mInputBundleFiles.empty()) {
+        if (opts.mMode != ProgOptions::Execute) {
+            OPENVDB_LOG_FATAL("object bundles can only be provided for execution");
+            usage();
+        }
+        if (opts.mInputCode) {
+            OPENVDB_LOG_FATAL("expected either AX code or object bundles, not both");
+            usage();
+        }
+        if (opts.mInputBundleFiles.size() > 2) {
+            OPENVDB_LOG_FATAL("expected at most two object bundles");
+            usage();
+        }
+    }
+    else if (opts.mMode != ProgOptions::Functions) {
         if (!opts.mInputCode) {
             OPENVDB_LOG_FATAL("expected at least one AX file or a code snippet");
             usage();
@@ -540,16 +673,45 @@ main(int argc, char *argv[])
     logs.setPrintLines(true);
     logs.setNumberedOutput(true);
 
-    // parse
+    // read object bundles, or otherwise parse
 
-    axtimer();
-    axlog("[INFO] Parsing input code" << std::flush);
+    openvdb::ax::ObjectBundle::ConstPtr pointBundle, volumeBundle;
+    openvdb::ax::ast::Tree::ConstPtr syntaxTree;
+
+    if (!opts.mInputBundleFiles.empty()) {
+        axtimer();
+        axlog("[INFO] Reading object bundles" << std::flush);
+        for (const std::string& file : opts.mInputBundleFiles) {
+            std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+            if (!in) {
+                OPENVDB_LOG_FATAL("File Load Error: " << file);
+                usage();
+            }
+            openvdb::ax::ObjectBundle::ConstPtr bundle;
+            try {
+                bundle = openvdb::ax::ObjectBundle::read(in);
+            } catch (openvdb::Exception& e) {
+                OPENVDB_LOG_ERROR(e.what() << " (" << file << ")");
+                return EXIT_FAILURE;
+            }
+            if (bundle->type() == openvdb::ax::ObjectBundle::ExecutableType::POINTS) {
+                pointBundle = bundle;
+            }
+            else {
+                volumeBundle = bundle;
+            }
+        }
+        axlog(": " << axtime() << '\n');
+    }
+    else {
+        axtimer();
+        axlog("[INFO] Parsing input code" << std::flush);
 
-    const openvdb::ax::ast::Tree::ConstPtr syntaxTree =
-        openvdb::ax::ast::parse(opts.mInputCode->c_str(), logs);
+        syntaxTree = openvdb::ax::ast::parse(opts.mInputCode->c_str(), logs);
         axlog(": " << axtime() << '\n');
-    if (!syntaxTree) {
-        return EXIT_FAILURE;
+        if (!syntaxTree) {
+            return EXIT_FAILURE;
+        }
     }
 
     if (opts.mMode == ProgOptions::Analyze) {
@@ -580,8 +742,14 @@ main(int argc, char *argv[])
     axtimer();
     axlog("[INFO] Creating Compiler\n");
     axlog("[INFO] | Optimization Level [" << optLevelToString(opts.mOptLevel) << "]\n" << std::flush);
+    axlog("[INFO] | Target CPU [" << targetCPUToString(opts.mTargetCPU) << "]\n" << std::flush);
+    axlog("[INFO] | Fast Math [" << fastMathLevelToString(opts.mFastMath) << "]\n" << std::flush);
+    axlog("[INFO] | Vector Library [" << vectorLibraryToString(opts.mVectorLibrary) << "]\n" << std::flush);
     openvdb::ax::CompilerOptions compOpts;
     compOpts.mOptLevel = opts.mOptLevel;
+    compOpts.mTargetCPU = opts.mTargetCPU;
+    compOpts.mFastMath = opts.mFastMath;
+    compOpts.mVectorLibrary = opts.mVectorLibrary;
 
     openvdb::ax::Compiler::Ptr compiler =
         openvdb::ax::Compiler::create(compOpts);
@@ -610,8 +778,9 @@ main(int argc, char *argv[])
 
         bool psuccess = true;
 
-        if (opts.mCompileFor == ProgOptions::Compilation::All ||
-            opts.mCompileFor == ProgOptions::Compilation::Points) {
+        if (opts.mTryCompile &&
+            (opts.mCompileFor == ProgOptions::Compilation::All ||
+             opts.mCompileFor == ProgOptions::Compilation::Points)) {
             axtimer();
             axlog("[INFO] Compiling for VDB Points\n" << std::flush);
             try {
@@ -636,8 +805,9 @@ main(int argc, char *argv[])
 
         bool vsuccess = true;
 
-        if (opts.mCompileFor == ProgOptions::Compilation::All ||
-            opts.mCompileFor == ProgOptions::Compilation::Volumes) {
+        if (opts.mTryCompile &&
+            (opts.mCompileFor == ProgOptions::Compilation::All ||
+             opts.mCompileFor == ProgOptions::Compilation::Volumes)) {
             axtimer();
             axlog("[INFO] Compiling for VDB Volumes\n" << std::flush);
             try {
@@ -660,7 +830,61 @@ main(int argc, char *argv[])
             axlog("[INFO] | " << axtime() << '\n' << std::flush);
         }
 
-        return ((vsuccess && psuccess) ? EXIT_SUCCESS : EXIT_FAILURE);
+        // compile ahead of time and write the object code
+
+        auto emit = [&](const ProgOptions::Compilation type,
+            const std::string& file,
+            const bool bundle) -> bool
+        {
+            const bool points = type == ProgOptions::Compilation::Points;
+            axtimer();
+            axlog("[INFO] Compiling " << (bundle ? "object bundle" : "object code")
+                << " for VDB " << (points ? "Points" : "Volumes") << '\n' << std::flush);
+
+            openvdb::ax::ObjectBundle::Ptr objects;
+            try {
+                if (points) {
+                    objects = compiler->compileObject
+                        <openvdb::ax::PointExecutable>(*syntaxTree, logs, customData);
+                }
+                else {
+                    objects = compiler->compileObject
+                        <openvdb::ax::VolumeExecutable>(*syntaxTree, logs, customData);
+                }
+            }
+            catch (std::exception& e) {
+                axlog("[INFO] Fatal error!\n");
+                OPENVDB_LOG_ERROR(e.what());
+                return false;
+            }
+
+            if (!objects) {
+                axlog("[INFO] Compilation error(s)!\n");
+                return false;
+            }
+
+            std::ofstream out(file.c_str(), std::ios::out | std::ios::binary);
+            if (bundle) objects->write(out);
+            else out.write(objects->object().data(), objects->object().size());
+            if (!out) {
+                OPENVDB_LOG_ERROR("File Write Error: " << file);
+                return false;
+            }
+
+            axlog("[INFO] | Wrote \"" << file << "\"\n");
+            axlog("[INFO] | " << axtime() << '\n' << std::flush);
+            return true;
+        };
+
+        bool esuccess = true;
+        if (!opts.mEmitObjFile.empty()) {
+            esuccess &= emit(opts.mEmitObjFor, opts.mEmitObjFile, /*bundle*/false);
+        }
+        if (!opts.mEmitBundleFile.empty()) {
+            esuccess &= emit(opts.mEmitBundleFor, opts.mEmitBundleFile, /*bundle*/true);
+        }
+
+        return ((vsuccess && psuccess && esuccess) ? EXIT_SUCCESS : EXIT_FAILURE);
     }
 
     // Execute points
@@ -674,13 +898,28 @@ main(int argc, char *argv[])
 
         axtimer();
         try {
-            axlog("[INFO] Compiling for VDB Points\n" << std::flush);
-            pointExe = compiler->compile<openvdb::ax::PointExecutable>(*syntaxTree, logs, customData);
+            if (pointBundle) {
+                axlog("[INFO] Loading object bundle for VDB Points\n" << std::flush);
+                pointExe = openvdb::ax::PointExecutable::load(*pointBundle, customData);
+            }
+            else if (syntaxTree) {
+                axlog("[INFO] Compiling for VDB Points\n" << std::flush);
+                pointExe = compiler->compile<openvdb::ax::PointExecutable>(*syntaxTree, logs, customData);
+            }
+            else {
+                OPENVDB_LOG_FATAL("no object bundle for VDB Points was provided");
+                return EXIT_FAILURE;
+            }
         } catch (std::exception& e) {
             OPENVDB_LOG_FATAL("Fatal error!\nErrors:\n" << e.what());
             return EXIT_FAILURE;
         }
 
+        // the tree is only used to query the code, so use the tree held
+        // by the bundle if one was loaded
+        const openvdb::ax::ast::Tree::ConstPtr pointTree =
+            pointBundle ? pointBundle->tree() : syntaxTree;
+
         if (pointExe) {
             axlog("[INFO] | Compilation successful");
             if (logs.hasWarning()) {
@@ -695,13 +934,21 @@ main(int argc, char *argv[])
         }
         axlog("[INFO] | " << axtime() << '\n' << std::flush);
 
+        // the volumes of the file can be sampled by the point kernels. Values
+        // rasterized by the point kernels are added to the volume of the same
+        // name if one exists, otherwise they are written out as new volumes
+        openvdb::GridCPtrVec volumes;
+        openvdb::GridPtrVec rasterized;
         size_t total = 0, count = 1;
-        if (opts.mVerbose) {
-            for (auto grid : *grids) {
-                if (!grid->isType<openvdb::points::PointDataGrid>()) continue;
+        for (auto grid : *grids) {
+            if (grid->isType<openvdb::points::PointDataGrid>()) {
                 ++total;
+                continue;
             }
+            volumes.emplace_back(grid);
+            rasterized.emplace_back(grid);
         }
+        const size_t existing = rasterized.size();
 
         for (auto grid : *grids) {
             if (!grid->isType<openvdb::points::PointDataGrid>()) continue;
@@ -713,8 +960,8 @@ main(int argc, char *argv[])
             ++count;
 
             try {
-                pointExe->execute(*points);
-                if (openvdb::ax::ast::callsFunction(*syntaxTree, "deletepoint")) {
+                pointExe->execute(*points, volumes, rasterized);
+                if (pointTree && openvdb::ax::ast::callsFunction(*pointTree, "deletepoint")) {
                     openvdb::points::deleteFromGroup(points->tree(), "dead", false, false);
                 }
             }
@@ -726,6 +973,8 @@ main(int argc, char *argv[])
             axlog("[INFO] | Execution success.\n");
             axlog("[INFO] | " << axtime() << '\n' << std::flush);
         }
+
+        grids->insert(grids->end(), rasterized.begin() + existing, rasterized.end());
     }
 
     // Execute volumes
@@ -737,8 +986,18 @@ main(int argc, char *argv[])
 
         openvdb::ax::VolumeExecutable::Ptr volumeExe;
         try {
-            axlog("[INFO] Compiling for VDB Points\n" << std::flush);
-            volumeExe = compiler->compile<openvdb::ax::VolumeExecutable>(*syntaxTree, logs, customData);
+            if (volumeBundle) {
+                axlog("[INFO] Loading object bundle for VDB Volumes\n" << std::flush);
+                volumeExe = openvdb::ax::VolumeExecutable::load(*volumeBundle, customData);
+            }
+            else if (syntaxTree) {
+                axlog("[INFO] Compiling for VDB Points\n" << std::flush);
+                volumeExe = compiler->compile<openvdb::ax::VolumeExecutable>(*syntaxTree, logs, customData);
+            }
+            else {
+                OPENVDB_LOG_FATAL("no object bundle for VDB Volumes was provided");
+                return EXIT_FAILURE;
+            }
         } catch (std::exception& e) {
             OPENVDB_LOG_FATAL("Fatal error!\nErrors:\n" << e.what());
             return EXIT_FAILURE;
@@ -49,6 +49,7 @@
 #include <llvm/IR/InlineAsm.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/Metadata.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/MathExtras.h>
 #include <llvm/Support/raw_os_ostream.h>
@@ -1215,6 +1216,20 @@ const FunctionGroup* ComputeGenerator::getFunction(const std::string &identifier
     return mFunctionRegistry.getOrInsert(identifier, mOptions, allowInternal);
 }
 
+bool ComputeGenerator::writesToArgument(const ast::FunctionCall& node, const size_t i)
+{
+    // unknown functions are reported during code generation
+    const FunctionGroup* const function = this->getFunction(node.name());
+    if (!function) return true;
+
+    // the matched declaration depends on the argument types, which aren't
+    // known until code generation, so check every declaration
+    for (const Function::Ptr& decl : function->list()) {
+        if (decl->writesToArgument(i, mContext)) return true;
+    }
+    return false;
+}
+
 template <typename ValueType>
 typename std::enable_if<std::is_integral<ValueType>::value, bool>::type
 ComputeGenerator::visit(const ast::Value<ValueType>* node)
@@ -1257,9 +1272,23 @@ bool ComputeGenerator::visit(const ast::ExternalVariable* node)
     llvm::Type* type = llvmTypeFromToken(node->type(), mContext);
     llvm::Value* address = mBuilder.CreateLoad(ptrToAddress);
     llvm::Value* value = mBuilder.CreateIntToPtr(address, type->getPointerTo(0));
+
+    // External data is not modified during execution. Mark the load as
+    // invariant so that it can be hoisted out of loops (such as the point
+    // range loop), regardless of any stores to attribute data. Non scalar
+    // values are copied into local memory to keep every read invariant.
+    llvm::LoadInst* load = mBuilder.CreateLoad(value);
+    load->setMetadata(llvm::LLVMContext::MD_invariant_load,
+        llvm::MDNode::get(mContext, llvm::None));
+
     if (type->isIntegerTy() || type->isFloatingPointTy()) {
-        value = mBuilder.CreateLoad(value);
+        value = load;
     }
+    else {
+        value = insertStaticAlloca(mBuilder, type);
+        mBuilder.CreateStore(load, value);
+    }
+
     mValues.push(value);
     return true;
 }
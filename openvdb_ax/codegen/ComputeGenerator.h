@@ -243,6 +243,12 @@ protected:
     const FunctionGroup* getFunction(const std::string& identifier,
             const bool allowInternal = false);
 
+    /// @brief  Returns whether the function called by the given node may
+    ///         modify its argument at index i. This is true if any declaration
+    ///         of the function may write to the argument, or if the function
+    ///         does not exist. Can be used with AttributeRegistry::create.
+    bool writesToArgument(const ast::FunctionCall& node, const size_t i);
+
     bool binaryExpression(llvm::Value*& result, llvm::Value* lhs, llvm::Value* rhs,
         const ast::tokens::OperatorToken op, const ast::Node* node);
     bool assignExpression(llvm::Value* lhs, llvm::Value*& rhs, const ast::Node* node);
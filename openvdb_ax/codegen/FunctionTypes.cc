@@ -207,6 +207,30 @@ Function::match(const std::vector<llvm::Type*>& inputs, llvm::LLVMContext& C) co
     return Implicit;
 }
 
+bool
+Function::writesToArgument(const size_t i, llvm::LLVMContext& C) const
+{
+    std::vector<llvm::Type*> types;
+    this->types(types, C);
+    if (i >= types.size()) return false;
+
+    // scalars are always passed by value
+    if (!types[i]->isPointerTy()) return false;
+
+    if (this->hasParamAttribute(i, llvm::Attribute::ReadOnly) ||
+        this->hasParamAttribute(i, llvm::Attribute::ReadNone)) return false;
+
+    if (mAttributes) {
+        const auto& attrs = mAttributes->mFnAttrs;
+        for (const llvm::Attribute::AttrKind attr : attrs) {
+            if (attr == llvm::Attribute::ReadOnly ||
+                attr == llvm::Attribute::ReadNone) return false;
+        }
+    }
+
+    return true;
+}
+
 void
 Function::print(llvm::LLVMContext& C,
     std::ostream& os,
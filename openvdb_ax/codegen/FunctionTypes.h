@@ -390,6 +390,16 @@ struct Function
     /// @param C       The LLVM Context
     virtual SignatureMatch match(const std::vector<llvm::Type*>& inputs, llvm::LLVMContext& C) const;
 
+    /// @brief  Returns whether this function may modify the argument at the
+    ///         given index of its AX signature. Scalars are passed by value and
+    ///         are never modified. Arrays and strings are passed by pointer and
+    ///         may be modified unless the parameter or function is marked as
+    ///         readonly or readnone.
+    /// @note   Returns false if the index is not a valid argument index.
+    /// @param i  The index of the argument
+    /// @param C  The LLVM Context
+    virtual bool writesToArgument(const size_t i, llvm::LLVMContext& C) const;
+
     /// @brief  The number of arguments that this function has
     inline size_t size() const { return mSize; }
 
@@ -559,6 +569,12 @@ public:
         return inputs.front();
     }
 
+    /// @brief  Override of writesToArgument which skips the SRET argument
+    bool writesToArgument(const size_t i, llvm::LLVMContext& C) const override
+    {
+        return DerivedFunction::writesToArgument(i + 1, C);
+    }
+
     /// @brief  Override of print to avoid printing out the SRET type
     void print(llvm::LLVMContext& C,
            std::ostream& os,
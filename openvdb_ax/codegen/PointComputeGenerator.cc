@@ -55,6 +55,8 @@
 #include <llvm/Pass.h>
 #include <llvm/Support/MathExtras.h>
 
+#include <unordered_map>
+
 namespace openvdb {
 OPENVDB_USE_VERSION_NAMESPACE
 namespace OPENVDB_VERSION_NAME {
@@ -72,7 +74,12 @@ PointKernel::argumentKeys()
         "point_index",
         "attribute_handles",
         "group_handles",
-        "leaf_data"
+        "leaf_data",
+        "attribute_layouts",
+        "reductions",
+        "neighbours",
+        "volumes",
+        "rasterization"
     }};
 
     return arguments;
@@ -164,7 +171,12 @@ AttributeRegistry::Ptr PointComputeGenerator::generate(const ast::Tree& tree)
 
         std::vector<llvm::Value*> args(kPointRangeArguments);
         args[argumentIndex] = incr;
-        mBuilder.CreateCall(mFunction, args);
+        llvm::CallInst* call = mBuilder.CreateCall(mFunction, args);
+
+        // Always inline the kernel into the range loop so that loop invariant
+        // code (e.g. external variable reads) can be hoisted out of the loop
+        call->addAttribute(llvm::AttributeList::FunctionIndex,
+            llvm::Attribute::AlwaysInline);
 
         llvm::Value* next = mBuilder.CreateAdd(incr, mBuilder.getInt64(1), "nextval");
         llvm::Value* endCondition = mBuilder.CreateICmpULT(incr, indexMinusOne, "endcond");
@@ -186,7 +198,10 @@ AttributeRegistry::Ptr PointComputeGenerator::generate(const ast::Tree& tree)
 
     // build the attribute registry
 
-    AttributeRegistry::Ptr registry = AttributeRegistry::create(tree);
+    AttributeRegistry::Ptr registry = AttributeRegistry::create(tree,
+        [this](const ast::FunctionCall& call, const size_t i) {
+            return this->writesToArgument(call, i);
+        });
 
     // Visit all attributes and allocate them in local IR memory - assumes attributes
     // have been verified by the ax compiler
@@ -203,12 +218,32 @@ AttributeRegistry::Ptr PointComputeGenerator::generate(const ast::Tree& tree)
         localTable->insert(data.tokenname(), value);
     }
 
-    // insert getters for read variables
+    // insert getters for read variables. Attributes which are always
+    // assigned to before being used are registered as write only. Read only
+    // attributes which are only used within a branch are deferred to the
+    // start of that branch so they aren't read for every point. Track the
+    // number of uses of each attribute once its getter exists so that
+    // unmodified attributes can be identified after code generation
+
+    mDeferredReads.clear();
+    const ast::Block* root = tree.child(0);
+    std::unordered_map<std::string, const ast::Block*> usageBlocks;
+    ast::attributeUsageBlock(tree, usageBlocks);
 
+    std::unordered_map<std::string, unsigned> getterUses;
     for (const AttributeRegistry::AccessData& data : registry->data()) {
         if (!data.reads()) continue;
         const std::string token = data.tokenname();
-        this->getAttributeValue(token, localTable->get(token));
+        if (!data.writes()) {
+            const ast::Block* block = usageBlocks[token];
+            if (block && block != root) {
+                mDeferredReads[block].emplace_back(token);
+                continue;
+            }
+        }
+        llvm::Value* value = localTable->get(token);
+        this->getAttributeValue(token, value);
+        getterUses[token] = value->getNumUses();
     }
 
     // full code generation
@@ -220,18 +255,40 @@ AttributeRegistry::Ptr PointComputeGenerator::generate(const ast::Tree& tree)
 
     std::vector<const AttributeRegistry::AccessData*> write;
     for (const AttributeRegistry::AccessData& access : registry->data()) {
-        if (access.writes()) write.emplace_back(&access);
+        if (!access.writes()) continue;
+        const std::string token = access.tokenname();
+        llvm::Value* value = localTable->get(token);
+
+        // Expected to be used more than one (i.e. should never be zero)
+        assert(value->hasNUsesOrMore(1));
+
+        // Check to see if this value is still being used - it may have
+        // been cleaned up due to returns. If the only uses are from the
+        // original get, the attribute is unmodified.
+        // @todo  The original get can also be optimized out in this case
+        auto iter = getterUses.find(token);
+        if (iter != getterUses.end() &&
+            value->getNumUses() <= iter->second) continue;
+
+        write.emplace_back(&access);
     }
+
     // if it doesn't write to any externally accessible data (i.e attributes)
     // then early exit
     if (write.empty()) return registry;
 
-    for (auto block = mFunction->begin(); block != mFunction->end(); ++block) {
+    // Collect the return blocks first - setting attributes may split blocks
 
+    std::vector<llvm::Instruction*> returns;
+    for (auto block = mFunction->begin(); block != mFunction->end(); ++block) {
         // Only inset set calls if theres a valid return instruction in this block
-
         llvm::Instruction* inst = block->getTerminator();
         if (!inst || !llvm::isa<llvm::ReturnInst>(inst)) continue;
+        returns.emplace_back(inst);
+    }
+
+    for (llvm::Instruction* inst : returns) {
+
         mBuilder.SetInsertPoint(inst);
 
         // Insert set attribute instructions before termination
@@ -241,24 +298,12 @@ AttributeRegistry::Ptr PointComputeGenerator::generate(const ast::Tree& tree)
             const std::string token = access->tokenname();
             llvm::Value* value = localTable->get(token);
 
-            // Expected to be used more than one (i.e. should never be zero)
-            assert(value->hasNUsesOrMore(1));
-
-            // Check to see if this value is still being used - it may have
-            // been cleaned up due to returns. If there's only one use, it's
-            // the original get of this attribute.
-            if (value->hasOneUse()) {
-                // @todo  The original get can also be optimized out in this case
-                // this->globals().remove(variable.first);
-                // mModule.getGlobalVariable(variable.first)->eraseFromParent();
-                continue;
-            }
-
             llvm::Type* type = value->getType()->getPointerElementType();
             llvm::Type* strType = LLVMType<AXString>::get(mContext);
             const bool usingString = type == strType;
 
             llvm::Value* handlePtr = this->attributeHandleFromToken(token);
+            llvm::Value* layoutPtr = this->attributeLayoutFromToken(token);
             const FunctionGroup* const function = this->getFunction("setattribute", true);
 
             // load the result (if its a scalar)
@@ -272,6 +317,7 @@ AttributeRegistry::Ptr PointComputeGenerator::generate(const ast::Tree& tree)
             // construct function arguments
             std::vector<llvm::Value*> args {
                 handlePtr, // handle
+                layoutPtr, // layout
                 pointidx, // point index
                 value // set value
             };
@@ -288,6 +334,20 @@ AttributeRegistry::Ptr PointComputeGenerator::generate(const ast::Tree& tree)
     return registry;
 }
 
+bool PointComputeGenerator::visit(const ast::Block* block)
+{
+    // insert any reads which have been deferred to this block
+    auto iter = mDeferredReads.find(block);
+    if (iter != mDeferredReads.end()) {
+        SymbolTable* localTable = this->mSymbolTables.getOrInsert(1);
+        for (const std::string& token : iter->second) {
+            this->getAttributeValue(token, localTable->get(token));
+        }
+    }
+
+    return ComputeGenerator::visit(block);
+}
+
 bool PointComputeGenerator::visit(const ast::Attribute* node)
 {
     const std::string globalName = node->tokenname();
@@ -335,13 +395,14 @@ void PointComputeGenerator::getAttributeValue(const std::string& globalName, llv
         mBuilder.CreateStore(string, lstrptr);
         mBuilder.CreateStore(size, lsize);
 
-        args.reserve(4);
+        args.reserve(5);
     }
     else {
-        args.reserve(3);
+        args.reserve(4);
     }
 
     args.emplace_back(handlePtr);
+    args.emplace_back(this->attributeLayoutFromToken(globalName));
     args.emplace_back(pointidx);
     args.emplace_back(location);
 
@@ -351,10 +412,8 @@ void PointComputeGenerator::getAttributeValue(const std::string& globalName, llv
     function->execute(args, mBuilder);
 }
 
-llvm::Value* PointComputeGenerator::attributeHandleFromToken(const std::string& token)
+llvm::Value* PointComputeGenerator::attributeIndexFromToken(const std::string& token)
 {
-    // Visiting an attribute - get the attribute handle out of a vector of void pointers
-
     // insert the attribute into the map of global variables and get a unique global representing
     // the location which will hold the attribute handle offset.
 
@@ -362,10 +421,17 @@ llvm::Value* PointComputeGenerator::attributeHandleFromToken(const std::string&
         (mModule.getOrInsertGlobal(token, LLVMType<int64_t>::get(mContext)));
     this->globals().insert(token, index);
 
+    return mBuilder.CreateLoad(index);
+}
+
+llvm::Value* PointComputeGenerator::attributeHandleFromToken(const std::string& token)
+{
+    // Visiting an attribute - get the attribute handle out of a vector of void pointers
+
     // index into the void* array of handles and load the value.
     // The result is a loaded void* value
 
-    index = mBuilder.CreateLoad(index);
+    llvm::Value* index = this->attributeIndexFromToken(token);
 
     llvm::Value* handles = extractArgument(mFunction, "attribute_handles");
     assert(handles);
@@ -375,6 +441,22 @@ llvm::Value* PointComputeGenerator::attributeHandleFromToken(const std::string&
     return mBuilder.CreateLoad(handlePtr);
 }
 
+llvm::Value* PointComputeGenerator::attributeLayoutFromToken(const std::string& token)
+{
+    // index into the array of attribute layouts, which shares the ordering
+    // of the attribute handles. The result is a void* to the layout
+
+    llvm::Value* index = this->attributeIndexFromToken(token);
+
+    llvm::Value* layouts = extractArgument(mFunction, "attribute_layouts");
+    assert(layouts);
+    llvm::Type* layoutType = LLVMType<AttributeLayout>::get(mContext);
+    layouts = mBuilder.CreatePointerCast(layouts, layoutType->getPointerTo());
+    llvm::Value* layoutPtr = mBuilder.CreateGEP(layouts, index);
+
+    return mBuilder.CreatePointerCast(layoutPtr, LLVMType<void*>::get(mContext));
+}
+
 } // namespace codegen_internal
 
 } // namespace codegen
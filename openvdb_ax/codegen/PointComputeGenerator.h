@@ -48,6 +48,10 @@
 
 #include <openvdb/version.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace openvdb {
 OPENVDB_USE_VERSION_NAMESPACE
 namespace OPENVDB_VERSION_NAME {
@@ -70,6 +74,20 @@ namespace codegen {
 ///                array of group handles
 ///           6) - A void pointer to a LeafLocalData object, used to track newly
 ///                initialized attributes and arrays
+///           7) - A void pointer to an array of AttributeLayout structs, one
+///                for each attribute handle, describing any directly
+///                accessible attribute data
+///           8) - A void pointer to the Reductions object of the executing
+///                thread, which accumulates the results of reduce functions
+///           9) - A void pointer to the PointNeighbours query object of the
+///                executing thread, used by neighbour query functions. This
+///                is null if the kernel does not query neighbours
+///          10) - A void pointer to the VolumeSamplers accessors of the
+///                executing thread, used by volume sampling functions. This
+///                is null if no volumes have been provided
+///          11) - A void pointer to the Rasterization object of the executing
+///                thread, which accumulates the values of rasterize(). This
+///                is null if no output grids have been provided
 ///
 struct PointKernel
 {
@@ -80,6 +98,11 @@ struct PointKernel
              uint64_t,
              void**,
              void**,
+             void*,
+             const void* const,
+             void*,
+             void*,
+             void*,
              void*);
 
     using FunctionTraitsT = codegen::FunctionTraits<Signature>;
@@ -90,6 +113,34 @@ struct PointKernel
     static std::string getDefaultName();
 };
 
+/// @brief  Describes the memory layout of a single point attribute array.
+///         Uncompressed attribute data which is stored with the same type as
+///         its AX representation can be read and written by the generated
+///         code directly, bypassing the attribute handles.
+/// @note   A null data pointer signals that the attribute must be accessed
+///         through its handle.
+struct AttributeLayout
+{
+    /// Pointer to the first value of the attribute array
+    void* mData = nullptr;
+    /// The number of values between consecutive points. This is zero for
+    /// uniform arrays
+    uint64_t mStride = 0;
+};
+
+template <>
+struct LLVMType<AttributeLayout>
+{
+    static inline llvm::StructType*
+    get(llvm::LLVMContext& C) {
+        const std::vector<llvm::Type*> types {
+            LLVMType<void*>::get(C),  // data
+            LLVMType<uint64_t>::get(C) // stride
+        };
+        return llvm::StructType::get(C, types);
+    }
+};
+
 /// @brief  An additonal function built by the PointComputeGenerator.
 ///         Currently both compute and compute range functions have the same
 ///         signature
@@ -98,6 +149,11 @@ struct PointRangeKernel : public PointKernel
     static std::string getDefaultName();
 };
 
+/// @brief  The internal _pointleaforigin function, which writes the origin of
+///         the leaf being processed by a PointKernel. Also used by functions
+///         outside of the point library, such as rand, to identify points.
+FunctionGroup::UniquePtr ax_pointleaforigin(const FunctionOptions& op);
+
 
 ///////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////
@@ -128,10 +184,17 @@ struct PointComputeGenerator : public ComputeGenerator
 
     AttributeRegistry::Ptr generate(const ast::Tree& node);
     bool visit(const ast::Attribute*) override;
+    bool visit(const ast::Block*) override;
 
 private:
+    llvm::Value* attributeIndexFromToken(const std::string&);
     llvm::Value* attributeHandleFromToken(const std::string&);
+    llvm::Value* attributeLayoutFromToken(const std::string&);
     void getAttributeValue(const std::string& globalName, llvm::Value* location);
+
+    // Read only attributes which are only accessed within a branch, retrieved
+    // at the start of the corresponding block rather than at function entry
+    std::unordered_map<const ast::Block*, std::vector<std::string>> mDeferredReads;
 };
 
 } // namespace namespace codegen_internal
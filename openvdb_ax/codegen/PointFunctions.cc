@@ -43,7 +43,11 @@
 #include "FunctionTypes.h"
 #include "Types.h"
 #include "Utils.h"
+#include "PointComputeGenerator.h"
 #include "PointLeafLocalData.h"
+#include "PointNeighbours.h"
+#include "Rasterization.h"
+#include "VolumeSamplers.h"
 
 #include "../ast/Tokens.h"
 #include "../compiler/CompilerOptions.h"
@@ -52,6 +56,7 @@
 #include <openvdb/openvdb.h>
 #include <openvdb/points/PointDataGrid.h>
 
+#include <type_traits>
 #include <unordered_map>
 
 namespace openvdb {
@@ -90,6 +95,60 @@ groupHandle(const std::string& name, void** groupHandles, const void* const data
     return static_cast<HandleT*>(groupHandles[groupIdx]);
 }
 
+/// @brief  Generate a branch on whether the provided AttributeLayout holds
+///         directly accessible attribute data. The direct callback is invoked
+///         with a pointer to the value of the point at the given index and
+///         the fallback callback should access the attribute through its
+///         handle. The builder is left at the point where both paths merge.
+/// @note   If instructions follow the current insertion point (i.e. when
+///         inserting before a return), the current block is split.
+template <typename DirectCb, typename FallbackCb>
+inline void
+branchOnLayout(llvm::IRBuilder<>& B,
+    llvm::Value* layout,
+    llvm::Value* index,
+    llvm::Type* valueType,
+    const DirectCb& direct,
+    const FallbackCb& fallback)
+{
+    llvm::LLVMContext& C = B.getContext();
+    llvm::BasicBlock* current = B.GetInsertBlock();
+    llvm::Function* F = current->getParent();
+
+    llvm::BasicBlock* post = nullptr;
+    if (B.GetInsertPoint() == current->end()) {
+        post = llvm::BasicBlock::Create(C, "attribute.post", F);
+    }
+    else {
+        post = current->splitBasicBlock(B.GetInsertPoint(), "attribute.post");
+        // remove the unconditional branch inserted by the split
+        current->getTerminator()->eraseFromParent();
+        B.SetInsertPoint(current);
+    }
+
+    llvm::BasicBlock* directBlock =
+        llvm::BasicBlock::Create(C, "attribute.direct", F, post);
+    llvm::BasicBlock* fallbackBlock =
+        llvm::BasicBlock::Create(C, "attribute.handle", F, post);
+
+    llvm::Type* layoutType = LLVMType<AttributeLayout>::get(C);
+    layout = B.CreatePointerCast(layout, layoutType->getPointerTo());
+    llvm::Value* data = B.CreateLoad(B.CreateStructGEP(layoutType, layout, 0));
+    B.CreateCondBr(B.CreateIsNull(data), fallbackBlock, directBlock);
+
+    B.SetInsertPoint(directBlock);
+    llvm::Value* stride = B.CreateLoad(B.CreateStructGEP(layoutType, layout, 1));
+    data = B.CreatePointerCast(data, valueType->getPointerTo());
+    direct(B.CreateGEP(data, B.CreateMul(index, stride)));
+    B.CreateBr(post);
+
+    B.SetInsertPoint(fallbackBlock);
+    fallback();
+    B.CreateBr(post);
+
+    B.SetInsertPoint(post, post->begin());
+}
+
 }
 
 inline FunctionGroup::UniquePtr ax_ingroup(const FunctionOptions& op)
@@ -144,6 +203,39 @@ inline FunctionGroup::UniquePtr ax_ingroup(const FunctionOptions& op)
         .get();
 }
 
+FunctionGroup::UniquePtr ax_pointleaforigin(const FunctionOptions& op)
+{
+    static auto origin =
+        [](const void* const leafDataPtr,
+           int32_t (*out)[3])
+    {
+        const codegen_internal::PointLeafLocalData* const leafData =
+            static_cast<const codegen_internal::PointLeafLocalData*>(leafDataPtr);
+        const openvdb::Coord& coord = leafData->origin();
+        (*out)[0] = coord.x();
+        (*out)[1] = coord.y();
+        (*out)[2] = coord.z();
+    };
+
+    using PointLeafOrigin = void(const void* const, int32_t(*)[3]);
+
+    // @note  Also called by rand and rand32 to key unseeded calls
+    //   (see StandardFunctions.cc)
+    return FunctionBuilder("_pointleaforigin")
+        .addSignature<PointLeafOrigin>(origin, "ax.pointleaforigin")
+        .addParameterAttribute(0, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(0, llvm::Attribute::NoAlias)
+        .addParameterAttribute(1, llvm::Attribute::WriteOnly)
+        .addParameterAttribute(1, llvm::Attribute::NoAlias)
+        .addFunctionAttribute(llvm::Attribute::ArgMemOnly)
+        .addFunctionAttribute(llvm::Attribute::NoUnwind)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for querying the origin of the leaf "
+            "node being processed")
+        .get();
+}
+
 inline FunctionGroup::UniquePtr axingroup(const FunctionOptions& op)
 {
     static auto generate =
@@ -348,7 +440,7 @@ inline FunctionGroup::UniquePtr axdeletepoint(const FunctionOptions& op)
         .get();
 }
 
-inline FunctionGroup::UniquePtr axsetattribute(const FunctionOptions& op)
+inline FunctionGroup::UniquePtr ax_setattribute(const FunctionOptions& op)
 {
     static auto setattribptr =
         [](void* attributeHandle, uint64_t index, const auto value)
@@ -425,7 +517,7 @@ inline FunctionGroup::UniquePtr axsetattribute(const FunctionOptions& op)
     using SetAttribM4F = void(void*, uint64_t, const openvdb::math::Mat4<float>*);
     using SetAttribStr = void(void*, uint64_t, const AXString*, void* const);
 
-    return FunctionBuilder("setattribute")
+    return FunctionBuilder("_setattribute")
         .addSignature<SetAttribD>((SetAttribD*)(setattrib))
         .addSignature<SetAttribF>((SetAttribF*)(setattrib))
         .addSignature<SetAttribI64>((SetAttribI64*)(setattrib))
@@ -463,7 +555,91 @@ inline FunctionGroup::UniquePtr axsetattribute(const FunctionOptions& op)
         .get();
 }
 
-inline FunctionGroup::UniquePtr axgetattribute(const FunctionOptions& op)
+inline FunctionGroup::UniquePtr axsetattribute(const FunctionOptions& op)
+{
+    static auto generate =
+        [op](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        assert(args.size() == 4);
+        verifyContext(B.GetInsertBlock()->getParent(), "setattribute");
+        llvm::Value* value = args[3];
+        const bool isPtr = value->getType()->isPointerTy();
+        llvm::Type* type = isPtr ?
+            value->getType()->getPointerElementType() : value->getType();
+
+        branchOnLayout(B, args[1], args[2], type,
+            [&](llvm::Value* location) {
+                B.CreateStore(isPtr ? B.CreateLoad(value) : value, location);
+            },
+            [&]() {
+                ax_setattribute(op)->execute({args[0], args[2], value}, B);
+            });
+        return nullptr;
+    };
+
+    static auto generatestr =
+        [op](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        // strings are always set through their handle
+        assert(args.size() == 5);
+        return ax_setattribute(op)->execute({args[0], args[2], args[3], args[4]}, B);
+    };
+
+    using SetAttribD = void(void*, const void*, uint64_t, const double);
+    using SetAttribF = void(void*, const void*, uint64_t, const float);
+    using SetAttribI64 = void(void*, const void*, uint64_t, const int64_t);
+    using SetAttribI32 = void(void*, const void*, uint64_t, const int32_t);
+    using SetAttribI16 = void(void*, const void*, uint64_t, const int16_t);
+    using SetAttribB = void(void*, const void*, uint64_t, const bool);
+    using SetAttribV2D = void(void*, const void*, uint64_t, const openvdb::math::Vec2<double>*);
+    using SetAttribV2F = void(void*, const void*, uint64_t, const openvdb::math::Vec2<float>*);
+    using SetAttribV2I = void(void*, const void*, uint64_t, const openvdb::math::Vec2<int32_t>*);
+    using SetAttribV3D = void(void*, const void*, uint64_t, const openvdb::math::Vec3<double>*);
+    using SetAttribV3F = void(void*, const void*, uint64_t, const openvdb::math::Vec3<float>*);
+    using SetAttribV3I = void(void*, const void*, uint64_t, const openvdb::math::Vec3<int32_t>*);
+    using SetAttribV4D = void(void*, const void*, uint64_t, const openvdb::math::Vec4<double>*);
+    using SetAttribV4F = void(void*, const void*, uint64_t, const openvdb::math::Vec4<float>*);
+    using SetAttribV4I = void(void*, const void*, uint64_t, const openvdb::math::Vec4<int32_t>*);
+    using SetAttribM3D = void(void*, const void*, uint64_t, const openvdb::math::Mat3<double>*);
+    using SetAttribM3F = void(void*, const void*, uint64_t, const openvdb::math::Mat3<float>*);
+    using SetAttribM4D = void(void*, const void*, uint64_t, const openvdb::math::Mat4<double>*);
+    using SetAttribM4F = void(void*, const void*, uint64_t, const openvdb::math::Mat4<float>*);
+    using SetAttribStr = void(void*, const void*, uint64_t, const AXString*, void* const);
+
+    return FunctionBuilder("setattribute")
+        .addSignature<SetAttribD>(generate)
+        .addSignature<SetAttribF>(generate)
+        .addSignature<SetAttribI64>(generate)
+        .addSignature<SetAttribI32>(generate)
+        .addSignature<SetAttribI16>(generate)
+        .addSignature<SetAttribB>(generate)
+        .addSignature<SetAttribV2D>(generate)
+        .addSignature<SetAttribV2F>(generate)
+        .addSignature<SetAttribV2I>(generate)
+        .addSignature<SetAttribV3D>(generate)
+        .addSignature<SetAttribV3F>(generate)
+        .addSignature<SetAttribV3I>(generate)
+        .addSignature<SetAttribV4D>(generate)
+        .addSignature<SetAttribV4F>(generate)
+        .addSignature<SetAttribV4I>(generate)
+        .addSignature<SetAttribM3D>(generate)
+        .addSignature<SetAttribM3F>(generate)
+        .addSignature<SetAttribM4D>(generate)
+        .addSignature<SetAttribM4F>(generate)
+        .addSignature<SetAttribStr>(generatestr)
+        .addDependency("_setattribute")
+        .setEmbedIR(true)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for setting the value of a point attribute. "
+            "Uncompressed attribute data is written directly, otherwise the value is set "
+            "through the attribute handle.")
+        .get();
+}
+
+inline FunctionGroup::UniquePtr ax_getattribute(const FunctionOptions& op)
 {
     static auto getattrib =
         [](void* attributeHandle, uint64_t index, auto value)
@@ -532,7 +708,7 @@ inline FunctionGroup::UniquePtr axgetattribute(const FunctionOptions& op)
     using GetAttribM4F = void(void*, uint64_t, openvdb::math::Mat4<float>*);
     using GetAttribStr = void(void*, uint64_t, AXString*, const void* const);
 
-    return FunctionBuilder("getattribute")
+    return FunctionBuilder("_getattribute")
         .addSignature<GetAttribD>((GetAttribD*)(getattrib))
         .addSignature<GetAttribF>((GetAttribF*)(getattrib))
         .addSignature<GetAttribI64>((GetAttribI64*)(getattrib))
@@ -565,6 +741,88 @@ inline FunctionGroup::UniquePtr axgetattribute(const FunctionOptions& op)
         .get();
 }
 
+inline FunctionGroup::UniquePtr axgetattribute(const FunctionOptions& op)
+{
+    static auto generate =
+        [op](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        assert(args.size() == 4);
+        verifyContext(B.GetInsertBlock()->getParent(), "getattribute");
+        llvm::Value* value = args[3];
+        llvm::Type* type = value->getType()->getPointerElementType();
+
+        branchOnLayout(B, args[1], args[2], type,
+            [&](llvm::Value* location) {
+                B.CreateStore(B.CreateLoad(location), value);
+            },
+            [&]() {
+                ax_getattribute(op)->execute({args[0], args[2], value}, B);
+            });
+        return nullptr;
+    };
+
+    static auto generatestr =
+        [op](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        // strings are always retrieved through their handle
+        assert(args.size() == 5);
+        return ax_getattribute(op)->execute({args[0], args[2], args[3], args[4]}, B);
+    };
+
+    using GetAttribD = void(void*, const void*, uint64_t, double*);
+    using GetAttribF = void(void*, const void*, uint64_t, float*);
+    using GetAttribI64 = void(void*, const void*, uint64_t, int64_t*);
+    using GetAttribI32 = void(void*, const void*, uint64_t, int32_t*);
+    using GetAttribI16 = void(void*, const void*, uint64_t, int16_t*);
+    using GetAttribB = void(void*, const void*, uint64_t, bool*);
+    using GetAttribV2D = void(void*, const void*, uint64_t, openvdb::math::Vec2<double>*);
+    using GetAttribV2F = void(void*, const void*, uint64_t, openvdb::math::Vec2<float>*);
+    using GetAttribV2I = void(void*, const void*, uint64_t, openvdb::math::Vec2<int32_t>*);
+    using GetAttribV3D = void(void*, const void*, uint64_t, openvdb::math::Vec3<double>*);
+    using GetAttribV3F = void(void*, const void*, uint64_t, openvdb::math::Vec3<float>*);
+    using GetAttribV3I = void(void*, const void*, uint64_t, openvdb::math::Vec3<int32_t>*);
+    using GetAttribV4D = void(void*, const void*, uint64_t, openvdb::math::Vec4<double>*);
+    using GetAttribV4F = void(void*, const void*, uint64_t, openvdb::math::Vec4<float>*);
+    using GetAttribV4I = void(void*, const void*, uint64_t, openvdb::math::Vec4<int32_t>*);
+    using GetAttribM3D = void(void*, const void*, uint64_t, openvdb::math::Mat3<double>*);
+    using GetAttribM3F = void(void*, const void*, uint64_t, openvdb::math::Mat3<float>*);
+    using GetAttribM4D = void(void*, const void*, uint64_t, openvdb::math::Mat4<double>*);
+    using GetAttribM4F = void(void*, const void*, uint64_t, openvdb::math::Mat4<float>*);
+    using GetAttribStr = void(void*, const void*, uint64_t, AXString*, const void* const);
+
+    return FunctionBuilder("getattribute")
+        .addSignature<GetAttribD>(generate)
+        .addSignature<GetAttribF>(generate)
+        .addSignature<GetAttribI64>(generate)
+        .addSignature<GetAttribI32>(generate)
+        .addSignature<GetAttribI16>(generate)
+        .addSignature<GetAttribB>(generate)
+        .addSignature<GetAttribV2D>(generate)
+        .addSignature<GetAttribV2F>(generate)
+        .addSignature<GetAttribV2I>(generate)
+        .addSignature<GetAttribV3D>(generate)
+        .addSignature<GetAttribV3F>(generate)
+        .addSignature<GetAttribV3I>(generate)
+        .addSignature<GetAttribV4D>(generate)
+        .addSignature<GetAttribV4F>(generate)
+        .addSignature<GetAttribV4I>(generate)
+        .addSignature<GetAttribM3D>(generate)
+        .addSignature<GetAttribM3F>(generate)
+        .addSignature<GetAttribM4D>(generate)
+        .addSignature<GetAttribM4F>(generate)
+        .addSignature<GetAttribStr>(generatestr)
+        .addDependency("_getattribute")
+        .setEmbedIR(true)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for getting the value of a point attribute. "
+            "Uncompressed attribute data is read directly, otherwise the value is "
+            "retrieved through the attribute handle.")
+        .get();
+}
+
 inline FunctionGroup::UniquePtr axstrattribsize(const FunctionOptions& op)
 {
     static auto strattribsize =
@@ -601,6 +859,422 @@ inline FunctionGroup::UniquePtr axstrattribsize(const FunctionOptions& op)
         .get();
 }
 
+inline FunctionGroup::UniquePtr ax_nearpointcount(const FunctionOptions& op)
+{
+    static auto count =
+        [](void* const queryPtr,
+           const openvdb::math::Vec3<float>* const pos,
+           const float radius) -> int32_t
+    {
+        assert(queryPtr);
+        assert(pos);
+        codegen_internal::PointNeighbours::Query* const query =
+            static_cast<codegen_internal::PointNeighbours::Query*>(queryPtr);
+        return query->count(*pos, radius);
+    };
+
+    using NearPointCount = int32_t(void* const,
+        const openvdb::math::Vec3<float>* const,
+        const float);
+
+    return FunctionBuilder("_nearpointcount")
+        .addSignature<NearPointCount>(count)
+        .setArgumentNames({"neighbours", "pos", "radius"})
+        .addParameterAttribute(0, llvm::Attribute::NoAlias)
+        .addParameterAttribute(1, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(1, llvm::Attribute::NoAlias)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for counting the points within a "
+            "radius of a position")
+        .get();
+}
+
+inline FunctionGroup::UniquePtr axnearpointcount(const FunctionOptions& op)
+{
+    auto generate =
+        [op](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        // Pull out parent function arguments
+        llvm::Function* compute = B.GetInsertBlock()->getParent();
+        verifyContext(compute, "nearpointcount");
+        llvm::Value* neighbours = extractArgument(compute, "neighbours");
+        assert(neighbours);
+
+        std::vector<llvm::Value*> input;
+        input.reserve(1 + args.size());
+        input.emplace_back(neighbours);
+        input.insert(input.end(), args.begin(), args.end());
+        return ax_nearpointcount(op)->execute(input, B);
+    };
+
+    return FunctionBuilder("nearpointcount")
+        .addSignature<int32_t(const openvdb::math::Vec3<float>*, float)>(generate)
+        .setArgumentNames({"pos", "radius"})
+        .addDependency("_nearpointcount")
+        .setEmbedIR(true) // always embed as we pass through function param "neighbours"
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Return the number of points within the given world space "
+            "radius of a position, including the current point if it lies within the "
+            "radius. Point positions are those at the start of execution.")
+        .get();
+}
+
+inline FunctionGroup::UniquePtr ax_nearpointaverage(const FunctionOptions& op)
+{
+    static auto average =
+        [](auto out,
+           void* const queryPtr,
+           const AXString* const name,
+           const openvdb::math::Vec3<float>* const pos,
+           const float radius)
+    {
+        using ValueType = typename std::remove_pointer<decltype(out)>::type;
+        assert(queryPtr);
+        assert(name);
+        assert(pos);
+        codegen_internal::PointNeighbours::Query* const query =
+            static_cast<codegen_internal::PointNeighbours::Query*>(queryPtr);
+        *out = query->average<ValueType>(name->ptr, name->size, *pos, radius);
+    };
+
+    using AverageF = void(float*,
+        void* const,
+        const AXString* const,
+        const openvdb::math::Vec3<float>* const,
+        const float);
+    using AverageV3F = void(openvdb::math::Vec3<float>*,
+        void* const,
+        const AXString* const,
+        const openvdb::math::Vec3<float>* const,
+        const float);
+
+    return FunctionBuilder("_nearpointaverage")
+        .addSignature<AverageF>((AverageF*)(average))
+        .addSignature<AverageV3F>((AverageV3F*)(average))
+        .setArgumentNames({"result", "neighbours", "str", "pos", "radius"})
+        .addParameterAttribute(0, llvm::Attribute::NoAlias)
+        .addParameterAttribute(0, llvm::Attribute::WriteOnly)
+        .addParameterAttribute(1, llvm::Attribute::NoAlias)
+        .addParameterAttribute(2, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(3, llvm::Attribute::ReadOnly)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for averaging an attribute of the points "
+            "within a radius of a position")
+        .get();
+}
+
+/// @brief  Builds nearpointaverage() and nearpointaveragev(), which return
+///   values of type ValueT
+template <typename ValueT>
+inline FunctionGroup::UniquePtr axnearpointaverage(const FunctionOptions& op,
+    const char* name,
+    const char* doc)
+{
+    auto generate =
+        [op, name](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        // Pull out parent function arguments
+        llvm::Function* compute = B.GetInsertBlock()->getParent();
+        verifyContext(compute, name);
+        llvm::Value* neighbours = extractArgument(compute, "neighbours");
+        assert(neighbours);
+
+        std::vector<llvm::Value*> input;
+        input.reserve(2 + args.size());
+        input.emplace_back(insertStaticAlloca(B, LLVMType<ValueT>::get(B.getContext())));
+        input.emplace_back(neighbours);
+        input.insert(input.end(), args.begin(), args.end());
+        ax_nearpointaverage(op)->execute(input, B);
+        return std::is_floating_point<ValueT>::value ?
+            B.CreateLoad(input.front()) : input.front();
+    };
+
+    using ReturnT = typename std::conditional<std::is_floating_point<ValueT>::value,
+        ValueT, openvdb::math::Vec3<float>*>::type;
+
+    return FunctionBuilder(name)
+        .addSignature<ReturnT(const AXString*, const openvdb::math::Vec3<float>*, float)>(generate)
+        .setArgumentNames({"str", "pos", "radius"})
+        .addDependency("_nearpointaverage")
+        .addParameterAttribute(0, llvm::Attribute::ReadOnly)
+        .setEmbedIR(true) // always embed as we pass through function param "neighbours"
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation(doc)
+        .get();
+}
+
+inline FunctionGroup::UniquePtr axnearpointaveragef(const FunctionOptions& op)
+{
+    return axnearpointaverage<float>(op, "nearpointaverage",
+        "Return the average value of the given 'float' attribute of the points within "
+        "the given world space radius of a position, or 0.0f if no points are found. "
+        "The attribute name must be a string literal. Values are those at the start "
+        "of execution.");
+}
+
+inline FunctionGroup::UniquePtr axnearpointaveragev(const FunctionOptions& op)
+{
+    return axnearpointaverage<float[3]>(op, "nearpointaveragev",
+        "Return the average value of the given 'vector float' attribute of the points "
+        "within the given world space radius of a position, or { 0.0f, 0.0f, 0.0f } if "
+        "no points are found. The attribute name must be a string literal and \"P\" "
+        "averages the world space positions. Values are those at the start of execution.");
+}
+
+inline FunctionGroup::UniquePtr ax_volumesample(const FunctionOptions& op)
+{
+    static auto sample =
+        [](auto out,
+           void* const accessorsPtr,
+           const AXString* const name,
+           const openvdb::math::Vec3<float>* const pos,
+           const int32_t order)
+    {
+        using ValueType = typename std::remove_pointer<decltype(out)>::type;
+        assert(name);
+        assert(pos);
+        if (!accessorsPtr) {
+            *out = openvdb::zeroVal<ValueType>();
+            return;
+        }
+        codegen_internal::VolumeSamplers::Accessors* const accessors =
+            static_cast<codegen_internal::VolumeSamplers::Accessors*>(accessorsPtr);
+        *out = accessors->sample<ValueType>(name->ptr, name->size, *pos, order);
+    };
+
+    using SampleF = void(float*,
+        void* const,
+        const AXString* const,
+        const openvdb::math::Vec3<float>* const,
+        const int32_t);
+    using SampleV3F = void(openvdb::math::Vec3<float>*,
+        void* const,
+        const AXString* const,
+        const openvdb::math::Vec3<float>* const,
+        const int32_t);
+
+    return FunctionBuilder("_volumesample")
+        .addSignature<SampleF>((SampleF*)(sample))
+        .addSignature<SampleV3F>((SampleV3F*)(sample))
+        .setArgumentNames({"result", "volumes", "str", "pos", "order"})
+        .addParameterAttribute(0, llvm::Attribute::NoAlias)
+        .addParameterAttribute(0, llvm::Attribute::WriteOnly)
+        .addParameterAttribute(1, llvm::Attribute::NoAlias)
+        .addParameterAttribute(2, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(3, llvm::Attribute::ReadOnly)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for sampling a volume at a position")
+        .get();
+}
+
+inline FunctionGroup::UniquePtr ax_volumegradient(const FunctionOptions& op)
+{
+    static auto gradient =
+        [](openvdb::math::Vec3<float>* out,
+           void* const accessorsPtr,
+           const AXString* const name,
+           const openvdb::math::Vec3<float>* const pos,
+           const int32_t order)
+    {
+        assert(name);
+        assert(pos);
+        if (!accessorsPtr) {
+            *out = openvdb::zeroVal<openvdb::math::Vec3<float>>();
+            return;
+        }
+        codegen_internal::VolumeSamplers::Accessors* const accessors =
+            static_cast<codegen_internal::VolumeSamplers::Accessors*>(accessorsPtr);
+        *out = accessors->gradient(name->ptr, name->size, *pos, order);
+    };
+
+    using Gradient = void(openvdb::math::Vec3<float>*,
+        void* const,
+        const AXString* const,
+        const openvdb::math::Vec3<float>* const,
+        const int32_t);
+
+    return FunctionBuilder("_volumegradient")
+        .addSignature<Gradient>(gradient)
+        .setArgumentNames({"result", "volumes", "str", "pos", "order"})
+        .addParameterAttribute(0, llvm::Attribute::NoAlias)
+        .addParameterAttribute(0, llvm::Attribute::WriteOnly)
+        .addParameterAttribute(1, llvm::Attribute::NoAlias)
+        .addParameterAttribute(2, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(3, llvm::Attribute::ReadOnly)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for computing the gradient of a volume "
+            "at a position")
+        .get();
+}
+
+/// @brief  Builds volumesample(), volumesamplev() and volumegradient(),
+///   which return values of type ValueT by calling the internal function
+///   built by Internal and registered under the name internal. When no
+///   interpolation order is provided, values are interpolated trilinearly.
+template <typename ValueT, FunctionGroup::UniquePtr(*Internal)(const FunctionOptions&)>
+inline FunctionGroup::UniquePtr axvolumesample(const FunctionOptions& op,
+    const char* name,
+    const char* internal,
+    const char* doc)
+{
+    auto generate =
+        [op, name](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        // Pull out parent function arguments
+        llvm::Function* compute = B.GetInsertBlock()->getParent();
+        verifyContext(compute, name);
+        llvm::Value* volumes = extractArgument(compute, "volumes");
+        assert(volumes);
+
+        std::vector<llvm::Value*> input;
+        input.reserve(3 + args.size());
+        input.emplace_back(insertStaticAlloca(B, LLVMType<ValueT>::get(B.getContext())));
+        input.emplace_back(volumes);
+        input.insert(input.end(), args.begin(), args.end());
+        if (args.size() == 2) input.emplace_back(LLVMType<int32_t>::get(B.getContext(), 1));
+        Internal(op)->execute(input, B);
+        return std::is_floating_point<ValueT>::value ?
+            B.CreateLoad(input.front()) : input.front();
+    };
+
+    using ReturnT = typename std::conditional<std::is_floating_point<ValueT>::value,
+        ValueT, openvdb::math::Vec3<float>*>::type;
+
+    return FunctionBuilder(name)
+        .addSignature<ReturnT(const AXString*, const openvdb::math::Vec3<float>*)>(generate)
+        .addSignature<ReturnT(const AXString*, const openvdb::math::Vec3<float>*, int32_t)>(generate)
+        .setArgumentNames({"str", "pos", "order"})
+        .addDependency(internal)
+        .addParameterAttribute(0, llvm::Attribute::ReadOnly)
+        .setEmbedIR(true) // always embed as we pass through function param "volumes"
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation(doc)
+        .get();
+}
+
+inline FunctionGroup::UniquePtr axvolumesamplef(const FunctionOptions& op)
+{
+    return axvolumesample<float, ax_volumesample>(op, "volumesample", "_volumesample",
+        "Sample the 'float' volume of the given name at a world space position, or "
+        "return 0.0f if no such volume has been provided to the execution. The optional "
+        "order selects nearest neighbour (0), trilinear (1, the default) or triquadratic "
+        "(2) interpolation.");
+}
+
+inline FunctionGroup::UniquePtr axvolumesamplev(const FunctionOptions& op)
+{
+    return axvolumesample<float[3], ax_volumesample>(op, "volumesamplev", "_volumesample",
+        "Sample the 'vector float' volume of the given name at a world space position, "
+        "or return { 0.0f, 0.0f, 0.0f } if no such volume has been provided to the "
+        "execution. The optional order selects nearest neighbour (0), trilinear (1, the "
+        "default) or triquadratic (2) interpolation.");
+}
+
+inline FunctionGroup::UniquePtr axvolumegradient(const FunctionOptions& op)
+{
+    return axvolumesample<float[3], ax_volumegradient>(op, "volumegradient", "_volumegradient",
+        "Return the world space gradient of the 'float' volume of the given name at a "
+        "world space position, or { 0.0f, 0.0f, 0.0f } if no such volume has been "
+        "provided to the execution. The gradient is computed with central differences "
+        "of the values interpolated half a voxel either side of the position, using "
+        "the optional interpolation order as with volumesample().");
+}
+
+inline FunctionGroup::UniquePtr ax_rasterize(const FunctionOptions& op)
+{
+    using Rasterization = codegen_internal::Rasterization;
+
+    static auto rasterize = [](void* const data, const AXString* const name,
+        const openvdb::math::Vec3<float>* const pos, const float value)
+    {
+        assert(name);
+        assert(pos);
+        if (!data) return;
+        static_cast<Rasterization*>(data)->rasterize(name->ptr, name->size, *pos, value);
+    };
+
+    static auto rasterizev = [](void* const data, const AXString* const name,
+        const openvdb::math::Vec3<float>* const pos,
+        const openvdb::math::Vec3<float>* const value)
+    {
+        assert(name);
+        assert(pos);
+        assert(value);
+        if (!data) return;
+        static_cast<Rasterization*>(data)->rasterize(name->ptr, name->size, *pos, *value);
+    };
+
+    using RasterizeF = void(void*,
+        const AXString* const,
+        const openvdb::math::Vec3<float>* const,
+        const float);
+    using RasterizeV3F = void(void*,
+        const AXString* const,
+        const openvdb::math::Vec3<float>* const,
+        const openvdb::math::Vec3<float>* const);
+
+    return FunctionBuilder("_rasterize")
+        .addSignature<RasterizeF>(rasterize)
+        .addSignature<RasterizeV3F>(rasterizev)
+        .setArgumentNames({"rasterization", "str", "pos", "value"})
+        .addParameterAttribute(0, llvm::Attribute::NoAlias)
+        .addParameterAttribute(1, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(2, llvm::Attribute::ReadOnly)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for rasterizing a value into the "
+            "volumes of the current thread.")
+        .get();
+}
+
+inline FunctionGroup::UniquePtr axrasterize(const FunctionOptions& op)
+{
+    auto generate =
+        [op](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        // Pull out parent function arguments
+        llvm::Function* compute = B.GetInsertBlock()->getParent();
+        verifyContext(compute, "rasterize");
+        llvm::Value* rasterization = extractArgument(compute, "rasterization");
+        assert(rasterization);
+
+        std::vector<llvm::Value*> input;
+        input.reserve(1 + args.size());
+        input.emplace_back(rasterization);
+        input.insert(input.end(), args.begin(), args.end());
+        return ax_rasterize(op)->execute(input, B);
+    };
+
+    return FunctionBuilder("rasterize")
+        .addSignature<void(const AXString*, const openvdb::math::Vec3<float>*, float)>(generate)
+        .addSignature<void(const AXString*, const openvdb::math::Vec3<float>*,
+            const openvdb::math::Vec3<float>*)>(generate)
+        .setArgumentNames({"str", "pos", "value"})
+        .addDependency("_rasterize")
+        .addParameterAttribute(0, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(1, llvm::Attribute::ReadOnly)
+        .setEmbedIR(true) // always embed as we pass through function param "rasterization"
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Splat a 'float' or 'vector float' value into the volume of the "
+            "given name at a world space position. The value is distributed between the "
+            "eight surrounding voxels with trilinear weights. Each thread rasterizes into "
+            "its own volumes, which are summed once execution completes. Volumes are only "
+            "written if output grids are provided to the execution.")
+        .get();
+}
+
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 
@@ -624,10 +1298,25 @@ void insertVDBPointFunctions(FunctionRegistry& registry,
     add("removefromgroup",axremovefromgroup);
     add("deletepoint", axdeletepoint);
     add("_ingroup", ax_ingroup, true);
+    add("_pointleaforigin", ax_pointleaforigin, true);
     add("editgroup", axeditgroup, true);
+    add("_getattribute", ax_getattribute, true);
+    add("_setattribute", ax_setattribute, true);
     add("getattribute", axgetattribute, true);
     add("setattribute", axsetattribute, true);
     add("strattribsize", axstrattribsize, true);
+    add("_nearpointcount", ax_nearpointcount, true);
+    add("_nearpointaverage", ax_nearpointaverage, true);
+    add("nearpointcount", axnearpointcount);
+    add("nearpointaverage", axnearpointaveragef);
+    add("nearpointaveragev", axnearpointaveragev);
+    add("_volumesample", ax_volumesample, true);
+    add("_volumegradient", ax_volumegradient, true);
+    add("volumesample", axvolumesamplef);
+    add("volumesamplev", axvolumesamplev);
+    add("volumegradient", axvolumegradient);
+    add("_rasterize", ax_rasterize, true);
+    add("rasterize", axrasterize);
 }
 
 } // namespace codegen
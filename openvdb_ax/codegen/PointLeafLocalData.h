@@ -83,14 +83,20 @@ struct PointLeafLocalData
     ///
     /// @param  count  The number of points within the current leaf, used to initialize
     ///                the size of new arrays
+    /// @param  origin The origin of the current leaf
     ///
-    PointLeafLocalData(const size_t count)
+    PointLeafLocalData(const size_t count, const openvdb::Coord& origin = openvdb::Coord())
         : mPointCount(count)
+        , mOrigin(origin)
         , mArrays()
         , mOffset(0)
         , mHandles()
         , mStringMap() {}
 
+    /// @brief  Return the origin of the leaf this data was created for
+    ///
+    inline const openvdb::Coord& origin() const { return mOrigin; }
+
     ////////////////////////////////////////////////////////////////////////
 
     /// Group methods
@@ -244,6 +250,7 @@ struct PointLeafLocalData
 private:
 
     const size_t mPointCount;
+    const openvdb::Coord mOrigin;
     std::vector<std::unique_ptr<GroupArrayT>> mArrays;
     points::GroupType mOffset;
     std::map<std::string, std::unique_ptr<GroupHandleT>> mHandles;
@@ -0,0 +1,383 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file codegen/PointNeighbours.h
+///
+/// @brief  A read-only spatial index of the points of a PointDataGrid, used
+///   by point kernels to find the neighbours of a position with
+///   nearpointcount(), nearpointaverage() and nearpointaveragev()
+///
+
+#ifndef OPENVDB_AX_CODEGEN_POINT_NEIGHBOURS_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_CODEGEN_POINT_NEIGHBOURS_HAS_BEEN_INCLUDED
+
+#include "../ast/AST.h"
+#include "../ast/Scanners.h"
+#include "../ast/Tokens.h"
+#include "../compiler/Logger.h"
+#include "../Exceptions.h"
+
+#include <openvdb/openvdb.h>
+#include <openvdb/version.h>
+#include <openvdb/math/BBox.h>
+#include <openvdb/math/Coord.h>
+#include <openvdb/math/Transform.h>
+#include <openvdb/math/Vec3.h>
+#include <openvdb/points/AttributeArray.h>
+#include <openvdb/points/PointDataGrid.h>
+#include <openvdb/tree/ValueAccessor.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace codegen {
+
+namespace codegen_internal {
+
+/// @brief  The points of a PointDataGrid, bucketed by the leaf nodes and
+///   voxels which hold them. The world space positions and any attributes
+///   read through neighbour queries are cached when the index is built, so
+///   queries see the points as they were before execution started,
+///   regardless of what the kernel writes.
+///
+/// @details  The leaf node holding a coordinate is found through a tree of
+///   leaf sized tiles storing the leaf's position in the cache. Every thread
+///   queries through its own Query object, which keeps a ValueAccessor into
+///   this tree warm between calls. Queries visit the points of each voxel
+///   overlapping the search radius in place and never allocate.
+///
+class PointNeighbours
+{
+public:
+    using Ptr = std::unique_ptr<PointNeighbours>;
+    using LeafT = points::PointDataTree::LeafNodeType;
+
+    /// @brief  The attributes read through neighbour queries, paired with
+    ///   the type they are read as
+    using AttributeVec = std::vector<std::pair<std::string, ast::tokens::CoreType>>;
+
+    /// @brief  The cached data of a single leaf node
+    struct Leaf
+    {
+        const LeafT* mNode = nullptr;
+        /// The values of each float attribute
+        std::vector<std::vector<float>> mFloats;
+        /// The values of each vec3f attribute. The first holds the world
+        /// space positions of the points
+        std::vector<std::vector<math::Vec3<float>>> mVectors;
+
+        inline const std::vector<math::Vec3<float>>& positions() const { return mVectors.front(); }
+    };
+
+    /// @brief  Finds the neighbours of positions on behalf of a single thread
+    class Query
+    {
+    public:
+        Query(const PointNeighbours& neighbours)
+            : mNeighbours(neighbours)
+            , mAccessor(neighbours.mIndex) {}
+
+        /// @brief  Invoke an operator for every point within a radius of a
+        ///   world space position. The operator is called with the Leaf
+        ///   holding the point and the index of the point within the leaf.
+        template <typename OpT>
+        inline void foreach(const math::Vec3<float>& pos, const float radius, const OpT& op)
+        {
+            if (!(radius >= 0.0f)) return;
+
+            const math::Vec3<double> center(pos);
+            const math::BBox<math::Vec3<double>> bounds =
+                mNeighbours.mTransform.worldToIndex(math::BBox<math::Vec3<double>>(
+                    center - double(radius), center + double(radius)));
+
+            CoordBBox bbox(Coord::round(bounds.min()), Coord::round(bounds.max()));
+            bbox.intersect(mNeighbours.mBounds);
+            if (bbox.empty()) return;
+
+            const float radius2 = radius * radius;
+            const Coord& min = bbox.min();
+            const Coord& max = bbox.max();
+            constexpr int32_t Mask = ~(int32_t(LeafT::DIM) - 1);
+            int32_t index;
+
+            for (int32_t x = min.x() & Mask; x <= max.x(); x += LeafT::DIM) {
+                for (int32_t y = min.y() & Mask; y <= max.y(); y += LeafT::DIM) {
+                    for (int32_t z = min.z() & Mask; z <= max.z(); z += LeafT::DIM) {
+                        if (!mAccessor.probeValue(Coord(x, y, z), index)) continue;
+                        const Leaf& leaf = mNeighbours.mLeaves[index];
+
+                        CoordBBox voxels = leaf.mNode->getNodeBoundingBox();
+                        voxels.intersect(bbox);
+                        const std::vector<math::Vec3<float>>& positions = leaf.positions();
+
+                        Coord ijk;
+                        for (ijk.x() = voxels.min().x(); ijk.x() <= voxels.max().x(); ++ijk.x()) {
+                            for (ijk.y() = voxels.min().y(); ijk.y() <= voxels.max().y(); ++ijk.y()) {
+                                for (ijk.z() = voxels.min().z(); ijk.z() <= voxels.max().z(); ++ijk.z()) {
+                                    const Index offset = LeafT::coordToOffset(ijk);
+                                    const Index end = leaf.mNode->getValue(offset);
+                                    Index n = offset == 0 ? 0 : leaf.mNode->getValue(offset - 1);
+                                    for (; n < end; ++n) {
+                                        if ((positions[n] - pos).lengthSqr() <= radius2) op(leaf, n);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /// @brief  The number of points within a radius of a position
+        inline int32_t count(const math::Vec3<float>& pos, const float radius)
+        {
+            int32_t count = 0;
+            this->foreach(pos, radius, [&count](const Leaf&, const Index) { ++count; });
+            return count;
+        }
+
+        /// @brief  The average value of an attribute of the points within a
+        ///   radius of a position. Returns zero if no points are found or if
+        ///   the attribute has not been cached.
+        ///
+        /// @param  name  The name of the attribute, not null terminated
+        /// @param  size  The length of the name
+        /// @param  pos   The world space position to search around
+        /// @param  radius  The world space search radius
+        ///
+        template <typename ValueT>
+        inline ValueT average(const char* name, const size_t size,
+            const math::Vec3<float>& pos, const float radius)
+        {
+            using SumT = typename std::conditional<std::is_floating_point<ValueT>::value,
+                double, math::Vec3<double>>::type;
+
+            const std::vector<std::string>& names = mNeighbours.names(ValueT());
+            size_t attribute = 0;
+            for (; attribute < names.size(); ++attribute) {
+                const std::string& candidate = names[attribute];
+                if (candidate.size() == size && candidate.compare(0, size, name, size) == 0) break;
+            }
+            if (attribute == names.size()) return zeroVal<ValueT>();
+
+            SumT sum = zeroVal<SumT>();
+            size_t count = 0;
+            this->foreach(pos, radius, [&](const Leaf& leaf, const Index n) {
+                sum += PointNeighbours::values(leaf, ValueT())[attribute][n];
+                ++count;
+            });
+
+            if (count == 0) return zeroVal<ValueT>();
+            return ValueT(sum / double(count));
+        }
+
+    private:
+        const PointNeighbours& mNeighbours;
+        tree::ValueAccessor<const Int32Tree> mAccessor;
+    };
+
+    /// @brief  Find the neighbour queries performed by a syntax tree. The
+    ///   attribute names given to nearpointaverage() and nearpointaveragev()
+    ///   must be string literals so that their values can be cached before
+    ///   execution. Other names are reported as errors to the logger.
+    /// @return The attributes read by the queries, or a null pointer if the
+    ///   tree does not query neighbours
+    static inline std::shared_ptr<const AttributeVec>
+    accesses(const ast::Tree& tree, Logger* const logger = nullptr)
+    {
+        std::shared_ptr<AttributeVec> attributes;
+        ast::visitNodeType<ast::FunctionCall>(tree,
+            [&](const ast::FunctionCall& call) -> bool {
+                ast::tokens::CoreType type = ast::tokens::UNKNOWN;
+                if (call.name() == "nearpointaverage")       type = ast::tokens::FLOAT;
+                else if (call.name() == "nearpointaveragev") type = ast::tokens::VEC3F;
+                else if (call.name() != "nearpointcount")    return true;
+
+                if (!attributes) attributes.reset(new AttributeVec);
+                if (type == ast::tokens::UNKNOWN || call.empty()) return true;
+
+                const ast::Value<std::string>* const name =
+                    dynamic_cast<const ast::Value<std::string>*>(call.child(0));
+                if (!name) {
+                    if (logger) {
+                        logger->error("the attribute name passed to \"" + call.name() +
+                            "\" must be a string literal.", &call);
+                    }
+                    return true;
+                }
+
+                // world space positions are always cached
+                if (type == ast::tokens::VEC3F && name->value() == "P") return true;
+                const AttributeVec::value_type access(name->value(), type);
+                if (std::find(attributes->begin(), attributes->end(), access) == attributes->end()) {
+                    attributes->emplace_back(access);
+                }
+                return true;
+            });
+        return attributes;
+    }
+
+    /// @brief  Build the index of a grid, caching the given attributes.
+    ///   Throws an AXExecutionError if an attribute does not exist, or a
+    ///   TypeError if it is not of the type it is read as.
+    PointNeighbours(const points::PointDataGrid& grid, const AttributeVec& attributes)
+        : mTransform(grid.transform())
+        , mIndex(-1)
+        , mBounds()
+        , mLeaves()
+        , mFloatNames()
+        , mVectorNames({"P"})
+        , mQueries()
+    {
+        std::vector<const LeafT*> leaves;
+        grid.tree().getNodes(leaves);
+        if (leaves.empty()) return;
+
+        const points::AttributeSet::Descriptor& desc =
+            leaves.front()->attributeSet().descriptor();
+
+        for (const auto& attribute : attributes) {
+            const std::string& name = attribute.first;
+            const bool vector = attribute.second == ast::tokens::VEC3F;
+            const size_t pos = desc.find(name);
+            if (pos == points::AttributeSet::INVALID_POS) {
+                OPENVDB_THROW(AXExecutionError, "Attribute \"" + name +
+                    "\" queried by neighbour functions does not exist on grid \"" +
+                    grid.getName() + "\"");
+            }
+            const std::string expected = vector ?
+                typeNameAsString<math::Vec3<float>>() : typeNameAsString<float>();
+            if (desc.valueType(pos) != expected) {
+                OPENVDB_THROW(TypeError, "Attribute \"" + name + "\" queried by neighbour "
+                    "functions is of type \"" + desc.valueType(pos) + "\", expected \"" +
+                    expected + "\".");
+            }
+            if (vector) mVectorNames.emplace_back(name);
+            else        mFloatNames.emplace_back(name);
+        }
+
+        mLeaves.resize(leaves.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, leaves.size()),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i < range.end(); ++i) {
+                    this->build(*leaves[i], mLeaves[i]);
+                }
+            });
+
+        for (size_t i = 0; i < leaves.size(); ++i) {
+            mIndex.addTile(/*level*/1, leaves[i]->origin(), static_cast<int32_t>(i), /*active*/true);
+            mBounds.expand(leaves[i]->getNodeBoundingBox());
+        }
+    }
+
+    /// @brief  The query object of the calling thread
+    inline Query& query() const
+    {
+        std::unique_ptr<Query>& query = mQueries.local();
+        if (!query) query.reset(new Query(*this));
+        return *query;
+    }
+
+private:
+    inline void build(const LeafT& node, Leaf& leaf) const
+    {
+        leaf.mNode = &node;
+        const Index count = static_cast<Index>(node.pointCount());
+
+        leaf.mVectors.resize(mVectorNames.size());
+        std::vector<math::Vec3<float>>& positions = leaf.mVectors.front();
+        positions.resize(count);
+        points::AttributeHandle<math::Vec3<float>> handle(node.constAttributeArray("P"));
+        for (auto iter = node.beginIndexAll(); iter; ++iter) {
+            const math::Vec3<double> pos =
+                iter.getCoord().asVec3d() + math::Vec3<double>(handle.get(*iter));
+            positions[*iter] = math::Vec3<float>(mTransform.indexToWorld(pos));
+        }
+
+        for (size_t i = 1; i < mVectorNames.size(); ++i) {
+            cache(node.constAttributeArray(mVectorNames[i]), count, leaf.mVectors[i]);
+        }
+        leaf.mFloats.resize(mFloatNames.size());
+        for (size_t i = 0; i < mFloatNames.size(); ++i) {
+            cache(node.constAttributeArray(mFloatNames[i]), count, leaf.mFloats[i]);
+        }
+    }
+
+    template <typename ValueT>
+    static inline void cache(const points::AttributeArray& array,
+        const Index count, std::vector<ValueT>& values)
+    {
+        points::AttributeHandle<ValueT> handle(array);
+        values.resize(count);
+        for (Index n = 0; n < count; ++n) values[n] = handle.get(n);
+    }
+
+    inline const std::vector<std::string>& names(float) const { return mFloatNames; }
+    inline const std::vector<std::string>& names(math::Vec3<float>) const { return mVectorNames; }
+
+    static inline const std::vector<std::vector<float>>&
+    values(const Leaf& leaf, float) { return leaf.mFloats; }
+    static inline const std::vector<std::vector<math::Vec3<float>>>&
+    values(const Leaf& leaf, math::Vec3<float>) { return leaf.mVectors; }
+
+    const math::Transform mTransform;
+    Int32Tree mIndex;
+    CoordBBox mBounds;
+    std::vector<Leaf> mLeaves;
+    std::vector<std::string> mFloatNames;
+    std::vector<std::string> mVectorNames;
+    mutable tbb::enumerable_thread_specific<std::unique_ptr<Query>> mQueries;
+};
+
+} // namespace codegen_internal
+
+} // namespace codegen
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_CODEGEN_POINT_NEIGHBOURS_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
@@ -0,0 +1,310 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file codegen/Rasterization.h
+///
+/// @brief  Thread local volumes which point kernels splat values into with
+///   rasterize()
+///
+
+#ifndef OPENVDB_AX_CODEGEN_RASTERIZATION_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_CODEGEN_RASTERIZATION_HAS_BEEN_INCLUDED
+
+#include "../Exceptions.h"
+
+#include <openvdb/openvdb.h>
+#include <openvdb/version.h>
+#include <openvdb/math/Maps.h>
+#include <openvdb/math/Transform.h>
+#include <openvdb/math/Vec3.h>
+#include <openvdb/tools/Composite.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace codegen {
+
+namespace codegen_internal {
+
+/// @brief  Accumulates the values rasterized by the kernels run on a single
+///   thread into sparse float and vec3f volumes owned by the thread. Once
+///   execution completes, the volumes of every thread are summed with a
+///   parallel pairwise reduction and written to the output grids. This
+///   avoids any synchronisation between threads during execution.
+///
+/// @note  Volumes are identified by name and found with a linear search, as
+///   with Reductions. Values are splatted into the eight voxels surrounding
+///   a position, weighted trilinearly, so the sum of a rasterized volume is
+///   the sum of the values rasterized into it. Voxels with a weight of zero
+///   are not activated.
+///
+struct Rasterization
+{
+    /// @brief  The rasterization of every thread taking part in an execution
+    using ThreadRasterization = tbb::enumerable_thread_specific<Rasterization>;
+
+    /// @param  transform  The transform of volumes which don't exist in grids,
+    ///   typically the transform of the points being executed
+    /// @param  grids  The existing output grids. Volumes of the same name are
+    ///   rasterized with the transform of the existing grid.
+    Rasterization(const math::Transform& transform, const GridPtrVec& grids)
+        : mTransform(&transform)
+        , mGrids(&grids)
+        , mFloats()
+        , mVectors()
+        , mConflict() {}
+
+    /// @brief  Splat a value into the volume of the given name at a world
+    ///   space position
+    ///
+    /// @param  name  The name of the volume, not null terminated
+    /// @param  size  The length of the name
+    /// @param  pos   The world space position to rasterize at
+    /// @param  value The value to rasterize
+    ///
+    template <typename ValueT>
+    inline void rasterize(const char* name, const size_t size,
+        const math::Vec3<float>& pos, const ValueT& value)
+    {
+        Slot<ValueT>& slot = this->slot<ValueT>(name, size);
+
+        const math::Vec3<double> ijk = slot.mAffine ?
+            slot.mAffine->applyInverseMap(math::Vec3<double>(pos)) :
+            slot.mTransform->worldToIndex(math::Vec3<double>(pos));
+        const Coord origin = Coord::floor(ijk);
+        const math::Vec3<double> t = ijk - origin.asVec3d();
+
+        for (int i = 0; i < 2; ++i) {
+            const double wx = i ? t[0] : 1.0 - t[0];
+            for (int j = 0; j < 2; ++j) {
+                const double wy = j ? t[1] : 1.0 - t[1];
+                for (int k = 0; k < 2; ++k) {
+                    const double wz = k ? t[2] : 1.0 - t[2];
+                    // don't activate voxels which receive nothing, such as the
+                    // neighbours of a position at the centre of a voxel
+                    const double weight = wx * wy * wz;
+                    if (weight == 0.0) continue;
+                    const Coord xyz = origin.offsetBy(i, j, k);
+                    const ValueT weighted = value * static_cast<float>(weight);
+                    slot.mAccessor.setValue(xyz, slot.mAccessor.getValue(xyz) + weighted);
+                }
+            }
+        }
+    }
+
+    /// @brief  Sum the volumes of all threads into the output grids. Volumes
+    ///   are added to any existing grid of the same name. Otherwise, a new
+    ///   grid with the transform provided on construction is appended. Throws
+    ///   an AXExecutionError if a volume has been rasterized with different
+    ///   value types, or if a grid of the same name exists with a different
+    ///   type.
+    /// @note  The thread local volumes are consumed by the reduction
+    ///
+    static inline void write(ThreadRasterization& threads,
+        const math::Transform& transform,
+        GridPtrVec& grids)
+    {
+        std::string conflict;
+        for (const Rasterization& local : threads) {
+            if (conflict.empty()) conflict = local.mConflict;
+            for (const Slot<float>& slot : local.mFloats) {
+                for (const Rasterization& other : threads) {
+                    if (conflict.empty() && other.find(other.mVectors, slot.mName)) {
+                        conflict = slot.mName;
+                    }
+                }
+            }
+        }
+        if (!conflict.empty()) {
+            OPENVDB_THROW(AXExecutionError, "Unable to rasterize \"" + conflict +
+                "\" as it has been used with different value types, or a grid of "
+                "this name exists with a different type.");
+        }
+
+        std::vector<std::pair<std::string, std::vector<FloatGrid::Ptr>>> floats;
+        std::vector<std::pair<std::string, std::vector<Vec3SGrid::Ptr>>> vectors;
+        for (const Rasterization& local : threads) {
+            gather(local.mFloats, floats);
+            gather(local.mVectors, vectors);
+        }
+        // release the accessors of every thread before their trees are modified
+        threads.clear();
+
+        for (auto& volume : floats) reduce(volume.first, volume.second, transform, grids);
+        for (auto& volume : vectors) reduce(volume.first, volume.second, transform, grids);
+    }
+
+private:
+    template <typename ValueT>
+    using GridType = Grid<typename tree::Tree4<ValueT, 5, 4, 3>::Type>;
+
+    /// @brief  A thread local volume, written through a single accessor
+    template <typename ValueT>
+    struct Slot
+    {
+        using GridT = GridType<ValueT>;
+
+        Slot(const std::string& name, const math::Transform& transform)
+            : mName(name)
+            , mGrid(GridT::create())
+            , mAccessor(mGrid->tree())
+            , mTransform(&transform)
+            , mAffine(transform.isLinear() ?
+                transform.baseMap()->getAffineMap() : math::AffineMap::Ptr()) {}
+
+        std::string mName;
+        typename GridT::Ptr mGrid;
+        typename GridT::Accessor mAccessor;
+        const math::Transform* mTransform;
+        math::AffineMap::Ptr mAffine;
+    };
+
+    inline std::vector<Slot<float>>& slots(float) { return mFloats; }
+    inline std::vector<Slot<math::Vec3<float>>>& slots(math::Vec3<float>) { return mVectors; }
+
+    template <typename ValueT>
+    static inline bool find(const std::vector<Slot<ValueT>>& slots, const std::string& name)
+    {
+        for (const Slot<ValueT>& slot : slots) {
+            if (slot.mName == name) return true;
+        }
+        return false;
+    }
+
+    /// @brief  Find or create the volume of the given name. New volumes use
+    ///   the transform of an existing output grid of the same name.
+    template <typename ValueT>
+    inline Slot<ValueT>& slot(const char* name, const size_t size)
+    {
+        std::vector<Slot<ValueT>>& slots = this->slots(ValueT());
+        for (Slot<ValueT>& slot : slots) {
+            if (slot.mName.size() != size) continue;
+            if (slot.mName.compare(0, size, name, size) != 0) continue;
+            return slot;
+        }
+
+        const std::string str(name, size);
+        const math::Transform* transform = mTransform;
+        for (const GridBase::Ptr& grid : *mGrids) {
+            if (!grid || grid->getName() != str) continue;
+            if (grid->isType<GridType<ValueT>>()) transform = &grid->transform();
+            else if (mConflict.empty()) mConflict = str;
+            break;
+        }
+        slots.emplace_back(str, *transform);
+        return slots.back();
+    }
+
+    template <typename ValueT, typename GridPtrT>
+    static inline void gather(const std::vector<Slot<ValueT>>& slots,
+        std::vector<std::pair<std::string, std::vector<GridPtrT>>>& volumes)
+    {
+        for (const Slot<ValueT>& slot : slots) {
+            auto iter = volumes.begin();
+            for (; iter != volumes.end(); ++iter) {
+                if (iter->first == slot.mName) break;
+            }
+            if (iter == volumes.end()) {
+                volumes.emplace_back(slot.mName, std::vector<GridPtrT>());
+                iter = volumes.end() - 1;
+            }
+            iter->second.emplace_back(slot.mGrid);
+        }
+    }
+
+    /// @brief  Sum the volumes of every thread into the output grid of the
+    ///   given name. Pairs of volumes are summed in parallel, halving the
+    ///   number of volumes with each pass until one remains.
+    template <typename GridPtrT>
+    static inline void reduce(const std::string& name,
+        std::vector<GridPtrT>& volumes,
+        const math::Transform& transform,
+        GridPtrVec& grids)
+    {
+        using GridT = typename GridPtrT::element_type;
+
+        GridPtrT target;
+        for (const GridBase::Ptr& grid : grids) {
+            if (!grid || grid->getName() != name) continue;
+            target = gridPtrCast<GridT>(grid);
+            break;
+        }
+
+        if (target) {
+            volumes.insert(volumes.begin(), target);
+        }
+        else {
+            target = volumes.front();
+            target->setName(name);
+            target->setTransform(transform.copy());
+            grids.emplace_back(target);
+        }
+
+        for (size_t size = volumes.size(); size > 1;) {
+            const size_t half = (size + 1) / 2;
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, size - half),
+                [&volumes, half](const tbb::blocked_range<size_t>& range) {
+                    for (size_t i = range.begin(); i < range.end(); ++i) {
+                        tools::compSum(*volumes[i], *volumes[i + half]);
+                    }
+                });
+            size = half;
+        }
+    }
+
+    const math::Transform* mTransform;
+    const GridPtrVec* mGrids;
+    std::vector<Slot<float>> mFloats;
+    std::vector<Slot<math::Vec3<float>>> mVectors;
+    std::string mConflict;
+};
+
+} // namespace codegen_internal
+
+} // namespace codegen
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_CODEGEN_RASTERIZATION_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
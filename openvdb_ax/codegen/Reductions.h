@@ -0,0 +1,251 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file codegen/Reductions.h
+///
+/// @brief  Thread local accumulators for the reductions performed by AX
+///   kernels with reduceadd(), reducemin() and reducemax()
+///
+
+#ifndef OPENVDB_AX_CODEGEN_REDUCTIONS_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_CODEGEN_REDUCTIONS_HAS_BEEN_INCLUDED
+
+#include "../compiler/CustomData.h"
+#include "../Exceptions.h"
+
+#include <openvdb/Metadata.h>
+#include <openvdb/version.h>
+#include <openvdb/math/Math.h>
+#include <openvdb/math/Vec3.h>
+
+#include <tbb/enumerable_thread_specific.h>
+
+#include <array>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace codegen {
+
+namespace codegen_internal {
+
+/// @brief  Accumulates the values reduced by the kernels run on a single
+///   thread. The executables pass one of these to every kernel call made by
+///   a thread and merge them once execution completes, writing the results
+///   to the CustomData. This avoids any synchronisation between threads
+///   during execution.
+///
+/// @note  Reductions are identified by name. A kernel typically performs
+///   only a handful, so they are found with a linear search which, unlike
+///   a map, doesn't construct a string on every call.
+///
+struct Reductions
+{
+    /// @brief  The operation values are combined with
+    enum Op { ADD = 0, MIN, MAX };
+
+    /// @brief  The reductions of every thread taking part in an execution
+    using ThreadReductions = tbb::enumerable_thread_specific<Reductions>;
+
+    /// @brief  Combine a value into the reduction of the given name. The
+    ///   first value reduced initializes the reduction.
+    ///
+    /// @param  name  The name of the reduction, not null terminated
+    /// @param  size  The length of the name
+    /// @param  op    The operation to combine values with
+    /// @param  value The value to reduce
+    ///
+    template <typename ValueT>
+    inline void reduce(const char* name, const size_t size, const Op op, const ValueT& value)
+    {
+        for (Slot& slot : mSlots) {
+            if (slot.mName.size() != size) continue;
+            if (slot.mName.compare(0, size, name, size) != 0) continue;
+            if (slot.mOp != op || slot.mWrite != &Slot::write<ValueT>) {
+                if (mConflict.empty()) mConflict = slot.mName;
+                return;
+            }
+            combine(slot.mValue, Traits<ValueT>::get(value), op);
+            return;
+        }
+        mSlots.push_back({std::string(name, size), op,
+            &Slot::write<ValueT>, Traits<ValueT>::get(value)});
+    }
+
+    /// @brief  Merge the reductions of another thread into this object
+    inline void merge(const Reductions& other)
+    {
+        if (mConflict.empty()) mConflict = other.mConflict;
+        for (const Slot& in : other.mSlots) {
+            auto iter = mSlots.begin();
+            for (; iter != mSlots.end(); ++iter) {
+                if (iter->mName == in.mName) break;
+            }
+            if (iter == mSlots.end()) {
+                mSlots.emplace_back(in);
+            }
+            else if (iter->mOp != in.mOp || iter->mWrite != in.mWrite) {
+                if (mConflict.empty()) mConflict = in.mName;
+            }
+            else {
+                combine(iter->mValue, in.mValue, in.mOp);
+            }
+        }
+    }
+
+    /// @brief  Write the results to the given custom data. Each result is
+    ///   combined with any existing data of the same name, allowing a
+    ///   reduction to continue over multiple executions. Throws an
+    ///   AXExecutionError if a reduction has been used with different
+    ///   operations or value types, or if the existing data is of a
+    ///   different type.
+    /// @note   If no custom data is provided, the results are discarded
+    ///
+    inline void write(CustomData* const data) const
+    {
+        if (!mConflict.empty()) {
+            OPENVDB_THROW(AXExecutionError, "Reduction \"" + mConflict +
+                "\" has been used with different operations or value types.");
+        }
+        if (!data) return;
+        for (const Slot& slot : mSlots) slot.mWrite(slot, *data);
+    }
+
+    /// @brief  Merge the reductions of all threads and write the results to
+    ///   the given custom data
+    /// @note  Executables may share custom data, so the writes of concurrent
+    ///   executions are serialised. Kernels which read the custom data while
+    ///   it is written are not synchronised with.
+    static inline void write(const ThreadReductions& reductions, CustomData* const data)
+    {
+        Reductions result;
+        for (const Reductions& local : reductions) result.merge(local);
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+        result.write(data);
+    }
+
+private:
+    using Values = std::array<double, 3>;
+
+    /// @brief  Conversion between the supported value types and the double
+    ///   precision values they are accumulated as
+    template <typename ValueT>
+    struct Traits
+    {
+        static inline Values get(const ValueT& value) {
+            return Values{{static_cast<double>(value), 0.0, 0.0}};
+        }
+        static inline ValueT set(const Values& values) {
+            if (!std::is_integral<ValueT>::value) return static_cast<ValueT>(values[0]);
+            return static_cast<ValueT>(math::Clamp(values[0],
+                static_cast<double>(std::numeric_limits<ValueT>::lowest()),
+                static_cast<double>(std::numeric_limits<ValueT>::max())));
+        }
+    };
+
+    template <typename T>
+    struct Traits<math::Vec3<T>>
+    {
+        static inline Values get(const math::Vec3<T>& value) {
+            return Values{{static_cast<double>(value[0]),
+                static_cast<double>(value[1]), static_cast<double>(value[2])}};
+        }
+        static inline math::Vec3<T> set(const Values& values) {
+            return math::Vec3<T>(Traits<T>::set({{values[0], 0.0, 0.0}}),
+                Traits<T>::set({{values[1], 0.0, 0.0}}),
+                Traits<T>::set({{values[2], 0.0, 0.0}}));
+        }
+    };
+
+    static inline void combine(Values& a, const Values& b, const Op op)
+    {
+        for (size_t i = 0; i < 3; ++i) {
+            switch (op) {
+                case ADD : a[i] += b[i]; break;
+                case MIN : a[i] = std::min(a[i], b[i]); break;
+                case MAX : a[i] = std::max(a[i], b[i]); break;
+            }
+        }
+    }
+
+    struct Slot
+    {
+        /// @brief  Writes the result of a slot to custom data. The pointer
+        ///   also identifies the value type of the slot
+        using WriteFn = void(*)(const Slot&, CustomData&);
+
+        template <typename ValueT>
+        static void write(const Slot& slot, CustomData& data)
+        {
+            using MetadataT = TypedMetadata<ValueT>;
+            Values result = slot.mValue;
+            if (data.hasData(slot.mName)) {
+                const MetadataT* const existing = data.getData<MetadataT>(slot.mName);
+                if (!existing) {
+                    OPENVDB_THROW(AXExecutionError, "Unable to write reduction \"" +
+                        slot.mName + "\" as custom data of this name exists with a "
+                        "different type.");
+                }
+                combine(result, Traits<ValueT>::get(existing->value()), slot.mOp);
+            }
+            data.insertData<MetadataT>(slot.mName,
+                typename MetadataT::Ptr(new MetadataT(Traits<ValueT>::set(result))));
+        }
+
+        std::string mName;
+        Op mOp;
+        WriteFn mWrite;
+        Values mValue;
+    };
+
+    std::vector<Slot> mSlots;
+    std::string mConflict;
+};
+
+} // namespace codegen_internal
+
+} // namespace codegen
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_CODEGEN_REDUCTIONS_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
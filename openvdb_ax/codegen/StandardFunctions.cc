@@ -39,21 +39,22 @@
 
 #include "Functions.h"
 #include "FunctionTypes.h"
+#include "PointComputeGenerator.h"
+#include "Reductions.h"
 #include "Types.h"
 #include "Utils.h"
+#include "VolumeComputeGenerator.h"
 
 #include "../Exceptions.h"
 #include "../math/OpenSimplexNoise.h"
 #include "../compiler/CompilerOptions.h"
 #include "../compiler/CustomData.h"
 
-#include <tbb/enumerable_thread_specific.h>
-
 #include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/ValueSymbolTable.h>
 
 #include <unordered_map>
 #include <functional>
-#include <random>
 #include <cmath>
 #include <stddef.h>
 #include <stdint.h>
@@ -68,19 +69,178 @@ namespace codegen {
 namespace
 {
 
-// Reduce a size_t hash down into an unsigned int, taking all bits in the
-// size_t into account. We achieve this by repeatedly XORing as many bytes
-// that fit into an unsigned int, and then shift those bytes out of the
-// hash. We repeat until we have no bits left in the hash.
-template <typename SeedType>
-inline SeedType hashToSeed(size_t hash) {
-    SeedType seed = 0;
-    do {
-        seed ^= (SeedType) hash;
-    } while (hash >>= sizeof(SeedType) * 8);
-    return seed;
+/// @brief  IR implementations of the counter based random number generators
+///   used by rand and rand32. Each generator is a pure function of a 64 bit
+///   key and counter (Widynski's Squares RNG), so results do not depend on
+///   any state shared between elements or threads.
+namespace rng
+{
+
+// Rotate a 64 bit value by 32 bits
+inline llvm::Value* swapHalves(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    return B.CreateOr(B.CreateLShr(x, 32), B.CreateShl(x, 32));
+}
+
+// x * x + y, rotated by 32 bits
+inline llvm::Value* squaresRound(llvm::IRBuilder<>& B, llvm::Value* x, llvm::Value* y)
+{
+    return swapHalves(B, B.CreateAdd(B.CreateMul(x, x), y));
+}
+
+/// @brief  Squares RNG with five rounds, returning 64 random bits
+inline llvm::Value* squares64(llvm::IRBuilder<>& B, llvm::Value* counter, llvm::Value* key)
+{
+    llvm::Value* y = B.CreateMul(counter, key);
+    llvm::Value* z = B.CreateAdd(y, key);
+    llvm::Value* x = squaresRound(B, y, y);
+    x = squaresRound(B, x, z);
+    x = squaresRound(B, x, y);
+    llvm::Value* t = B.CreateAdd(B.CreateMul(x, x), z);
+    x = swapHalves(B, t);
+    return B.CreateXor(t, B.CreateLShr(B.CreateAdd(B.CreateMul(x, x), y), 32));
+}
+
+/// @brief  Squares RNG with four rounds, returning 32 random bits in the
+///   lower half of a 64 bit value
+inline llvm::Value* squares32(llvm::IRBuilder<>& B, llvm::Value* counter, llvm::Value* key)
+{
+    llvm::Value* y = B.CreateMul(counter, key);
+    llvm::Value* z = B.CreateAdd(y, key);
+    llvm::Value* x = squaresRound(B, y, y);
+    x = squaresRound(B, x, z);
+    x = squaresRound(B, x, y);
+    return B.CreateLShr(B.CreateAdd(B.CreateMul(x, x), z), 32);
+}
+
+/// @brief  Mix the bits of a 64 bit value (the splitmix64 finalizer) to
+///   produce a key. Keys are forced odd.
+inline llvm::Value* mix(llvm::IRBuilder<>& B, llvm::Value* z)
+{
+    z = B.CreateMul(B.CreateXor(z, B.CreateLShr(z, 30)), B.getInt64(0xbf58476d1ce4e5b9ULL));
+    z = B.CreateMul(B.CreateXor(z, B.CreateLShr(z, 27)), B.getInt64(0x94d049bb133111ebULL));
+    z = B.CreateXor(z, B.CreateLShr(z, 31));
+    return B.CreateOr(z, B.getInt64(1));
+}
+
+/// @brief  Convert a seed of any scalar type to a key. Floating point seeds
+///   are keyed by their bit representation, with -0 and +0 producing the same
+///   key.
+inline llvm::Value* seedToKey(llvm::IRBuilder<>& B, llvm::Value* seed)
+{
+    llvm::Type* type = seed->getType();
+    if (type->isFloatingPointTy()) {
+        seed = B.CreateFPExt(seed, B.getDoubleTy());
+        llvm::Value* zero = B.CreateFCmpOEQ(seed, llvm::ConstantFP::get(B.getDoubleTy(), 0.0));
+        seed = B.CreateSelect(zero, B.getInt64(0), B.CreateBitCast(seed, B.getInt64Ty()));
+    }
+    else {
+        seed = B.CreateSExtOrTrunc(seed, B.getInt64Ty());
+    }
+    return mix(B, seed);
+}
+
+/// @brief  Compute a key which uniquely identifies the element (voxel or
+///   point) being processed by the current kernel, used by unseeded calls.
+///   Voxels are identified by their index space coordinate, points by the
+///   origin of their leaf and their index within it.
+inline llvm::Value* elementKey(llvm::IRBuilder<>& B)
+{
+    llvm::Function* compute = B.GetInsertBlock()->getParent();
+    llvm::Value* coord = nullptr;
+    llvm::Value* index = B.getInt64(0);
+
+    if (compute->getName() == VolumeKernel::getDefaultName()) {
+        coord = extractArgument(compute, "coord_is");
+        assert(coord);
+    }
+    else if (compute->getName() == PointKernel::getDefaultName()) {
+        llvm::Value* leafData = extractArgument(compute, "leaf_data");
+        llvm::Value* pointIndex = extractArgument(compute, "point_index");
+        assert(leafData);
+        assert(pointIndex);
+
+        // the leaf origin is retrieved with the internal _pointleaforigin
+        // function (see PointFunctions.cc)
+        coord = insertStaticAlloca(B, llvm::ArrayType::get(B.getInt32Ty(), 3));
+        ax_pointleaforigin(FunctionOptions())->execute({ leafData, coord }, B);
+        index = pointIndex;
+    }
+
+    if (!coord) return mix(B, index);
+
+    // combine the index and each coordinate component with a different odd
+    // multiplier before mixing
+    static const uint64_t multipliers[3] = {
+        0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL
+    };
+    llvm::Value* key = B.CreateMul(index, B.getInt64(0xd6e8feb86659fd93ULL));
+    for (int i = 0; i < 3; ++i) {
+        llvm::Value* element = B.CreateLoad(B.CreateConstGEP2_64(coord, 0, i));
+        element = B.CreateZExt(element, B.getInt64Ty());
+        key = B.CreateXor(key, B.CreateMul(element, B.getInt64(multipliers[i])));
+    }
+    return mix(B, key);
 }
 
+/// @brief  Return the key and counter of a generator for the current kernel,
+///   creating them at the start of the kernel if they do not exist. The key
+///   is initialized from the current element.
+inline std::pair<llvm::Value*, llvm::Value*>
+state(llvm::IRBuilder<>& B, const std::string& name)
+{
+    llvm::Function* compute = B.GetInsertBlock()->getParent();
+    llvm::ValueSymbolTable* table = compute->getValueSymbolTable();
+    llvm::Value* key = table->lookup(name + ".key");
+    llvm::Value* counter = table->lookup(name + ".counter");
+    if (key && counter) return { key, counter };
+
+    auto IP = B.saveIP();
+    llvm::BasicBlock& entry = compute->getEntryBlock();
+    B.SetInsertPoint(&entry, entry.getFirstInsertionPt());
+    key = B.CreateAlloca(B.getInt64Ty(), nullptr, name + ".key");
+    counter = B.CreateAlloca(B.getInt64Ty(), nullptr, name + ".counter");
+    B.CreateStore(elementKey(B), key);
+    B.CreateStore(B.getInt64(0), counter);
+    B.restoreIP(IP);
+    return { key, counter };
+}
+
+/// @brief  Generate a random double in the range [0,1). If a seed is
+///   provided, the generator is reset to the start of the sequence for the
+///   seed. Otherwise the current sequence is advanced.
+/// @param B  The IRBuilder
+/// @param seed  The seed, or a nullptr
+/// @param name  The name of the generator state
+/// @param bits  The number of random bits to generate, 32 or 53
+inline llvm::Value*
+generate(llvm::IRBuilder<>& B, llvm::Value* seed, const std::string& name, const int bits)
+{
+    const auto keyAndCounter = state(B, name);
+    if (seed) {
+        B.CreateStore(seedToKey(B, seed), keyAndCounter.first);
+        B.CreateStore(B.getInt64(0), keyAndCounter.second);
+    }
+
+    llvm::Value* key = B.CreateLoad(keyAndCounter.first);
+    llvm::Value* counter = B.CreateLoad(keyAndCounter.second);
+    B.CreateStore(B.CreateAdd(counter, B.getInt64(1)), keyAndCounter.second);
+
+    llvm::Value* result;
+    if (bits == 32) {
+        result = squares32(B, counter, key);
+    }
+    else {
+        assert(bits == 53);
+        result = B.CreateLShr(squares64(B, counter, key), 64 - bits);
+    }
+    result = B.CreateUIToFP(result, B.getDoubleTy());
+    return B.CreateFMul(result,
+        llvm::ConstantFP::get(B.getDoubleTy(), std::ldexp(1.0, -bits)));
+}
+
+} // namespace rng
+
 struct SimplexNoise
 {
     // Open simplex noise - Visually axis-decorrelated coherent noise algorithm
@@ -94,6 +254,17 @@ struct SimplexNoise
         // Noise::eval returns a number between -1 and 1
         return (result + 1.0) * 0.5;
     }
+
+    // Evaluate the noise at n positions, see OSN::OSNoise::evalBatch
+    inline static void noiseBatch(const double* x, const double* y, const double* z,
+        double* result, const int64_t n)
+    {
+        static const OSN::OSNoise noiseGenerator = OSN::OSNoise();
+        noiseGenerator.evalBatch<double>(x, y, z, result, n);
+        for (int64_t i = 0; i < n; ++i) {
+            result[i] = (result[i] + 1.0) * 0.5;
+        }
+    }
 };
 
 }
@@ -807,149 +978,69 @@ inline FunctionGroup::UniquePtr axfit(const FunctionOptions& op)
 
 inline FunctionGroup::UniquePtr axrand(const FunctionOptions& op)
 {
-    struct Rand
+    static auto generate =
+        [](const std::vector<llvm::Value*>& args,
+           llvm::IRBuilder<>& B) -> llvm::Value*
     {
-        static double rand(const std::mt19937_64::result_type* seed)
-        {
-            using ThreadLocalEngineContainer =
-                tbb::enumerable_thread_specific<std::mt19937_64>;
-            static ThreadLocalEngineContainer ThreadLocalEngines;
-            static std::uniform_real_distribution<double> Generator(0.0,1.0);
-            std::mt19937_64& engine = ThreadLocalEngines.local();
-            if (seed) {
-                engine.seed(static_cast<std::mt19937_64::result_type>(*seed));
-            }
-            return Generator(engine);
-        }
-
-        static double rand() { return Rand::rand(nullptr); }
-
-        static double rand(double seed)
-        {
-            const std::mt19937_64::result_type hash =
-                static_cast<std::mt19937_64::result_type>(std::hash<double>()(seed));
-            return Rand::rand(&hash);
-        }
-
-        static double rand(int64_t seed)
-        {
-            const std::mt19937_64::result_type hash =
-                static_cast<std::mt19937_64::result_type>(seed);
-            return Rand::rand(&hash);
-        }
+        assert(args.size() <= 1);
+        return rng::generate(B, args.empty() ? nullptr : args.front(), "ax.rand", 53);
     };
 
     return FunctionBuilder("rand")
-        .addSignature<double()>((double(*)())(Rand::rand))
-        .addSignature<double(double)>((double(*)(double))(Rand::rand))
-        .addSignature<double(int64_t)>((double(*)(int64_t))(Rand::rand))
+        .addSignature<double()>(generate)
+        .addSignature<double(double)>(generate)
+        .addSignature<double(int64_t)>(generate)
         .setArgumentNames({"seed"})
-        // We can't constant fold rand even if it's been called with a constant as
-        // it will leave the generator in a different state in comparison to other
-        // threads and, as it relies on an internal state, doesn't respect branching
-        // etc. We also can't use a different generate for constant calls as subsequent
-        // calls to rand() without an argument won't know to advance the generator.
+        .addDependency("_pointleaforigin")
+        // The generator state is held by the kernel so rand must be embedded.
+        // It can't be constant folded, as calls with a seed also reset the
+        // state used by subsequent calls without a seed.
+        .setEmbedIR(true)
         .setConstantFold(false)
         .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
         .setDocumentation("Creates a random number based on the provided "
             "seed. The number will be in the range of 0 to 1. The same number is "
             "produced for the same seed. Note that if rand is called without a seed "
-            "the previous state of the random number generator is advanced for the "
-            "currently processing element. This state is determined by the last call to "
-            "rand() with a given seed. If rand is not called with a seed, the generator "
-            "advances continuously across different elements which can produce non-"
-            "deterministic results. It is important that rand is always called with a "
-            "seed at least once for deterministic results.")
+            "the generator advances from the last call to rand() with a seed made by "
+            "the currently processing element. If no seed has been provided, the "
+            "generator is seeded from the element being processed (the coordinate of "
+            "a voxel, or the leaf and index of a point). Results are deterministic "
+            "and do not depend on the order in which elements are processed.")
         .get();
 }
 
 inline FunctionGroup::UniquePtr axrand32(const FunctionOptions& op)
 {
-    struct Rand
+    static auto generate =
+        [](const std::vector<llvm::Value*>& args,
+           llvm::IRBuilder<>& B) -> llvm::Value*
     {
-        static double rand(const std::mt19937::result_type* seed)
-        {
-            using ThreadLocalEngineContainer =
-                tbb::enumerable_thread_specific<std::mt19937>;
-            // Obtain thread-local engine (or create if it doesn't exist already).
-            static ThreadLocalEngineContainer ThreadLocalEngines;
-            static std::uniform_real_distribution<double> Generator(0.0,1.0);
-            std::mt19937& engine = ThreadLocalEngines.local();
-            if (seed) {
-                engine.seed(static_cast<std::mt19937::result_type>(*seed));
-            }
-            // Once we have seeded the random number generator, we then evaluate it,
-            // which returns a floating point number in the range [0,1)
-            return Generator(engine);
-        }
-
-        static double rand() { return Rand::rand(nullptr); }
-
-        static double rand(double seed)
-        {
-            // We initially hash the double-precision seed with `std::hash`. The
-            // important thing about the hash is that it produces a "reliable" hash value,
-            // taking into account a number of special cases for floating point numbers
-            // (e.g. -0 and +0 must return the same hash value, etc). Other than these
-            // special cases, this function will usually just copy the binary
-            // representation of a float into the resultant `size_t`
-            const size_t hash = std::hash<double>()(seed);
-
-            // Now that we have a reliable hash (with special floating-point cases taken
-            // care of), we proceed to use this hash to seed a random number generator.
-            // The generator takes an unsigned int, which is not guaranteed to be the
-            // same size as size_t.
-            //
-            // So, we must convert it. I should note that the OpenVDB math libraries will
-            // do this for us, but its implementation static_casts `size_t` to `unsigned int`,
-            // and because `std::hash` returns a binary copy of the original
-            // double-precision number in almost all cases, this ends up producing noticable
-            // patterns in the result (e.g. by truncating the upper 4 bytes, values of 1.0,
-            // 2.0, 3.0, and 4.0 all return the same hash value because their lower 4 bytes
-            // are all zero).
-            //
-            // We use the `hashToSeed` function to reduce our `size_t` to an `unsigned int`,
-            // whilst taking all bits in the `size_t` into account.
-            // On some architectures std::uint_fast32_t may be size_t, but we always hash to
-            // be consistent.
-            const std::mt19937::result_type uintseed =
-                static_cast<std::mt19937::result_type>(hashToSeed<uint32_t>(hash));
-            return Rand::rand(&uintseed);
-        }
-
-        static double rand(int32_t seed)
-        {
-            const std::mt19937::result_type uintseed =
-                static_cast<std::mt19937::result_type>(seed);
-            return Rand::rand(&uintseed);
-        }
+        assert(args.size() <= 1);
+        return rng::generate(B, args.empty() ? nullptr : args.front(), "ax.rand32", 32);
     };
 
     return FunctionBuilder("rand32")
-        .addSignature<double()>((double(*)())(Rand::rand))
-        .addSignature<double(double)>((double(*)(double))(Rand::rand))
-        .addSignature<double(int32_t)>((double(*)(int32_t))(Rand::rand))
+        .addSignature<double()>(generate)
+        .addSignature<double(double)>(generate)
+        .addSignature<double(int32_t)>(generate)
         .setArgumentNames({"seed"})
-        // We can't constant fold rand even if it's been called with a constant as
-        // it will leave the generator in a different state in comparison to other
-        // threads and, as it relies on an internal state, doesn't respect branching
-        // etc. We also can't use a different generate for constant calls as subsequent
-        // calls to rand() without an argument won't know to advance the generator.
+        .addDependency("_pointleaforigin")
+        // See rand
+        .setEmbedIR(true)
         .setConstantFold(false)
         .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
         .setDocumentation("Creates a random number based on the provided 32 bit "
             "seed. The number will be in the range of 0 to 1. The same number is "
             "produced for the same seed. "
             "NOTE: This function does not share the same random number generator as "
-            "rand(). rand32() may provide a higher throughput on some architectures, "
-            "but will produce different results to rand(). "
-            "NOTE: If rand32 is called without a seed the previous state of the random "
-            "number generator is advanced for the currently processing element. This "
-            "state is determined by the last call to rand32() with a given seed. If "
-            "rand32 is not called with a seed, the generator advances continuously "
-            "across different elements which can produce non-deterministic results. "
-            "It is important that rand32 is always called with a seed at least once "
-            "for deterministic results.")
+            "rand(). rand32() generates 32 random bits rather than 53, which may "
+            "provide a higher throughput on some architectures, but will produce "
+            "different results to rand(). "
+            "NOTE: If rand32 is called without a seed the generator advances from the "
+            "last call to rand32() with a seed made by the currently processing "
+            "element. If no seed has been provided, the generator is seeded from the "
+            "element being processed. Results are deterministic and do not depend on "
+            "the order in which elements are processed.")
         .get();
 }
 
@@ -1870,8 +1961,45 @@ inline FunctionGroup::UniquePtr axtranspose(const FunctionOptions& op)
 
 // Noise
 
+inline FunctionGroup::UniquePtr axsimplexnoisebatch(const FunctionOptions& op)
+{
+    return FunctionBuilder("_simplexnoisebatch")
+        .addSignature<void(const double*, const double*, const double*, double*, int64_t)>
+            (SimplexNoise::noiseBatch, "ax.simplexnoise.batch")
+            .setArgumentNames({"x", "y", "z", "result", "n"})
+            .addParameterAttribute(0, llvm::Attribute::ReadOnly)
+            .addParameterAttribute(1, llvm::Attribute::ReadOnly)
+            .addParameterAttribute(2, llvm::Attribute::ReadOnly)
+            .addParameterAttribute(3, llvm::Attribute::WriteOnly)
+            .addFunctionAttribute(llvm::Attribute::ArgMemOnly)
+            .addFunctionAttribute(llvm::Attribute::NoUnwind)
+            .setConstantFold(false)
+        .setPreferredImpl(FunctionBuilder::C)
+        .setDocumentation("Internal function for computing simplex noise at an array "
+            "of coordinates. Called by the vectorized variants of simplexnoise.")
+        .get();
+}
+
 inline FunctionGroup::UniquePtr axsimplexnoise(const FunctionOptions& op)
 {
+    // The IR implementations forward to the (x, y, z) C binding, which the
+    // loop vectorizer can replace with its batched variants when a vector
+    // library is in use (see VectorFunctions.h)
+    auto generate =
+        [op](const std::vector<llvm::Value*>& args,
+             llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        std::vector<llvm::Value*> xyz;
+        if (args[0]->getType()->isPointerTy()) {
+            arrayUnpack(args[0], xyz, B, /*load*/true);
+        }
+        else {
+            xyz = args;
+            xyz.resize(3, LLVMType<double>::get(B.getContext(), 0.0));
+        }
+        return axsimplexnoise(op)->execute(xyz, B);
+    };
+
     static auto simplexnoisex = [](double x) -> double {
         return SimplexNoise::noise(x, 0.0, 0.0);
     };
@@ -1886,18 +2014,27 @@ inline FunctionGroup::UniquePtr axsimplexnoise(const FunctionOptions& op)
     };
 
     return FunctionBuilder("simplexnoise")
-        .addSignature<double(double)>(simplexnoisex)
+        .addSignature<double(double)>(generate, simplexnoisex)
             .setArgumentNames({"x"})
+            .addFunctionAttribute(llvm::Attribute::NoUnwind)
+            .addFunctionAttribute(llvm::Attribute::AlwaysInline)
             .setConstantFold(false)
-        .addSignature<double(double, double)>(simplexnoisexy)
+        .addSignature<double(double, double)>(generate, simplexnoisexy)
             .setArgumentNames({"x", "y"})
+            .addFunctionAttribute(llvm::Attribute::NoUnwind)
+            .addFunctionAttribute(llvm::Attribute::AlwaysInline)
             .setConstantFold(false)
         .addSignature<double(double,double,double)>(simplexnoisexyz)
             .setArgumentNames({"x", "y", "z"})
+            .addDependency("_simplexnoisebatch")
+            .addFunctionAttribute(llvm::Attribute::ReadNone)
+            .addFunctionAttribute(llvm::Attribute::NoUnwind)
             .setConstantFold(false)
-        .addSignature<double(const openvdb::math::Vec3<double>*)>(simplexnoisev)
+        .addSignature<double(const openvdb::math::Vec3<double>*)>(generate, simplexnoisev)
             .setArgumentNames({"pos"})
             .addParameterAttribute(0, llvm::Attribute::ReadOnly)
+            .addFunctionAttribute(llvm::Attribute::NoUnwind)
+            .addFunctionAttribute(llvm::Attribute::AlwaysInline)
             .setConstantFold(false)
         .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
         .setDocumentation("Compute simplex noise at coordinates x, y and z. Coordinates which are "
@@ -2241,6 +2378,125 @@ inline FunctionGroup::UniquePtr axexternalv(const FunctionOptions& op)
         .get();
 }
 
+inline FunctionGroup::UniquePtr ax_reduce(const FunctionOptions& op)
+{
+    using Reductions = codegen_internal::Reductions;
+
+    static auto reduce = [](void* const data, const AXString* const name,
+        const int32_t operation, auto value)
+    {
+        static_cast<Reductions*>(data)->reduce(name->ptr, name->size,
+            static_cast<Reductions::Op>(operation), value);
+    };
+
+    static auto reducev = [](void* const data, const AXString* const name,
+        const int32_t operation, auto value)
+    {
+        using ValueType = typename std::remove_pointer<decltype(value)>::type;
+        static_cast<Reductions*>(data)->reduce<ValueType>(name->ptr, name->size,
+            static_cast<Reductions::Op>(operation), *value);
+    };
+
+    using ReduceF = void(void*, const AXString* const, const int32_t, float);
+    using ReduceI = void(void*, const AXString* const, const int32_t, int32_t);
+    using ReduceV3F = void(void*, const AXString* const, const int32_t, openvdb::math::Vec3<float>*);
+
+    // scalar values are passed by value, so only the vector signature can
+    // mark its value as read only
+    return FunctionBuilder("_reduce")
+        .addSignature<ReduceF>((ReduceF*)(reduce))
+        .addSignature<ReduceI>((ReduceI*)(reduce))
+        .setArgumentNames({"reductions", "str", "op", "value"})
+        .addParameterAttribute(1, llvm::Attribute::ReadOnly)
+        .setConstantFold(false)
+        .addSignature<ReduceV3F>((ReduceV3F*)(reducev))
+        .setArgumentNames({"reductions", "str", "op", "value"})
+        .addParameterAttribute(1, llvm::Attribute::ReadOnly)
+        .addParameterAttribute(3, llvm::Attribute::ReadOnly)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Internal function for reducing a value into the "
+            "reductions of the current thread.")
+        .get();
+}
+
+/// @brief  Builds the reduce functions, which only differ in the operation
+///   values are combined with
+inline FunctionGroup::UniquePtr
+axreduce(const FunctionOptions& op,
+    const char* name,
+    const codegen_internal::Reductions::Op operation,
+    const char* doc)
+{
+    auto generate =
+        [op, operation](const std::vector<llvm::Value*>& args,
+           llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        // Pull out the reductions of the current thread from the parent function
+        llvm::Function* compute = B.GetInsertBlock()->getParent();
+        assert(compute);
+        llvm::Value* reductions = extractArgument(compute, "reductions");
+        if (!reductions) {
+            OPENVDB_THROW(AXCompilerError, "Reduce functions can only be called "
+                "from point and volume kernels.");
+        }
+
+        std::vector<llvm::Value*> inputs;
+        inputs.reserve(2 + args.size());
+        inputs.emplace_back(reductions);
+        inputs.emplace_back(args[0]);
+        inputs.emplace_back(LLVMType<int32_t>::get(B.getContext(), static_cast<int32_t>(operation)));
+        inputs.emplace_back(args[1]);
+        return ax_reduce(op)->execute(inputs, B);
+    };
+
+    return FunctionBuilder(name)
+        .addSignature<void(const AXString*, float)>(generate)
+        .addSignature<void(const AXString*, int32_t)>(generate)
+        .addSignature<void(const AXString*, openvdb::math::Vec3<float>*)>(generate)
+        .setArgumentNames({"str", "value"})
+        .addDependency("_reduce")
+        .addParameterAttribute(0, llvm::Attribute::ReadOnly)
+        .setConstantFold(false)
+        .setEmbedIR(true) // always embed as we pass through function param "reductions"
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation(doc)
+        .get();
+}
+
+inline FunctionGroup::UniquePtr axreduceadd(const FunctionOptions& op)
+{
+    return axreduce(op, "reduceadd", codegen_internal::Reductions::ADD,
+        "Add a value of type 'float', 'int' or 'vector float' to the sum with "
+        "the given name. Each thread accumulates its own sum, which are combined "
+        "once execution completes and written to the Custom data provided to "
+        "the AX compiler. If the data already exists, the sum is added to it. "
+        "The Custom data must not be read by other executions until this one "
+        "completes.");
+}
+
+inline FunctionGroup::UniquePtr axreducemin(const FunctionOptions& op)
+{
+    return axreduce(op, "reducemin", codegen_internal::Reductions::MIN,
+        "Reduce a value of type 'float', 'int' or 'vector float' to the minimum "
+        "with the given name. Vectors are reduced per component. Each thread "
+        "accumulates its own minimum, which are combined once execution completes "
+        "and written to the Custom data provided to the AX compiler. If the data "
+        "already exists, it is included in the minimum. The Custom data must not "
+        "be read by other executions until this one completes.");
+}
+
+inline FunctionGroup::UniquePtr axreducemax(const FunctionOptions& op)
+{
+    return axreduce(op, "reducemax", codegen_internal::Reductions::MAX,
+        "Reduce a value of type 'float', 'int' or 'vector float' to the maximum "
+        "with the given name. Vectors are reduced per component. Each thread "
+        "accumulates its own maximum, which are combined once execution completes "
+        "and written to the Custom data provided to the AX compiler. If the data "
+        "already exists, it is included in the maximum. The Custom data must not "
+        "be read by other executions until this one completes.");
+}
+
 ///////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////
 
@@ -2314,6 +2570,7 @@ void insertStandardFunctions(FunctionRegistry& registry,
 
     add("simplexnoise", axsimplexnoise);
     add("curlsimplexnoise", axcurlsimplexnoise);
+    add("_simplexnoisebatch", axsimplexnoisebatch, true);
 
     // trig
 
@@ -2344,6 +2601,10 @@ void insertStandardFunctions(FunctionRegistry& registry,
     add("_external", ax_external, true);
     add("external", axexternal);
     add("externalv", axexternalv);
+    add("_reduce", ax_reduce, true);
+    add("reduceadd", axreduceadd);
+    add("reducemin", axreducemin);
+    add("reducemax", axreducemax);
 }
 
 
@@ -0,0 +1,548 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file codegen/VectorFunctions.cc
+///
+/// @brief  Definitions of AX's bundled vector math library. The
+///   approximations are those of the cephes library (as used by sse_mathfun),
+///   generated directly as llvm IR so that they can be compiled for the
+///   target of the module and inlined where profitable.
+///
+
+#include "VectorFunctions.h"
+
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Module.h>
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace codegen {
+
+namespace
+{
+
+using VectorKernel = llvm::Value*(*)(llvm::IRBuilder<>&, llvm::Value*);
+
+/// @brief  A vector function family, mapping a scalar intrinsic to its 4, 8
+///   and 16 wide variants. mOutOfRange returns a per element mask of values
+///   which must fall back to the scalar intrinsic.
+struct VectorFunction
+{
+    const char* mScalar;
+    const char* mVector[3];
+    VectorKernel mOutOfRange;
+    VectorKernel mKernel;
+};
+
+const unsigned sVectorWidths[3] = { 4, 8, 16 };
+
+inline llvm::Type* vectorType(llvm::Type* element, const unsigned width)
+{
+#if LLVM_VERSION_MAJOR < 11
+    return llvm::VectorType::get(element, width);
+#else
+    return llvm::FixedVectorType::get(element, width);
+#endif
+}
+
+inline llvm::Type* integerType(llvm::Type* type)
+{
+    return llvm::VectorType::getInteger(llvm::cast<llvm::VectorType>(type));
+}
+
+inline llvm::Constant* fpConstant(llvm::Type* type, const double value)
+{
+    return llvm::ConstantFP::get(type, value);
+}
+
+inline llvm::Constant* intConstant(llvm::Type* type, const int64_t value)
+{
+    return llvm::ConstantInt::get(type, static_cast<uint64_t>(value), /*signed*/value < 0);
+}
+
+/// @brief  Evaluate a polynomial in x with Horner's method, coefficients
+///   ordered from the highest degree
+inline llvm::Value*
+polynomial(llvm::IRBuilder<>& B, llvm::Value* x, const std::initializer_list<double> coeffs)
+{
+    llvm::Type* type = x->getType();
+    auto iter = coeffs.begin();
+    llvm::Value* result = fpConstant(type, *iter);
+    for (++iter; iter != coeffs.end(); ++iter) {
+        result = B.CreateFAdd(B.CreateFMul(result, x), fpConstant(type, *iter));
+    }
+    return result;
+}
+
+inline llvm::Value* absolute(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    llvm::Type* intTy = integerType(x->getType());
+    llvm::Value* bits = B.CreateAnd(B.CreateBitCast(x, intTy), intConstant(intTy, 0x7fffffff));
+    return B.CreateBitCast(bits, x->getType());
+}
+
+/// @brief  Floor through integer conversion, only valid for values which fit
+///   into an int32. Avoids llvm.floor, which is scalarized without SSE4.1
+inline llvm::Value* floorInt(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    llvm::Type* type = x->getType();
+    llvm::Value* t = B.CreateSIToFP(B.CreateFPToSI(x, integerType(type)), type);
+    return B.CreateSelect(B.CreateFCmpOGT(t, x), B.CreateFSub(t, fpConstant(type, 1.0)), t);
+}
+
+// sin, cos
+
+llvm::Value* sincosRange(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    // the three part reduction loses precision past 8192. Unordered
+    // comparisons also catch NaN values
+    return B.CreateFCmpUGT(absolute(B, x), fpConstant(x->getType(), 8192.0));
+}
+
+llvm::Value* sincos(llvm::IRBuilder<>& B, llvm::Value* x, const bool cosine)
+{
+    llvm::Type* type = x->getType();
+    llvm::Type* intTy = integerType(type);
+    llvm::Value* bits = B.CreateBitCast(x, intTy);
+    llvm::Value* ax = absolute(B, x);
+
+    // octant j = (int(|x| * 4/pi) + 1) & ~1
+    llvm::Value* j = B.CreateFPToSI(B.CreateFMul(ax, fpConstant(type, 1.27323954473516)), intTy);
+    j = B.CreateAnd(B.CreateAdd(j, intConstant(intTy, 1)), intConstant(intTy, -2));
+    llvm::Value* y = B.CreateSIToFP(j, type);
+
+    llvm::Value* sign = nullptr;
+    if (cosine) {
+        j = B.CreateSub(j, intConstant(intTy, 2));
+        sign = B.CreateShl(B.CreateAnd(B.CreateNot(j), intConstant(intTy, 4)), intConstant(intTy, 29));
+    }
+    else {
+        sign = B.CreateXor(B.CreateAnd(bits, intConstant(intTy, 0x80000000)),
+            B.CreateShl(B.CreateAnd(j, intConstant(intTy, 4)), intConstant(intTy, 29)));
+    }
+    llvm::Value* sinPoly = B.CreateICmpEQ(B.CreateAnd(j, intConstant(intTy, 2)), intConstant(intTy, 0));
+
+    // extended precision modular arithmetic, r = |x| - y * pi/4
+    llvm::Value* r = B.CreateFSub(ax, B.CreateFMul(y, fpConstant(type, 0.78515625)));
+    r = B.CreateFSub(r, B.CreateFMul(y, fpConstant(type, 2.4187564849853515625e-4)));
+    r = B.CreateFSub(r, B.CreateFMul(y, fpConstant(type, 3.77489497744594108e-8)));
+    llvm::Value* z = B.CreateFMul(r, r);
+
+    // cos(r) = 1 - z/2 + z^2 * P(z)
+    llvm::Value* c = polynomial(B, z,
+        { 2.443315711809948E-005, -1.388731625493765E-003, 4.166664568298827E-002 });
+    c = B.CreateFMul(B.CreateFMul(c, z), z);
+    c = B.CreateFAdd(B.CreateFSub(c, B.CreateFMul(z, fpConstant(type, 0.5))), fpConstant(type, 1.0));
+
+    // sin(r) = r + r * z * P(z)
+    llvm::Value* s = polynomial(B, z,
+        { -1.9515295891E-4, 8.3321608736E-3, -1.6666654611E-1 });
+    s = B.CreateFAdd(B.CreateFMul(B.CreateFMul(s, z), r), r);
+
+    llvm::Value* result = B.CreateBitCast(B.CreateSelect(sinPoly, s, c), intTy);
+    return B.CreateBitCast(B.CreateXor(result, sign), type);
+}
+
+llvm::Value* vsin(llvm::IRBuilder<>& B, llvm::Value* x) { return sincos(B, x, false); }
+llvm::Value* vcos(llvm::IRBuilder<>& B, llvm::Value* x) { return sincos(B, x, true); }
+
+// exp, exp2
+
+llvm::Value* expRange(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    // keep the result and 2^n normal
+    return B.CreateFCmpUGT(absolute(B, x), fpConstant(x->getType(), 87.0));
+}
+
+llvm::Value* exp2Range(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    return B.CreateFCmpUGT(absolute(B, x), fpConstant(x->getType(), 126.0));
+}
+
+/// @brief  Compute e^r * 2^n for |r| <= ln(2)/2 and an integral n
+llvm::Value* expScale(llvm::IRBuilder<>& B, llvm::Value* r, llvm::Value* n)
+{
+    llvm::Type* type = r->getType();
+    llvm::Type* intTy = integerType(type);
+
+    llvm::Value* z = B.CreateFMul(r, r);
+    llvm::Value* y = polynomial(B, r, { 1.9875691500E-4, 1.3981999507E-3, 8.3334519073E-3,
+        4.1665795894E-2, 1.6666665459E-1, 5.0000001201E-1 });
+    y = B.CreateFAdd(B.CreateFAdd(B.CreateFMul(y, z), r), fpConstant(type, 1.0));
+
+    // build 2^n from its exponent bits
+    llvm::Value* e = B.CreateAdd(B.CreateFPToSI(n, intTy), intConstant(intTy, 127));
+    e = B.CreateShl(e, intConstant(intTy, 23));
+    return B.CreateFMul(y, B.CreateBitCast(e, type));
+}
+
+llvm::Value* vexp(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    llvm::Type* type = x->getType();
+    // n = floor(x / ln(2) + 0.5), r = x - n * ln(2)
+    llvm::Value* n = B.CreateFAdd(B.CreateFMul(x, fpConstant(type, 1.44269504088896341)),
+        fpConstant(type, 0.5));
+    n = floorInt(B, n);
+    llvm::Value* r = B.CreateFSub(x, B.CreateFMul(n, fpConstant(type, 0.693359375)));
+    r = B.CreateFSub(r, B.CreateFMul(n, fpConstant(type, -2.12194440e-4)));
+    return expScale(B, r, n);
+}
+
+llvm::Value* vexp2(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    llvm::Type* type = x->getType();
+    // n = floor(x + 0.5), r = (x - n) * ln(2)
+    llvm::Value* n = floorInt(B, B.CreateFAdd(x, fpConstant(type, 0.5)));
+    llvm::Value* r = B.CreateFMul(B.CreateFSub(x, n), fpConstant(type, 0.693147180559945309));
+    return expScale(B, r, n);
+}
+
+// log, log2, log10
+
+llvm::Value* logRange(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    // negative, zero, denormal, infinite and NaN values
+    llvm::Type* type = x->getType();
+    return B.CreateOr(B.CreateFCmpULT(x, fpConstant(type, 1.17549435e-38)),
+        B.CreateFCmpOEQ(x, llvm::ConstantFP::getInfinity(type)));
+}
+
+/// @brief  Decompose x into m * 2^e with m in [sqrt(0.5), sqrt(2)) and
+///   compute log(m). The result is split into the reduced mantissa r = m - 1
+///   and the remaining polynomial terms y so that log(m) = r + y
+void logReduce(llvm::IRBuilder<>& B, llvm::Value* x,
+    llvm::Value*& r, llvm::Value*& y, llvm::Value*& e)
+{
+    llvm::Type* type = x->getType();
+    llvm::Type* intTy = integerType(type);
+    llvm::Value* bits = B.CreateBitCast(x, intTy);
+    llvm::Value* one = fpConstant(type, 1.0);
+
+    // m in [0.5, 1)
+    llvm::Value* m = B.CreateOr(B.CreateAnd(bits, intConstant(intTy, 0x007fffff)),
+        intConstant(intTy, 0x3f000000));
+    m = B.CreateBitCast(m, type);
+    e = B.CreateSub(B.CreateLShr(bits, intConstant(intTy, 23)), intConstant(intTy, 126));
+    e = B.CreateSIToFP(e, type);
+
+    llvm::Value* small = B.CreateFCmpOLT(m, fpConstant(type, 0.707106781186547524));
+    e = B.CreateFSub(e, B.CreateSelect(small, one, fpConstant(type, 0.0)));
+    r = B.CreateFAdd(B.CreateFSub(m, one), B.CreateSelect(small, m, fpConstant(type, 0.0)));
+
+    llvm::Value* z = B.CreateFMul(r, r);
+    y = polynomial(B, r, { 7.0376836292E-2, -1.1514610310E-1, 1.1676998740E-1,
+        -1.2420140846E-1, 1.4249322787E-1, -1.6668057665E-1, 2.0000714765E-1,
+        -2.4999993993E-1, 3.3333331174E-1 });
+    y = B.CreateFMul(B.CreateFMul(y, r), z);
+    y = B.CreateFSub(y, B.CreateFMul(z, fpConstant(type, 0.5)));
+}
+
+llvm::Value* vlog(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    llvm::Type* type = x->getType();
+    llvm::Value* r, *y, *e;
+    logReduce(B, x, r, y, e);
+    // log(x) = log(m) + e * ln(2), with ln(2) split for extended precision
+    y = B.CreateFAdd(y, B.CreateFMul(e, fpConstant(type, -2.12194440e-4)));
+    llvm::Value* result = B.CreateFAdd(r, y);
+    return B.CreateFAdd(result, B.CreateFMul(e, fpConstant(type, 0.693359375)));
+}
+
+llvm::Value* vlog2(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    llvm::Type* type = x->getType();
+    llvm::Value* r, *y, *e;
+    logReduce(B, x, r, y, e);
+    // exact for powers of two, where r and y are 0
+    llvm::Value* result = B.CreateFMul(B.CreateFAdd(r, y), fpConstant(type, 1.44269504088896341));
+    return B.CreateFAdd(result, e);
+}
+
+llvm::Value* vlog10(llvm::IRBuilder<>& B, llvm::Value* x)
+{
+    llvm::Type* type = x->getType();
+    llvm::Value* r, *y, *e;
+    logReduce(B, x, r, y, e);
+    llvm::Value* result = B.CreateFMul(B.CreateFAdd(r, y), fpConstant(type, 0.434294481903251828));
+    return B.CreateFAdd(result, B.CreateFMul(e, fpConstant(type, 0.301029995663981195)));
+}
+
+#define AX_VECTOR_NAMES(Name) \
+    { "ax." #Name ".v4f32", "ax." #Name ".v8f32", "ax." #Name ".v16f32" }
+
+/// @note  Names must persist for the lifetime of the program, as a
+///   TargetLibraryInfoImpl only stores references to them
+const VectorFunction sVectorFunctions[] = {
+    { "llvm.sin.f32",   AX_VECTOR_NAMES(sin),   sincosRange, vsin },
+    { "llvm.cos.f32",   AX_VECTOR_NAMES(cos),   sincosRange, vcos },
+    { "llvm.exp.f32",   AX_VECTOR_NAMES(exp),   expRange,    vexp },
+    { "llvm.exp2.f32",  AX_VECTOR_NAMES(exp2),  exp2Range,   vexp2 },
+    { "llvm.log.f32",   AX_VECTOR_NAMES(log),   logRange,    vlog },
+    { "llvm.log2.f32",  AX_VECTOR_NAMES(log2),  logRange,    vlog2 },
+    { "llvm.log10.f32", AX_VECTOR_NAMES(log10), logRange,    vlog10 }
+};
+
+/// @brief  A vector function family implemented by a batched C binding.
+///   Maps the symbol of a scalar C binding, taking and returning doubles, to
+///   its 4, 8 and 16 wide variants. The batch binding takes a pointer to the
+///   values of each argument, a pointer to the results and the number of
+///   values.
+struct BatchFunction
+{
+    const char* mScalar;
+    const char* mVector[3];
+    const char* mBatch;
+};
+
+#define AX_BATCH_NAMES(Name) \
+    { "ax." #Name ".v4f64", "ax." #Name ".v8f64", "ax." #Name ".v16f64" }
+
+/// @note  Scalar and batch symbols must match those of the C bindings
+///   registered in StandardFunctions.cc
+const BatchFunction sBatchFunctions[] = {
+    { "ax.simplexnoise.dddd", AX_BATCH_NAMES(simplexnoise), "ax.simplexnoise.batch" }
+};
+
+#undef AX_BATCH_NAMES
+#undef AX_VECTOR_NAMES
+
+/// @brief  Create a function which calls a scalar function for every element
+///   of a vector. It is never optimized, so that the vectorizers can not map
+///   the scalar calls back to the vector function which calls it.
+llvm::Function*
+createScalarized(llvm::Module& M, llvm::Function& scalar, llvm::Type* type,
+    const unsigned width, const std::string& name)
+{
+    llvm::FunctionType* FT = llvm::FunctionType::get(type, { type }, /*var-args*/false);
+    llvm::Function* F =
+        llvm::Function::Create(FT, llvm::Function::InternalLinkage, name, &M);
+    F->addFnAttr(llvm::Attribute::NoInline);
+    F->addFnAttr(llvm::Attribute::OptimizeNone);
+    F->setDoesNotThrow();
+
+    llvm::IRBuilder<> B(llvm::BasicBlock::Create(M.getContext(), "entry", F));
+    llvm::Value* x = &*(F->arg_begin());
+    llvm::Value* result = llvm::UndefValue::get(type);
+    for (unsigned i = 0; i < width; ++i) {
+        llvm::Value* element = B.CreateExtractElement(x, B.getInt32(i));
+        element = B.CreateCall(&scalar, { element });
+        result = B.CreateInsertElement(result, element, B.getInt32(i));
+    }
+    B.CreateRet(result);
+    return F;
+}
+
+void
+insertVectorFunction(llvm::Module& M, llvm::Function& scalar,
+    const VectorFunction& function, const size_t index)
+{
+    const std::string name = function.mVector[index];
+    if (M.getFunction(name)) return;
+
+    llvm::LLVMContext& C = M.getContext();
+    const unsigned width = sVectorWidths[index];
+    llvm::Type* type = vectorType(scalar.getReturnType(), width);
+
+    llvm::FunctionType* FT = llvm::FunctionType::get(type, { type }, /*var-args*/false);
+    llvm::Function* F =
+        llvm::Function::Create(FT, llvm::Function::ExternalLinkage, name, &M);
+    F->setDoesNotAccessMemory();
+    F->setDoesNotThrow();
+
+    llvm::Function* fallback = createScalarized(M, scalar, type, width, name + ".scalar");
+    fallback->setDoesNotAccessMemory();
+
+    llvm::BasicBlock* entry = llvm::BasicBlock::Create(C, "entry", F);
+    llvm::BasicBlock* vectorBlock = llvm::BasicBlock::Create(C, "vector", F);
+    llvm::BasicBlock* scalarBlock = llvm::BasicBlock::Create(C, "scalar", F);
+
+    llvm::IRBuilder<> B(entry);
+    llvm::Value* x = &*(F->arg_begin());
+
+    // reduce the per element mask to a single flag
+    llvm::Value* outside = function.mOutOfRange(B, x);
+    outside = B.CreateBitCast(outside, B.getIntNTy(width));
+    outside = B.CreateICmpNE(outside, llvm::ConstantInt::get(outside->getType(), 0));
+    B.CreateCondBr(outside, scalarBlock, vectorBlock,
+        llvm::MDBuilder(C).createBranchWeights(1, 2000));
+
+    B.SetInsertPoint(vectorBlock);
+    B.CreateRet(function.mKernel(B, x));
+
+    B.SetInsertPoint(scalarBlock);
+    B.CreateRet(B.CreateCall(fallback, { x }));
+}
+
+void
+insertBatchFunction(llvm::Module& M, llvm::Function& scalar,
+    const BatchFunction& function, const size_t index)
+{
+    const std::string name = function.mVector[index];
+    if (M.getFunction(name)) return;
+
+    llvm::LLVMContext& C = M.getContext();
+    const unsigned width = sVectorWidths[index];
+    llvm::Type* element = scalar.getReturnType();
+    llvm::Type* type = vectorType(element, width);
+    const unsigned size = scalar.getFunctionType()->getNumParams();
+
+    // declare the batch C binding, void(const T*..., T*, int64_t)
+    llvm::Function* batch = M.getFunction(function.mBatch);
+    if (!batch) {
+        std::vector<llvm::Type*> batchArgs(size + 1, element->getPointerTo());
+        batchArgs.emplace_back(llvm::Type::getInt64Ty(C));
+        llvm::FunctionType* batchFT =
+            llvm::FunctionType::get(llvm::Type::getVoidTy(C), batchArgs, /*var-args*/false);
+        batch = llvm::Function::Create(batchFT,
+            llvm::Function::ExternalLinkage, function.mBatch, &M);
+        batch->setOnlyAccessesArgMemory();
+        batch->setDoesNotThrow();
+    }
+
+    // the variant only accesses its own stack, so is still free of side
+    // effects to its callers
+    std::vector<llvm::Type*> args(size, type);
+    llvm::FunctionType* FT = llvm::FunctionType::get(type, args, /*var-args*/false);
+    llvm::Function* F =
+        llvm::Function::Create(FT, llvm::Function::ExternalLinkage, name, &M);
+    F->setDoesNotAccessMemory();
+    F->setDoesNotThrow();
+
+    llvm::IRBuilder<> B(llvm::BasicBlock::Create(C, "entry", F));
+
+    // store each vector argument on the stack and pass the address of its
+    // first element
+    std::vector<llvm::Value*> batchArgs;
+    for (llvm::Argument& arg : F->args()) {
+        llvm::Value* alloc = B.CreateAlloca(type);
+        B.CreateStore(&arg, alloc);
+        batchArgs.emplace_back(B.CreateBitCast(alloc, element->getPointerTo()));
+    }
+
+    llvm::Value* result = B.CreateAlloca(type);
+    batchArgs.emplace_back(B.CreateBitCast(result, element->getPointerTo()));
+    batchArgs.emplace_back(B.getInt64(width));
+
+    B.CreateCall(batch, batchArgs);
+    B.CreateRet(B.CreateLoad(result));
+}
+
+}
+
+void addVectorFunctionMappings(llvm::TargetLibraryInfoImpl& TLII)
+{
+    std::vector<llvm::VecDesc> mappings;
+    for (const VectorFunction& function : sVectorFunctions) {
+        for (size_t i = 0; i < 3; ++i) {
+#if LLVM_VERSION_MAJOR < 13
+            mappings.push_back({ function.mScalar, function.mVector[i],
+                sVectorWidths[i] });
+#else
+            mappings.push_back({ function.mScalar, function.mVector[i],
+                llvm::ElementCount::getFixed(sVectorWidths[i]) });
+#endif
+        }
+    }
+    for (const BatchFunction& function : sBatchFunctions) {
+        for (size_t i = 0; i < 3; ++i) {
+#if LLVM_VERSION_MAJOR < 13
+            mappings.push_back({ function.mScalar, function.mVector[i],
+                sVectorWidths[i] });
+#else
+            mappings.push_back({ function.mScalar, function.mVector[i],
+                llvm::ElementCount::getFixed(sVectorWidths[i]) });
+#endif
+        }
+    }
+    TLII.addVectorizableFunctions(mappings);
+}
+
+void insertVectorFunctions(llvm::Module& module)
+{
+    for (const VectorFunction& function : sVectorFunctions) {
+        llvm::Function* scalar = module.getFunction(function.mScalar);
+        if (!scalar) continue;
+        for (size_t i = 0; i < 3; ++i) {
+            insertVectorFunction(module, *scalar, function, i);
+        }
+    }
+    for (const BatchFunction& function : sBatchFunctions) {
+        llvm::Function* scalar = module.getFunction(function.mScalar);
+        if (!scalar) continue;
+        for (size_t i = 0; i < 3; ++i) {
+            insertBatchFunction(module, *scalar, function, i);
+        }
+    }
+}
+
+void removeUnusedVectorFunctions(llvm::Module& module)
+{
+    for (const VectorFunction& function : sVectorFunctions) {
+        for (size_t i = 0; i < 3; ++i) {
+            llvm::Function* F = module.getFunction(function.mVector[i]);
+            if (!F || !F->use_empty()) continue;
+            F->eraseFromParent();
+            // the scalar fallback is only called by the erased function
+            F = module.getFunction(std::string(function.mVector[i]) + ".scalar");
+            if (F && F->use_empty()) F->eraseFromParent();
+        }
+    }
+    for (const BatchFunction& function : sBatchFunctions) {
+        for (size_t i = 0; i < 3; ++i) {
+            llvm::Function* F = module.getFunction(function.mVector[i]);
+            if (F && F->use_empty()) F->eraseFromParent();
+        }
+        // the batch binding is only called by the variants
+        llvm::Function* F = module.getFunction(function.mBatch);
+        if (F && F->use_empty()) F->eraseFromParent();
+    }
+}
+
+} // namespace codegen
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file codegen/VectorFunctions.h
+///
+/// @brief  AX's bundled vector math library. Defines vector variants of the
+///   llvm floating point math intrinsics used by AX functions and maps them
+///   to their scalar versions, allowing the loop and SLP vectorizers to
+///   vectorize calls to sin, cos, exp and log. Also maps C bindings which
+///   provide a batched implementation, such as simplexnoise, to variants
+///   which call the batched binding.
+///
+
+#ifndef OPENVDB_AX_CODEGEN_VECTOR_FUNCTIONS_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_CODEGEN_VECTOR_FUNCTIONS_HAS_BEEN_INCLUDED
+
+#include <openvdb/version.h>
+
+namespace llvm {
+class Module;
+class TargetLibraryInfoImpl;
+}
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace codegen {
+
+/// @brief  Register the vector variants of AX's math library with a target
+///   library info. The vectorizers will replace calls to scalar intrinsics
+///   with calls to the mapped variants, which must then exist in the module
+///   being optimized (see insertVectorFunctions).
+/// @param TLII  The target library info to add mappings to
+void addVectorFunctionMappings(llvm::TargetLibraryInfoImpl& TLII);
+
+/// @brief  Define the vector variants of all scalar math intrinsics and C
+///   bindings which are used in a module and have been registered with
+///   addVectorFunctionMappings. Variants are only inserted if they do not
+///   already exist.
+/// @note  Variants of math intrinsics fall back to the scalar intrinsic for
+///   each element when any element lies outside of the range supported by
+///   the vectorized approximation (including infinite and NaN values).
+///   Otherwise results are within a few ULP of the scalar intrinsic. Variants
+///   of C bindings return identical results to the scalar binding.
+/// @param module  The module to define functions in
+void insertVectorFunctions(llvm::Module& module);
+
+/// @brief  Remove any vector variants defined by insertVectorFunctions which
+///   have no uses, typically called once the module has been optimized.
+/// @param module  The module to remove functions from
+void removeUnusedVectorFunctions(llvm::Module& module);
+
+} // namespace codegen
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_CODEGEN_VECTOR_FUNCTIONS_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
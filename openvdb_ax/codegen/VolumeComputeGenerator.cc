@@ -56,7 +56,9 @@ VolumeKernel::argumentKeys()
         "accessors",
         "transforms",
         "write_index",
-        "write_acccessor"
+        "write_acccessor",
+        "active",
+        "reductions"
     }};
 
     return arguments;
@@ -102,7 +104,10 @@ AttributeRegistry::Ptr VolumeComputeGenerator::generate(const ast::Tree& tree)
 
     // build the attribute registry
 
-    AttributeRegistry::Ptr registry = AttributeRegistry::create(tree);
+    AttributeRegistry::Ptr registry = AttributeRegistry::create(tree,
+        [this](const ast::FunctionCall& call, const size_t i) {
+            return this->writesToArgument(call, i);
+        });
 
     // Visit all attributes and allocate them in local IR memory - assumes attributes
     // have been verified by the ax compiler
@@ -119,11 +124,26 @@ AttributeRegistry::Ptr VolumeComputeGenerator::generate(const ast::Tree& tree)
         localTable->insert(data.tokenname(), value);
     }
 
-    // insert getters for read variables
+    // insert getters for read variables. Attributes which are always
+    // assigned to before being used are registered as write only. Read only
+    // attributes which are only used within a branch are deferred to the
+    // start of that branch so they aren't read for every voxel
+
+    mDeferredReads.clear();
+    const ast::Block* root = tree.child(0);
+    std::unordered_map<std::string, const ast::Block*> usageBlocks;
+    ast::attributeUsageBlock(tree, usageBlocks);
 
     for (const AttributeRegistry::AccessData& data : registry->data()) {
         if (!data.reads()) continue;
         const std::string token = data.tokenname();
+        if (!data.writes()) {
+            const ast::Block* block = usageBlocks[token];
+            if (block && block != root) {
+                mDeferredReads[block].emplace_back(token);
+                continue;
+            }
+        }
         this->getAccessorValue(token, localTable->get(token));
     }
 
@@ -221,6 +241,20 @@ AttributeRegistry::Ptr VolumeComputeGenerator::generate(const ast::Tree& tree)
     return registry;
 }
 
+bool VolumeComputeGenerator::visit(const ast::Block* block)
+{
+    // insert any reads which have been deferred to this block
+    auto iter = mDeferredReads.find(block);
+    if (iter != mDeferredReads.end()) {
+        SymbolTable* localTable = this->mSymbolTables.getOrInsert(1);
+        for (const std::string& token : iter->second) {
+            this->getAccessorValue(token, localTable->get(token));
+        }
+    }
+
+    return ComputeGenerator::visit(block);
+}
+
 bool VolumeComputeGenerator::visit(const ast::Attribute* node)
 {
     const std::string globalName = node->tokenname();
@@ -46,6 +46,10 @@
 
 #include <openvdb/version.h>
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace openvdb {
 OPENVDB_USE_VERSION_NAMESPACE
 namespace OPENVDB_VERSION_NAME {
@@ -67,6 +71,14 @@ namespace codegen {
 ///                  an array of grid accessors
 ///             5) - A void pointer to a vector of void pointers, representing
 ///                  an array of grid transforms
+///             6) - The index of the grid currently being written to
+///             7) - A void pointer to the accessor of the grid currently
+///                  being written to
+///             8) - A pointer to a bool holding the active state of the
+///                  current voxel. This is initialized with the voxel's
+///                  current state and can be modified by the kernel
+///             9) - A void pointer to the Reductions object of the executing
+///                  thread, which accumulates the results of reduce functions
 ///
 struct VolumeKernel
 {
@@ -78,6 +90,8 @@ struct VolumeKernel
              void**,
              void**,
              int64_t,
+             void*,
+             bool*,
              void*);
 
     using FunctionTraitsT = codegen::FunctionTraits<Signature>;
@@ -116,10 +130,15 @@ struct VolumeComputeGenerator : public ComputeGenerator
 
     AttributeRegistry::Ptr generate(const ast::Tree& node);
     bool visit(const ast::Attribute*) override;
+    bool visit(const ast::Block*) override;
 
 private:
     llvm::Value* accessorHandleFromToken(const std::string&);
     void getAccessorValue(const std::string&, llvm::Value*);
+
+    // Read only attributes which are only accessed within a branch, retrieved
+    // at the start of the corresponding block rather than at function entry
+    std::unordered_map<const ast::Block*, std::vector<std::string>> mDeferredReads;
 };
 
 } // namespace codegen_internal
@@ -123,6 +123,34 @@ inline FunctionGroup::UniquePtr axgetcoord(const FunctionOptions& op)
         .get();
 }
 
+inline FunctionGroup::UniquePtr axsetactive(const FunctionOptions& op)
+{
+    static auto generate = [](const std::vector<llvm::Value*>& args,
+         llvm::IRBuilder<>& B) -> llvm::Value*
+    {
+        assert(args.size() == 1);
+        // Pull out parent function arguments
+        llvm::Function* compute = B.GetInsertBlock()->getParent();
+        verifyContext(compute, "setactive");
+        llvm::Value* active = extractArgument(compute, "active");
+        assert(active);
+        B.CreateStore(args.front(), active);
+        return nullptr;
+    };
+
+    return FunctionBuilder("setactive")
+        .addSignature<void(bool)>(generate)
+        .setEmbedIR(true)
+        .setConstantFold(false)
+        .setPreferredImpl(op.mPrioritiseIR ? FunctionBuilder::IR : FunctionBuilder::C)
+        .setDocumentation("Sets the active state of the current voxel in the volumes "
+            "being written to. The new state is applied once the voxel has been processed. "
+            "If any voxels are deactivated, nodes which end up entirely inactive are "
+            "pruned at the end of execution. Note that the topology of volumes which are "
+            "only read from is never modified.")
+        .get();
+}
+
 inline FunctionGroup::UniquePtr axsetvoxel(const FunctionOptions& op)
 {
     static auto setvoxelptr =
@@ -382,6 +410,7 @@ void insertVDBVolumeFunctions(FunctionRegistry& registry,
     add("getcoordy", axgetcoord<1>);
     add("getcoordz", axgetcoord<2>);
     add("getvoxelpws", axgetvoxelpws);
+    add("setactive", axsetactive);
     add("getvoxel", axgetvoxel, true);
     add("setvoxel", axsetvoxel, true);
 }
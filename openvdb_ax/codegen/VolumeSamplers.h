@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file codegen/VolumeSamplers.h
+///
+/// @brief  Read-only volumes provided to a point execution, which point
+///   kernels sample with volumesample(), volumesamplev() and
+///   volumegradient()
+///
+
+#ifndef OPENVDB_AX_CODEGEN_VOLUME_SAMPLERS_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_CODEGEN_VOLUME_SAMPLERS_HAS_BEEN_INCLUDED
+
+#include <openvdb/openvdb.h>
+#include <openvdb/version.h>
+#include <openvdb/math/Maps.h>
+#include <openvdb/math/Transform.h>
+#include <openvdb/math/Vec3.h>
+#include <openvdb/tools/Interpolation.h>
+#include <openvdb/tree/ValueAccessor.h>
+
+#include <tbb/enumerable_thread_specific.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace codegen {
+
+namespace codegen_internal {
+
+/// @brief  The float and vec3f volumes available to the kernels of a point
+///   execution. Volumes of any other type are ignored.
+///
+/// @details  The map from world to index space of each volume is resolved
+///   once, when the volumes are gathered. Linear transforms are reduced to
+///   their affine map, avoiding the virtual dispatch of the Transform on
+///   every sample. Every thread samples through its own Accessors object,
+///   which holds a ValueAccessor per volume that stays warm between the
+///   samples taken by the thread.
+///
+class VolumeSamplers
+{
+public:
+    using Ptr = std::unique_ptr<VolumeSamplers>;
+
+    /// @brief  A single volume and its hoisted transform
+    template <typename GridT>
+    struct Volume
+    {
+        using AccessorT = tree::ValueAccessor<const typename GridT::TreeType>;
+
+        Volume(const typename GridT::ConstPtr& grid)
+            : mGrid(grid)
+            , mAffine(grid->transform().isLinear() ?
+                grid->transform().baseMap()->getAffineMap() : math::AffineMap::Ptr()) {}
+
+        inline math::Vec3<double> worldToIndex(const math::Vec3<double>& pos) const
+        {
+            if (mAffine) return mAffine->applyInverseMap(pos);
+            return mGrid->transform().worldToIndex(pos);
+        }
+
+        /// @brief  Transform an index space gradient at the given index space
+        ///   position to world space
+        inline math::Vec3<double> gradientToWorld(const math::Vec3<double>& gradient,
+            const math::Vec3<double>& ijk) const
+        {
+            if (mAffine) return mAffine->applyIJT(gradient);
+            return mGrid->transform().baseMap()->applyIJT(gradient, ijk);
+        }
+
+        typename GridT::ConstPtr mGrid;
+        math::AffineMap::Ptr mAffine;
+    };
+
+    /// @brief  Samples the volumes on behalf of a single thread
+    class Accessors
+    {
+    public:
+        Accessors(const VolumeSamplers& samplers)
+            : mSamplers(samplers)
+            , mFloats()
+            , mVectors()
+        {
+            mFloats.reserve(samplers.mFloats.size());
+            for (const auto& volume : samplers.mFloats) mFloats.emplace_back(volume.mGrid->tree());
+            mVectors.reserve(samplers.mVectors.size());
+            for (const auto& volume : samplers.mVectors) mVectors.emplace_back(volume.mGrid->tree());
+        }
+
+        /// @brief  Sample the volume of the given name at a world space
+        ///   position. Returns zero if no volume of this name and type exists.
+        ///
+        /// @param  name  The name of the volume, not null terminated
+        /// @param  size  The length of the name
+        /// @param  pos   The world space position to sample at
+        /// @param  order The interpolation order. 0 samples the nearest voxel,
+        ///   1 interpolates trilinearly and 2 triquadratically
+        ///
+        template <typename ValueT>
+        inline ValueT sample(const char* name, const size_t size,
+            const math::Vec3<float>& pos, const int32_t order)
+        {
+            const auto& volumes = mSamplers.volumes(ValueT());
+            const size_t idx = find(volumes, name, size);
+            if (idx == volumes.size()) return zeroVal<ValueT>();
+
+            const math::Vec3<double> ijk = volumes[idx].worldToIndex(math::Vec3<double>(pos));
+            return VolumeSamplers::sample(this->accessor(ValueT(), idx), ijk, order);
+        }
+
+        /// @brief  The world space gradient of the float volume of the given
+        ///   name at a world space position, computed with central
+        ///   differences of the interpolated values half a voxel either side
+        ///   of the position. Returns zero if no float volume of this name
+        ///   exists.
+        inline math::Vec3<float> gradient(const char* name, const size_t size,
+            const math::Vec3<float>& pos, const int32_t order)
+        {
+            const auto& volumes = mSamplers.mFloats;
+            const size_t idx = find(volumes, name, size);
+            if (idx == volumes.size()) return zeroVal<math::Vec3<float>>();
+
+            const Volume<FloatGrid>& volume = volumes[idx];
+            Volume<FloatGrid>::AccessorT& accessor = mFloats[idx];
+            const math::Vec3<double> ijk = volume.worldToIndex(math::Vec3<double>(pos));
+
+            math::Vec3<double> gradient;
+            for (int i = 0; i < 3; ++i) {
+                math::Vec3<double> offset(0.0);
+                offset[i] = 0.5;
+                gradient[i] = double(VolumeSamplers::sample(accessor, ijk + offset, order)) -
+                    double(VolumeSamplers::sample(accessor, ijk - offset, order));
+            }
+            return math::Vec3<float>(volume.gradientToWorld(gradient, ijk));
+        }
+
+    private:
+        template <typename GridT>
+        static inline size_t find(const std::vector<Volume<GridT>>& volumes,
+            const char* name, const size_t size)
+        {
+            size_t idx = 0;
+            for (; idx < volumes.size(); ++idx) {
+                const std::string& candidate = volumes[idx].mGrid->getName();
+                if (candidate.size() == size && candidate.compare(0, size, name, size) == 0) break;
+            }
+            return idx;
+        }
+
+        inline Volume<FloatGrid>::AccessorT&
+        accessor(float, const size_t idx) { return mFloats[idx]; }
+        inline Volume<Vec3SGrid>::AccessorT&
+        accessor(math::Vec3<float>, const size_t idx) { return mVectors[idx]; }
+
+        const VolumeSamplers& mSamplers;
+        std::vector<Volume<FloatGrid>::AccessorT> mFloats;
+        std::vector<Volume<Vec3SGrid>::AccessorT> mVectors;
+    };
+
+    /// @brief  Gather the float and vec3f volumes from a list of grids
+    VolumeSamplers(const GridCPtrVec& grids)
+        : mFloats()
+        , mVectors()
+        , mAccessors()
+    {
+        for (const auto& grid : grids) {
+            if (!grid) continue;
+            if (grid->isType<FloatGrid>()) {
+                mFloats.emplace_back(gridConstPtrCast<FloatGrid>(grid));
+            }
+            else if (grid->isType<Vec3SGrid>()) {
+                mVectors.emplace_back(gridConstPtrCast<Vec3SGrid>(grid));
+            }
+        }
+    }
+
+    /// @brief  The accessors of the calling thread
+    inline Accessors& accessors() const
+    {
+        std::unique_ptr<Accessors>& accessors = mAccessors.local();
+        if (!accessors) accessors.reset(new Accessors(*this));
+        return *accessors;
+    }
+
+private:
+    template <typename AccessorT>
+    static inline typename AccessorT::ValueType
+    sample(AccessorT& accessor, const math::Vec3<double>& ijk, const int32_t order)
+    {
+        if (order <= 0) return tools::PointSampler::sample(accessor, ijk);
+        if (order == 1) return tools::BoxSampler::sample(accessor, ijk);
+        return tools::QuadraticSampler::sample(accessor, ijk);
+    }
+
+    inline const std::vector<Volume<FloatGrid>>& volumes(float) const { return mFloats; }
+    inline const std::vector<Volume<Vec3SGrid>>& volumes(math::Vec3<float>) const { return mVectors; }
+
+    std::vector<Volume<FloatGrid>> mFloats;
+    std::vector<Volume<Vec3SGrid>> mVectors;
+    mutable tbb::enumerable_thread_specific<std::unique_ptr<Accessors>> mAccessors;
+};
+
+} // namespace codegen_internal
+
+} // namespace codegen
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_CODEGEN_VOLUME_SAMPLERS_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
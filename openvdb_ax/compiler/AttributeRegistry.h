@@ -48,7 +48,11 @@
 #include "../ast/Scanners.h"
 
 #include <openvdb/version.h>
+#include <openvdb/Exceptions.h>
 
+#include <algorithm>
+#include <istream>
+#include <ostream>
 #include <unordered_map>
 
 namespace openvdb {
@@ -118,7 +122,15 @@ public:
 
     using AccessDataVec = std::vector<AccessData>;
 
-    inline static AttributeRegistry::Ptr create(const ast::Tree& tree);
+    /// @brief  Create a registry from the attribute accesses in a given AST
+    /// @param tree  The AST to analyze
+    /// @param writesToArgument  An optional query which determines whether
+    ///              attributes passed to functions are written to. If not
+    ///              provided, attributes passed directly to functions are
+    ///              assumed to be written to. See ast::catalogueVariables
+    inline static AttributeRegistry::Ptr
+    create(const ast::Tree& tree,
+        const ast::ArgumentWriteQuery& writesToArgument = ast::ArgumentWriteQuery());
 
     inline bool isReadable(const std::string& name, const ast::tokens::CoreType type) const
     {
@@ -176,9 +188,22 @@ public:
 
     void print(std::ostream& os) const;
 
+    /// @brief  Write the registry to a binary stream. The accesses are
+    ///         written in order, so all access indices are preserved.
+    /// @param  os  The stream to write to
+    inline void write(std::ostream& os) const;
+
+    /// @brief  Read a registry previously written with write()
+    /// @note   Throws an openvdb::IoError if the data is invalid
+    /// @param  is  The stream to read from
+    inline static AttributeRegistry::Ptr read(std::istream& is);
+
 private:
     AttributeRegistry() : mAccesses() {}
 
+    /// @brief  Initialize the uses of all accesses from their dependencies
+    inline void initializeUses();
+
     /// @brief  Add an access to the registry, returns an index into
     ///         the registry for that access
     /// @param  name      The name of the access
@@ -201,11 +226,26 @@ private:
 /////////////////////////////////////////////////////////////////////
 
 
-inline AttributeRegistry::Ptr AttributeRegistry::create(const ast::Tree& tree)
+inline AttributeRegistry::Ptr
+AttributeRegistry::create(const ast::Tree& tree,
+    const ast::ArgumentWriteQuery& writesToArgument)
 {
     AttributeRegistry::Ptr registry(new AttributeRegistry());
     std::vector<std::string> read, write, all;
-    ast::catalogueAttributeTokens(tree, &read, &write, &all);
+    ast::catalogueAttributeTokens(tree, &read, &write, &all, writesToArgument);
+
+    // Attributes which are read and written but are always assigned to
+    // before being used never have their initial values read. Treat these
+    // as write only so that their values aren't retrieved
+
+    std::vector<std::string> overwritten;
+    ast::overwrittenAttributeTokens(tree, overwritten);
+    for (const std::string& token : overwritten) {
+        auto iter = std::find(all.begin(), all.end(), token);
+        if (iter == all.end()) continue;
+        write.emplace_back(token);
+        all.erase(iter);
+    }
 
     size_t idx = 0;
     std::unordered_map<std::string, size_t> indexmap;
@@ -231,47 +271,119 @@ inline AttributeRegistry::Ptr AttributeRegistry::create(const ast::Tree& tree)
     dataBuilder(write, false, true);
     dataBuilder(all, true, true);
 
-    auto depBuilder = [&](const std::vector<std::string>& attribs) {
+    // initialize dependencies. These are resolved for all attributes at once
+    // as resolving them individually scales poorly with the size of the tree
 
-        std::string name, type;
-        for (const auto& attrib : attribs) {
-            ast::Attribute::nametypeFromToken(attrib, &name, &type);
-            const ast::tokens::CoreType typetoken =
-                ast::tokens::tokenFromTypeString(type);
+    std::unordered_map<std::string, std::vector<std::string>> dependencies;
+    ast::attributeDependencyTokens(tree, dependencies);
 
-            std::vector<std::string> deps;
-            ast::attributeDependencyTokens(tree, name, typetoken, deps);
-            if (deps.empty()) continue;
-
-            assert(indexmap.find(attrib) != indexmap.cend());
-            const size_t index = indexmap.at(attrib);
-            AccessData& access = registry->mAccesses[index];
-            for (const std::string& dep : deps) {
-                assert(indexmap.find(dep) != indexmap.cend());
-                const size_t depindex = indexmap.at(dep);
-                access.mDependencies.emplace_back(&registry->mAccesses[depindex]);
-            }
+    for (const auto& iter : dependencies) {
+        const std::vector<std::string>& deps = iter.second;
+        if (deps.empty()) continue;
+
+        assert(indexmap.find(iter.first) != indexmap.cend());
+        const size_t index = indexmap.at(iter.first);
+        AccessData& access = registry->mAccesses[index];
+        for (const std::string& dep : deps) {
+            assert(indexmap.find(dep) != indexmap.cend());
+            const size_t depindex = indexmap.at(dep);
+            access.mDependencies.emplace_back(&registry->mAccesses[depindex]);
+        }
+    }
+
+    registry->initializeUses();
+    return registry;
+}
+
+inline void AttributeRegistry::initializeUses()
+{
+    // Update usage from deps. Uses are inserted in the order of the registry
+    // accesses. Don't skip self depends as it may write to itself i.e.
+    // @a = @a + 1; should add a self usage
+
+    for (const AccessData& next : mAccesses) {
+        for (const AccessData* dep : next.mDependencies) {
+            const size_t depindex = static_cast<size_t>(dep - mAccesses.data());
+            mAccesses[depindex].mUses.emplace_back(&next);
+        }
+    }
+}
+
+inline void AttributeRegistry::write(std::ostream& os) const
+{
+    auto writeSize = [&os](const uint64_t size) {
+        os.write(reinterpret_cast<const char*>(&size), sizeof(uint64_t));
+    };
+    auto writeByte = [&os](const uint8_t byte) {
+        os.write(reinterpret_cast<const char*>(&byte), sizeof(uint8_t));
+    };
+
+    writeSize(mAccesses.size());
+    for (const AccessData& data : mAccesses) {
+        writeSize(data.name().size());
+        os.write(data.name().data(), data.name().size());
+        writeByte(static_cast<uint8_t>(data.type()));
+        writeByte(static_cast<uint8_t>(data.reads()));
+        writeByte(static_cast<uint8_t>(data.writes()));
+        writeSize(data.mDependencies.size());
+        for (const AccessData* dep : data.mDependencies) {
+            writeSize(static_cast<uint64_t>(dep - mAccesses.data()));
         }
+    }
+}
+
+inline AttributeRegistry::Ptr AttributeRegistry::read(std::istream& is)
+{
+    auto readSize = [&is]() -> uint64_t {
+        uint64_t size = 0;
+        if (!is.read(reinterpret_cast<char*>(&size), sizeof(uint64_t))) {
+            OPENVDB_THROW(IoError, "Unexpected end of attribute registry data");
+        }
+        return size;
+    };
+    auto readByte = [&is]() -> uint8_t {
+        uint8_t byte = 0;
+        if (!is.read(reinterpret_cast<char*>(&byte), sizeof(uint8_t))) {
+            OPENVDB_THROW(IoError, "Unexpected end of attribute registry data");
+        }
+        return byte;
     };
 
-    // initialize dependencies
+    AttributeRegistry::Ptr registry(new AttributeRegistry());
+    std::vector<std::vector<uint64_t>> dependencies;
 
-    depBuilder(read);
-    depBuilder(write);
-    depBuilder(all);
+    const uint64_t size = readSize();
+    for (uint64_t i = 0; i < size; ++i) {
+        std::string name(readSize(), '\0');
+        if (!is.read(&name[0], name.size())) {
+            OPENVDB_THROW(IoError, "Unexpected end of attribute registry data");
+        }
+        const uint8_t type = readByte();
+        if (type >= static_cast<uint8_t>(ast::tokens::UNKNOWN)) {
+            OPENVDB_THROW(IoError, "Invalid type for attribute \"" + name + "\"");
+        }
+        const bool reads = readByte();
+        const bool writes = readByte();
+        registry->addData(name, static_cast<ast::tokens::CoreType>(type), reads, writes);
+
+        dependencies.emplace_back(readSize());
+        for (uint64_t& dep : dependencies.back()) dep = readSize();
+    }
 
-    // Update usage from deps
+    // the accesses are all inserted, so pointers into the vector are stable
 
-    for (AccessData& access : registry->mAccesses) {
-        for (const AccessData& next : registry->mAccesses) {
-            // don't skip self depends as it may write to itself
-            // i.e. @a = @a + 1; should add a self usage
-            if (next.dependson(&access)) {
-                access.mUses.emplace_back(&next);
+    for (size_t i = 0; i < dependencies.size(); ++i) {
+        AccessData& access = registry->mAccesses[i];
+        for (const uint64_t dep : dependencies[i]) {
+            if (dep >= size) {
+                OPENVDB_THROW(IoError, "Invalid dependency for attribute \""
+                    + access.name() + "\"");
             }
+            access.mDependencies.emplace_back(&registry->mAccesses[dep]);
         }
     }
 
+    registry->initializeUses();
     return registry;
 }
 
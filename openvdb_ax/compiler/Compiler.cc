@@ -38,17 +38,22 @@
 #include "../ast/Scanners.h"
 #include "../codegen/Functions.h"
 #include "../codegen/PointComputeGenerator.h"
+#include "../codegen/PointNeighbours.h"
+#include "../codegen/VectorFunctions.h"
 #include "../codegen/VolumeComputeGenerator.h"
 #include "../Exceptions.h"
 
 #include <openvdb/Exceptions.h>
 
 #include <llvm/ADT/Optional.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/Triple.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/Analysis/TargetTransformInfo.h>
 #include <llvm/Config/llvm-config.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Mangler.h>
@@ -60,7 +65,9 @@
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/CodeGen.h>
 #include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/SourceMgr.h> // SMDiagnostic
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Target/TargetMachine.h>
@@ -79,7 +86,11 @@
 #include <llvm/Transforms/IPO.h> // Inter-procedural optimization passes
 #include <llvm/Transforms/IPO/AlwaysInliner.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar.h>
 
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
 
 namespace openvdb {
@@ -91,12 +102,37 @@ namespace ax {
 namespace
 {
 
-/// @brief  Initialize a target machine for the host platform. Returns a nullptr
-///         if a target could not be created.
+/// @brief  Throws if code generated by the target machine requires CPU
+///         features which the host does not support
+inline void verifyHostFeatures(const llvm::TargetMachine& TM)
+{
+    llvm::StringMap<bool> HostFeatures;
+    llvm::sys::getHostCPUFeatures(HostFeatures);
+
+    const llvm::SubtargetFeatures Features(TM.getTargetFeatureString());
+    for (const std::string& feature : Features.getFeatures()) {
+        if (feature.size() < 2 || feature[0] != '+') continue;
+        const auto iter = HostFeatures.find(feature.substr(1));
+        if (iter == HostFeatures.end() || !iter->second) {
+            OPENVDB_THROW(AXCompilerError, "The target CPU \"" + TM.getTargetCPU().str() +
+                "\" requires the CPU feature \"" + feature.substr(1) + "\" which is not "
+                "supported by the host machine. Code for this target can only be "
+                "compiled ahead of time with compileObject().");
+        }
+    }
+}
+
+/// @brief  Initialize a target machine for the host platform and the requested
+///         target CPU. Returns a nullptr if a target could not be created.
+/// @note   The host is not required to support the target CPU, as object code
+///         may be compiled for other machines. The instruction set extensions
+///         of the x86-64 targets are added to the features explicitly, so that
+///         they are recorded by object bundles and checked when loaded.
 /// @note   This logic is based off the Kaleidoscope tutorial below with extensions
 ///         for CPU and CPU featrue set targetting
 ///         https://llvm.org/docs/tutorial/MyFirstLanguageFrontend/LangImpl08.html
-inline std::unique_ptr<llvm::TargetMachine> initializeTargetMachine()
+inline std::unique_ptr<llvm::TargetMachine>
+initializeTargetMachine(const CompilerOptions::TargetCPU target)
 {
     const std::string TargetTriple = llvm::sys::getDefaultTargetTriple();
     std::string Error;
@@ -107,14 +143,58 @@ inline std::unique_ptr<llvm::TargetMachine> initializeTargetMachine()
         return nullptr;
     }
 
-    // default cpu with no additional features = "generic"
-    const llvm::StringRef& CPU = llvm::sys::getHostCPUName();
+    const bool x86 = llvm::Triple(TargetTriple).getArch() == llvm::Triple::x86_64;
 
+    // default cpu with no additional features = "generic"
+    std::string CPU = "generic";
     llvm::SubtargetFeatures Features;
-    llvm::StringMap<bool> HostFeatures;
-    if (llvm::sys::getHostCPUFeatures(HostFeatures))
-      for (auto &F : HostFeatures)
-        Features.AddFeature(F.first(), F.second);
+
+    auto checkTarget = [x86](const std::string& name) {
+        if (!x86) {
+            OPENVDB_THROW(AXCompilerError, "The " + name + " target CPU is only "
+                "supported on x86-64 platforms.");
+        }
+    };
+
+    // the extensions of haswell, which skylake-avx512 extends
+    auto addAVX2Features = [&Features]() {
+        for (const char* feature :
+            { "avx", "avx2", "bmi", "bmi2", "f16c", "fma", "lzcnt", "movbe", "popcnt" }) {
+            Features.AddFeature(feature);
+        }
+    };
+
+    switch (target) {
+        case CompilerOptions::TargetCPU::HOST : {
+            CPU = llvm::sys::getHostCPUName().str();
+            llvm::StringMap<bool> HostFeatures;
+            if (llvm::sys::getHostCPUFeatures(HostFeatures))
+              for (auto &F : HostFeatures)
+                Features.AddFeature(F.first(), F.second);
+            break;
+        }
+        case CompilerOptions::TargetCPU::GENERIC : {
+            if (x86) CPU = "x86-64";
+            break;
+        }
+        case CompilerOptions::TargetCPU::AVX2 : {
+            checkTarget("AVX2");
+            CPU = "haswell";
+            addAVX2Features();
+            break;
+        }
+        case CompilerOptions::TargetCPU::AVX512 : {
+            checkTarget("AVX-512");
+            CPU = "skylake-avx512";
+            addAVX2Features();
+            for (const char* feature :
+                { "avx512f", "avx512cd", "avx512bw", "avx512dq", "avx512vl" }) {
+                Features.AddFeature(feature);
+            }
+            break;
+        }
+        default : {}
+    }
 
     // default options
     llvm::TargetOptions opt;
@@ -127,6 +207,29 @@ inline std::unique_ptr<llvm::TargetMachine> initializeTargetMachine()
     return TargetMachine;
 }
 
+/// @brief  Create a JIT execution engine for the given module. If a target
+///         machine is provided, machine code is generated for its CPU and
+///         features. Otherwise, the engine selects a generic host target.
+inline std::shared_ptr<llvm::ExecutionEngine>
+initializeExecutionEngine(std::unique_ptr<llvm::Module> module,
+                          const llvm::TargetMachine* TM)
+{
+    std::string error;
+    llvm::EngineBuilder builder(std::move(module));
+    builder.setEngineKind(llvm::EngineKind::JIT);
+    builder.setErrorStr(&error);
+    if (TM) {
+        builder.setMCPU(TM->getTargetCPU());
+        builder.setMAttrs(llvm::SubtargetFeatures(TM->getTargetFeatureString()).getFeatures());
+    }
+
+    std::shared_ptr<llvm::ExecutionEngine> executionEngine(builder.create());
+    if (!executionEngine) {
+        OPENVDB_THROW(AXCompilerError, "Failed to create LLVMExecutionEngine: " + error);
+    }
+    return executionEngine;
+}
+
 #ifndef USE_NEW_PASS_MANAGER
 
 void addStandardLinkPasses(llvm::legacy::PassManagerBase& passes)
@@ -199,13 +302,13 @@ void LLVMoptimise(llvm::Module* module,
                   const unsigned optLevel,
                   const unsigned sizeLevel,
                   const bool verify,
-                  llvm::TargetMachine* TM)
+                  llvm::TargetMachine* TM,
+                  const llvm::TargetLibraryInfoImpl& TLII)
 {
     // Pass manager setup and IR optimisations - Do target independent optimisations
     // only - i.e. the following do not require an llvm TargetMachine analysis pass
 
     llvm::legacy::PassManager passes;
-    llvm::TargetLibraryInfoImpl TLII(llvm::Triple(module->getTargetTriple()));
     passes.add(new llvm::TargetLibraryInfoWrapperPass(TLII));
 
     // Add internal analysis passes from the target machine.
@@ -234,7 +337,8 @@ void LLVMoptimise(llvm::Module* module,
 void LLVMoptimise(llvm::Module* module,
                   const llvm::PassBuilder::OptimizationLevel opt,
                   const bool verify,
-                  llvm::TargetMachine* TM)
+                  llvm::TargetMachine* TM,
+                  const llvm::TargetLibraryInfoImpl& TLII)
 {
     unsigned optLevel = 0, sizeLevel = 0;
 
@@ -274,7 +378,7 @@ void LLVMoptimise(llvm::Module* module,
     sizeLevel = opt.getSizeLevel();
 #endif
 
-    LLVMoptimise(module, optLevel, sizeLevel, verify, TM);
+    LLVMoptimise(module, optLevel, sizeLevel, verify, TM, TLII);
 }
 
 #else
@@ -282,7 +386,8 @@ void LLVMoptimise(llvm::Module* module,
 void LLVMoptimise(llvm::Module* module,
                   const llvm::PassBuilder::OptimizationLevel optLevel,
                   const bool verify,
-                  llvm::TargetMachine* TM)
+                  llvm::TargetMachine* TM,
+                  const llvm::TargetLibraryInfoImpl& TLII)
 {
     // use the PassBuilder for optimisation pass management
     // see llvm's llvm/Passes/PassBuilder.h, tools/opt/NewPMDriver.cpp
@@ -294,6 +399,10 @@ void LLVMoptimise(llvm::Module* module,
     llvm::CGSCCAnalysisManager cGSCCAM;
     llvm::ModuleAnalysisManager MAM;
 
+    // register the target library info first, so that the default is not
+    // used in its place
+    FAM.registerPass([&] { return llvm::TargetLibraryAnalysis(TLII); });
+
     // register all of the analysis passes available by default
     PB.registerModuleAnalyses(MAM);
     PB.registerCGSCCAnalyses(cGSCCAM);
@@ -326,6 +435,7 @@ void LLVMoptimise(llvm::Module* module,
 void optimiseAndVerify(llvm::Module* module,
         const bool verify,
         const CompilerOptions::OptLevel optLevel,
+        const CompilerOptions::VectorLibrary vectorLibrary,
         llvm::TargetMachine* TM)
 {
     if (verify) {
@@ -335,34 +445,189 @@ void optimiseAndVerify(llvm::Module* module,
         }
     }
 
+    const llvm::Triple triple(module->getTargetTriple());
+    llvm::TargetLibraryInfoImpl TLII(triple);
+
+    // map scalar math calls to the selected vector library
+    if (vectorLibrary == CompilerOptions::VectorLibrary::AX) {
+        codegen::addVectorFunctionMappings(TLII);
+        codegen::insertVectorFunctions(*module);
+    }
+    else if (vectorLibrary == CompilerOptions::VectorLibrary::SVML) {
+#if LLVM_VERSION_MAJOR < 17
+        TLII.addVectorizableFunctionsFromVecLib(llvm::TargetLibraryInfoImpl::SVML);
+#else
+        TLII.addVectorizableFunctionsFromVecLib(llvm::TargetLibraryInfoImpl::SVML, triple);
+#endif
+    }
+
     switch (optLevel) {
         case CompilerOptions::OptLevel::O0 : {
-            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O0, verify, TM);
+            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O0, verify, TM, TLII);
             break;
         }
         case CompilerOptions::OptLevel::O1 : {
-            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O1, verify, TM);
+            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O1, verify, TM, TLII);
             break;
         }
         case CompilerOptions::OptLevel::O2 : {
-            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O2, verify, TM);
+            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O2, verify, TM, TLII);
             break;
         }
         case CompilerOptions::OptLevel::Os : {
-            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::Os, verify, TM);
+            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::Os, verify, TM, TLII);
             break;
         }
         case CompilerOptions::OptLevel::Oz : {
-            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::Oz, verify, TM);
+            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::Oz, verify, TM, TLII);
             break;
         }
         case CompilerOptions::OptLevel::O3 : {
-            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O3, verify, TM);
+            LLVMoptimise(module, llvm::PassBuilder::OptimizationLevel::O3, verify, TM, TLII);
             break;
         }
         case CompilerOptions::OptLevel::NONE :
         default             : {}
     }
+
+    if (vectorLibrary == CompilerOptions::VectorLibrary::AX) {
+        codegen::removeUnusedVectorFunctions(*module);
+    }
+}
+
+/// @brief  Apply a fast math level to all floating point operations and
+///         function definitions in a module. This is performed after code
+///         generation so that the bodies of IR functions are also affected.
+void applyFastMath(llvm::Module& module, const CompilerOptions::FastMath level)
+{
+    if (level == CompilerOptions::FastMath::NONE) return;
+
+    llvm::FastMathFlags FMF;
+    if (level == CompilerOptions::FastMath::FAST) {
+        FMF.setFast();
+    }
+    else {
+        FMF.setAllowContract(true);
+        if (level == CompilerOptions::FastMath::RELAXED) {
+            FMF.setAllowReassoc();
+            FMF.setAllowReciprocal();
+            FMF.setApproxFunc();
+            FMF.setNoSignedZeros();
+        }
+    }
+
+    for (llvm::Function& F : module) {
+        if (F.isDeclaration()) continue;
+
+        // function attributes are used by the code generator
+        if (level != CompilerOptions::FastMath::CONTRACT) {
+            F.addFnAttr("no-signed-zeros-fp-math", "true");
+        }
+        if (level == CompilerOptions::FastMath::FAST) {
+            F.addFnAttr("unsafe-fp-math", "true");
+            F.addFnAttr("no-infs-fp-math", "true");
+            F.addFnAttr("no-nans-fp-math", "true");
+        }
+
+        for (llvm::Instruction& inst : llvm::instructions(F)) {
+            if (!llvm::isa<llvm::FPMathOperator>(&inst)) continue;
+            inst.setFastMathFlags(FMF);
+        }
+    }
+}
+
+/// @brief  Pass which constant folds calls to C bindings whose arguments have
+///         become constant through optimisation. AX code generation only
+///         folds calls with immediate constant arguments, so expressions such
+///         as "int a = 1; cosh(a);" keep their calls until llvm has propagated
+///         the constants. Only bindings which allow constant folding are
+///         evaluated.
+struct ConstantFoldCBindingsPass : public llvm::ModulePass
+{
+    static char ID;
+
+    ConstantFoldCBindingsPass(const codegen::FunctionRegistry& registry)
+        : llvm::ModulePass(ID)
+        , mRegistry(registry) {}
+
+    bool runOnModule(llvm::Module& module) override
+    {
+        // collect the foldable C bindings which are declared in the module
+
+        std::unordered_map<std::string, const codegen::CFunctionBase*> bindings;
+        for (const auto& iter : mRegistry.map()) {
+            const codegen::FunctionGroup* const function = iter.second.function();
+            if (!function) continue;
+            for (const codegen::Function::Ptr& decl : function->list()) {
+                const llvm::Function* llvmFunction = module.getFunction(decl->symbol());
+                if (!llvmFunction || !llvmFunction->empty()) continue;
+                const codegen::CFunctionBase* binding =
+                    dynamic_cast<const codegen::CFunctionBase*>(decl.get());
+                if (!binding || !binding->hasConstantFold()) continue;
+                bindings[decl->symbol()] = binding;
+            }
+        }
+
+        if (bindings.empty()) return false;
+
+        // fold calls in instruction order, replacing their uses immediately so
+        // that dependent calls can also be folded
+
+        std::vector<llvm::CallInst*> folded;
+        for (llvm::Function& F : module) {
+            for (llvm::Instruction& inst : llvm::instructions(F)) {
+                llvm::CallInst* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+                if (!call) continue;
+                const llvm::Function* callee = call->getCalledFunction();
+                if (!callee) continue;
+
+                const auto iter = bindings.find(callee->getName().str());
+                if (iter == bindings.end()) continue;
+
+                std::vector<llvm::Value*> args;
+                for (llvm::Value* arg : call->arg_operands()) {
+                    // only scalar immediates are supported by the folder
+                    if (!llvm::isa<llvm::ConstantInt>(arg) &&
+                        !llvm::isa<llvm::ConstantFP>(arg)) break;
+                    args.emplace_back(arg);
+                }
+                if (args.size() != call->getNumArgOperands()) continue;
+
+                llvm::Value* result = iter->second->fold(args, module.getContext());
+                if (!result || result->getType() != call->getType()) continue;
+
+                call->replaceAllUsesWith(result);
+                folded.emplace_back(call);
+            }
+        }
+
+        for (llvm::CallInst* call : folded) call->eraseFromParent();
+        return !folded.empty();
+    }
+
+private:
+    const codegen::FunctionRegistry& mRegistry;
+};
+
+char ConstantFoldCBindingsPass::ID = 0;
+
+/// @brief  Fold C bindings after optimisation and clean up any resulting
+///         constant expressions
+void foldCBindings(llvm::Module* module,
+        const codegen::FunctionRegistry& registry,
+        const bool verify,
+        const CompilerOptions::OptLevel optLevel)
+{
+    // without optimisation constants are not propagated to calls
+    if (optLevel == CompilerOptions::OptLevel::NONE ||
+        optLevel == CompilerOptions::OptLevel::O0) return;
+
+    llvm::legacy::PassManager passes;
+    passes.add(new ConstantFoldCBindingsPass(registry));
+    passes.add(llvm::createInstructionCombiningPass());
+    passes.add(llvm::createCFGSimplificationPass());
+    if (verify) passes.add(llvm::createVerifierPass());
+    passes.run(*module);
 }
 
 void initializeGlobalFunctions(const codegen::FunctionRegistry& registry,
@@ -619,6 +884,109 @@ registerExternalGlobals(const codegen::SymbolTable& globals, CustomData::Ptr& da
     }
 }
 
+/// @brief  Prepare the external variable globals for object code which is
+///         compiled ahead of time. The addresses of the custom data are not
+///         known until the object code is loaded, so each global is defined
+///         as a writable zero value which is assigned on load. The tokens of
+///         the external variables are added to the provided vector.
+inline void
+registerExternalBindings(const codegen::SymbolTable& globals,
+    llvm::LLVMContext& C,
+    std::vector<std::string>& tokens)
+{
+    std::string name, typestr;
+    for (const auto& global : globals.map()) {
+
+        const std::string& token = global.first;
+        if (!ast::ExternalVariable::nametypeFromToken(token, &name, &typestr)) continue;
+
+        // should always be a GlobalVariable.
+        assert(llvm::isa<llvm::GlobalVariable>(global.second));
+
+        llvm::GlobalVariable* variable = llvm::cast<llvm::GlobalVariable>(global.second);
+        assert(variable->getValueType() == codegen::LLVMType<uintptr_t>::get(C));
+
+        variable->setInitializer(codegen::LLVMType<uintptr_t>::get(C, uintptr_t(0)));
+        variable->setConstant(false); // written to when the object code is loaded
+        tokens.emplace_back(token);
+    }
+}
+
+/// @brief  Returns the function identifiers and symbols of the C bindings
+///         called by a module. These are bound to the functions of the
+///         registry in the process which loads the object code.
+ObjectBundle::BindingVec
+objectBindings(const codegen::FunctionRegistry& registry, const llvm::Module& module)
+{
+    ObjectBundle::BindingVec bindings;
+
+    for (const auto& iter : registry.map()) {
+        const codegen::FunctionGroup* const function = iter.second.function();
+        if (!function) continue;
+
+        for (const codegen::Function::Ptr& decl : function->list()) {
+            // skip functions which aren't called or have a body
+            const llvm::Function* llvmFunction = module.getFunction(decl->symbol());
+            if (!llvmFunction) continue;
+            if (llvmFunction->size() > 0) continue;
+
+            const codegen::CFunctionBase* binding =
+                dynamic_cast<const codegen::CFunctionBase*>(decl.get());
+            if (!binding) {
+                OPENVDB_LOG_WARN("Function with symbol \"" << decl->symbol() << "\" has "
+                    "no function body and is not a C binding.");
+                continue;
+            }
+            if (binding->address() == 0) {
+                OPENVDB_THROW(AXCompilerError, "No available mapping for C Binding "
+                    "with symbol \"" << decl->symbol() << "\"");
+            }
+
+            bindings.emplace_back(iter.first, decl->symbol());
+        }
+    }
+
+    return bindings;
+}
+
+/// @brief  Generate relocatable object code from an optimised module. The code
+///         is position independent so that it can be loaded at any address.
+std::string
+emitObject(llvm::Module& module, const llvm::TargetMachine& TM)
+{
+    std::unique_ptr<llvm::TargetMachine> objectTM(
+        TM.getTarget().createTargetMachine(TM.getTargetTriple().str(),
+            TM.getTargetCPU(), TM.getTargetFeatureString(), TM.Options,
+            llvm::Reloc::PIC_));
+    if (!objectTM) {
+        OPENVDB_THROW(AXCompilerError, "Unable to create a target machine for "
+            "object code generation.");
+    }
+
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream stream(buffer);
+    llvm::legacy::PassManager passes;
+
+#if LLVM_VERSION_MAJOR < 7
+    const bool failed = objectTM->addPassesToEmitFile(passes, stream,
+        llvm::TargetMachine::CGFT_ObjectFile);
+#elif LLVM_VERSION_MAJOR < 10
+    const bool failed = objectTM->addPassesToEmitFile(passes, stream, nullptr,
+        llvm::TargetMachine::CGFT_ObjectFile);
+#else
+    const bool failed = objectTM->addPassesToEmitFile(passes, stream, nullptr,
+        llvm::CGFT_ObjectFile);
+#endif
+
+    if (failed) {
+        OPENVDB_THROW(AXCompilerError, "The target machine is unable to emit "
+            "object code.");
+    }
+
+    passes.run(module);
+    return std::string(buffer.data(), buffer.size());
+}
+
 struct PointDefaultModifier :
     public openvdb::ax::ast::Visitor<PointDefaultModifier, /*non-const*/false>
 {
@@ -629,11 +997,15 @@ struct PointDefaultModifier :
 
     virtual ~PointDefaultModifier() = default;
 
-    const std::set<std::string> autoVecAttribs {"P", "v", "N", "Cd"};
+    /// @brief  Returns whether the given attribute is modified
+    static bool modifies(const ast::Attribute& attrib) {
+        static const std::set<std::string> autoVecAttribs {"P", "v", "N", "Cd"};
+        if (!attrib.inferred()) return false;
+        return autoVecAttribs.find(attrib.name()) != autoVecAttribs.end();
+    }
 
     bool visit(ast::Attribute* attrib) {
-        if (!attrib->inferred()) return true;
-        if (autoVecAttribs.find(attrib->name()) == autoVecAttribs.end()) return true;
+        if (!modifies(*attrib)) return true;
 
         openvdb::ax::ast::Attribute::UniquePtr
             replacement(new openvdb::ax::ast::Attribute(attrib->name(), ast::tokens::VEC3F, true));
@@ -647,6 +1019,347 @@ struct PointDefaultModifier :
     }
 };
 
+/// @brief  Replaces calls to external() and externalv() which are given a
+///         string literal with the equivalent external variable access, i.e.
+///         $name and v$name. External variables are resolved to loads from
+///         the CustomData at compile time rather than being looked up by
+///         name on every call, allowing llvm to hoist them out of loops.
+/// @note   Only calls which name existing custom data of the matching type
+///         are replaced. Other calls are left untouched, as external() returns
+///         zero for missing data without inserting it into the CustomData,
+///         and for data of a different type, where the external variable
+///         would fail to compile.
+struct ExternalLookupModifier :
+    public openvdb::ax::ast::Visitor<ExternalLookupModifier, /*non-const*/false>
+{
+    using openvdb::ax::ast::Visitor<ExternalLookupModifier, false>::traverse;
+    using openvdb::ax::ast::Visitor<ExternalLookupModifier, false>::visit;
+
+    ExternalLookupModifier(const CustomData* const data)
+        : mData(data) {}
+
+    virtual ~ExternalLookupModifier() = default;
+
+    /// @brief  Returns the type of the external variable which replaces the
+    ///         given call, or UNKNOWN if the call is not modified
+    ast::tokens::CoreType modifies(const ast::FunctionCall& call) const
+    {
+        ast::tokens::CoreType type = ast::tokens::UNKNOWN;
+        if (call.name() == "external")       type = ast::tokens::FLOAT;
+        else if (call.name() == "externalv") type = ast::tokens::VEC3F;
+        else return ast::tokens::UNKNOWN;
+
+        if (call.numArgs() != 1) return ast::tokens::UNKNOWN;
+        const ast::Value<std::string>* const literal =
+            dynamic_cast<const ast::Value<std::string>*>(call.child(0));
+        if (!literal) return ast::tokens::UNKNOWN;
+
+        if (!mData) return ast::tokens::UNKNOWN;
+        const Metadata::ConstPtr meta = mData->getData(literal->value());
+        if (!meta) return ast::tokens::UNKNOWN;
+
+        const bool match = type == ast::tokens::FLOAT ?
+            static_cast<bool>(dynamic_cast<const TypedMetadata<float>*>(meta.get())) :
+            static_cast<bool>(dynamic_cast<const TypedMetadata<math::Vec3<float>>*>(meta.get()));
+        return match ? type : ast::tokens::UNKNOWN;
+    }
+
+    bool visit(ast::FunctionCall* call)
+    {
+        const ast::tokens::CoreType type = this->modifies(*call);
+        if (type == ast::tokens::UNKNOWN) return true;
+
+        const std::string& name =
+            static_cast<const ast::Value<std::string>*>(call->child(0))->value();
+        ast::ExternalVariable::UniquePtr replacement(new ast::ExternalVariable(name, type));
+        if (!call->replace(replacement.get())) {
+            OPENVDB_THROW(AXCompilerError,
+                "Conversion of external lookup \"" + name + "\" failed.");
+        }
+        replacement.release();
+        return true;
+    }
+
+private:
+    const CustomData* const mData;
+};
+
+/// @brief  Returns the AST to compile, applying any compile time modifications.
+///         The modifiers rarely change the AST, so rather than always copying
+///         the given tree, a copy is only made if a node is found which would
+///         be modified. The copy is held by the provided storage.
+/// @param  tree     The AST to compile
+/// @param  points   Whether to apply the point modifications
+/// @param  data     The custom data which the AST will be compiled with
+/// @param  storage  Storage for the modified copy of the AST, if one is made
+const ast::Tree&
+modifiedTree(const ast::Tree& tree,
+    const bool points,
+    const CustomData* const data,
+    ast::Tree::UniquePtr& storage)
+{
+    ExternalLookupModifier externals(data);
+
+    bool modify = false;
+    if (points) {
+        ast::visitNodeType<ast::Attribute>(tree,
+            [&](const ast::Attribute& attrib) -> bool {
+                modify = PointDefaultModifier::modifies(attrib);
+                return !modify;
+            });
+    }
+    if (!modify) {
+        ast::visitNodeType<ast::FunctionCall>(tree,
+            [&](const ast::FunctionCall& call) -> bool {
+                modify = externals.modifies(call) != ast::tokens::UNKNOWN;
+                return !modify;
+            });
+    }
+    if (!modify) return tree;
+
+    {
+        ast::NodeArena arena;
+        ast::NodeArena::Scope scope(arena);
+        storage.reset(tree.copy());
+    }
+
+    if (points) {
+        PointDefaultModifier modifier;
+        modifier.traverse(storage.get());
+    }
+    externals.traverse(storage.get());
+    return *storage;
+}
+
+/// @brief  Map the nodes of a copied tree to the line and column numbers of
+///   the nodes they were copied from
+void copyNodeLocations(const ast::Node& node, const ast::Node& copy, Logger& logger)
+{
+    assert(node.children() == copy.children());
+    const Logger::CodeLocation location = logger.getNodeLocation(&node);
+    if (location.first > 0) logger.addNodeLocation(&copy, location);
+    for (size_t i = 0; i < node.children(); ++i) {
+        const ast::Node* child = node.child(i);
+        if (child) copyNodeLocations(*child, *copy.child(i), logger);
+    }
+}
+
+/// @brief  Rewrite a tree which is followed by others in a fused kernel so
+///   that its return statements only end the tree. The returns are replaced
+///   with breaks out of a single iteration do-while loop, which the block is
+///   wrapped in. Returns the statement to insert into the fused kernel, or
+///   a nullptr on error.
+ast::Statement* endWithBreaks(ast::Block* block, Logger& logger)
+{
+    std::vector<const ast::Keyword*> returns;
+    bool valid = true;
+    ast::visitNodeType<ast::Keyword>(*block,
+        [&](const ast::Keyword& keyword) -> bool {
+            bool proceed = true;
+            const ast::Node* parent = keyword.parent();
+            while (parent && parent->nodetype() != ast::Node::LoopNode) {
+                parent = parent->parent();
+            }
+            if (keyword.keyword() == ast::tokens::RETURN) {
+                if (!parent) returns.emplace_back(&keyword);
+                else {
+                    valid = false;
+                    proceed = logger.error("return statements within loops can "
+                        "only be used in the last of a chain of fused kernels.",
+                        &keyword);
+                }
+            }
+            else if (!parent) {
+                // these would otherwise break from the do-while loop
+                valid = false;
+                proceed = logger.error("keyword \"" +
+                    ast::tokens::keywordNameFromToken(keyword.keyword()) +
+                    "\" used outside of loop.", &keyword);
+            }
+            return proceed;
+        });
+
+    if (!valid) return nullptr;
+    if (returns.empty()) return block;
+
+    for (const ast::Keyword* keyword : returns) {
+        // the block is owned by the fused kernel, so may be modified
+        ast::Node* node = const_cast<ast::Keyword*>(keyword);
+        const bool replaced = node->replace(new ast::Keyword(ast::tokens::BREAK));
+        assert(replaced);
+        (void)replaced;
+    }
+    return new ast::Loop(ast::tokens::DO, new ast::Value<bool>(false), block);
+}
+
+/// @brief  Verify that the neighbour queries of a tree which follows others
+///   in a fused kernel don't read attributes written by the trees before it.
+///   Neighbours are indexed once from the values of points before execution,
+///   so such queries would not see the values written by the earlier trees
+///   as they would when the trees are executed in turn. Positions are read
+///   by every query. Returns false and logs an error for each such query.
+bool verifyNeighbourQueries(const ast::Block& block,
+    const std::vector<const ast::Block*>& previous,
+    Logger& logger)
+{
+    bool valid = true;
+    ast::visitNodeType<ast::FunctionCall>(block,
+        [&](const ast::FunctionCall& call) -> bool {
+            if (call.name() != "nearpointcount" &&
+                call.name() != "nearpointaverage" &&
+                call.name() != "nearpointaveragev") return true;
+
+            std::vector<std::string> names { "P" };
+            if (call.name() != "nearpointcount" && !call.empty()) {
+                const ast::Value<std::string>* const name =
+                    dynamic_cast<const ast::Value<std::string>*>(call.child(0));
+                if (name) names.emplace_back(name->value());
+            }
+
+            for (const std::string& name : names) {
+                for (const ast::Block* earlier : previous) {
+                    if (!ast::writesToAttribute(*earlier, name)) continue;
+                    valid = false;
+                    return logger.error("\"" + call.name() + "\" queries \"@" + name +
+                        "\" which is written by an earlier kernel in a chain of fused "
+                        "kernels. Neighbour queries only see the values of points "
+                        "from before execution.", &call);
+                }
+            }
+            return true;
+        });
+    return valid;
+}
+
+/// @brief  Fuse an ordered chain of trees into a single tree, each within
+///   its own scope. The logger is updated to resolve the locations of the
+///   nodes of the fused tree through the trees they were copied from.
+ast::Tree::ConstPtr
+fuse(const std::vector<ast::Tree::ConstPtr>& syntaxTrees, Logger& logger)
+{
+    ast::NodeArena arena;
+    ast::NodeArena::Scope scope(arena);
+
+    ast::Block::UniquePtr fused(new ast::Block);
+    std::vector<const ast::Block*> previous;
+    bool deletes = false;
+    for (size_t i = 0; i < syntaxTrees.size(); ++i) {
+        assert(syntaxTrees[i]);
+        const ast::Block& original = *(syntaxTrees[i]->child(0));
+        ast::Block* block = original.copy();
+        copyNodeLocations(original, *block, logger);
+
+        if (!verifyNeighbourQueries(*block, previous, logger)) {
+            delete block;
+            return nullptr;
+        }
+        previous.emplace_back(block);
+
+        ast::Statement* statement = block;
+        if (i != syntaxTrees.size() - 1) {
+            statement = endWithBreaks(block, logger);
+            if (!statement) {
+                delete block;
+                return nullptr;
+            }
+        }
+
+        // points are only removed once execution completes, so skip the
+        // points deleted by earlier trees as if they had already been removed
+        if (deletes) {
+            ast::Block* skipped = statement == block ? block : new ast::Block(statement);
+            statement = new ast::ConditionalStatement(
+                new ast::UnaryOperator(
+                    new ast::FunctionCall("ingroup", new ast::Value<std::string>("dead")),
+                    ast::tokens::NOT),
+                skipped);
+        }
+        deletes |= ast::callsFunction(*block, "deletepoint");
+
+        fused->addStatement(statement);
+    }
+
+    ast::Tree::ConstPtr tree(new ast::Tree(fused.release()));
+    logger.setSourceTree(tree);
+    // the fused tree has no single source to print lines from
+    logger.setSourceCode(nullptr);
+    return tree;
+}
+
+/// @brief  Generate and optimise the module of an AST. This is shared by the
+///   JIT compilation of executables and the ahead of time compilation of
+///   object code, which only differ in how the external variables of the
+///   module are bound. Returns a nullptr if a compilation error was logged.
+/// @param tree  The AST to compile, with any compile time modifications
+/// @param C  The context to create the module in
+/// @param options  The compiler options
+/// @param registry  The function registry
+/// @param TM  The target machine to compile for, which may be a nullptr for
+///   the host
+/// @param logger  The logger to report errors to
+/// @param attributes  Set to the access registry of the AST
+/// @param externals  Invoked with the globals of the generated module prior
+///   to optimisation, to bind the external variables it accesses
+template <typename GeneratorT>
+std::unique_ptr<llvm::Module>
+generateModule(const ast::Tree& tree,
+    llvm::LLVMContext& C,
+    const CompilerOptions& options,
+    codegen::FunctionRegistry& registry,
+    llvm::TargetMachine* TM,
+    Logger& logger,
+    AttributeRegistry::Ptr& attributes,
+    const std::function<void(const codegen::SymbolTable&)>& externals)
+{
+    verifyTypedAccesses(tree, logger);
+
+    // initialize the module and generate LLVM IR
+
+    std::unique_ptr<llvm::Module> module(new llvm::Module("module", C));
+    if (TM) {
+        module->setDataLayout(TM->createDataLayout());
+        module->setTargetTriple(TM->getTargetTriple().normalize());
+    }
+
+    GeneratorT codeGenerator(*module, options.mFunctionOptions, registry, logger);
+    attributes = codeGenerator.generate(tree);
+
+    // if there has been a compilation error through user error, exit
+    if (!attributes) {
+        assert(logger.hasError());
+        return nullptr;
+    }
+
+    // map accesses (always do this prior to optimising as globals may be removed)
+    registerAccesses(codeGenerator.globals(), *attributes);
+    externals(codeGenerator.globals());
+
+    // optimise
+
+    llvm::Module* modulePtr = module.get();
+    applyFastMath(*modulePtr, options.mFastMath);
+    optimiseAndVerify(modulePtr, options.mVerify, options.mOptLevel,
+        options.mVectorLibrary, TM);
+
+    // re-constant fold. Although constant folding will work with constant
+    // expressions prior to optimisation, expressions like "int a = 1; cosh(a);"
+    // will still keep a call to cosh, as llvm is unable to optimise C bindings
+    // out (it isn't aware of the function body). llvm can however change this
+    // example into "cosh(1)" which we can then handle.
+    foldCBindings(modulePtr, registry, options.mVerify, options.mOptLevel);
+    return module;
+}
+
+/// @brief  Returns the number of CPU features enabled by a feature string
+inline size_t enabledFeatures(const std::string& features)
+{
+    size_t count = 0;
+    for (const std::string& feature : llvm::SubtargetFeatures(features).getFeatures()) {
+        if (!feature.empty() && feature[0] == '+') ++count;
+    }
+    return count;
+}
+
 } // anonymous namespace
 
 /////////////////////////////////////////////////////////////////////////////
@@ -671,67 +1384,45 @@ void Compiler::setFunctionRegistry(std::unique_ptr<codegen::FunctionRegistry>&&
     mFunctionRegistry = std::move(functionRegistry);
 }
 
+llvm::TargetMachine* Compiler::targetMachine(const bool verifyHost)
+{
+    if (!mTargetMachine) {
+        mTargetMachine = initializeTargetMachine(mCompilerOptions.mTargetCPU);
+    }
+    if (verifyHost && mTargetMachine) verifyHostFeatures(*mTargetMachine);
+    return mTargetMachine.get();
+}
+
 template<>
 PointExecutable::Ptr
 Compiler::compile<PointExecutable>(const ast::Tree& syntaxTree,
                                    Logger& logger,
                                    const CustomData::Ptr customData)
 {
-    openvdb::SharedPtr<ast::Tree> tree(syntaxTree.copy());
-    PointDefaultModifier modifier;
-    modifier.traverse(tree.get());
-
-    verifyTypedAccesses(*tree, logger);
-    // initialize the module and generate LLVM IR
-    std::unique_ptr<llvm::Module> module(new llvm::Module("module", *mContext));
-    std::unique_ptr<llvm::TargetMachine> TM = initializeTargetMachine();
-    if (TM) {
-        module->setDataLayout(TM->createDataLayout());
-        module->setTargetTriple(TM->getTargetTriple().normalize());
-    }
-
-    codegen::codegen_internal::PointComputeGenerator
-        codeGenerator(*module, mCompilerOptions.mFunctionOptions,
-            *mFunctionRegistry, logger);
-    AttributeRegistry::Ptr attributes = codeGenerator.generate(*tree);
-
-    // if there has been a compilation error through user error, exit
-    if (!attributes) {
-        assert(logger.hasError());
-        return nullptr;
-    }
+    ast::Tree::UniquePtr storage;
+    const ast::Tree& tree =
+        modifiedTree(syntaxTree, /*points*/true, customData.get(), storage);
 
-    // map accesses (always do this prior to optimising as globals may be removed)
-    registerAccesses(codeGenerator.globals(), *attributes);
+    const auto neighbours =
+        codegen::codegen_internal::PointNeighbours::accesses(tree, &logger);
 
+    llvm::TargetMachine* TM = this->targetMachine(/*verify host*/true);
     CustomData::Ptr validCustomData(customData);
-    registerExternalGlobals(codeGenerator.globals(), validCustomData, *mContext);
+    AttributeRegistry::Ptr attributes;
 
-    // optimise
-
-    llvm::Module* modulePtr = module.get();
-    optimiseAndVerify(modulePtr, mCompilerOptions.mVerify, mCompilerOptions.mOptLevel, TM.get());
-
-    // @todo re-constant fold!! although constant folding will work with constant
-    //       expressions prior to optimisation, expressions like "int a = 1; cosh(a);"
-    //       will still keep a call to cosh. This is because the current AX folding
-    //       only checks for an immediate constant expression and for C bindings,
-    //       like cosh, llvm its unable to optimise the call out (as it isn't aware
-    //       of the function body). What llvm can do, however, is change this example
-    //       into "cosh(1)" which we can then handle.
+    std::unique_ptr<llvm::Module> module =
+        generateModule<codegen::codegen_internal::PointComputeGenerator>
+            (tree, *mContext, mCompilerOptions, *mFunctionRegistry, TM, logger, attributes,
+                [&](const codegen::SymbolTable& globals) {
+                    registerExternalGlobals(globals, validCustomData, *mContext);
+                });
+    if (!module) return nullptr;
 
     // create the llvm execution engine which will build our function pointers
 
-    std::string error;
+    llvm::Module* modulePtr = module.get();
     std::shared_ptr<llvm::ExecutionEngine>
-        executionEngine(llvm::EngineBuilder(std::move(module))
-            .setEngineKind(llvm::EngineKind::JIT)
-            .setErrorStr(&error)
-            .create());
-
-    if (!executionEngine) {
-        OPENVDB_THROW(AXCompilerError, "Failed to create LLVMExecutionEngine: " + error);
-    }
+        executionEngine = initializeExecutionEngine(std::move(module), TM);
 
     // map functions
 
@@ -764,7 +1455,8 @@ Compiler::compile<PointExecutable>(const ast::Tree& syntaxTree,
             executionEngine,
             attributes,
             validCustomData,
-            functionMap));
+            functionMap,
+            neighbours));
 
     return executable;
 }
@@ -775,48 +1467,26 @@ Compiler::compile<VolumeExecutable>(const ast::Tree& syntaxTree,
                                     Logger& logger,
                                     const CustomData::Ptr customData)
 {
-    verifyTypedAccesses(syntaxTree, logger);
-
-    // initialize the module and generate LLVM IR
-
-    std::unique_ptr<llvm::Module> module(new llvm::Module("module", *mContext));
-    std::unique_ptr<llvm::TargetMachine> TM = initializeTargetMachine();
-    if (TM) {
-        module->setDataLayout(TM->createDataLayout());
-        module->setTargetTriple(TM->getTargetTriple().normalize());
-    }
-
-    codegen::codegen_internal::VolumeComputeGenerator
-        codeGenerator(*module, mCompilerOptions.mFunctionOptions,
-            *mFunctionRegistry, logger);
-    AttributeRegistry::Ptr attributes = codeGenerator.generate(syntaxTree);
-
-    // if there has been a compilation error through user error, exit
-    if (!attributes) {
-        assert(logger.hasError());
-        return nullptr;
-    }
-
-    // map accesses (always do this prior to optimising as globals may be removed)
-    registerAccesses(codeGenerator.globals(), *attributes);
+    ast::Tree::UniquePtr storage;
+    const ast::Tree& tree =
+        modifiedTree(syntaxTree, /*points*/false, customData.get(), storage);
 
+    llvm::TargetMachine* TM = this->targetMachine(/*verify host*/true);
     CustomData::Ptr validCustomData(customData);
-    registerExternalGlobals(codeGenerator.globals(), validCustomData, *mContext);
+    AttributeRegistry::Ptr attributes;
 
-    llvm::Module* modulePtr = module.get();
-    optimiseAndVerify(modulePtr, mCompilerOptions.mVerify, mCompilerOptions.mOptLevel, TM.get());
+    std::unique_ptr<llvm::Module> module =
+        generateModule<codegen::codegen_internal::VolumeComputeGenerator>
+            (tree, *mContext, mCompilerOptions, *mFunctionRegistry, TM, logger, attributes,
+                [&](const codegen::SymbolTable& globals) {
+                    registerExternalGlobals(globals, validCustomData, *mContext);
+                });
+    if (!module) return nullptr;
 
-    std::string error;
+    llvm::Module* modulePtr = module.get();
     std::shared_ptr<llvm::ExecutionEngine>
-        executionEngine(llvm::EngineBuilder(std::move(module))
-            .setEngineKind(llvm::EngineKind::JIT)
-            .setErrorStr(&error)
-            .create());
+        executionEngine = initializeExecutionEngine(std::move(module), TM);
 
-
-    if (!executionEngine) {
-        OPENVDB_THROW(AXCompilerError, "Failed to create LLVMExecutionEngine: " + error);
-    }
     // map functions
 
     initializeGlobalFunctions(*mFunctionRegistry, *executionEngine,
@@ -845,6 +1515,139 @@ Compiler::compile<VolumeExecutable>(const ast::Tree& syntaxTree,
     return executable;
 }
 
+template<>
+PointExecutable::Ptr
+Compiler::compile<PointExecutable>(const std::vector<ast::Tree::ConstPtr>& syntaxTrees,
+                                   Logger& logger,
+                                   const CustomData::Ptr customData)
+{
+    const ast::Tree::ConstPtr tree = fuse(syntaxTrees, logger);
+    if (!tree) {
+        assert(logger.hasError());
+        return nullptr;
+    }
+    return this->compile<PointExecutable>(*tree, logger, customData);
+}
+
+template<>
+VolumeExecutable::Ptr
+Compiler::compile<VolumeExecutable>(const std::vector<ast::Tree::ConstPtr>&,
+                                    Logger&,
+                                    const CustomData::Ptr)
+{
+    OPENVDB_THROW(AXCompilerError, "Fusing multiple syntax trees is not "
+        "supported for volume executables.");
+}
+
+template <typename GeneratorT>
+ObjectBundle::Ptr
+Compiler::compileVariants(const ast::Tree& syntaxTree,
+    const ast::Tree& tree,
+    const ObjectBundle::ExecutableType type,
+    Logger& logger)
+{
+    // the target machines of each variant, starting with the compiler's own
+
+    std::vector<CompilerOptions::TargetCPU> cpus { mCompilerOptions.mTargetCPU };
+    std::vector<llvm::TargetMachine*> targets { this->targetMachine(/*verify host*/false) };
+    std::vector<std::unique_ptr<llvm::TargetMachine>> storage;
+
+    for (const CompilerOptions::TargetCPU cpu : mCompilerOptions.mObjectTargets) {
+        if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) continue;
+        cpus.emplace_back(cpu);
+        storage.emplace_back(initializeTargetMachine(cpu));
+        targets.emplace_back(storage.back().get());
+    }
+
+    for (const llvm::TargetMachine* TM : targets) {
+        if (!TM) {
+            OPENVDB_THROW(AXCompilerError, "Unable to create a target machine for "
+                "object code generation.");
+        }
+    }
+
+    ObjectBundle::Ptr bundle(new ObjectBundle(type));
+
+    // the module of each variant is generated from the same tree, so errors
+    // and warnings are only logged for the first
+    Logger quiet([](const std::string&) {}, [](const std::string&) {});
+
+    for (size_t i = 0; i < targets.size(); ++i) {
+        llvm::TargetMachine* TM = targets[i];
+        std::vector<std::string> externals;
+        AttributeRegistry::Ptr attributes;
+
+        std::unique_ptr<llvm::Module> module =
+            generateModule<GeneratorT>
+                (tree, *mContext, mCompilerOptions, *mFunctionRegistry, TM,
+                    i == 0 ? logger : quiet, attributes,
+                    [&](const codegen::SymbolTable& globals) {
+                        registerExternalBindings(globals, *mContext, externals);
+                    });
+        if (!module) {
+            if (i == 0) return nullptr;
+            OPENVDB_THROW(AXCompilerError, "Failed to compile object code for the "
+                "target CPU \"" + TM->getTargetCPU().str() + "\"");
+        }
+
+        if (i == 0) {
+            bundle->mTriple = module->getTargetTriple();
+            bundle->mTree.reset(syntaxTree.copy());
+            bundle->mAttributeRegistry = attributes;
+            bundle->mExternals = std::move(externals);
+        }
+
+        // generate the object code
+
+        ObjectBundle::Variant variant;
+        variant.mCPU = TM->getTargetCPU().str();
+        variant.mFeatures = TM->getTargetFeatureString().str();
+        variant.mBindings = objectBindings(*mFunctionRegistry, *module);
+        variant.mObject = emitObject(*module, *TM);
+        bundle->mVariants.emplace_back(std::move(variant));
+    }
+
+    // order the variants from the most to the least CPU features, so that the
+    // widest instruction set which the host supports is loaded
+    std::stable_sort(bundle->mVariants.begin(), bundle->mVariants.end(),
+        [](const ObjectBundle::Variant& a, const ObjectBundle::Variant& b) {
+            return enabledFeatures(a.features()) > enabledFeatures(b.features());
+        });
+
+    return bundle;
+}
+
+template<>
+ObjectBundle::Ptr
+Compiler::compileObject<PointExecutable>(const ast::Tree& syntaxTree,
+                                         Logger& logger,
+                                         const CustomData::Ptr customData)
+{
+    ast::Tree::UniquePtr storage;
+    const ast::Tree& tree =
+        modifiedTree(syntaxTree, /*points*/true, customData.get(), storage);
+
+    // validate any neighbour queries, which are found again when the bundle is loaded
+    codegen::codegen_internal::PointNeighbours::accesses(tree, &logger);
+
+    return this->compileVariants<codegen::codegen_internal::PointComputeGenerator>
+        (syntaxTree, tree, ObjectBundle::ExecutableType::POINTS, logger);
+}
+
+template<>
+ObjectBundle::Ptr
+Compiler::compileObject<VolumeExecutable>(const ast::Tree& syntaxTree,
+                                          Logger& logger,
+                                          const CustomData::Ptr customData)
+{
+    ast::Tree::UniquePtr storage;
+    const ast::Tree& tree =
+        modifiedTree(syntaxTree, /*points*/false, customData.get(), storage);
+
+    return this->compileVariants<codegen::codegen_internal::VolumeComputeGenerator>
+        (syntaxTree, tree, ObjectBundle::ExecutableType::VOLUMES, logger);
+}
+
 
 } // namespace ax
 } // namespace OPENVDB_VERSION_NAME
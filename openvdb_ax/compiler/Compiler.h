@@ -45,6 +45,7 @@
 #include "CompilerOptions.h"
 #include "CustomData.h"
 #include "Logger.h"
+#include "ObjectBundle.h"
 
 #include "../ax.h" // backward compat support for initialize()
 #include "../ast/Parse.h"
@@ -57,6 +58,7 @@
 // forward
 namespace llvm {
 class LLVMContext;
+class TargetMachine;
 }
 
 namespace openvdb {
@@ -193,6 +195,39 @@ public:
         return exe;
     }
 
+    /// @brief Fuse an ordered chain of ASTs into a single kernel and compile
+    ///   it into an executable object of the given type. Executing the result
+    ///   is equivalent to executing each tree in turn, but iterates over the
+    ///   data once. Attributes written by one tree and read by a later one
+    ///   may be forwarded between them by the optimiser rather than stored
+    ///   and reloaded, and writes which a later tree overwrites may be
+    ///   removed where the optimiser can prove it is safe.
+    /// @details  Each tree is given its own scope, so local variables are not
+    ///   shared between them. A return statement in a tree ends that tree
+    ///   only, and the next tree in the chain is run. Points deleted with
+    ///   deletepoint() are skipped by the trees which follow, as if they had
+    ///   already been removed.
+    /// @note  Currently only supported for PointExecutables. Volume
+    ///   executables iterate over the topology of the grids each tree writes
+    ///   to, which fusing would change, and throw an AXCompilerError.
+    /// @note  A return statement within a loop can not be fused, unless it
+    ///   is in the last tree, and results in a compiler error.
+    /// @note  Neighbour queries see the values of points from before
+    ///   execution. A query which reads an attribute, or the positions, written
+    ///   by an earlier tree in the chain results in a compiler error.
+    /// @param syntaxTrees The ASTs to fuse, in order of execution
+    /// @param logger Logger for errors and warnings during compilation. The
+    ///   line and column numbers of messages are resolved through the trees
+    ///   passed in, so each should have been parsed with this logger. Lines
+    ///   of code are not printed, as they may belong to any of the trees.
+    /// @param data Optional external/custom data which is to be referenced by
+    ///   the executable object
+    template <typename ExecutableT>
+    typename ExecutableT::Ptr
+    compile(const std::vector<ast::Tree::ConstPtr>& syntaxTrees,
+            Logger& logger,
+            const CustomData::Ptr data = CustomData::Ptr());
+
     /// @brief Sets the compiler's function registry object.
     /// @param functionRegistry A unique pointer to a FunctionRegistry object.
     ///   The compiler will take ownership of the registry that was passed in.
@@ -244,11 +279,75 @@ public:
 
     ///////////////////////////////////////////////////////////////////////////
 
+    /// @brief Compile a given AST ahead of time into relocatable object code
+    ///   for an executable of the given type. The returned bundle can be
+    ///   written to disk and later loaded into an executable with
+    ///   PointExecutable::load() or VolumeExecutable::load(), which does not
+    ///   require the AX code to be recompiled or optimised.
+    /// @param syntaxTree An abstract syntax tree to compile
+    /// @param logger Logger for errors and warnings during compilation
+    /// @param data Optional custom data. This is only used to determine which
+    ///   external() calls can be resolved at compile time. Unlike compile(),
+    ///   external variables are bound to the custom data provided when the
+    ///   bundle is loaded.
+    /// @note  If compilation is unsuccessful, will return nullptr. Logger can
+    ///   then be queried for errors.
+    template <typename ExecutableT>
+    ObjectBundle::Ptr
+    compileObject(const ast::Tree& syntaxTree,
+            Logger& logger,
+            const CustomData::Ptr data = CustomData::Ptr());
+
+    /// @brief Compile a given snippet of AX code ahead of time into
+    ///   relocatable object code for an executable of the given type.
+    /// @param code A string of AX code
+    /// @param logger Logger for errors and warnings during compilation, will be
+    ///   cleared of existing data
+    /// @param data Optional custom data, see above
+    /// @note  If compilation is unsuccessful, will return nullptr. Logger can
+    ///   then be queried for errors.
+    template <typename ExecutableT>
+    ObjectBundle::Ptr
+    compileObject(const std::string& code,
+            Logger& logger,
+            const CustomData::Ptr data = CustomData::Ptr())
+    {
+        logger.clear();
+        const ast::Tree::ConstPtr syntaxTree = ast::parse(code.c_str(), logger);
+        if (syntaxTree) return compileObject<ExecutableT>(*syntaxTree, logger, data);
+        else return nullptr;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
 private:
 
+    /// @brief  Returns the target machine for the CPU selected by the compiler
+    ///   options, creating it on first use. May return a nullptr if no target
+    ///   could be created for the host platform.
+    /// @param verifyHost  Throw if the host does not support the target CPU.
+    ///   Code which is JIT compiled must be verified, whereas object code may
+    ///   be compiled for other machines and is verified when loaded.
+    llvm::TargetMachine* targetMachine(const bool verifyHost);
+
+    /// @brief  Compile a variant of the object code of a syntax tree for the
+    ///   target CPU of the compiler options and each of its object targets.
+    /// @param syntaxTree  The syntax tree to store in the bundle
+    /// @param tree  The syntax tree to compile, with any compile time
+    ///   modifications
+    /// @param type  The executable which the object code implements
+    /// @param logger  Logger for errors and warnings during compilation
+    template <typename GeneratorT>
+    ObjectBundle::Ptr
+    compileVariants(const ast::Tree& syntaxTree,
+        const ast::Tree& tree,
+        const ObjectBundle::ExecutableType type,
+        Logger& logger);
+
     std::shared_ptr<llvm::LLVMContext> mContext;
     const CompilerOptions mCompilerOptions;
     std::shared_ptr<codegen::FunctionRegistry> mFunctionRegistry;
+    std::shared_ptr<llvm::TargetMachine> mTargetMachine;
 };
 
 
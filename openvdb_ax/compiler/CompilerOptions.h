@@ -41,6 +41,8 @@
 #include <openvdb/openvdb.h>
 #include <openvdb/version.h>
 
+#include <vector>
+
 namespace openvdb {
 OPENVDB_USE_VERSION_NAMESPACE
 namespace OPENVDB_VERSION_NAME {
@@ -87,6 +89,66 @@ struct CompilerOptions
 
     OptLevel mOptLevel = OptLevel::O3;
 
+    /// @brief Controls the CPU and instruction set extensions which generated
+    ///        code is allowed to use
+    enum class TargetCPU
+    {
+        HOST,   // The CPU and all features of the host machine
+        GENERIC,// A generic CPU of the host architecture e.g. x86-64 (SSE2)
+        AVX2,   // x86-64 with AVX2 and FMA. Similar to clang -march=haswell
+        AVX512  // x86-64 with AVX-512. Similar to clang -march=skylake-avx512
+    };
+
+    /// @brief The target CPU of the compiler. Targets other than HOST and
+    ///        GENERIC are only valid on x86-64. JIT compiled executables are
+    ///        run on the machine they are compiled on, so the host must
+    ///        support the target. Object code compiled with compileObject()
+    ///        may target any CPU and is checked against the host when loaded.
+    TargetCPU mTargetCPU = TargetCPU::HOST;
+
+    /// @brief Additional target CPUs which compileObject() compiles variants
+    ///        of the object code for. When a bundle is loaded, the variant
+    ///        with the most CPU features which the host supports is used, so
+    ///        for example { AVX512, AVX2 } with a GENERIC target CPU produces
+    ///        a bundle which uses the widest instruction set of any x86-64
+    ///        machine. Targets equal to mTargetCPU are ignored. JIT compiled
+    ///        executables only use mTargetCPU.
+    std::vector<TargetCPU> mObjectTargets;
+
+    /// @brief Controls which floating point optimizations, that may change the
+    ///        results of floating point operations, are allowed
+    enum class FastMath
+    {
+        NONE,     // Strict IEEE floating point semantics
+        CONTRACT, // Allow the contraction of operations e.g. fused multiply-add
+        RELAXED,  // CONTRACT, plus reassociation, reciprocal and function
+                  // approximations and ignoring the sign of zero
+        FAST      // RELAXED, plus assuming that no values are NaN or infinite.
+                  // Similar to clang -ffast-math
+    };
+
+    /// @brief The fast math level of the compiler. Levels other than NONE can
+    ///        enable the vectorization of reductions and the use of FMA
+    ///        instructions, at the cost of exact floating point results.
+    /// @warning With FAST, NaN and infinity checks may be optimized out.
+    FastMath mFastMath = FastMath::NONE;
+
+    /// @brief Controls which vector math library calls to math functions such
+    ///        as sin, cos, exp and log are mapped to when they are vectorized
+    enum class VectorLibrary
+    {
+        NONE, // No library. Vectorized calls are computed per element
+        AX,   // AX's bundled library of single precision functions, which is
+              // generated as IR. See codegen/VectorFunctions.h
+        SVML  // Intel's Short Vector Math Library. Its symbols must be
+              // available to the process, e.g. by linking against libsvml
+    };
+
+    /// @brief The vector math library of the compiler. Vector libraries allow
+    ///        loops which call math functions to be vectorized. Results may
+    ///        differ from the scalar functions by a few ULP.
+    VectorLibrary mVectorLibrary = VectorLibrary::NONE;
+
     /// @brief If this flag is true, the generated llvm module will be verified when compilation
     ///        occurs, resulting in an exception being thrown if it is not valid
     bool mVerify = true;
@@ -157,6 +157,10 @@ nodeToCodeLocation(const ast::Node* node,
 {
     if (!tree) return Logger::CodeLocation(0,0);
     assert(node);
+    // nodes of the source tree itself are found directly, avoiding the walk
+    // through the tree which is linear in the size of each parent list
+    const auto directIter = map.find(node);
+    if (directIter != map.end()) return directIter->second;
     std::stack<size_t> pathStack = pathStackFromNode(node);
     const ast::Node* nodeInMap = nodeFromPathStack(pathStack, *tree);
     const auto locationIter = map.find(nodeInMap);
@@ -331,6 +335,11 @@ void Logger::addNodeLocation(const ax::ast::Node* node, const Logger::CodeLocati
     mNodeToLineColMap.emplace(node, location);
 }
 
+Logger::CodeLocation Logger::getNodeLocation(const ax::ast::Node* node) const
+{
+    return nodeToCodeLocation(node, mTreePtr, mNodeToLineColMap);
+}
+
 } // namespace ax
 } // namespace OPENVDB_VERSION_NAME
 } // namespace openvdb
@@ -206,6 +206,12 @@ public:
     /// @param location Line and column number in code
     void addNodeLocation(const ax::ast::Node* node, const CodeLocation& location);
 
+    /// @brief Returns the line and column number of a node, resolved through
+    ///   its position in the AST source tree. Returns 0:0 if the location is
+    ///   unknown.
+    /// @param node Pointer to AST node
+    CodeLocation getNodeLocation(const ax::ast::Node* node) const;
+
     // forward declaration
     struct Settings;
     struct SourceCode;
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file compiler/MortonOrder.h
+///
+/// @brief  Internal methods for ordering VDB nodes along a Morton (Z-order)
+///   curve, used by the executables to improve the spatial coherency of the
+///   nodes processed by each thread. This header is not installed.
+///
+
+#ifndef OPENVDB_AX_COMPILER_MORTON_ORDER_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_COMPILER_MORTON_ORDER_HAS_BEEN_INCLUDED
+
+#include <openvdb/version.h>
+#include <openvdb/math/Coord.h>
+
+#include <tbb/parallel_sort.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+
+namespace ax {
+namespace compiler_internal {
+
+/// @brief  Returns true if the Morton code of coordinate a is less than the
+///   Morton code of coordinate b.
+/// @details  The interleaved codes are never constructed. Instead, the axis
+///   holding the most significant differing bit decides the order, which
+///   supports the full range of signed 32 bit coordinates.
+inline bool mortonLess(const openvdb::Coord& a, const openvdb::Coord& b)
+{
+    // flip the sign bits so that negative coordinates order before positive
+    // coordinates when compared as unsigned integers
+    const uint32_t ua[3] = {
+        static_cast<uint32_t>(a.x()) ^ 0x80000000u,
+        static_cast<uint32_t>(a.y()) ^ 0x80000000u,
+        static_cast<uint32_t>(a.z()) ^ 0x80000000u
+    };
+    const uint32_t ub[3] = {
+        static_cast<uint32_t>(b.x()) ^ 0x80000000u,
+        static_cast<uint32_t>(b.y()) ^ 0x80000000u,
+        static_cast<uint32_t>(b.z()) ^ 0x80000000u
+    };
+
+    // true if the most significant set bit of x is lower than that of y
+    auto lessMsb = [](const uint32_t x, const uint32_t y) {
+        return x < y && x < (x ^ y);
+    };
+
+    size_t axis = 0;
+    uint32_t diff = ua[0] ^ ub[0];
+    for (size_t i = 1; i < 3; ++i) {
+        const uint32_t next = ua[i] ^ ub[i];
+        if (lessMsb(diff, next)) {
+            axis = i;
+            diff = next;
+        }
+    }
+    return ua[axis] < ub[axis];
+}
+
+/// @brief  Sort a container of node pointers by the Morton code of each
+///   node's origin
+template <typename NodeT>
+inline void mortonSort(std::vector<NodeT*>& nodes)
+{
+    tbb::parallel_sort(nodes.begin(), nodes.end(),
+        [](const NodeT* a, const NodeT* b) {
+            return mortonLess(a->origin(), b->origin());
+        });
+}
+
+} // namespace compiler_internal
+} // namespace ax
+
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_COMPILER_MORTON_ORDER_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
@@ -0,0 +1,455 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file compiler/ObjectBundle.cc
+
+#include "ObjectBundle.h"
+#include "CompilerOptions.h"
+
+#include "../ast/Serialize.h"
+#include "../codegen/Functions.h"
+#include "../Exceptions.h"
+
+#include <openvdb/Exceptions.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Triple.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Mangler.h>
+#include <llvm/IR/Module.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Object/ObjectFile.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <sstream>
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+namespace ax {
+
+namespace
+{
+
+/// @brief  The version of the bundle format. Bundles written with a different
+///         version cannot be read.
+constexpr uint32_t BundleVersion = 1;
+constexpr char BundleMagic[4] = { 'A', 'X', 'O', 'B' };
+
+template <typename T>
+inline void writeValue(std::ostream& os, const T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+inline void writeString(std::ostream& os, const std::string& str)
+{
+    writeValue<uint64_t>(os, str.size());
+    os.write(str.data(), str.size());
+}
+
+template <typename T>
+inline T readValue(std::istream& is)
+{
+    T value;
+    if (!is.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+        OPENVDB_THROW(IoError, "Unexpected end of AX object bundle data");
+    }
+    return value;
+}
+
+/// @brief  Returns the number of bytes left to read from a stream, or the
+///         maximum value if the stream is not seekable
+inline uint64_t remainingBytes(std::istream& is)
+{
+    const std::istream::pos_type pos = is.tellg();
+    if (pos == std::istream::pos_type(-1)) {
+        is.clear();
+        return std::numeric_limits<uint64_t>::max();
+    }
+    is.seekg(0, std::ios::end);
+    const std::istream::pos_type end = is.tellg();
+    is.clear();
+    is.seekg(pos);
+    if (end == std::istream::pos_type(-1) || end < pos) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return static_cast<uint64_t>(end - pos);
+}
+
+/// @brief  Read the size of a string or list. Each of its elements is at
+///         least the given number of bytes, so sizes which can't be satisfied
+///         by the remaining data are rejected before allocating for them.
+inline uint64_t readSize(std::istream& is, const uint64_t elementBytes)
+{
+    const uint64_t size = readValue<uint64_t>(is);
+    if (size > remainingBytes(is) / elementBytes) {
+        OPENVDB_THROW(IoError, "Invalid size in AX object bundle data");
+    }
+    return size;
+}
+
+inline std::string readString(std::istream& is)
+{
+    // the remaining data is unknown for streams which are not seekable, so
+    // read in blocks rather than allocating the whole string up front
+    static constexpr uint64_t BlockSize = 1 << 20;
+
+    const uint64_t size = readSize(is, 1);
+    std::string str;
+    while (str.size() < size) {
+        const uint64_t offset = str.size();
+        str.resize(offset + std::min(size - offset, BlockSize));
+        if (!is.read(&str[offset], str.size() - offset)) {
+            OPENVDB_THROW(IoError, "Unexpected end of AX object bundle data");
+        }
+    }
+    return str;
+}
+
+/// @brief  Returns the address of the value of the given custom data,
+///         inserting it if it does not exist. Returns 0 if the data exists
+///         with a different type.
+template <typename T, typename MetadataType = TypedMetadata<T>>
+inline uintptr_t
+metadataAddress(CustomData& data, const std::string& name)
+{
+    MetadataType* meta = data.getOrInsertData<MetadataType>(name);
+    if (meta) return reinterpret_cast<uintptr_t>(&(meta->value()));
+    return 0;
+}
+
+inline uintptr_t
+externalAddress(const ast::tokens::CoreType type, const std::string& name, CustomData& data)
+{
+    switch (type) {
+        case ast::tokens::BOOL    : return metadataAddress<bool>(data, name);
+        case ast::tokens::INT32   : return metadataAddress<int32_t>(data, name);
+        case ast::tokens::INT64   : return metadataAddress<int64_t>(data, name);
+        case ast::tokens::FLOAT   : return metadataAddress<float>(data, name);
+        case ast::tokens::DOUBLE  : return metadataAddress<double>(data, name);
+        case ast::tokens::VEC2I   : return metadataAddress<math::Vec2<int32_t>>(data, name);
+        case ast::tokens::VEC2F   : return metadataAddress<math::Vec2<float>>(data, name);
+        case ast::tokens::VEC2D   : return metadataAddress<math::Vec2<double>>(data, name);
+        case ast::tokens::VEC3I   : return metadataAddress<math::Vec3<int32_t>>(data, name);
+        case ast::tokens::VEC3F   : return metadataAddress<math::Vec3<float>>(data, name);
+        case ast::tokens::VEC3D   : return metadataAddress<math::Vec3<double>>(data, name);
+        case ast::tokens::VEC4I   : return metadataAddress<math::Vec4<int32_t>>(data, name);
+        case ast::tokens::VEC4F   : return metadataAddress<math::Vec4<float>>(data, name);
+        case ast::tokens::VEC4D   : return metadataAddress<math::Vec4<double>>(data, name);
+        case ast::tokens::MAT3F   : return metadataAddress<math::Mat3<float>>(data, name);
+        case ast::tokens::MAT3D   : return metadataAddress<math::Mat3<double>>(data, name);
+        case ast::tokens::MAT4F   : return metadataAddress<math::Mat4<float>>(data, name);
+        case ast::tokens::MAT4D   : return metadataAddress<math::Mat4<double>>(data, name);
+        case ast::tokens::STRING  : return metadataAddress<ax::AXString, ax::AXStringMetadata>(data, name);
+        case ast::tokens::UNKNOWN :
+        default      : {
+            OPENVDB_THROW(AXExecutionError, "External variable type unsupported or not recognised");
+        }
+    }
+}
+
+/// @brief  Throws if the object code of a bundle was compiled for a different
+///         platform to the host
+inline void
+verifyHostTriple(const std::string& triple)
+{
+    const llvm::Triple host(llvm::sys::getProcessTriple());
+    const llvm::Triple target(triple);
+    if (host.getArch() != target.getArch() ||
+        host.getOS() != target.getOS() ||
+        host.getObjectFormat() != target.getObjectFormat()) {
+        OPENVDB_THROW(AXExecutionError, "Object code was compiled for the target \""
+            << triple << "\" and cannot be loaded on the host \"" << host.str() << "\".");
+    }
+}
+
+/// @brief  Returns the first of the given CPU features which the host does
+///         not support, or an empty string if all of them are supported
+inline std::string
+missingHostFeature(const std::string& features)
+{
+    llvm::StringMap<bool> hostFeatures;
+    if (!llvm::sys::getHostCPUFeatures(hostFeatures)) return "";
+
+    const llvm::SubtargetFeatures targetFeatures(features);
+    for (const std::string& feature : targetFeatures.getFeatures()) {
+        // only check features which are enabled and known to the host
+        if (feature.size() < 2 || feature[0] != '+') continue;
+        const auto iter = hostFeatures.find(feature.substr(1));
+        if (iter != hostFeatures.end() && !iter->second) return feature.substr(1);
+    }
+    return "";
+}
+
+} // anonymous namespace
+
+/////////////////////////////////////////////////////////////////////////////
+
+const ObjectBundle::Variant& ObjectBundle::hostVariant() const
+{
+    assert(!mVariants.empty());
+    std::string missing;
+    for (const Variant& variant : mVariants) {
+        missing = missingHostFeature(variant.mFeatures);
+        if (missing.empty()) return variant;
+    }
+
+    // report the feature missing for the variant with the fewest features
+    OPENVDB_THROW(AXExecutionError, "Object code requires the CPU feature \""
+        << missing << "\" which is not supported by the host machine.");
+}
+
+void ObjectBundle::write(std::ostream& os) const
+{
+    os.write(BundleMagic, sizeof(BundleMagic));
+    writeValue<uint32_t>(os, BundleVersion);
+    writeValue<uint8_t>(os, static_cast<uint8_t>(mType));
+    writeString(os, mTriple);
+
+    writeValue<uint64_t>(os, mVariants.size());
+    for (const Variant& variant : mVariants) {
+        writeString(os, variant.mCPU);
+        writeString(os, variant.mFeatures);
+        writeValue<uint64_t>(os, variant.mBindings.size());
+        for (const auto& binding : variant.mBindings) {
+            writeString(os, binding.first);
+            writeString(os, binding.second);
+        }
+        writeString(os, variant.mObject);
+    }
+
+    std::ostringstream tree(std::ios_base::binary);
+    if (mTree) ast::serialize(*mTree, tree);
+    writeString(os, tree.str());
+
+    assert(mAttributeRegistry);
+    mAttributeRegistry->write(os);
+
+    writeValue<uint64_t>(os, mExternals.size());
+    for (const std::string& token : mExternals) writeString(os, token);
+}
+
+ObjectBundle::Ptr ObjectBundle::read(std::istream& is)
+{
+    char magic[sizeof(BundleMagic)];
+    if (!is.read(magic, sizeof(BundleMagic)) ||
+        std::memcmp(magic, BundleMagic, sizeof(BundleMagic)) != 0) {
+        OPENVDB_THROW(IoError, "Data is not an AX object bundle");
+    }
+
+    const uint32_t version = readValue<uint32_t>(is);
+    if (version != BundleVersion) {
+        OPENVDB_THROW(IoError, "Unsupported AX object bundle version " << version
+            << ", expected version " << BundleVersion);
+    }
+
+    const uint8_t type = readValue<uint8_t>(is);
+    if (type > static_cast<uint8_t>(ExecutableType::VOLUMES)) {
+        OPENVDB_THROW(IoError, "Invalid AX object bundle executable type");
+    }
+
+    ObjectBundle::Ptr bundle(new ObjectBundle(static_cast<ExecutableType>(type)));
+    bundle->mTriple = readString(is);
+
+    // every string is at least the size of its length, bindings are pairs of
+    // strings and variants are three strings and a list. Lists are grown as
+    // their elements are read as the sizes of streams which are not seekable
+    // can't be verified up front
+
+    const uint64_t variants = readSize(is, 4 * sizeof(uint64_t));
+    if (variants == 0) {
+        OPENVDB_THROW(IoError, "AX object bundle holds no object code");
+    }
+    for (uint64_t i = 0; i < variants; ++i) {
+        bundle->mVariants.emplace_back();
+        Variant& variant = bundle->mVariants.back();
+        variant.mCPU = readString(is);
+        variant.mFeatures = readString(is);
+
+        const uint64_t bindings = readSize(is, 2 * sizeof(uint64_t));
+        for (uint64_t j = 0; j < bindings; ++j) {
+            std::string name = readString(is);
+            variant.mBindings.emplace_back(std::move(name), readString(is));
+        }
+        variant.mObject = readString(is);
+    }
+
+    const std::string tree = readString(is);
+    if (!tree.empty()) bundle->mTree = ast::deserialize(tree.data(), tree.size());
+
+    bundle->mAttributeRegistry = AttributeRegistry::read(is);
+
+    const uint64_t externals = readSize(is, sizeof(uint64_t));
+    for (uint64_t i = 0; i < externals; ++i) {
+        bundle->mExternals.emplace_back(readString(is));
+    }
+
+    return bundle;
+}
+
+ObjectBundle::Linked
+ObjectBundle::link(const CustomData::Ptr& customData,
+        const std::vector<std::string>& kernels) const
+{
+    verifyHostTriple(mTriple);
+    const Variant& variant = this->hostVariant();
+
+    Linked linked;
+    linked.mContext.reset(new llvm::LLVMContext);
+
+    // the engine requires a module, however all code is provided by the
+    // object file so it remains empty
+
+    std::unique_ptr<llvm::Module> module(new llvm::Module("module", *linked.mContext));
+    module->setTargetTriple(mTriple);
+
+    std::string error;
+    llvm::EngineBuilder builder(std::move(module));
+    builder.setEngineKind(llvm::EngineKind::JIT);
+    builder.setErrorStr(&error);
+    builder.setMCPU(variant.mCPU);
+    builder.setMAttrs(llvm::SubtargetFeatures(variant.mFeatures).getFeatures());
+
+    linked.mEngine.reset(builder.create());
+    if (!linked.mEngine) {
+        OPENVDB_THROW(AXExecutionError, "Failed to create LLVMExecutionEngine: " + error);
+    }
+    llvm::ExecutionEngine& engine = *linked.mEngine;
+
+    std::unique_ptr<llvm::MemoryBuffer> buffer =
+        llvm::MemoryBuffer::getMemBufferCopy(variant.mObject, "ax");
+    auto object = llvm::object::ObjectFile::createObjectFile(buffer->getMemBufferRef());
+    if (!object) {
+        llvm::consumeError(object.takeError());
+        OPENVDB_THROW(AXExecutionError, "Invalid object code in AX object bundle");
+    }
+    engine.addObjectFile(llvm::object::OwningBinary<llvm::object::ObjectFile>
+        (std::move(*object), std::move(buffer)));
+
+    auto getMangledName = [&engine](const std::string& name) -> std::string {
+        llvm::SmallString<128> mangled;
+        llvm::Mangler::getNameWithPrefix(mangled, name, engine.getDataLayout());
+        return std::string(mangled.str());
+    };
+
+    // map the C bindings. Only the functions which are called are created in
+    // the registry
+
+    const FunctionOptions options;
+    codegen::FunctionRegistry::UniquePtr registry = codegen::createDefaultRegistry();
+
+    for (const auto& binding : variant.mBindings) {
+        const codegen::FunctionGroup* const function =
+            registry->getOrInsert(binding.first, options, /*internal*/true);
+
+        uint64_t address = 0;
+        if (function) {
+            for (const codegen::Function::Ptr& decl : function->list()) {
+                if (decl->symbol() != binding.second) continue;
+                const codegen::CFunctionBase* cfunction =
+                    dynamic_cast<const codegen::CFunctionBase*>(decl.get());
+                if (cfunction) address = cfunction->address();
+                break;
+            }
+        }
+
+        if (address == 0) {
+            OPENVDB_THROW(AXExecutionError, "No available mapping for C Binding "
+                "with symbol \"" << binding.second << "\"");
+        }
+        engine.updateGlobalMapping(getMangledName(binding.second), address);
+    }
+
+    // apply relocations and set memory permissions
+
+    engine.finalizeObject();
+    if (engine.hasError()) {
+        OPENVDB_THROW(AXExecutionError, "Failed to link AX object code: "
+            << engine.getErrorMessage());
+    }
+
+    // bind external variables. The object code holds a writable global for each
+    // external variable which is assigned the address of its custom data
+
+    linked.mCustomData = customData;
+    std::string name, typestr;
+    for (const std::string& token : mExternals) {
+        if (!ast::ExternalVariable::nametypeFromToken(token, &name, &typestr)) {
+            OPENVDB_THROW(AXExecutionError, "Invalid external variable \"" + token + "\"");
+        }
+
+        // if we have any external variables, the custom data must be initialized
+        // to at least hold zero values (initialized by the default metadata types)
+        if (!linked.mCustomData) linked.mCustomData.reset(new CustomData);
+
+        const uintptr_t address = externalAddress(
+            ast::tokens::tokenFromTypeString(typestr), name, *linked.mCustomData);
+        if (!address) {
+            OPENVDB_THROW(AXExecutionError, "Custom data \"" + name + "\" already exists "
+                "with a different type.");
+        }
+
+        const uint64_t global = engine.getGlobalValueAddress(token);
+        if (!global) {
+            OPENVDB_THROW(AXExecutionError, "Object code is missing the external "
+                "variable \"" + token + "\"");
+        }
+        std::memcpy(reinterpret_cast<void*>(global), &address, sizeof(uintptr_t));
+    }
+
+    for (const std::string& kernel : kernels) {
+        const uint64_t address = engine.getFunctionAddress(kernel);
+        if (!address) {
+            OPENVDB_THROW(AXExecutionError, "Object code is missing the compute "
+                "function \"" + kernel + "\"");
+        }
+        linked.mFunctions[kernel] = address;
+    }
+
+    return linked;
+}
+
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
@@ -0,0 +1,201 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+/// @file compiler/ObjectBundle.h
+///
+/// @brief  The ObjectBundle, produced by the OpenVDB AX Compiler when compiling
+///   ahead of time. A bundle holds the optimised relocatable object code of
+///   the compiled kernels along with everything required to construct an
+///   executable from it at a later time, in a different process.
+///
+/// @details  Loading a bundle with PointExecutable::load() or
+///   VolumeExecutable::load() links the object code into the current process
+///   and binds its C functions and external variables. LLVM is used only as
+///   a runtime linker - no IR is generated, optimised or compiled - which
+///   makes loading significantly faster and cheaper than compiling.
+///   Bundles can only be loaded on hosts with the same target triple. A
+///   bundle holds one variant of the object code per target CPU it was
+///   compiled for (see CompilerOptions::mObjectTargets), and the variant with
+///   the most CPU features which the host supports is the one loaded.
+///
+
+#ifndef OPENVDB_AX_COMPILER_OBJECT_BUNDLE_HAS_BEEN_INCLUDED
+#define OPENVDB_AX_COMPILER_OBJECT_BUNDLE_HAS_BEEN_INCLUDED
+
+#include "AttributeRegistry.h"
+#include "CustomData.h"
+
+#include "../ast/AST.h"
+
+#include <openvdb/version.h>
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class ExecutionEngine;
+class LLVMContext;
+}
+
+namespace openvdb {
+OPENVDB_USE_VERSION_NAMESPACE
+namespace OPENVDB_VERSION_NAME {
+namespace ax {
+
+class Compiler;
+class PointExecutable;
+class VolumeExecutable;
+
+/// @brief  Object code compiled ahead of time by the AX Compiler, which can
+///   be written to and read from disk and loaded into an executable
+class ObjectBundle
+{
+public:
+    using Ptr = std::shared_ptr<ObjectBundle>;
+    using ConstPtr = std::shared_ptr<const ObjectBundle>;
+
+    /// @brief  The executable which the object code implements
+    enum class ExecutableType { POINTS, VOLUMES };
+
+    /// @brief  Pairs of function identifiers and symbols of the C bindings
+    ///   which the object code calls
+    using BindingVec = std::vector<std::pair<std::string, std::string>>;
+
+    /// @brief  The object code compiled for a single target CPU
+    class Variant
+    {
+    public:
+        /// @return  The CPU the object code was compiled for
+        inline const std::string& cpu() const { return mCPU; }
+        /// @return  The CPU features the object code was compiled for
+        inline const std::string& features() const { return mFeatures; }
+        /// @return  The C bindings called by the object code, which are bound
+        ///   to the functions in the default function registry when loaded
+        inline const BindingVec& bindings() const { return mBindings; }
+        /// @return  The relocatable object code in the native object file
+        ///   format of the target, for example ELF on Linux
+        inline const std::string& object() const { return mObject; }
+
+    private:
+        friend class Compiler;
+        friend class ObjectBundle;
+
+        std::string mCPU;
+        std::string mFeatures;
+        BindingVec mBindings;
+        std::string mObject;
+    };
+
+    /// @return  The executable which the object code implements
+    inline ExecutableType type() const { return mType; }
+    /// @return  The target triple the object code was compiled for
+    inline const std::string& triple() const { return mTriple; }
+    /// @return  The variants of the object code, ordered from the most to the
+    ///   least CPU features. A bundle always holds at least one variant
+    inline const std::vector<Variant>& variants() const { return mVariants; }
+    /// @brief  Returns the variant which is loaded on this host, the first
+    ///   variant whose CPU features the host supports. Throws an
+    ///   AXExecutionError if the host supports none of the variants.
+    const Variant& hostVariant() const;
+
+    /// @return  The CPU the first variant was compiled for
+    inline const std::string& cpu() const { return mVariants.front().cpu(); }
+    /// @return  The CPU features the first variant was compiled for
+    inline const std::string& features() const { return mVariants.front().features(); }
+    /// @return  The syntax tree the object code was compiled from
+    inline const ast::Tree::ConstPtr& tree() const { return mTree; }
+    /// @return  The registry of the attributes or volumes accessed by the
+    ///   object code
+    inline const AttributeRegistry::ConstPtr& attributeRegistry() const { return mAttributeRegistry; }
+    /// @return  The tokens of the external variables accessed by the object
+    ///   code, which are bound to CustomData when the bundle is loaded
+    inline const std::vector<std::string>& externals() const { return mExternals; }
+    /// @return  The C bindings called by the first variant
+    inline const BindingVec& bindings() const { return mVariants.front().bindings(); }
+    /// @return  The object code of the first variant
+    inline const std::string& object() const { return mVariants.front().object(); }
+
+    /// @brief  Write the bundle to a binary stream
+    /// @param  os  The stream to write to
+    void write(std::ostream& os) const;
+
+    /// @brief  Read a bundle previously written with write()
+    /// @note   Throws an openvdb::IoError if the data is invalid or was
+    ///   written with a different version of the format
+    /// @param  is  The stream to read from
+    static Ptr read(std::istream& is);
+
+private:
+    friend class Compiler;
+    friend class PointExecutable;
+    friend class VolumeExecutable;
+
+    /// @brief  The LLVM constructs and kernel addresses of linked object code
+    struct Linked
+    {
+        std::shared_ptr<llvm::LLVMContext> mContext;
+        std::shared_ptr<llvm::ExecutionEngine> mEngine;
+        CustomData::Ptr mCustomData;
+        std::unordered_map<std::string, uint64_t> mFunctions;
+    };
+
+    ObjectBundle(const ExecutableType type) : mType(type) {}
+
+    /// @brief  Link the object code of the host variant into the current
+    ///   process, binding its C functions and external variables. Throws an
+    ///   AXExecutionError if the object code can not be loaded on this host.
+    /// @param  customData  The custom data to bind external variables to.
+    ///   If not provided and the object code accesses external variables, a
+    ///   new CustomData object is created.
+    /// @param  kernels  The names of the kernels to retrieve
+    Linked link(const CustomData::Ptr& customData,
+        const std::vector<std::string>& kernels) const;
+
+    ExecutableType mType;
+    std::string mTriple;
+    ast::Tree::ConstPtr mTree;
+    AttributeRegistry::ConstPtr mAttributeRegistry;
+    std::vector<std::string> mExternals;
+    std::vector<Variant> mVariants;
+};
+
+} // namespace ax
+} // namespace OPENVDB_VERSION_NAME
+} // namespace openvdb
+
+#endif // OPENVDB_AX_COMPILER_OBJECT_BUNDLE_HAS_BEEN_INCLUDED
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
@@ -31,12 +31,17 @@
 /// @file compiler/PointExecutable.cc
 
 #include "PointExecutable.h"
+#include "MortonOrder.h"
 
 #include "../Exceptions.h"
 // @TODO refactor so we don't have to include PointComputeGenerator.h,
 // but still have the functions defined in one place
 #include "../codegen/PointComputeGenerator.h"
 #include "../codegen/PointLeafLocalData.h"
+#include "../codegen/PointNeighbours.h"
+#include "../codegen/Rasterization.h"
+#include "../codegen/Reductions.h"
+#include "../codegen/VolumeSamplers.h"
 
 #include <openvdb/Types.h>
 
@@ -48,6 +53,12 @@
 #include <openvdb/points/PointMask.h>
 #include <openvdb/points/PointMove.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <numeric>
+
 namespace openvdb {
 OPENVDB_USE_VERSION_NAMESPACE
 namespace OPENVDB_VERSION_NAME {
@@ -58,6 +69,7 @@ struct PointExecutable::Settings
 {
     bool mCreateMissing = true;
     size_t mGrainSize = 1;
+    bool mSpatialOrdering = false;
     std::string mGroup = "";
 };
 
@@ -69,6 +81,36 @@ using KernelFunctionPtr = std::add_pointer<codegen::PointKernel::Signature>::typ
 using FunctionTraitsT = codegen::PointKernel::FunctionTraitsT;
 using ReturnT = FunctionTraitsT::ReturnType;
 using PointLeafLocalData = codegen::codegen_internal::PointLeafLocalData;
+using Reductions = codegen::codegen_internal::Reductions;
+using PointNeighbours = codegen::codegen_internal::PointNeighbours;
+using VolumeSamplers = codegen::codegen_internal::VolumeSamplers;
+using Rasterization = codegen::codegen_internal::Rasterization;
+
+/// @brief  Build the AttributeLayout of an attribute array, exposing its data
+///         if it can be accessed directly by the generated code
+template <typename ValueT>
+inline codegen::AttributeLayout
+layoutFromArray(const points::AttributeArray& array)
+{
+    using ArrayT = points::TypedAttributeArray<ValueT, points::NullCodec>;
+
+    codegen::AttributeLayout layout;
+    if (!array.isType<ArrayT>()) return layout;
+    if (!array.hasConstantStride()) return layout;
+
+    const ArrayT& typed = static_cast<const ArrayT&>(array);
+    layout.mData = const_cast<void*>(static_cast<const void*>(typed.data()));
+    layout.mStride = array.isUniform() ? 0 : array.stride();
+    return layout;
+}
+
+/// @brief  String attributes are always accessed through their handles
+template <>
+inline codegen::AttributeLayout
+layoutFromArray<std::string>(const points::AttributeArray&)
+{
+    return codegen::AttributeLayout();
+}
 
 /// @brief  The arguments of the generated function
 ///
@@ -108,6 +150,16 @@ struct PointFunctionArguments
             return static_cast<void*>(mHandle.get());
         }
 
+        /// @brief  Describe the layout of the array of this handle. The data
+        ///         is only exposed if it is stored uncompressed as ValueT.
+        /// @note   Must be called after the handle has been initialized, as
+        ///         handle creation loads (and for write handles, expands) the
+        ///         array.
+        inline codegen::AttributeLayout
+        layout(const LeafT& leaf, const size_t pos) const {
+            return layoutFromArray<ValueT>(leaf.constAttributeArray(pos));
+        }
+
     private:
         typename HandleT::Ptr mHandle;
     };
@@ -118,15 +170,24 @@ struct PointFunctionArguments
     PointFunctionArguments(const KernelFunctionPtr function,
                            const CustomData* const customData,
                            const points::AttributeSet& attributeSet,
-                           PointLeafLocalData* const leafLocalData)
+                           PointLeafLocalData* const leafLocalData,
+                           Reductions* const reductions,
+                           PointNeighbours::Query* const neighbours,
+                           VolumeSamplers::Accessors* const volumes,
+                           Rasterization* const rasterization)
         : mFunction(function)
         , mCustomData(customData)
         , mAttributeSet(&attributeSet)
         , mVoidAttributeHandles()
         , mAttributeHandles()
+        , mAttributeLayouts()
         , mVoidGroupHandles()
         , mGroupHandles()
-        , mLeafLocalData(leafLocalData) {}
+        , mLeafLocalData(leafLocalData)
+        , mReductions(reductions)
+        , mNeighbours(neighbours)
+        , mVolumes(volumes)
+        , mRasterization(rasterization) {}
 
     /// @brief  Given a built version of the function signature, automatically
     ///         bind the current arguments and return a callable function
@@ -139,7 +200,12 @@ struct PointFunctionArguments
                 static_cast<FunctionTraitsT::Arg<2>::Type>(index),
                 static_cast<FunctionTraitsT::Arg<3>::Type>(mVoidAttributeHandles.data()),
                 static_cast<FunctionTraitsT::Arg<4>::Type>(mVoidGroupHandles.data()),
-                static_cast<FunctionTraitsT::Arg<5>::Type>(mLeafLocalData));
+                static_cast<FunctionTraitsT::Arg<5>::Type>(mLeafLocalData),
+                static_cast<FunctionTraitsT::Arg<6>::Type>(mAttributeLayouts.data()),
+                static_cast<FunctionTraitsT::Arg<7>::Type>(mReductions),
+                static_cast<FunctionTraitsT::Arg<8>::Type>(mNeighbours),
+                static_cast<FunctionTraitsT::Arg<9>::Type>(mVolumes),
+                static_cast<FunctionTraitsT::Arg<10>::Type>(mRasterization));
         };
     }
 
@@ -148,6 +214,7 @@ struct PointFunctionArguments
     {
         typename TypedHandle<ValueT>::UniquePtr handle(new TypedHandle<ValueT>());
         mVoidAttributeHandles.emplace_back(handle->initReadHandle(leaf, pos));
+        mAttributeLayouts.emplace_back(handle->layout(leaf, pos));
         mAttributeHandles.emplace_back(std::move(handle));
     }
 
@@ -156,6 +223,7 @@ struct PointFunctionArguments
     {
         typename TypedHandle<ValueT>::UniquePtr handle(new TypedHandle<ValueT>());
         mVoidAttributeHandles.emplace_back(handle->initWriteHandle(leaf, pos));
+        mAttributeLayouts.emplace_back(handle->layout(leaf, pos));
         mAttributeHandles.emplace_back(std::move(handle));
     }
 
@@ -174,7 +242,10 @@ struct PointFunctionArguments
     }
 
     inline void addNullGroupHandle() { mVoidGroupHandles.emplace_back(nullptr); }
-    inline void addNullAttribHandle() { mVoidAttributeHandles.emplace_back(nullptr); }
+    inline void addNullAttribHandle() {
+        mVoidAttributeHandles.emplace_back(nullptr);
+        mAttributeLayouts.emplace_back();
+    }
 
 private:
     const KernelFunctionPtr mFunction;
@@ -182,6 +253,7 @@ private:
     const points::AttributeSet* const mAttributeSet;
     std::vector<void*> mVoidAttributeHandles;
     std::vector<Handles::UniquePtr> mAttributeHandles;
+    std::vector<codegen::AttributeLayout> mAttributeLayouts;
     std::vector<void*> mVoidGroupHandles;
 #if (OPENVDB_LIBRARY_MAJOR_VERSION_NUMBER > 7 ||  \
     (OPENVDB_LIBRARY_MAJOR_VERSION_NUMBER >= 7 && \
@@ -191,6 +263,10 @@ private:
     std::vector<std::unique_ptr<points::GroupHandle>> mGroupHandles;
 #endif
     PointLeafLocalData* const mLeafLocalData;
+    Reductions* const mReductions;
+    PointNeighbours::Query* const mNeighbours;
+    VolumeSamplers::Accessors* const mVolumes;
+    Rasterization* const mRasterization;
 };
 
 
@@ -332,6 +408,10 @@ struct PointExecuterOp
                const math::Transform& transform,
                const GroupIndex& groupIndex,
                std::vector<PointLeafLocalData::UniquePtr>& leafLocalData,
+               Reductions::ThreadReductions& reductions,
+               const PointNeighbours* const neighbours,
+               const VolumeSamplers* const volumes,
+               Rasterization::ThreadRasterization* const rasterization,
                const std::string& positionAttribute,
                const std::pair<bool,bool>& positionAccess)
         : mAttributeRegistry(attributeRegistry)
@@ -340,6 +420,10 @@ struct PointExecuterOp
         , mTransform(transform)
         , mGroupIndex(groupIndex)
         , mLeafLocalData(leafLocalData)
+        , mReductions(reductions)
+        , mNeighbours(neighbours)
+        , mVolumes(volumes)
+        , mRasterization(rasterization)
         , mPositionAttribute(positionAttribute)
         , mPositionAccess(positionAccess) {}
 
@@ -366,9 +450,13 @@ struct PointExecuterOp
         const size_t count = leaf.getLastValue();
         const points::AttributeSet& set = leaf.attributeSet();
         auto& leafLocalData = mLeafLocalData[idx];
-        leafLocalData.reset(new PointLeafLocalData(count));
+        leafLocalData.reset(new PointLeafLocalData(count, leaf.origin()));
 
-        PointFunctionArguments args(mComputeFunction, mCustomData, set, leafLocalData.get());
+        PointFunctionArguments args(mComputeFunction, mCustomData, set,
+            leafLocalData.get(), &mReductions.local(),
+            mNeighbours ? &mNeighbours->query() : nullptr,
+            mVolumes ? &mVolumes->accessors() : nullptr,
+            mRasterization ? &mRasterization->local() : nullptr);
 
         // add attributes based on the order and existence in the attribute registry
         for (const auto& iter : mAttributeRegistry.data()) {
@@ -458,6 +546,10 @@ private:
     const math::Transform&    mTransform;
     const GroupIndex&         mGroupIndex;
     std::vector<PointLeafLocalData::UniquePtr>& mLeafLocalData;
+    Reductions::ThreadReductions& mReductions;
+    const PointNeighbours* const mNeighbours;
+    const VolumeSamplers* const mVolumes;
+    Rasterization::ThreadRasterization* const mRasterization;
     const std::string&          mPositionAttribute;
     const std::pair<bool,bool>& mPositionAccess;
 };
@@ -550,13 +642,15 @@ void checkAttributesExist(const points::PointDataGrid& grid,
 PointExecutable::PointExecutable(const std::shared_ptr<const llvm::LLVMContext>& context,
                 const std::shared_ptr<const llvm::ExecutionEngine>& engine,
                 const AttributeRegistry::ConstPtr& attributeRegistry,
-                const CustomData::ConstPtr& customData,
-                const std::unordered_map<std::string, uint64_t>& functions)
+                const CustomData::Ptr& customData,
+                const std::unordered_map<std::string, uint64_t>& functions,
+                const std::shared_ptr<const NeighbourAccesses>& neighbours)
     : mContext(context)
     , mExecutionEngine(engine)
     , mAttributeRegistry(attributeRegistry)
     , mCustomData(customData)
     , mFunctionAddresses(functions)
+    , mNeighbourAccesses(neighbours)
     , mSettings(new Settings)
 {
     assert(mContext);
@@ -570,11 +664,63 @@ PointExecutable::PointExecutable(const PointExecutable& other)
     , mAttributeRegistry(other.mAttributeRegistry)
     , mCustomData(other.mCustomData)
     , mFunctionAddresses(other.mFunctionAddresses)
+    , mNeighbourAccesses(other.mNeighbourAccesses)
     , mSettings(new Settings(*other.mSettings)) {}
 
 PointExecutable::~PointExecutable() {}
 
+PointExecutable::Ptr
+PointExecutable::load(const ObjectBundle& bundle, const CustomData::Ptr customData)
+{
+    if (bundle.type() != ObjectBundle::ExecutableType::POINTS) {
+        OPENVDB_THROW(AXExecutionError, "Object bundle was not compiled for points.");
+    }
+
+    const std::vector<std::string> functionNames {
+        codegen::PointKernel::getDefaultName(),
+        codegen::PointRangeKernel::getDefaultName()
+    };
+
+    // the neighbour queries are found from the syntax tree, and the object
+    // code would otherwise be passed null queries
+    if (!bundle.tree()) {
+        OPENVDB_THROW(AXExecutionError, "Object bundle for points has no syntax tree.");
+    }
+
+    // the queries were validated when the bundle was compiled
+    const std::shared_ptr<const NeighbourAccesses> neighbours =
+        PointNeighbours::accesses(*bundle.tree());
+
+    ObjectBundle::Linked linked = bundle.link(customData, functionNames);
+    return PointExecutable::Ptr(new PointExecutable(linked.mContext,
+        linked.mEngine,
+        bundle.attributeRegistry(),
+        linked.mCustomData,
+        linked.mFunctions,
+        neighbours));
+}
+
 void PointExecutable::execute(openvdb::points::PointDataGrid& grid) const
+{
+    this->execute(grid, GridCPtrVec());
+}
+
+void PointExecutable::execute(openvdb::points::PointDataGrid& grid,
+    const GridCPtrVec& volumes) const
+{
+    this->execute(grid, volumes, nullptr);
+}
+
+void PointExecutable::execute(openvdb::points::PointDataGrid& grid,
+    const GridCPtrVec& volumes,
+    GridPtrVec& rasterized) const
+{
+    this->execute(grid, volumes, &rasterized);
+}
+
+void PointExecutable::execute(openvdb::points::PointDataGrid& grid,
+    const GridCPtrVec& volumes,
+    GridPtrVec* const rasterized) const
 {
     using LeafManagerT = openvdb::tree::LeafManager<openvdb::points::PointDataTree>;
 
@@ -621,12 +767,64 @@ void PointExecutable::execute(openvdb::points::PointDataGrid& grid) const
     const math::Transform& transform = grid.transform();
     LeafManagerT leafManager(grid.tree());
     std::vector<PointLeafLocalData::UniquePtr> leafLocalData(leafManager.leafCount());
+    Reductions::ThreadReductions reductions;
     const bool threaded = mSettings->mGrainSize > 0;
 
+    // index the points as they are before execution for neighbour queries
+    PointNeighbours::Ptr neighbours;
+    if (mNeighbourAccesses) {
+        neighbours.reset(new PointNeighbours(grid, *mNeighbourAccesses));
+    }
+
+    // gather the volumes which can be sampled
+    VolumeSamplers::Ptr samplers;
+    if (!volumes.empty()) samplers.reset(new VolumeSamplers(volumes));
+
+    // each thread rasterizes into its own volumes, which are summed below
+    std::unique_ptr<Rasterization::ThreadRasterization> rasterization;
+    if (rasterized) {
+        rasterization.reset(new Rasterization::ThreadRasterization(
+            Rasterization(transform, *rasterized)));
+    }
+
     PointExecuterOp executerOp(*mAttributeRegistry,
         mCustomData.get(), compute, transform, groupIndex,
-        leafLocalData, positionAttribute, positionAccess);
-    leafManager.foreach(executerOp, threaded, mSettings->mGrainSize);
+        leafLocalData, reductions, neighbours.get(), samplers.get(),
+        rasterization.get(), positionAttribute, positionAccess);
+
+    if (mSettings->mSpatialOrdering) {
+        // visit the leaf nodes in the Morton order of their origins. The leaf
+        // manager index of each leaf is retained for its local data
+        std::vector<size_t> order(leafManager.leafCount());
+        std::iota(order.begin(), order.end(), size_t(0));
+        tbb::parallel_sort(order.begin(), order.end(),
+            [&leafManager](const size_t a, const size_t b) {
+                return compiler_internal::mortonLess(
+                    leafManager.leaf(a).origin(), leafManager.leaf(b).origin());
+            });
+
+        auto op = [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i < range.end(); ++i) {
+                executerOp(leafManager.leaf(order[i]), order[i]);
+            }
+        };
+
+        const tbb::blocked_range<size_t> range(0, order.size(),
+            threaded ? mSettings->mGrainSize : 1);
+        if (threaded) tbb::parallel_for(range, op);
+        else          op(range);
+    }
+    else {
+        leafManager.foreach(executerOp, threaded, mSettings->mGrainSize);
+    }
+
+    // release the spatial index before the tree is modified
+    neighbours.reset();
+
+    if (rasterization) {
+        Rasterization::write(*rasterization, transform, *rasterized);
+        rasterization.reset();
+    }
 
     // Check to see if any new data has been added and apply it accordingly
 
@@ -711,6 +909,9 @@ void PointExecutable::execute(openvdb::points::PointDataGrid& grid) const
         // remove temporary world space storage
         points::dropAttribute(grid.tree(), positionAttribute);
     }
+
+    // combine the reductions of each thread
+    Reductions::write(reductions, mCustomData.get());
 }
 
 
@@ -738,6 +939,16 @@ size_t PointExecutable::getGrainSize() const
     return mSettings->mGrainSize;
 }
 
+void PointExecutable::setSpatialOrdering(const bool flag)
+{
+    mSettings->mSpatialOrdering = flag;
+}
+
+bool PointExecutable::getSpatialOrdering() const
+{
+    return mSettings->mSpatialOrdering;
+}
+
 void PointExecutable::setGroupExecution(const std::string& group)
 {
     mSettings->mGroup = group;
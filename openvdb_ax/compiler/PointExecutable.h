@@ -41,12 +41,17 @@
 
 #include "CustomData.h"
 #include "AttributeRegistry.h"
+#include "ObjectBundle.h"
 
 #include <openvdb/openvdb.h>
 #include <openvdb/version.h>
 #include <openvdb/points/PointDataGrid.h>
 
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 class TestPointExecutable;
 
@@ -69,6 +74,19 @@ public:
     using Ptr = std::shared_ptr<PointExecutable>;
     ~PointExecutable();
 
+    /// @brief  Load an executable from object code compiled ahead of time with
+    ///   Compiler::compileObject(). The object code is linked into the current
+    ///   process without being recompiled or optimised. Throws an
+    ///   AXExecutionError if the bundle was not compiled for points, has no
+    ///   syntax tree or can not be loaded on this host.
+    /// @note   openvdb::ax::initialize() must have been called.
+    /// @param bundle  The object bundle to load
+    /// @param customData  Custom data to bind the external variables accessed
+    ///   by the object code to. If not provided, custom data is created when
+    ///   external variables are accessed.
+    static Ptr load(const ObjectBundle& bundle,
+        const CustomData::Ptr customData = CustomData::Ptr());
+
     /// @brief  Copy constructor. Shares the LLVM constructs but deep copies the
     ///   settings. Multiple copies of an executor can be used at the same time
     ///   safely.
@@ -77,8 +95,35 @@ public:
     ////////////////////////////////////////////////////////
 
     /// @brief executes compiled AX code on target grid
+    /// @note  The results of reduce functions are written to the CustomData
+    ///   of this executable once execution completes. The write back is
+    ///   serialised, but the CustomData must not otherwise be accessed, for
+    ///   example by another execution which reads it, until execute returns.
     void execute(points::PointDataGrid& grid) const;
 
+    /// @brief  Executes compiled AX code on a target grid, providing a set of
+    ///   volumes which can be sampled with volumesample(), volumesamplev()
+    ///   and volumegradient(). Volumes are looked up by grid name and are
+    ///   only read from. Only FloatGrids and Vec3SGrids can be sampled; other
+    ///   grid types are ignored.
+    /// @param grid  The point grid to execute over
+    /// @param volumes  The volumes available to the executing kernel
+    void execute(points::PointDataGrid& grid, const GridCPtrVec& volumes) const;
+
+    /// @brief  Executes compiled AX code on a target grid, providing a set of
+    ///   volumes to sample and a set of output grids which rasterize() splats
+    ///   values into. Values rasterized into a grid which already exists in
+    ///   rasterized are added to it, using the transform of the existing grid.
+    ///   Otherwise, a new grid with the transform of the point grid is
+    ///   appended. Existing grids must be FloatGrids or Vec3SGrids, matching
+    ///   the type of the rasterized values.
+    /// @param grid  The point grid to execute over
+    /// @param volumes  The volumes available to the executing kernel
+    /// @param rasterized  The grids to rasterize into
+    void execute(points::PointDataGrid& grid,
+        const GridCPtrVec& volumes,
+        GridPtrVec& rasterized) const;
+
     ////////////////////////////////////////////////////////
 
     /// @brief  Set a specific point group to execute over. The default is none,
@@ -108,6 +153,15 @@ public:
     /// @return  The current grain size
     size_t getGrainSize() const;
 
+    /// @brief  Set whether leaf nodes are sorted along a Morton (Z-order)
+    ///   curve before execution. This groups spatially close nodes into the
+    ///   same threaded ranges, which can improve cache performance when
+    ///   accessing other data. Default is false.
+    /// @param flag  Enables or disables spatial ordering
+    void setSpatialOrdering(const bool flag);
+    /// @return  Whether this executable sorts leaf nodes before execution
+    bool getSpatialOrdering() const;
+
     ////////////////////////////////////////////////////////
 
     // @brief deprecated methods
@@ -140,6 +194,16 @@ private:
     friend class Compiler;
     friend class ::TestPointExecutable;
 
+    /// @brief  Executes compiled AX code on a target grid. If rasterized is
+    ///   null, calls to rasterize() have no effect.
+    void execute(points::PointDataGrid& grid,
+        const GridCPtrVec& volumes,
+        GridPtrVec* const rasterized) const;
+
+    /// @brief  The attributes read through neighbour queries, paired with
+    ///   the types they are read as
+    using NeighbourAccesses = std::vector<std::pair<std::string, ast::tokens::CoreType>>;
+
     /// @brief Constructor, expected to be invoked by the compiler. Should not
     ///   be invoked directly.
     /// @param context Shared pointer to an llvm:LLVMContext associated with the
@@ -151,11 +215,16 @@ private:
     ///   It can be used to retrieve external data from within the AX code
     /// @param functions A map of function names to physical memory addresses
     ///   which were built by llvm using engine
+    /// @param neighbours The attributes read through neighbour queries. If
+    ///   null, the AX code does not query neighbours and no spatial index is
+    ///   built on execution
     PointExecutable(const std::shared_ptr<const llvm::LLVMContext>& context,
                     const std::shared_ptr<const llvm::ExecutionEngine>& engine,
                     const AttributeRegistry::ConstPtr& attributeRegistry,
-                    const CustomData::ConstPtr& customData,
-                    const std::unordered_map<std::string, uint64_t>& functions);
+                    const CustomData::Ptr& customData,
+                    const std::unordered_map<std::string, uint64_t>& functions,
+                    const std::shared_ptr<const NeighbourAccesses>& neighbours =
+                        std::shared_ptr<const NeighbourAccesses>());
 
 private:
     // The Context and ExecutionEngine must exist _only_ for object lifetime
@@ -163,8 +232,9 @@ private:
     const std::shared_ptr<const llvm::LLVMContext> mContext;
     const std::shared_ptr<const llvm::ExecutionEngine> mExecutionEngine;
     const AttributeRegistry::ConstPtr mAttributeRegistry;
-    const CustomData::ConstPtr mCustomData;
+    const CustomData::Ptr mCustomData;
     const std::unordered_map<std::string, uint64_t> mFunctionAddresses;
+    const std::shared_ptr<const NeighbourAccesses> mNeighbourAccesses;
     std::unique_ptr<Settings> mSettings;
 };
 
@@ -31,11 +31,13 @@
 /// @file compiler/VolumeExecutable.cc
 
 #include "VolumeExecutable.h"
+#include "MortonOrder.h"
 
 #include "../Exceptions.h"
 // @TODO refactor so we don't have to include VolumeComputeGenerator.h,
 // but still have the functions defined in one place
 #include "../codegen/VolumeComputeGenerator.h"
+#include "../codegen/Reductions.h"
 
 #include <openvdb/Exceptions.h>
 #include <openvdb/Types.h>
@@ -44,10 +46,17 @@
 #include <openvdb/math/Vec3.h>
 #include <openvdb/tree/ValueAccessor.h>
 #include <openvdb/tree/LeafManager.h>
-#include <openvdb/tree/NodeManager.h>
+#include <openvdb/tools/Prune.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <memory>
 
 namespace openvdb {
@@ -82,6 +91,10 @@ struct VolumeExecutable::Settings
     bool mCreateMissing = true;
     IterType mValueIterator = IterType::ON;
     size_t mGrainSize = 1;
+    bool mAutoGrainSize = true;
+    bool mSpatialOrdering = false;
+    bool mRefine = false;
+    double mRefinementThreshold = 0.0;
 };
 
 namespace {
@@ -117,6 +130,8 @@ using SupportedTypeList = openvdb::TypeList<
     ConverterT<std::string>>;
 
 
+using Reductions = codegen::codegen_internal::Reductions;
+
 /// The arguments of the generated function
 struct VolumeFunctionArguments
 {
@@ -144,11 +159,13 @@ struct VolumeFunctionArguments
     VolumeFunctionArguments(const KernelFunctionPtr function,
             const size_t index,
             void* const accessor,
-            const CustomData* const customData)
+            const CustomData* const customData,
+            Reductions* const reductions)
         : mFunction(function)
         , mIdx(index)
         , mAccessor(accessor)
         , mCustomData(customData)
+        , mReductions(reductions)
         , mVoidAccessors()
         , mAccessors()
         , mVoidTransforms() {}
@@ -158,14 +175,16 @@ struct VolumeFunctionArguments
     ///         which takes no arguments
     inline auto bind()
     {
-        return [&](const openvdb::Coord& ijk, const openvdb::Vec3f& pos) -> ReturnT {
+        return [&](const openvdb::Coord& ijk, const openvdb::Vec3f& pos, bool* active) -> ReturnT {
             return mFunction(static_cast<FunctionTraitsT::Arg<0>::Type>(mCustomData),
                 reinterpret_cast<FunctionTraitsT::Arg<1>::Type>(ijk.data()),
                 reinterpret_cast<FunctionTraitsT::Arg<2>::Type>(pos.asV()),
                 static_cast<FunctionTraitsT::Arg<3>::Type>(mVoidAccessors.data()),
                 static_cast<FunctionTraitsT::Arg<4>::Type>(mVoidTransforms.data()),
                 static_cast<FunctionTraitsT::Arg<5>::Type>(mIdx),
-                mAccessor);
+                mAccessor,
+                static_cast<FunctionTraitsT::Arg<7>::Type>(active),
+                static_cast<FunctionTraitsT::Arg<8>::Type>(mReductions));
         };
     }
 
@@ -189,6 +208,7 @@ private:
     const size_t mIdx;
     void* const mAccessor;
     const CustomData* const mCustomData;
+    Reductions* const mReductions;
     std::vector<void*> mVoidAccessors;
     std::vector<Accessors::UniquePtr> mAccessors;
     std::vector<void*> mVoidTransforms;
@@ -292,6 +312,38 @@ struct VolumeExecuterOp
     using LeafManagerT = tree::LeafManager<TreeT>;
     using LeafRangeT = typename LeafManagerT::LeafRange;
 
+    /// @brief  The write accessor and kernel arguments of a single thread.
+    ///   These persist for the lifetime of the operator so that accessor
+    ///   caches remain warm between the ranges processed by each thread.
+    struct ThreadData
+    {
+        ThreadData(const VolumeExecuterOp& op)
+            : mAccessor(op.mTree)
+            , mArgs(op.mComputeFunction, op.mIdx,
+                static_cast<void*>(&mAccessor), op.mCustomData,
+                &op.mReductions.local())
+        {
+            openvdb::GridBase** read = op.mGrids;
+            for (const auto& iter : op.mAttributeRegistry.data()) {
+                assert(read);
+                retrieveAccessor(mArgs, *read, iter.type());
+                mArgs.addTransform((*read)->transform());
+                ++read;
+            }
+        }
+
+        openvdb::tree::ValueAccessor<TreeT> mAccessor;
+        VolumeFunctionArguments mArgs;
+    };
+
+    using ThreadDataT = tbb::enumerable_thread_specific<std::unique_ptr<ThreadData>>;
+
+    /// @brief  The traits of the iterator over the values of a node which
+    ///   are executed
+    template <typename NodeType>
+    using IterTraitsT = tree::IterTraits<NodeType,
+        typename LeafIterTraitsT::template NodeConverter<NodeType>::Type>;
+
     VolumeExecuterOp(const AttributeRegistry& attributeRegistry,
                      const CustomData* const customData,
                      const math::Transform& assignedVolumeTransform,
@@ -299,7 +351,8 @@ struct VolumeExecuterOp
                      openvdb::GridBase** grids,
                      TreeT& tree,
                      const size_t idx,
-                     const Index level)
+                     std::atomic<bool>& deactivated,
+                     Reductions::ThreadReductions& reductions)
         : mAttributeRegistry(attributeRegistry)
         , mCustomData(customData)
         , mComputeFunction(computeFunction)
@@ -307,54 +360,34 @@ struct VolumeExecuterOp
         , mGrids(grids)
         , mIdx(idx)
         , mTree(tree)
-        , mLevel(level) {
+        , mDeactivated(deactivated)
+        , mReductions(reductions)
+        , mThreadData(new ThreadDataT) {
             assert(mGrids);
         }
 
-    // For use with a NodeManager
-    // @note The enable_if shouldn't be necessary but the partitioner
-    //  through TBB refuses to call the LeafRange operator with a
-    //   const reference argument.
-    template <typename NodeType, typename =
-        typename std::enable_if<!std::is_same<NodeType, LeafRangeT>::value>::type>
-    void operator()(NodeType& node) const
+    VolumeFunctionArguments& args() const
     {
-        // if the current node level does not match, skip
-        // @todo only run over the given level, avoid caching other nodes
-        assert(node.getLevel() > 0);
-        if (node.getLevel() != mLevel) return;
-        openvdb::tree::ValueAccessor<TreeT> acc(mTree);
-        VolumeFunctionArguments args(mComputeFunction,
-            mIdx, static_cast<void*>(&acc), mCustomData);
-
-        openvdb::GridBase** read = mGrids;
-        for (const auto& iter : mAttributeRegistry.data()) {
-            assert(read);
-            retrieveAccessor(args, *read, iter.type());
-            args.addTransform((*read)->transform());
-            ++read;
-        }
+        std::unique_ptr<ThreadData>& data = mThreadData->local();
+        if (!data) data.reset(new ThreadData(*this));
+        return data->mArgs;
+    }
 
-        const auto run = args.bind();
-        (*this)(node, run);
+    // For use with a range of nodes, when the target execution level is
+    // greater than 0 or the leaf nodes are spatially ordered
+    template <typename NodeType>
+    void operator()(const tbb::blocked_range<NodeType**>& range) const
+    {
+        const auto run = this->args().bind();
+        for (NodeType** node = range.begin(); node != range.end(); ++node) {
+            (*this)(**node, run);
+        }
     }
 
     // For use with a LeafManager, when the target execution level is 0
     void operator()(const typename LeafManagerT::LeafRange& range) const
     {
-        openvdb::tree::ValueAccessor<TreeT> acc(mTree);
-        VolumeFunctionArguments args(mComputeFunction,
-            mIdx, static_cast<void*>(&acc), mCustomData);
-
-        openvdb::GridBase** read = mGrids;
-        for (const auto& iter : mAttributeRegistry.data()) {
-            assert(read);
-            retrieveAccessor(args, *read, iter.type());
-            args.addTransform((*read)->transform());
-            ++read;
-        }
-
-        const auto run = args.bind();
+        const auto run = this->args().bind();
         for (auto leaf = range.begin(); leaf; ++leaf) {
             (*this)(*leaf, run);
         }
@@ -363,14 +396,22 @@ struct VolumeExecuterOp
     template <typename NodeType, typename FuncT>
     void operator()(NodeType& node, const FuncT& axfunc) const
     {
-        using IterT = typename LeafIterTraitsT::template NodeConverter<NodeType>::Type;
-        using IterTraitsT = tree::IterTraits<NodeType, IterT>;
-
-        for (auto iter = IterTraitsT::begin(node); iter; ++iter) {
+        bool deactivated = false;
+        for (auto iter = IterTraitsT<NodeType>::begin(node); iter; ++iter) {
             const openvdb::Coord& coord = iter.getCoord();
             const openvdb::Vec3f& pos = mTransform.indexToWorld(coord);
-            axfunc(coord, pos);
+            const bool on = iter.isValueOn();
+            bool active = on;
+            axfunc(coord, pos, &active);
+            // apply any changes made through setactive(). Node iterators only
+            // advance forwards, so modifying the state of the current value
+            // does not change which values are still to be visited
+            if (active != on) {
+                iter.setValueOn(active);
+                deactivated |= on;
+            }
         }
+        if (deactivated) mDeactivated = true;
     }
 
 private:
@@ -381,7 +422,10 @@ private:
     openvdb::GridBase** const mGrids;
     const size_t mIdx;
     TreeT& mTree;
-    const Index mLevel; // only used with NodeManagers
+    std::atomic<bool>& mDeactivated;
+    Reductions::ThreadReductions& mReductions;
+    // shared between all copies of this operator made by tbb
+    const std::shared_ptr<ThreadDataT> mThreadData;
 };
 
 void registerVolumes(GridPtrVec& grids,
@@ -439,9 +483,10 @@ void registerVolumes(GridPtrVec& grids,
         // @todo implement better execution order detection which could minimize
         // the number of deep copies required
 
-        if (iter.writes() && iter.affectsothers()) {
-            // if affectsothers(), it's also read from at some point
-            assert(iter.reads());
+        // Grids which are always overwritten before being used are never read
+        // and don't require a copy, even if other grids depend on them
+
+        if (iter.writes() && iter.reads() && iter.affectsothers()) {
             readGrids.push_back(matchedGrid->deepCopyGrid());
             writeableGrids.push_back(matchedGrid);
         }
@@ -454,6 +499,211 @@ void registerVolumes(GridPtrVec& grids,
     }
 }
 
+/// @brief  Returns whether the settings enable multi-threading
+inline bool threaded(const VolumeExecutable::Settings& S)
+{
+    return S.mAutoGrainSize || S.mGrainSize > 0;
+}
+
+/// @brief  Returns the grain size to use when threading over a given number
+///   of nodes. If no grain size has been set, the nodes are split into a
+///   small number of ranges per thread to balance load without the overhead
+///   of scheduling every node individually.
+inline size_t grainSize(const VolumeExecutable::Settings& S, const size_t count)
+{
+    if (!S.mAutoGrainSize) return S.mGrainSize;
+    const size_t threads =
+        static_cast<size_t>(std::max(1, tbb::this_task_arena::max_concurrency()));
+    return std::max(size_t(1), count / (threads * 8));
+}
+
+/// @brief  Execute the given operator over an array of nodes of the target
+///   execution level. If enabled, the nodes are first sorted by the Morton
+///   code of their origins so that each range covers a compact region of
+///   space, improving the coherency of accessor caches on other grids.
+template <typename NodeT, typename OpT>
+inline void runNodeArray(std::vector<NodeT*>& nodes,
+    const OpT& op,
+    const VolumeExecutable::Settings& S)
+{
+    if (nodes.empty()) return;
+    if (S.mSpatialOrdering) compiler_internal::mortonSort(nodes);
+
+    const bool thread = threaded(S);
+    const tbb::blocked_range<NodeT**>
+        range(nodes.data(), nodes.data() + nodes.size(),
+            thread ? grainSize(S, nodes.size()) : 1);
+    if (thread) tbb::parallel_for(range, op);
+    else        op(range);
+}
+
+/// @brief  Execute the given operator over the tiles of the root node
+template <typename ChildT, typename OpT>
+inline void runNodeArray(std::vector<tree::RootNode<ChildT>*>& nodes,
+    const OpT& op,
+    const VolumeExecutable::Settings&)
+{
+    op(tbb::blocked_range<tree::RootNode<ChildT>**>
+        (nodes.data(), nodes.data() + nodes.size()));
+}
+
+/// @brief  The variation between two values of a volume, used to decide
+///   where the result of a tree execution level is refined. Scalars use the
+///   absolute difference and vectors the length of the difference. Other
+///   value types can not be refined.
+template <typename ValueT, typename Enable = void>
+struct Variation
+{
+    static constexpr bool Supported = false;
+    static double get(const ValueT&, const ValueT&) { return 0.0; }
+};
+
+template <typename ValueT>
+struct Variation<ValueT, typename std::enable_if<std::is_arithmetic<ValueT>::value &&
+    !std::is_same<ValueT, bool>::value>::type>
+{
+    static constexpr bool Supported = true;
+    static double get(const ValueT& a, const ValueT& b)
+    {
+        return std::abs(double(a) - double(b));
+    }
+};
+
+template <typename ValueT>
+struct Variation<ValueT, typename std::enable_if<VecTraits<ValueT>::IsVec>::type>
+{
+    static constexpr bool Supported = true;
+    static double get(const ValueT& a, const ValueT& b)
+    {
+        double length = 0.0;
+        for (int i = 0; i < VecTraits<ValueT>::Size; ++i) {
+            const double delta = double(a[i]) - double(b[i]);
+            length += delta * delta;
+        }
+        return std::sqrt(length);
+    }
+};
+
+/// @brief  Execute the given operator over the leaf nodes reached by the
+///   refinement of a tree execution level.
+template <typename NodeT, typename TreeT, typename OpT>
+inline typename std::enable_if<(NodeT::LEVEL == 0)>::type
+refineNodes(TreeT&, std::vector<NodeT*>& nodes, const OpT& op,
+    const VolumeExecutable::Settings& S)
+{
+    runNodeArray(nodes, op, S);
+}
+
+/// @brief  Execute the given operator over the tiles of an array of nodes and
+///   refine the result where it varies. Once executed, the result of each
+///   tile is compared with those of the adjacent tiles which were executed
+///   with it. Tiles which vary by more than the refinement threshold are
+///   restored to their value before execution and replaced by a child node,
+///   the tiles of which are executed in the same way. Refinement ends at the
+///   leaf level, where every voxel of a refined region is executed.
+template <typename NodeT, typename TreeT, typename OpT>
+inline typename std::enable_if<(NodeT::LEVEL > 0)>::type
+refineNodes(TreeT& tree, std::vector<NodeT*>& nodes, const OpT& op,
+    const VolumeExecutable::Settings& S)
+{
+    using ValueT = typename TreeT::ValueType;
+    using ChildT = typename NodeT::ChildNodeType;
+    using IterTraitsT = typename OpT::template IterTraitsT<NodeT>;
+
+    struct Tile
+    {
+        Coord mOrigin;
+        ValueT mValue;
+        bool mOn;
+    };
+
+    // record the tiles to execute and their values before execution
+    std::vector<Tile> tiles;
+    for (NodeT* node : nodes) {
+        for (auto iter = IterTraitsT::begin(*node); iter; ++iter) {
+            tiles.push_back(Tile { iter.getCoord(), iter.getValue(), iter.isValueOn() });
+        }
+    }
+    if (tiles.empty()) return;
+
+    runNodeArray(nodes, op, S);
+
+    std::sort(tiles.begin(), tiles.end(),
+        [](const Tile& a, const Tile& b) { return a.mOrigin < b.mOrigin; });
+    auto executed = [&tiles](const Coord& ijk) {
+        const auto iter = std::lower_bound(tiles.begin(), tiles.end(), ijk,
+            [](const Tile& tile, const Coord& origin) { return tile.mOrigin < origin; });
+        return iter != tiles.end() && iter->mOrigin == ijk;
+    };
+
+    // flag the tiles whose result varies from that of an adjacent tile
+    std::vector<char> refine(tiles.size(), 0);
+    auto evaluate = [&](const tbb::blocked_range<size_t>& range) {
+        tree::ValueAccessor<const TreeT> acc(tree);
+        for (size_t i = range.begin(); i < range.end(); ++i) {
+            const ValueT& result = acc.getValue(tiles[i].mOrigin);
+            for (int axis = 0; axis < 3 && !refine[i]; ++axis) {
+                for (const Int32 offset : { -Int32(ChildT::DIM), Int32(ChildT::DIM) }) {
+                    Coord ijk = tiles[i].mOrigin;
+                    ijk[axis] += offset;
+                    if (!executed(ijk)) continue;
+                    if (Variation<ValueT>::get(result, acc.getValue(ijk)) >
+                        S.mRefinementThreshold) {
+                        refine[i] = 1;
+                        break;
+                    }
+                }
+            }
+        }
+    };
+
+    const tbb::blocked_range<size_t> range(0, tiles.size(),
+        threaded(S) ? grainSize(S, tiles.size()) : 1);
+    if (threaded(S)) tbb::parallel_for(range, evaluate);
+    else             evaluate(range);
+
+    // restore and subdivide the tiles to refine
+    std::vector<ChildT*> children;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (!refine[i]) continue;
+        const Tile& tile = tiles[i];
+        tree.addTile(NodeT::LEVEL, tile.mOrigin, tile.mValue, tile.mOn);
+        tree.addTile(ChildT::LEVEL, tile.mOrigin, tile.mValue, tile.mOn);
+        children.emplace_back(tree.template probeNode<ChildT>(tile.mOrigin));
+        assert(children.back());
+    }
+
+    if (!children.empty()) refineNodes(tree, children, op, S);
+}
+
+/// @brief  Execute the given operator over all nodes at a specific level
+///   of a tree. Only nodes of the target level are gathered and visited.
+///   NodeT is the node type to start the search from and level must be
+///   less than or equal to its level.
+template <typename NodeT, typename TreeT, typename OpT>
+inline typename std::enable_if<(NodeT::LEVEL == 0)>::type
+runNodes(TreeT&, const Index, const OpT&, const VolumeExecutable::Settings&)
+{
+    // leaf level execution is performed with a LeafManager
+    assert(false && "Invalid tree execution level");
+}
+
+template <typename NodeT, typename TreeT, typename OpT>
+inline typename std::enable_if<(NodeT::LEVEL > 0)>::type
+runNodes(TreeT& tree, const Index level, const OpT& op, const VolumeExecutable::Settings& S)
+{
+    if (level < NodeT::LEVEL) {
+        runNodes<typename NodeT::ChildNodeType>(tree, level, op, S);
+        return;
+    }
+
+    assert(level == NodeT::LEVEL);
+    std::vector<NodeT*> nodes;
+    tree.getNodes(nodes);
+    if (S.mRefine) refineNodes(tree, nodes, op, S);
+    else           runNodeArray(nodes, op, S);
+}
+
 template<typename LeafT> struct ValueOnIter  { using IterTraitsT = typename tree::IterTraits<LeafT, typename LeafT::ValueOnIter>;  };
 template<typename LeafT> struct ValueAllIter { using IterTraitsT = typename tree::IterTraits<LeafT, typename LeafT::ValueAllIter>; };
 template<typename LeafT> struct ValueOffIter { using IterTraitsT = typename tree::IterTraits<LeafT, typename LeafT::ValueOffIter>; };
@@ -464,6 +714,7 @@ inline void run(openvdb::GridBase& grid,
     const KernelFunctionPtr kernel,
     const AttributeRegistry& registry,
     const CustomData* const custom,
+    Reductions::ThreadReductions& reductions,
     const VolumeExecutable::Settings& S)
 {
     using TreeType = typename GridT::TreeType;
@@ -474,23 +725,57 @@ inline void run(openvdb::GridBase& grid,
     const int64_t idx = registry.accessIndex(grid.getName(), type);
     assert(idx >= 0);
 
+    if (S.mRefine && S.mTreeExecutionLevel > 0 &&
+        !Variation<typename TreeType::ValueType>::Supported) {
+        OPENVDB_THROW(AXExecutionError, "Unable to refine the execution of volume '"
+            + grid.getName() + "' as its value type '" + grid.valueType()
+            + "' has no measure of variation.");
+    }
+
     GridT& typed = static_cast<GridT&>(grid);
+    std::atomic<bool> deactivated(false);
     VolumeExecuterOp<TreeType, typename IterType::IterTraitsT>
         executerOp(registry, custom, grid.transform(),
-            kernel, readptrs, typed.tree(), idx, S.mTreeExecutionLevel);
+            kernel, readptrs, typed.tree(), idx, deactivated, reductions);
 
-    const bool thread = S.mGrainSize > 0;
+    const bool thread = threaded(S);
 
-    if (S.mTreeExecutionLevel == 0) {
+    if (S.mTreeExecutionLevel == 0 && S.mSpatialOrdering) {
+        // execute over the spatially sorted leaf nodes of the grid currently
+        // being modified.
+        std::vector<typename TreeType::LeafNodeType*> leaves;
+        typed.tree().getNodes(leaves);
+        runNodeArray(leaves, executerOp, S);
+    }
+    else if (S.mTreeExecutionLevel == 0) {
         // execute over the topology of the grid currently being modified.
         tree::LeafManager<TreeType> leafManager(typed.tree());
-        if (thread) tbb::parallel_for(leafManager.leafRange(S.mGrainSize), executerOp);
-        else        executerOp(leafManager.leafRange());
+        if (thread) {
+            const size_t grain = grainSize(S, leafManager.leafCount());
+            tbb::parallel_for(leafManager.leafRange(grain), executerOp);
+        }
+        else {
+            executerOp(leafManager.leafRange());
+        }
+    }
+    else if (S.mTreeExecutionLevel == TreeType::RootNodeType::LEVEL) {
+        // execute over the tiles of the root node
+        using RootNodeType = typename TreeType::RootNodeType;
+        std::vector<RootNodeType*> root { &(typed.tree().root()) };
+        if (S.mRefine) refineNodes(typed.tree(), root, executerOp, S);
+        else           runNodeArray(root, executerOp, S);
     }
     else {
-        // no leaf nodes
-        tree::NodeManager<TreeType, TreeType::RootNodeType::LEVEL-1> manager(typed.tree());
-        manager.foreachBottomUp(executerOp, thread, S.mGrainSize);
+        // execute over the tiles of all internal nodes of the target level,
+        // refining the result where enabled
+        runNodes<typename TreeType::RootNodeType::ChildNodeType>
+            (typed.tree(), S.mTreeExecutionLevel, executerOp, S);
+    }
+
+    // if setactive() has switched off any values, remove nodes which are
+    // now entirely inactive so that the output only holds surviving data
+    if (deactivated) {
+        tools::pruneInactive(typed.tree(), thread);
     }
 }
 
@@ -500,6 +785,7 @@ inline void run(const openvdb::GridPtrVec& writeableGrids,
                 const KernelFunctionPtr kernel,
                 const AttributeRegistry& registry,
                 const CustomData* const custom,
+                Reductions::ThreadReductions& reductions,
                 const VolumeExecutable::Settings& S)
 {
     // extract grid pointers from shared pointer container
@@ -508,24 +794,58 @@ inline void run(const openvdb::GridPtrVec& writeableGrids,
     readptrs.reserve(readGrids.size());
     for (auto& grid : readGrids) readptrs.emplace_back(grid.get());
 
-    for (const auto& grid : writeableGrids) {
-        const bool success = grid->apply<SupportedTypeList>([&](auto& typed) {
+    auto runGrid = [&](openvdb::GridBase& grid) {
+        const bool success = grid.apply<SupportedTypeList>([&](auto& typed) {
             using GridType = typename std::decay<decltype(typed)>::type;
-            run<IterT, GridType>(*grid, readptrs.data(), kernel, registry, custom, S);
+            run<IterT, GridType>(grid, readptrs.data(), kernel, registry, custom, reductions, S);
         });
         if (!success) {
-            OPENVDB_THROW(AXExecutionError, "Could not retrieve volume '" + grid->getName()
-                + "' as it has an unknown or unsupported value type '" + grid->valueType()
+            OPENVDB_THROW(AXExecutionError, "Could not retrieve volume '" + grid.getName()
+                + "' as it has an unknown or unsupported value type '" + grid.valueType()
                 + "'");
         }
+    };
+
+    // Every execution reads all registered volumes, regardless of which grid
+    // is being iterated. Writeable grids which are also read from without a
+    // deep copy are therefore visited by all other executions and must be
+    // processed on their own. All remaining writeable grids are independent
+    // and are executed together so that many small volumes can still
+    // saturate the available threads.
+
+    openvdb::GridPtrVec concurrent, exclusive;
+    for (const auto& grid : writeableGrids) {
+        const ast::tokens::CoreType type =
+            ast::tokens::tokenFromTypeString(grid->valueType());
+        const int64_t idx = registry.accessIndex(grid->getName(), type);
+        assert(idx >= 0);
+        const AttributeRegistry::AccessData& access = registry.data()[idx];
+        if (access.reads() && readptrs[idx] == grid.get()) exclusive.emplace_back(grid);
+        else concurrent.emplace_back(grid);
+    }
+
+    if (threaded(S) && concurrent.size() > 1) {
+        // each grid's own parallel_for is nested within the task group,
+        // allowing idle threads to steal leaf ranges from any grid
+        tbb::task_group tasks;
+        for (const auto& grid : concurrent) {
+            openvdb::GridBase* ptr = grid.get();
+            tasks.run([&runGrid, ptr]() { runGrid(*ptr); });
+        }
+        tasks.wait();
     }
+    else {
+        for (const auto& grid : concurrent) runGrid(*grid);
+    }
+
+    for (const auto& grid : exclusive) runGrid(*grid);
 }
 } // anonymous namespace
 
 VolumeExecutable::VolumeExecutable(const std::shared_ptr<const llvm::LLVMContext>& context,
                     const std::shared_ptr<const llvm::ExecutionEngine>& engine,
                     const AttributeRegistry::ConstPtr& accessRegistry,
-                    const CustomData::ConstPtr& customData,
+                    const CustomData::Ptr& customData,
                     const std::unordered_map<std::string, uint64_t>& functionAddresses)
     : mContext(context)
     , mExecutionEngine(engine)
@@ -549,6 +869,25 @@ VolumeExecutable::VolumeExecutable(const VolumeExecutable& other)
 
 VolumeExecutable::~VolumeExecutable() {}
 
+VolumeExecutable::Ptr
+VolumeExecutable::load(const ObjectBundle& bundle, const CustomData::Ptr customData)
+{
+    if (bundle.type() != ObjectBundle::ExecutableType::VOLUMES) {
+        OPENVDB_THROW(AXExecutionError, "Object bundle was not compiled for volumes.");
+    }
+
+    const std::vector<std::string> functionNames {
+        codegen::VolumeKernel::getDefaultName()
+    };
+
+    ObjectBundle::Linked linked = bundle.link(customData, functionNames);
+    return VolumeExecutable::Ptr(new VolumeExecutable(linked.mContext,
+        linked.mEngine,
+        bundle.attributeRegistry(),
+        linked.mCustomData,
+        linked.mFunctions));
+}
+
 void VolumeExecutable::execute(openvdb::GridPtrVec& grids) const
 {
     openvdb::GridPtrVec readGrids, writeableGrids;
@@ -565,16 +904,20 @@ void VolumeExecutable::execute(openvdb::GridPtrVec& grids) const
             "No AX kernel found for execution.");
     }
 
+    Reductions::ThreadReductions reductions;
     if (mSettings->mValueIterator == IterType::ON)
-        run<ValueOnIter>(writeableGrids, readGrids, kernel, *mAttributeRegistry, mCustomData.get(), *mSettings);
+        run<ValueOnIter>(writeableGrids, readGrids, kernel, *mAttributeRegistry, mCustomData.get(), reductions, *mSettings);
     else if (mSettings->mValueIterator == IterType::OFF)
-        run<ValueOffIter>(writeableGrids, readGrids, kernel, *mAttributeRegistry, mCustomData.get(), *mSettings);
+        run<ValueOffIter>(writeableGrids, readGrids, kernel, *mAttributeRegistry, mCustomData.get(), reductions, *mSettings);
     else if (mSettings->mValueIterator == IterType::ALL)
-        run<ValueAllIter>(writeableGrids, readGrids, kernel, *mAttributeRegistry, mCustomData.get(), *mSettings);
+        run<ValueAllIter>(writeableGrids, readGrids, kernel, *mAttributeRegistry, mCustomData.get(), reductions, *mSettings);
     else {
         OPENVDB_THROW(AXExecutionError,
             "Unrecognised voxel iterator.");
     }
+
+    // combine the reductions of each thread
+    Reductions::write(reductions, mCustomData.get());
 }
 
 void VolumeExecutable::execute(openvdb::GridBase& grid) const
@@ -611,15 +954,16 @@ void VolumeExecutable::execute(openvdb::GridBase& grid) const
             "No code has been successfully compiled for execution.");
     }
 
+    Reductions::ThreadReductions reductions;
     const bool success = grid.apply<SupportedTypeList>([&](auto& typed) {
         using GridType = typename std::decay<decltype(typed)>::type;
         openvdb::GridBase* grids = &grid;
         if (mSettings->mValueIterator == IterType::ON)
-            run<ValueOnIter, GridType>(grid, &grids, kernel, *mAttributeRegistry, mCustomData.get(), *mSettings);
+            run<ValueOnIter, GridType>(grid, &grids, kernel, *mAttributeRegistry, mCustomData.get(), reductions, *mSettings);
         else if (mSettings->mValueIterator == IterType::OFF)
-            run<ValueOffIter, GridType>(grid, &grids, kernel, *mAttributeRegistry, mCustomData.get(), *mSettings);
+            run<ValueOffIter, GridType>(grid, &grids, kernel, *mAttributeRegistry, mCustomData.get(), reductions, *mSettings);
         else if (mSettings->mValueIterator == IterType::ALL)
-            run<ValueAllIter, GridType>(grid, &grids, kernel, *mAttributeRegistry, mCustomData.get(), *mSettings);
+            run<ValueAllIter, GridType>(grid, &grids, kernel, *mAttributeRegistry, mCustomData.get(), reductions, *mSettings);
         else
             OPENVDB_THROW(AXExecutionError,"Unrecognised voxel iterator.");
     });
@@ -628,6 +972,9 @@ void VolumeExecutable::execute(openvdb::GridBase& grid) const
             + "' as it has an unknown or unsupported value type '" + grid.valueType()
             + "'");
     }
+
+    // combine the reductions of each thread
+    Reductions::write(reductions, mCustomData.get());
 }
 
 
@@ -673,6 +1020,7 @@ VolumeExecutable::IterType VolumeExecutable::getValueIterator() const
 void VolumeExecutable::setGrainSize(const size_t grain)
 {
     mSettings->mGrainSize = grain;
+    mSettings->mAutoGrainSize = false;
 }
 
 size_t VolumeExecutable::getGrainSize() const
@@ -680,6 +1028,40 @@ size_t VolumeExecutable::getGrainSize() const
     return mSettings->mGrainSize;
 }
 
+void VolumeExecutable::setSpatialOrdering(const bool flag)
+{
+    mSettings->mSpatialOrdering = flag;
+}
+
+bool VolumeExecutable::getSpatialOrdering() const
+{
+    return mSettings->mSpatialOrdering;
+}
+
+void VolumeExecutable::setRefinement(const bool flag)
+{
+    mSettings->mRefine = flag;
+}
+
+bool VolumeExecutable::getRefinement() const
+{
+    return mSettings->mRefine;
+}
+
+void VolumeExecutable::setRefinementThreshold(const double threshold)
+{
+    if (threshold < 0.0) {
+        OPENVDB_THROW(RuntimeError,
+            "Invalid refinement threshold in VolumeExecutable.");
+    }
+    mSettings->mRefinementThreshold = threshold;
+}
+
+double VolumeExecutable::getRefinementThreshold() const
+{
+    return mSettings->mRefinementThreshold;
+}
+
 
 } // namespace ax
 } // namespace OPENVDB_VERSION_NAME
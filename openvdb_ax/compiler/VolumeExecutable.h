@@ -41,6 +41,7 @@
 
 #include "CustomData.h"
 #include "AttributeRegistry.h"
+#include "ObjectBundle.h"
 
 #include <openvdb/version.h>
 #include <openvdb/Grid.h>
@@ -69,6 +70,19 @@ public:
     using Ptr = std::shared_ptr<VolumeExecutable>;
     ~VolumeExecutable();
 
+    /// @brief  Load an executable from object code compiled ahead of time with
+    ///   Compiler::compileObject(). The object code is linked into the current
+    ///   process without being recompiled or optimised. Throws an
+    ///   AXExecutionError if the bundle was not compiled for volumes or can not
+    ///   be loaded on this host.
+    /// @note   openvdb::ax::initialize() must have been called.
+    /// @param bundle  The object bundle to load
+    /// @param customData  Custom data to bind the external variables accessed
+    ///   by the object code to. If not provided, custom data is created when
+    ///   external variables are accessed.
+    static Ptr load(const ObjectBundle& bundle,
+        const CustomData::Ptr customData = CustomData::Ptr());
+
     /// @brief  Copy constructor. Shares the LLVM constructs but deep copies the
     ///   settings. Multiple copies of an executor can be used at the same time
     ///   safely.
@@ -77,6 +91,10 @@ public:
     ////////////////////////////////////////////////////////
 
     /// @brief Execute AX code on target grids
+    /// @note  The results of reduce functions are written to the CustomData
+    ///   of this executable once execution completes. The write back is
+    ///   serialised, but the CustomData must not otherwise be accessed, for
+    ///   example by another execution which reads it, until execute returns.
     void execute(openvdb::GridPtrVec& grids) const;
     void execute(openvdb::GridBase& grid) const;
 
@@ -113,13 +131,53 @@ public:
     /// @return  The current value iterator type
     IterType getValueIterator() const;
 
-    /// @brief  Set the threading grain size. Default is 1. A value of 0 has the
-    ///   effect of disabling multi-threading.
+    /// @brief  Set the threading grain size. By default, the grain size is
+    ///   chosen from the number of nodes being processed. Setting a value
+    ///   disables this behaviour. A value of 0 has the effect of disabling
+    ///   multi-threading.
     /// @param grain The grain size
     void setGrainSize(const size_t grain);
-    /// @return  The current grain size
+    /// @return  The current grain size. If no grain size has been set, this
+    ///   is 1, the minimum grain size chosen from the node count
     size_t getGrainSize() const;
 
+    /// @brief  Set whether the nodes of the tree execution level are sorted
+    ///   along a Morton (Z-order) curve before execution. This groups
+    ///   spatially close nodes into the same threaded ranges, which can
+    ///   improve cache performance when accessing other grids. Default is
+    ///   false.
+    /// @param flag  Enables or disables spatial ordering
+    void setSpatialOrdering(const bool flag);
+    /// @return  Whether this executable sorts nodes before execution
+    bool getSpatialOrdering() const;
+
+    /// @brief  Set whether the result of a tree execution level greater than
+    ///   0 is refined where it varies. Each tile of the execution level is
+    ///   first processed as a single value, providing a coarse result. Tiles
+    ///   whose result differs from that of an adjacent tile by more than the
+    ///   refinement threshold are then restored and subdivided, and their
+    ///   children processed in the same way down to the voxels of the leaf
+    ///   level. Default is false.
+    /// @note  The variation of scalar values is their absolute difference and
+    ///   of vector values the length of their difference. Execution throws an
+    ///   AXExecutionError for grids of other value types.
+    /// @note  Tiles which are refined are processed more than once, so any
+    ///   reductions also accumulate the values of their coarse results.
+    /// @param flag  Enables or disables refinement
+    void setRefinement(const bool flag);
+    /// @return  Whether this executable refines the result of tree execution
+    ///   levels greater than 0
+    bool getRefinement() const;
+
+    /// @brief  Set the variation between adjacent tiles above which tiles are
+    ///   refined. Default is 0, which refines wherever the result varies.
+    /// @note  A negative threshold will cause this method to throw a runtime
+    ///   error.
+    /// @param threshold  The refinement threshold
+    void setRefinementThreshold(const double threshold);
+    /// @return  The refinement threshold
+    double getRefinementThreshold() const;
+
     ////////////////////////////////////////////////////////
 
     // @brief deprecated methods
@@ -166,7 +224,7 @@ private:
     VolumeExecutable(const std::shared_ptr<const llvm::LLVMContext>& context,
         const std::shared_ptr<const llvm::ExecutionEngine>& engine,
         const AttributeRegistry::ConstPtr& accessRegistry,
-        const CustomData::ConstPtr& customData,
+        const CustomData::Ptr& customData,
         const std::unordered_map<std::string, uint64_t>& functions);
 
 private:
@@ -175,7 +233,7 @@ private:
     const std::shared_ptr<const llvm::LLVMContext> mContext;
     const std::shared_ptr<const llvm::ExecutionEngine> mExecutionEngine;
     const AttributeRegistry::ConstPtr mAttributeRegistry;
-    const CustomData::ConstPtr mCustomData;
+    const CustomData::Ptr mCustomData;
     const std::unordered_map<std::string, uint64_t> mFunctionAddresses;
     std::unique_ptr<Settings> mSettings;
 };
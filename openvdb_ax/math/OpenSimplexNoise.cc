@@ -32,6 +32,8 @@
 
 #include "OpenSimplexNoise.h"
 
+#include <openvdb/Platform.h>
+
 #include <algorithm>
 #include <cmath>
 #include <type_traits>
@@ -73,6 +75,37 @@ inline void LCG_STEP (int64_t & x)
     x = ((x * MULTIPLIER) + INCREMENT);
 }
 
+// The number of positions evaluated together by evalBatch
+constexpr int64_t sBatchSize = 16;
+
+template <typename VerticesT, typename T>
+inline void setVertex(VerticesT& v, const int vertex, const int64_t lane,
+                      const OSNoise::inttype xsv,
+                      const OSNoise::inttype ysv,
+                      const OSNoise::inttype zsv,
+                      const T dx,
+                      const T dy,
+                      const T dz)
+{
+  // Only the lowest byte of each coordinate is used to index the
+  // permutation table. Storing it as an int keeps the table lookups of
+  // evalBatch in 32 bit lanes.
+  v.sv[vertex][0][lane] = static_cast<int>(xsv & 0xFF);
+  v.sv[vertex][1][lane] = static_cast<int>(ysv & 0xFF);
+  v.sv[vertex][2][lane] = static_cast<int>(zsv & 0xFF);
+  v.d[vertex][0][lane] = dx;
+  v.d[vertex][1][lane] = dy;
+  v.d[vertex][2][lane] = dz;
+}
+
+// Mark a vertex as not contributing. Its distance is outside of the
+// kernel radius, so its contribution evaluates to 0.
+template <typename VerticesT>
+inline void setUnusedVertex(VerticesT& v, const int vertex, const int64_t lane)
+{
+  setVertex(v, vertex, lane, 0, 0, 0, 2.0, 0.0, 0.0);
+}
+
 } // anonymous namespace
 
 // Array of gradient values for 3D. They approximate the directions to the
@@ -143,21 +176,33 @@ OSNoise::OSNoise(const int * p)
 }
 
 template <typename T>
-T OSNoise::eval(const T x, const T y, const T z) const
+inline T OSNoise::contribution(const int xsv,
+                               const int ysv,
+                               const int zsv,
+                               const T dx,
+                               const T dy,
+                               const T dz) const
 {
-  static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+  const T m = pow2(dx) + pow2(dy) + pow2(dz);
+  const int index = mPermGradIndex[(mPerm[(mPerm[xsv] + ysv) & 0xFF] + zsv) & 0xFF];
+  const T ext = sGradients[index] * dx +
+                sGradients[index + 1] * dy +
+                sGradients[index + 2] * dz;
+  return pow4(std::max((T)2.0 - m, (T)0.0)) * ext;
+}
 
+// Forced inline so that the vertices of eval can be kept in registers
+template <typename T, int64_t N>
+OPENVDB_FORCE_INLINE void OSNoise::vertices(const T x, const T y, const T z,
+                              OSNoise::Vertices<T, N>& v, const int64_t lane) const
+{
   static const T STRETCH_CONSTANT = (T)(-1.0 / 6.0); // (1 / sqrt(3 + 1) - 1) / 3
   static const T SQUISH_CONSTANT  = (T)(1.0 / 3.0);  // (sqrt(3 + 1) - 1) / 3
-  static const T NORM_CONSTANT    = (T)(1.0 / 103.0);
 
   OSNoise::inttype xsb, ysb, zsb;
   T dx0, dy0, dz0;
   T xins, yins, zins;
 
-  // Parameters for the individual contributions
-  T contr_m [9], contr_ext [9];
-
   {
     // Place input coordinates on simplectic lattice.
     T stretchOffset = (x + y + z) * STRETCH_CONSTANT;
@@ -405,49 +450,43 @@ T OSNoise::eval(const T x, const T y, const T z) const
       }
     }
 
-    contr_m[0] = contr_ext[0] = 0.0;
+    setUnusedVertex(v, 0, lane);
 
     // Contribution (0,0,1).
     T dx1 = dx0 - (T)1.0 - SQUISH_CONSTANT;
     T dy1 = dy0 - SQUISH_CONSTANT;
     T dz1 = dz0 - SQUISH_CONSTANT;
-    contr_m[1] = pow2(dx1) + pow2(dy1) + pow2(dz1);
-    contr_ext[1] = extrapolate(xsb + 1, ysb, zsb, dx1, dy1, dz1);
+    setVertex(v, 1, lane, xsb + 1, ysb, zsb, dx1, dy1, dz1);
 
     // Contribution (0,1,0).
     T dx2 = dx0 - SQUISH_CONSTANT;
     T dy2 = dy0 - (T)1.0 - SQUISH_CONSTANT;
     T dz2 = dz1;
-    contr_m[2] = pow2(dx2) + pow2(dy2) + pow2(dz2);
-    contr_ext[2] = extrapolate(xsb, ysb + 1, zsb, dx2, dy2, dz2);
+    setVertex(v, 2, lane, xsb, ysb + 1, zsb, dx2, dy2, dz2);
 
     // Contribution (1,0,0).
     T dx3 = dx2;
     T dy3 = dy1;
     T dz3 = dz0 - (T)1.0 - SQUISH_CONSTANT;
-    contr_m[3] = pow2(dx3) + pow2(dy3) + pow2(dz3);
-    contr_ext[3] = extrapolate(xsb, ysb, zsb + 1, dx3, dy3, dz3);
+    setVertex(v, 3, lane, xsb, ysb, zsb + 1, dx3, dy3, dz3);
 
     // Contribution (1,1,0).
     T dx4 = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
     T dy4 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
     T dz4 = dz0 - (SQUISH_CONSTANT * (T)2.0);
-    contr_m[4] = pow2(dx4) + pow2(dy4) + pow2(dz4);
-    contr_ext[4] = extrapolate(xsb + 1, ysb + 1, zsb, dx4, dy4, dz4);
+    setVertex(v, 4, lane, xsb + 1, ysb + 1, zsb, dx4, dy4, dz4);
 
     // Contribution (1,0,1).
     T dx5 = dx4;
     T dy5 = dy0 - (SQUISH_CONSTANT * (T)2.0);
     T dz5 = dz0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-    contr_m[5] = pow2(dx5) + pow2(dy5) + pow2(dz5);
-    contr_ext[5] = extrapolate(xsb + 1, ysb, zsb + 1, dx5, dy5, dz5);
+    setVertex(v, 5, lane, xsb + 1, ysb, zsb + 1, dx5, dy5, dz5);
 
     // Contribution (0,1,1).
     T dx6 = dx0 - (SQUISH_CONSTANT * (T)2.0);
     T dy6 = dy4;
     T dz6 = dz5;
-    contr_m[6] = pow2(dx6) + pow2(dy6) + pow2(dz6);
-    contr_ext[6] = extrapolate(xsb, ysb + 1, zsb + 1, dx6, dy6, dz6);
+    setVertex(v, 6, lane, xsb, ysb + 1, zsb + 1, dx6, dy6, dz6);
 
   } else if (inSum <= (T)1.0) {
     // The point is inside the tetrahedron (3-Simplex) at (0,0,0)
@@ -550,33 +589,30 @@ T OSNoise::eval(const T x, const T y, const T z) const
 
     // Contribution (0,0,0)
     {
-      contr_m[0] = pow2(dx0) + pow2(dy0) + pow2(dz0);
-      contr_ext[0] = extrapolate(xsb, ysb, zsb, dx0, dy0, dz0);
+      setVertex(v, 0, lane, xsb, ysb, zsb, dx0, dy0, dz0);
     }
 
     // Contribution (0,0,1)
     T dx1 = dx0 - (T)1.0 - SQUISH_CONSTANT;
     T dy1 = dy0 - SQUISH_CONSTANT;
     T dz1 = dz0 - SQUISH_CONSTANT;
-    contr_m[1] = pow2(dx1) + pow2(dy1) + pow2(dz1);
-    contr_ext[1] = extrapolate(xsb + 1, ysb, zsb, dx1, dy1, dz1);
+    setVertex(v, 1, lane, xsb + 1, ysb, zsb, dx1, dy1, dz1);
 
     // Contribution (0,1,0)
     T dx2 = dx0 - SQUISH_CONSTANT;
     T dy2 = dy0 - (T)1.0 - SQUISH_CONSTANT;
     T dz2 = dz1;
-    contr_m[2] = pow2(dx2) + pow2(dy2) + pow2(dz2);
-    contr_ext[2] = extrapolate(xsb, ysb + 1, zsb, dx2, dy2, dz2);
+    setVertex(v, 2, lane, xsb, ysb + 1, zsb, dx2, dy2, dz2);
 
     // Contribution (1,0,0)
     T dx3 = dx2;
     T dy3 = dy1;
     T dz3 = dz0 - (T)1.0 - SQUISH_CONSTANT;
-    contr_m[3] = pow2(dx3) + pow2(dy3) + pow2(dz3);
-    contr_ext[3] = extrapolate(xsb, ysb, zsb + 1, dx3, dy3, dz3);
+    setVertex(v, 3, lane, xsb, ysb, zsb + 1, dx3, dy3, dz3);
 
-    contr_m[4] = contr_m[5] = contr_m[6] = 0.0;
-    contr_ext[4] = contr_ext[5] = contr_ext[6] = 0.0;
+    setUnusedVertex(v, 4, lane);
+    setUnusedVertex(v, 5, lane);
+    setUnusedVertex(v, 6, lane);
 
   } else {
     // The point is inside the tetrahedron (3-Simplex) at (1,1,1)
@@ -682,23 +718,20 @@ T OSNoise::eval(const T x, const T y, const T z) const
     T dx3 = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
     T dy3 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
     T dz3 = dz0 - (SQUISH_CONSTANT * (T)2.0);
-    contr_m[3] = pow2(dx3) + pow2(dy3) + pow2(dz3);
-    contr_ext[3] = extrapolate(xsb + 1, ysb + 1, zsb, dx3, dy3, dz3);
+    setVertex(v, 3, lane, xsb + 1, ysb + 1, zsb, dx3, dy3, dz3);
 
     // Contribution (1,0,1)
     T dx2 = dx3;
     T dy2 = dy0 - (SQUISH_CONSTANT * (T)2.0);
     T dz2 = dz0 - (T)1.0 - (SQUISH_CONSTANT * (T)2.0);
-    contr_m[2] = pow2(dx2) + pow2(dy2) + pow2(dz2);
-    contr_ext[2] = extrapolate(xsb + 1, ysb, zsb + 1, dx2, dy2, dz2);
+    setVertex(v, 2, lane, xsb + 1, ysb, zsb + 1, dx2, dy2, dz2);
 
     // Contribution (0,1,1)
     {
       T dx1 = dx0 - (SQUISH_CONSTANT * (T)2.0);
       T dy1 = dy3;
       T dz1 = dz2;
-      contr_m[1] = pow2(dx1) + pow2(dy1) + pow2(dz1);
-      contr_ext[1] = extrapolate(xsb, ysb + 1, zsb + 1, dx1, dy1, dz1);
+      setVertex(v, 1, lane, xsb, ysb + 1, zsb + 1, dx1, dy1, dz1);
     }
 
     // Contribution (1,1,1)
@@ -706,31 +739,76 @@ T OSNoise::eval(const T x, const T y, const T z) const
       dx0 = dx0 - (T)1.0 - (SQUISH_CONSTANT * (T)3.0);
       dy0 = dy0 - (T)1.0 - (SQUISH_CONSTANT * (T)3.0);
       dz0 = dz0 - (T)1.0 - (SQUISH_CONSTANT * (T)3.0);
-      contr_m[0] = pow2(dx0) + pow2(dy0) + pow2(dz0);
-      contr_ext[0] = extrapolate(xsb + 1, ysb + 1, zsb + 1, dx0, dy0, dz0);
+      setVertex(v, 0, lane, xsb + 1, ysb + 1, zsb + 1, dx0, dy0, dz0);
     }
 
-    contr_m[4] = contr_m[5] = contr_m[6] = 0.0;
-    contr_ext[4] = contr_ext[5] = contr_ext[6] = 0.0;
+    setUnusedVertex(v, 4, lane);
+    setUnusedVertex(v, 5, lane);
+    setUnusedVertex(v, 6, lane);
 
   }
 
   // First extra vertex.
-  contr_m[7] = pow2(dx_ext0) + pow2(dy_ext0) + pow2(dz_ext0);
-  contr_ext[7] = extrapolate(xsv_ext0, ysv_ext0, zsv_ext0, dx_ext0, dy_ext0, dz_ext0);
+  setVertex(v, 7, lane, xsv_ext0, ysv_ext0, zsv_ext0, dx_ext0, dy_ext0, dz_ext0);
 
   // Second extra vertex.
-  contr_m[8] = pow2(dx_ext1) + pow2(dy_ext1) + pow2(dz_ext1);
-  contr_ext[8] = extrapolate(xsv_ext1, ysv_ext1, zsv_ext1, dx_ext1, dy_ext1, dz_ext1);
+  setVertex(v, 8, lane, xsv_ext1, ysv_ext1, zsv_ext1, dx_ext1, dy_ext1, dz_ext1);
+
+}
+
+template <typename T>
+T OSNoise::eval(const T x, const T y, const T z) const
+{
+  static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+
+  static const T NORM_CONSTANT = (T)(1.0 / 103.0);
+
+  OSNoise::Vertices<T, 1> v;
+  this->vertices(x, y, z, v, 0);
 
   T value = 0.0;
   for (int i=0; i<9; ++i) {
-    value += pow4(std::max((T)2.0 - contr_m[i], (T)0.0)) * contr_ext[i];
+    value += this->contribution(v.sv[i][0][0], v.sv[i][1][0], v.sv[i][2][0],
+        v.d[i][0][0], v.d[i][1][0], v.d[i][2][0]);
   }
 
   return (value * NORM_CONSTANT);
 }
 
+template <typename T>
+void OSNoise::evalBatch(const T* x, const T* y, const T* z, T* result, const int64_t n) const
+{
+  static_assert(std::is_floating_point<T>::value, "OpenSimplexNoise can only be used with floating-point types");
+
+  static const T NORM_CONSTANT = (T)(1.0 / 103.0);
+
+  OSNoise::Vertices<T, sBatchSize> v;
+  T value[sBatchSize];
+
+  for (int64_t begin = 0; begin < n; begin += sBatchSize) {
+    const int64_t size = std::min(n - begin, sBatchSize);
+
+    // Finding the vertices branches on the region of the lattice cell which
+    // each position lies in, so is performed per position.
+    for (int64_t i = 0; i < size; ++i) {
+      this->vertices(x[begin + i], y[begin + i], z[begin + i], v, i);
+      value[i] = 0.0;
+    }
+
+    // Sum the contributions in the same order as eval
+    for (int j = 0; j < 9; ++j) {
+      for (int64_t i = 0; i < size; ++i) {
+        value[i] += this->contribution(v.sv[j][0][i], v.sv[j][1][i], v.sv[j][2][i],
+            v.d[j][0][i], v.d[j][1][i], v.d[j][2][i]);
+      }
+    }
+
+    for (int64_t i = 0; i < size; ++i) {
+      result[begin + i] = value[i] * NORM_CONSTANT;
+    }
+  }
+}
+
 template double OSNoise::extrapolate(const OSNoise::inttype xsb, const OSNoise::inttype ysb, const OSNoise::inttype zsb,
                                      const double dx, const double dy, const double dz) const;
 template double OSNoise::extrapolate(const OSNoise::inttype xsb, const OSNoise::inttype ysb, const OSNoise::inttype zsb,
@@ -738,5 +816,7 @@ template double OSNoise::extrapolate(const OSNoise::inttype xsb, const OSNoise::
                                      double (&de) [3]) const;
 
 template double OSNoise::eval(const double x, const double y, const double z) const;
+template void OSNoise::evalBatch(const double* x, const double* y, const double* z,
+                                double* result, const int64_t n) const;
 
 } // namespace OSN
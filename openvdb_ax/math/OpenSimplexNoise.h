@@ -57,6 +57,33 @@ namespace OPENVDB_VERSION_NAME {
 namespace ax {
 namespace math {
 
+namespace internal {
+
+// Evaluate NoiseT at n positions. Uses NoiseT::noiseBatch if it exists,
+// otherwise NoiseT::noise is called for each position.
+template <typename NoiseT>
+inline auto noiseBatch(const double* x, const double* y, const double* z,
+    double* result, const int64_t n, int)
+    -> decltype(NoiseT::noiseBatch(x, y, z, result, n), void())
+{
+    NoiseT::noiseBatch(x, y, z, result, n);
+}
+
+template <typename NoiseT>
+inline void noiseBatch(const double* x, const double* y, const double* z,
+    double* result, const int64_t n, long)
+{
+    for (int64_t i = 0; i < n; ++i) {
+        result[i] = NoiseT::noise(x[i], y[i], z[i]);
+    }
+}
+
+}
+
+/// @brief  Compute the curl of three noise potentials with central
+///   differences. All twelve noise samples are evaluated with a single
+///   batched call if NoiseT provides a static noiseBatch method, with the
+///   signature of OSN::OSNoise::evalBatch.
 template <typename NoiseT>
 void curlnoise(double (*out)[3], const double (*in)[3])
 {
@@ -70,20 +97,39 @@ void curlnoise(double (*out)[3], const double (*in)[3])
         { static_cast<float>((*in)[0]) - 512.0f, static_cast<float>((*in)[1]) + 512.0f, static_cast<float>((*in)[2]) - 512.0f }, // z
     };
 
+    // sample positions, as pairs of +/- delta offsets along an axis
+    const float samples[12][3] = {
+        { p[2][0], p[2][1] + delta, p[2][2] }, { p[2][0], p[2][1] - delta, p[2][2] },
+        { p[1][0], p[1][1], p[1][2] + delta }, { p[1][0], p[1][1], p[1][2] - delta },
+        { p[0][0], p[0][1], p[0][2] + delta }, { p[0][0], p[0][1], p[0][2] - delta },
+        { p[2][0] + delta, p[2][1], p[2][2] }, { p[2][0] - delta, p[2][1], p[2][2] },
+        { p[1][0] + delta, p[1][1], p[1][2] }, { p[1][0] - delta, p[1][1], p[1][2] },
+        { p[0][0], p[0][1] + delta, p[0][2] }, { p[0][0], p[0][1] - delta, p[0][2] }
+    };
+
+    double x[12], y[12], z[12], n[12];
+    for (int i = 0; i < 12; ++i) {
+        x[i] = samples[i][0];
+        y[i] = samples[i][1];
+        z[i] = samples[i][2];
+    }
+
+    internal::noiseBatch<NoiseT>(x, y, z, n, 12, 0);
+
     OPENVDB_NO_TYPE_CONVERSION_WARNING_BEGIN
     // Compute curl.x
-    a = (NoiseT::noise(p[2][0], p[2][1] + delta, p[2][2]) - NoiseT::noise(p[2][0], p[2][1] - delta, p[2][2])) / (2.0f * delta);
-    b = (NoiseT::noise(p[1][0], p[1][1], p[1][2] + delta) - NoiseT::noise(p[1][0], p[1][1], p[1][2] - delta)) / (2.0f * delta);
+    a = (n[0] - n[1]) / (2.0f * delta);
+    b = (n[2] - n[3]) / (2.0f * delta);
     (*out)[0] = a - b;
 
     // Compute curl.y
-    a = (NoiseT::noise(p[0][0], p[0][1], p[0][2] + delta) - NoiseT::noise(p[0][0], p[0][1], p[0][2] - delta)) / (2.0f * delta);
-    b = (NoiseT::noise(p[2][0] + delta, p[2][1], p[2][2]) - NoiseT::noise(p[2][0] - delta, p[2][1], p[2][2])) / (2.0f * delta);
+    a = (n[4] - n[5]) / (2.0f * delta);
+    b = (n[6] - n[7]) / (2.0f * delta);
     (*out)[1] = a - b;
 
     // Compute curl.z
-    a = (NoiseT::noise(p[1][0] + delta, p[1][1], p[1][2]) - NoiseT::noise(p[1][0] - delta, p[1][1], p[1][2])) / (2.0f * delta);
-    b = (NoiseT::noise(p[0][0], p[0][1] + delta, p[0][2]) - NoiseT::noise(p[0][0], p[0][1] - delta, p[0][2])) / (2.0f * delta);
+    a = (n[8] - n[9]) / (2.0f * delta);
+    b = (n[10] - n[11]) / (2.0f * delta);
     (*out)[2] = a - b;
     OPENVDB_NO_TYPE_CONVERSION_WARNING_END
 }
@@ -144,8 +190,41 @@ public:
     template <typename T>
     T eval(const T x, const T y, const T z) const;
 
+    // Evaluate the noise at n positions. Positions are processed in blocks;
+    // the lattice vertices of each position are found first, after which the
+    // contributions of all positions in a block are evaluated together. This
+    // allows the compiler to vectorize the contributions and gather the
+    // gradient table lookups. Results are identical to eval.
+    template <typename T>
+    void evalBatch(const T* x, const T* y, const T* z, T* result, const int64_t n) const;
+
 private:
 
+    // The lattice vertices which may contribute to the noise at N positions
+    // and the positions relative to each of them, stored per vertex and
+    // component so that lanes are contiguous. Only the lowest byte of each
+    // lattice coordinate is stored.
+    template <typename T, int64_t N>
+    struct Vertices
+    {
+        int sv[9][3][N];
+        T d[9][3][N];
+    };
+
+    // Find the vertices of a position and store them in the given lane
+    template <typename T, int64_t N>
+    inline void vertices(const T x, const T y, const T z,
+                         Vertices<T, N>& v, const int64_t lane) const;
+
+    // The contribution of a single lattice vertex
+    template <typename T>
+    inline T contribution(const int xsv,
+                          const int ysv,
+                          const int zsv,
+                          const T dx,
+                          const T dy,
+                          const T dz) const;
+
     template <typename T>
     inline T extrapolate(const inttype xsb,
                          const inttype ysb,
@@ -0,0 +1,178 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include <openvdb_ax/ast/Arena.h>
+#include <openvdb_ax/ast/AST.h>
+#include <openvdb_ax/ast/Parse.h>
+#include <openvdb_ax/ast/PrintTree.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace openvdb::ax::ast;
+using namespace openvdb::ax::ast::tokens;
+
+class TestArena : public CppUnit::TestCase
+{
+public:
+
+    CPPUNIT_TEST_SUITE(TestArena);
+    CPPUNIT_TEST(testScope);
+    CPPUNIT_TEST(testAllocation);
+    CPPUNIT_TEST(testTrees);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testScope();
+    void testAllocation();
+    void testTrees();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestArena);
+
+void TestArena::testScope()
+{
+    CPPUNIT_ASSERT(!NodeArena::active());
+
+    NodeArena arena1, arena2;
+    {
+        NodeArena::Scope scope1(arena1);
+        CPPUNIT_ASSERT_EQUAL(&arena1, NodeArena::active());
+        {
+            NodeArena::Scope scope2(arena2);
+            CPPUNIT_ASSERT_EQUAL(&arena2, NodeArena::active());
+        }
+        CPPUNIT_ASSERT_EQUAL(&arena1, NodeArena::active());
+
+        // arenas are only active on the thread which created the scope
+        NodeArena* other = &arena1;
+        std::thread thread([&]() { other = NodeArena::active(); });
+        thread.join();
+        CPPUNIT_ASSERT(!other);
+    }
+    CPPUNIT_ASSERT(!NodeArena::active());
+}
+
+void TestArena::testAllocation()
+{
+    // no active arena, nodes are allocated from the heap
+
+    NodeArena arena(1024);
+    Local::UniquePtr local(new Local("a"));
+    CPPUNIT_ASSERT_EQUAL(size_t(0), arena.chunks());
+
+    std::vector<Node::UniquePtr> nodes;
+    {
+        NodeArena::Scope scope(arena);
+        nodes.emplace_back(new Local("a"));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), arena.chunks());
+
+        // nodes are packed into the same chunk
+        nodes.emplace_back(new Local("b"));
+        CPPUNIT_ASSERT_EQUAL(size_t(1), arena.chunks());
+        CPPUNIT_ASSERT(reinterpret_cast<const char*>(nodes[1].get()) >
+            reinterpret_cast<const char*>(nodes[0].get()));
+        CPPUNIT_ASSERT(reinterpret_cast<const char*>(nodes[1].get()) -
+            reinterpret_cast<const char*>(nodes[0].get()) < 1024);
+
+        // allocates more chunks as required
+        for (size_t i = 0; i < 100; ++i) {
+            nodes.emplace_back(new Local("c"));
+        }
+        CPPUNIT_ASSERT(arena.chunks() > 1);
+    }
+
+    // no longer active
+
+    const size_t chunks = arena.chunks();
+    local.reset(new Local("d"));
+    CPPUNIT_ASSERT_EQUAL(chunks, arena.chunks());
+
+    // nodes can be destroyed in any order and on any thread
+
+    nodes[1].reset();
+    std::thread thread([&]() {
+        for (size_t i = 0; i < nodes.size(); i += 2) nodes[i].reset();
+    });
+    thread.join();
+    for (auto& node : nodes) node.reset();
+}
+
+void TestArena::testTrees()
+{
+    const std::string code =
+        "int a = 1;"
+        "if (@b > 0) { for (int i = 0; i < 10; ++i) { a += i; } }"
+        "v@c = {a, $d, 1}; string s = \"str\";"
+        "@e = @b ? func(a, 2) : 3.0;";
+
+    // parsed trees are allocated from an arena and must outlive it
+
+    Tree::ConstPtr tree = parse(code.c_str());
+    CPPUNIT_ASSERT(tree);
+    CPPUNIT_ASSERT(!NodeArena::active());
+
+    std::ostringstream expected;
+    print(*tree, true, expected);
+
+    // copies made within an arena are identical to the original
+
+    Tree::UniquePtr copy;
+    {
+        NodeArena arena;
+        NodeArena::Scope scope(arena);
+        copy.reset(tree->copy());
+        CPPUNIT_ASSERT_EQUAL(size_t(1), arena.chunks());
+    }
+
+    std::ostringstream result;
+    print(*copy, true, result);
+    CPPUNIT_ASSERT_EQUAL(expected.str(), result.str());
+
+    // nodes of the copy can be replaced and destroyed individually
+
+    const Node* attrib = copy->child(0)->child(1)->child(0)->child(0);
+    CPPUNIT_ASSERT(attrib);
+    CPPUNIT_ASSERT_EQUAL(Node::AttributeNode, attrib->nodetype());
+    Local::UniquePtr replacement(new Local("b"));
+    CPPUNIT_ASSERT(const_cast<Node*>(attrib)->replace(replacement.get()));
+    CPPUNIT_ASSERT_EQUAL(Node::LocalNode, copy->child(0)->child(1)->child(0)->child(0)->nodetype());
+    replacement.release();
+
+    tree.reset();
+    copy.reset();
+}
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
@@ -32,9 +32,14 @@
 #include <openvdb_ax/ast/Scanners.h>
 #include <openvdb_ax/test/util.h>
 
+#include <openvdb/util/CpuTimer.h>
+
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <algorithm>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 
 using namespace openvdb::ax::ast;
 using namespace openvdb::ax::ast::tokens;
@@ -132,12 +137,20 @@ public:
     CPPUNIT_TEST(testVisitNodeType);
     CPPUNIT_TEST(testFirstLastLocation);
     CPPUNIT_TEST(testAttributeDependencyTokens);
+    CPPUNIT_TEST(testAllAttributeDependencyTokens);
+    CPPUNIT_TEST(testOverwrittenAttributeTokens);
+    CPPUNIT_TEST(testAttributeUsageBlock);
+    CPPUNIT_TEST(testCatalogueFunctionArguments);
     // CPPUNIT_TEST(testVariableDependencies);
     CPPUNIT_TEST_SUITE_END();
 
     void testVisitNodeType();
     void testFirstLastLocation();
     void testAttributeDependencyTokens();
+    void testAllAttributeDependencyTokens();
+    void testOverwrittenAttributeTokens();
+    void testAttributeUsageBlock();
+    void testCatalogueFunctionArguments();
     // void testVariableDependencies();
 };
 
@@ -485,6 +498,331 @@ void TestScanners::testAttributeDependencyTokens()
     CPPUNIT_ASSERT_EQUAL(dependencies[0], std::string("vec3f@v"));
 }
 
+void TestScanners::testAllAttributeDependencyTokens()
+{
+    // The dependencies of all attributes must match the dependencies resolved
+    // for each individual attribute
+
+    auto compare = [](const std::string& code) {
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+
+        std::unordered_map<std::string, std::vector<std::string>> all;
+        attributeDependencyTokens(*tree, all);
+
+        std::vector<std::string> attributes;
+        catalogueAttributeTokens(*tree, &attributes, &attributes, &attributes);
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(ERROR_MSG("Invalid number of attributes", code),
+            attributes.size(), all.size());
+
+        std::string name, type;
+        for (const std::string& token : attributes) {
+            Attribute::nametypeFromToken(token, &name, &type);
+            std::vector<std::string> dependencies;
+            attributeDependencyTokens(*tree, name,
+                tokens::tokenFromTypeString(type), dependencies);
+            CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Missing attribute " + token, code),
+                all.find(token) != all.end());
+            CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Invalid dependencies for " + token, code),
+                dependencies == all.at(token));
+        }
+    };
+
+    for (const auto* codes : { &none, &self, &direct, &directvec, &indirect }) {
+        for (const std::string& code : *codes) compare(code);
+    }
+
+    compare("int a = func(1,@e);"
+        "pow(@d, a);"
+        "mat3f m = 0;"
+        "scale(m, v@v);"
+        "float f1 = 0;"
+        "float f2 = 0;"
+        "float f3 = 0;"
+        "f3 = @f;"
+        "f2 = f3;"
+        "f1 = f2;"
+        "if (@a - @e > f1) {"
+        "    @b = func(m);"
+        "    if (true) {"
+        "        ++@c[0] = a;"
+        "    }"
+        "}");
+
+    compare("for (float a = @a; a < @b; ++a) {"
+        "    @c += a;"
+        "    do { @d = @c * 2; } while (@e -= 1);"
+        "}"
+        "@f = @d > 0 ? @g : (@h = $x);"
+        "while (int i = @i) { if (i) return; @j = i, @k; }");
+
+    compare("do { @a = @b; } while (@c); @b = @a;");
+
+    // Generate large snippets with many interdependent attributes. When
+    // profiling, report how resolving the dependencies of all attributes at
+    // once scales with the size of the snippet
+
+    auto generate = [](const size_t attributes, const size_t statements) {
+        std::ostringstream os;
+        for (size_t i = 0; i < statements; ++i) {
+            const size_t a = (i * 7) % attributes;
+            const size_t b = (i * 13 + 5) % attributes;
+            const size_t c = (i * 31 + 11) % attributes;
+            if (i % 3 == 0) {
+                os << "@a" << a << " = @a" << b << " * 2.0f + @a" << c << ";\n";
+            }
+            else if (i % 3 == 1) {
+                os << "if (@a" << a << " > 0.0f) @a" << b << " += @a" << c << ";\n";
+            }
+            else {
+                os << "{ float l = @a" << a << "; @a" << b << " = l * @a" << c << "; }\n";
+            }
+        }
+        return os.str();
+    };
+
+    {
+        const size_t attributes = 20;
+        const std::string code = generate(attributes, 200);
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+
+        std::unordered_map<std::string, std::vector<std::string>> all;
+        attributeDependencyTokens(*tree, all);
+        CPPUNIT_ASSERT_EQUAL(attributes, all.size());
+
+        for (size_t i = 0; i < attributes; ++i) {
+            const std::string name = "a" + std::to_string(i);
+            std::vector<std::string> dependencies;
+            attributeDependencyTokens(*tree, name, tokens::CoreType::FLOAT, dependencies);
+            CPPUNIT_ASSERT(dependencies == all.at("float@" + name));
+        }
+    }
+
+#ifdef PROFILE
+    struct Timer : public openvdb::util::CpuTimer {} timer;
+
+    for (const size_t statements : { 1000, 5000, 20000 }) {
+        const size_t attributes = 200;
+        const std::string code = generate(attributes, statements);
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+
+        timer.start("\nAttribute dependencies (" + std::to_string(attributes) +
+            " attributes, " + std::to_string(statements) + " statements)");
+        std::unordered_map<std::string, std::vector<std::string>> all;
+        attributeDependencyTokens(*tree, all);
+        timer.stop();
+        CPPUNIT_ASSERT_EQUAL(attributes, all.size());
+
+        // resolving attributes individually scales with the number of attributes
+        // and super linearly with the size of the tree, so only time one on
+        // the smaller snippets
+        if (statements > 5000) continue;
+        timer.start("Attribute dependencies (single attribute resolved individually)");
+        std::vector<std::string> dependencies;
+        attributeDependencyTokens(*tree, "a0", tokens::CoreType::FLOAT, dependencies);
+        timer.stop();
+        CPPUNIT_ASSERT(dependencies == all.at("float@a0"));
+    }
+#endif
+}
+
+void TestScanners::testOverwrittenAttributeTokens()
+{
+    // @a is assigned before any other use
+    const std::vector<std::string> overwritten = {
+        "@a = 1;",
+        "@a = @b;",
+        "@a = 1; @a += 1;",
+        "@a = 1; @b += @a;",
+        "int i = @b; @a = i;",
+        "@a = 1; if (@b) return;",
+        "@a = 1; return;",
+        "@a = 1; @a = @a * 2;",
+    };
+
+    // the initial value of @a may be used
+    const std::vector<std::string> live = {
+        "@a;",
+        "@a += 1;",
+        "++@a;",
+        "@a = @a + 1;",
+        "@b = @a; @a = 1;",
+        "if (true) @a = 1;",
+        "if (@b) return; @a = 1;",
+        "return; @a = 1;",
+        "for (;;) @a = 1;",
+        "{ @a = 1; }",
+        "@a = 1, @b = 1;",
+        "vec3f@a.x = 1;",
+        "vec3f@a[0] = 1;",
+        "@b = @a = 1;",
+        "foo(@a); @a = 1;",
+    };
+
+    for (const std::string& code : overwritten) {
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+        std::vector<std::string> tokens;
+        overwrittenAttributeTokens(*tree, tokens);
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(ERROR_MSG("Expected 1 token", code),
+            size_t(1), tokens.size());
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(ERROR_MSG("Invalid overwritten token", code),
+            std::string("float@a"), tokens.front());
+    }
+
+    for (const std::string& code : live) {
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+        std::vector<std::string> tokens;
+        overwrittenAttributeTokens(*tree, tokens);
+        CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Expected 0 tokens", code),
+            std::find(tokens.begin(), tokens.end(), "float@a") == tokens.end() &&
+            std::find(tokens.begin(), tokens.end(), "vec3f@a") == tokens.end());
+    }
+
+    // multiple attributes
+
+    const Tree::ConstPtr tree = parse("@a = 1; @b = @c; if (@d) @d = 1; @d = 2; @c = 3;");
+    CPPUNIT_ASSERT(tree);
+    std::vector<std::string> tokens;
+    overwrittenAttributeTokens(*tree, tokens);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), tokens.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("float@a"), tokens[0]);
+    CPPUNIT_ASSERT_EQUAL(std::string("float@b"), tokens[1]);
+}
+
+void TestScanners::testAttributeUsageBlock()
+{
+    // unused
+
+    Tree::ConstPtr tree = parse("@b = 1;");
+    CPPUNIT_ASSERT(tree);
+    CPPUNIT_ASSERT(!attributeUsageBlock(*tree, "float@a"));
+
+    // uses which require the top level block
+
+    const std::vector<std::string> root = {
+        "@a;",
+        "if (@a) @b = 1;",
+        "if (@b) @b = @a; @b = @a;",
+        "if (@b) @b = @a; else @b = @a;",
+        "while (@b) { if (@c) @b = @a; }",
+        "for (int i = 0; i < 3; ++i) @b += @a;",
+        "@b = @c ? @a : 1;",
+    };
+
+    for (const std::string& code : root) {
+        tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+        CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Expected the top level block", code),
+            attributeUsageBlock(*tree, "float@a") == tree->child(0));
+    }
+
+    // uses within a single branch
+
+    const std::vector<std::string> branch = {
+        "if (@b) @b = @a;",
+        "if (@b) { @b = @a; @c = @a; }",
+        "if (@b) { if (@c) @b = @a; else @c = @a; }",
+        "if (@b) { while (@c) @b += @a; }",
+        "if (@b) { @b = @c ? @a : 1; }",
+    };
+
+    for (const std::string& code : branch) {
+        tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+        const ConditionalStatement* cond =
+            static_cast<const ConditionalStatement*>(tree->child(0)->child(0));
+        CPPUNIT_ASSERT(cond->isType<ConditionalStatement>());
+        CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Expected the true branch", code),
+            attributeUsageBlock(*tree, "float@a") == cond->trueBranch());
+    }
+
+    tree = parse("if (@b) @b = 1; else if (@c) @c = @a;");
+    CPPUNIT_ASSERT(tree);
+    const ConditionalStatement* cond =
+        static_cast<const ConditionalStatement*>(tree->child(0)->child(0));
+    cond = static_cast<const ConditionalStatement*>(cond->falseBranch()->child(0));
+    CPPUNIT_ASSERT(cond->isType<ConditionalStatement>());
+    CPPUNIT_ASSERT(attributeUsageBlock(*tree, "float@a") == cond->trueBranch());
+
+    // the usage blocks of all attributes, found in a single pass
+
+    for (const std::vector<std::string>* codes : { &root, &branch }) {
+        for (const std::string& code : *codes) {
+            tree = parse(code.c_str());
+            CPPUNIT_ASSERT(tree);
+            std::unordered_map<std::string, const Block*> blocks;
+            attributeUsageBlock(*tree, blocks);
+            CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Expected float@a", code),
+                blocks.find("float@a") != blocks.end());
+            for (const auto& iter : blocks) {
+                CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Mismatching usage block for " +
+                    iter.first, code), iter.second == attributeUsageBlock(*tree, iter.first));
+            }
+        }
+    }
+}
+
+void TestScanners::testCatalogueFunctionArguments()
+{
+    // the first argument of "modify" is written to, all others are read
+    const ArgumentWriteQuery query =
+        [](const FunctionCall& call, const size_t i) {
+            return call.name() == "modify" && i == 0;
+        };
+
+    const std::vector<std::string> read = {
+        "length(@a);",
+        "max(@a, 0);",
+        "modify(@b, @a);",
+        "modify(@a + 1);",
+        "modify(-@a);",
+        "modify(float(@a));",
+        "modify({@a, 1, 2});",
+        "modify(length(@a));",
+    };
+
+    const std::vector<std::string> readWrite = {
+        "modify(@a);",
+        "modify(@a, @b);",
+        "modify(@b ? @a : @c);",
+        "modify(@a = 1);",
+        "modify(++@a);",
+    };
+
+    for (const std::string& code : read) {
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+        std::vector<std::string> r, w, rw;
+        catalogueAttributeTokens(*tree, &r, &w, &rw, query);
+        CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Expected @a to be read only", code),
+            std::find(r.begin(), r.end(), "float@a") != r.end());
+    }
+
+    for (const std::string& code : readWrite) {
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT(tree);
+        std::vector<std::string> r, w, rw;
+        catalogueAttributeTokens(*tree, &r, &w, &rw, query);
+        CPPUNIT_ASSERT_MESSAGE(ERROR_MSG("Expected @a to be read and written", code),
+            std::find(rw.begin(), rw.end(), "float@a") != rw.end());
+    }
+
+    // without a query, direct arguments are assumed to be written to
+
+    std::vector<std::string> r, w, rw;
+    Tree::ConstPtr tree = parse("length(@a); max(@b + 1, 0);");
+    CPPUNIT_ASSERT(tree);
+    catalogueAttributeTokens(*tree, &r, &w, &rw);
+    CPPUNIT_ASSERT_EQUAL(size_t(1), r.size());
+    CPPUNIT_ASSERT_EQUAL(size_t(1), rw.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("float@b"), r.front());
+    CPPUNIT_ASSERT_EQUAL(std::string("float@a"), rw.front());
+}
+
 /*
 void TestScanners::testVariableDependencies()
 {
@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2015-2020 DNEG
+//
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
+//
+// Redistributions of source code must retain the above copyright
+// and license notice and the following restrictions and disclaimer.
+//
+// *     Neither the name of DNEG nor the names
+// of its contributors may be used to endorse or promote products derived
+// from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// IN NO EVENT SHALL THE COPYRIGHT HOLDERS' AND CONTRIBUTORS' AGGREGATE
+// LIABILITY FOR ALL CLAIMS REGARDLESS OF THEIR BASIS EXCEED US$250.00.
+//
+///////////////////////////////////////////////////////////////////////////
+
+#include <openvdb_ax/ast/AST.h>
+#include <openvdb_ax/ast/Parse.h>
+#include <openvdb_ax/ast/PrintTree.h>
+#include <openvdb_ax/ast/Serialize.h>
+#include <openvdb_ax/compiler/Logger.h>
+
+#include <openvdb/Exceptions.h>
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef PROFILE
+#include <openvdb/util/CpuTimer.h>
+#include <iostream>
+#endif
+
+using namespace openvdb::ax::ast;
+using namespace openvdb::ax::ast::tokens;
+
+namespace {
+
+// snippets which, between them, produce every node type and every optional
+// child of the AST
+static const std::vector<std::string> sSnippets = {
+    "",
+    "1;",
+    "true; false; 1s; 1; 1l; 1.0f; 1.0; \"string\"; \"\";",
+    "{ int a = 1; { a; } }",
+    "int a, b = 2, c;",
+    "f@a = 1.0f; v@b += 1; i@c -= 1; @d *= 2; s@e = \"str\"; @f /= 3; @g %= 4;",
+    "@a <<= 1; @a >>= 1; @a &= 1; @a ^= 1; @a |= 1;",
+    "$a; i$b; v$c; s$d; mat4d$e;",
+    "a = b + c - d * e / f % g;",
+    "a && b || !c; a == b; a != b; a > b; a < b; a >= b; a <= b;",
+    "a << b >> c & d | e ^ ~f; -a; +a;",
+    "++a; --a; a++; a--;",
+    "a = b ? c : d; a = b ?: d;",
+    "a = int(b); c = float(d); e = bool(f);",
+    "func(); func(a); func(a, b, 1);",
+    "a = {1, 2, 3}; b = {{1, 2}, {3, 4}};",
+    "a[0]; a[0, 1]; @b[1] = 2;",
+    "a, b, c; (a, b);",
+    "if (a) b; if (a) { b; } else c; if (a) b; else if (c) d; else { e; }",
+    "for (int i = 0; i < 10; ++i) { a; } for (;;) {} for (i = 0, j = 1; i < 2; ++i, ++j) { }",
+    "for (int i = 0, j = 1; i < 2;) { continue; }",
+    "while (a) { break; } while (int b = c) {} do { a; } while (b);",
+    "return; if (a) { return; }",
+    "vec3f a = 1; mat3d b; vec4i d; mat4f e; string f = \"\";",
+    "@a = $b + func(@c, {1, 2.0, \"a\"}) ?: @d[1, 2]--;"
+};
+
+/// @brief  Invoke a callback for every node of a pair of structurally
+///   identical trees, in lock step
+void visitTogether(const Node* a, const Node* b,
+    const std::function<void(const Node*, const Node*)>& op)
+{
+    CPPUNIT_ASSERT_EQUAL(static_cast<bool>(a), static_cast<bool>(b));
+    if (!a) return;
+    op(a, b);
+    CPPUNIT_ASSERT_EQUAL(a->children(), b->children());
+    for (size_t i = 0; i < a->children(); ++i) {
+        visitTogether(a->child(i), b->child(i), op);
+    }
+}
+
+std::string serialized(const Tree& tree, const openvdb::ax::Logger* logger = nullptr)
+{
+    std::ostringstream os(std::ios_base::binary);
+    serialize(tree, os, logger);
+    return os.str();
+}
+
+}
+
+class TestSerialize : public CppUnit::TestCase
+{
+public:
+
+    CPPUNIT_TEST_SUITE(TestSerialize);
+    CPPUNIT_TEST(testRoundTrip);
+    CPPUNIT_TEST(testLocations);
+    CPPUNIT_TEST(testInvalidData);
+    CPPUNIT_TEST_SUITE_END();
+
+    void testRoundTrip();
+    void testLocations();
+    void testInvalidData();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestSerialize);
+
+void TestSerialize::testRoundTrip()
+{
+    for (const std::string& code : sSnippets) {
+        const Tree::ConstPtr tree = parse(code.c_str());
+        CPPUNIT_ASSERT_MESSAGE(code, tree);
+
+        const std::string data = serialized(*tree);
+        const Tree::ConstPtr result = deserialize(data.data(), data.size());
+        CPPUNIT_ASSERT_MESSAGE(code, result);
+
+        std::ostringstream expected, actual;
+        reprint(*tree, expected);
+        reprint(*result, actual);
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(code, expected.str(), actual.str());
+
+        // reprint does not show all node data, i.e. inferred attribute types
+        // and value precision, compare the full trees as well
+
+        expected.str(""); actual.str("");
+        print(*tree, true, expected);
+        print(*result, true, actual);
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(code, expected.str(), actual.str());
+
+        visitTogether(tree.get(), result.get(), [&](const Node* a, const Node* b) {
+            CPPUNIT_ASSERT_EQUAL_MESSAGE(code, a->nodetype(), b->nodetype());
+            if (a->isType<Attribute>()) {
+                CPPUNIT_ASSERT_EQUAL_MESSAGE(code,
+                    static_cast<const Attribute*>(a)->inferred(),
+                    static_cast<const Attribute*>(b)->inferred());
+            }
+            if (b->parent()) {
+                CPPUNIT_ASSERT_EQUAL_MESSAGE(code, b, b->parent()->child(b->childidx()));
+            }
+        });
+
+        // serialized data is deterministic
+
+        CPPUNIT_ASSERT_EQUAL_MESSAGE(code, data, serialized(*result));
+    }
+
+    // trees which were not parsed can be serialized
+
+    Tree tree(new Block(new DeclareLocal(CoreType::INT32, new Local("a"),
+        new Value<int32_t>(std::numeric_limits<uint64_t>::max()))));
+    const std::string data = serialized(tree);
+    const Tree::ConstPtr result = deserialize(data.data(), data.size());
+    const Node* value = result->child(0)->child(0)->child(1);
+    CPPUNIT_ASSERT(value);
+    CPPUNIT_ASSERT_EQUAL(Node::ValueInt32Node, value->nodetype());
+    CPPUNIT_ASSERT_EQUAL(std::numeric_limits<uint64_t>::max(),
+        static_cast<const Value<int32_t>*>(value)->asContainerType());
+
+#ifdef PROFILE
+    std::string code;
+    for (size_t i = 0; i < 1000; ++i) {
+        for (const std::string& snippet : sSnippets) code += snippet;
+    }
+
+    struct Timer : public openvdb::util::CpuTimer {} timer;
+
+    openvdb::ax::Logger logger;
+    timer.start("parse");
+    const Tree::ConstPtr large = parse(code.c_str(), logger);
+    timer.stop();
+
+    const std::string largeData = serialized(*large, &logger);
+    std::cerr << "serialized " << code.size() << " bytes of code into "
+        << largeData.size() << " bytes" << std::endl;
+
+    openvdb::ax::Logger other;
+    timer.start("deserialize");
+    const Tree::ConstPtr loaded = deserialize(largeData.data(), largeData.size(), other);
+    timer.stop();
+#endif
+}
+
+void TestSerialize::testLocations()
+{
+    const std::string code =
+        "int a = 1;\n"
+        "if (@b > 0) {\n"
+        "    for (int i = 0; i < 10; ++i) { a += i; }\n"
+        "}\n"
+        "v@c = {a, $d, 1};   string s = \"str\";\n"
+        "@e = @b ? func(a, 2) : 3.0;";
+
+    openvdb::ax::Logger logger;
+    const Tree::ConstPtr tree = parse(code.c_str(), logger);
+    CPPUNIT_ASSERT(tree);
+
+    // locations are only serialized when a logger is provided
+
+    const std::string data = serialized(*tree, &logger);
+    CPPUNIT_ASSERT(serialized(*tree).size() < data.size());
+
+    openvdb::ax::Logger result;
+    const Tree::ConstPtr loaded = deserialize(data.data(), data.size(), result);
+    CPPUNIT_ASSERT(loaded);
+
+    size_t located = 0;
+    visitTogether(tree.get(), loaded.get(), [&](const Node* a, const Node* b) {
+        const auto location = logger.getNodeLocation(a);
+        CPPUNIT_ASSERT(location == result.getNodeLocation(b));
+        if (location.first > 0) ++located;
+    });
+    CPPUNIT_ASSERT(located > 0);
+
+    // locations also resolve for copies of the deserialized tree
+
+    const Tree::UniquePtr copy(loaded->copy());
+    visitTogether(tree.get(), copy.get(), [&](const Node* a, const Node* b) {
+        CPPUNIT_ASSERT(logger.getNodeLocation(a) == result.getNodeLocation(b));
+    });
+
+    // errors reported against deserialized nodes include their location
+
+    std::string message;
+    openvdb::ax::Logger errors([&](const std::string& msg) { message = msg; });
+    const Tree::ConstPtr withErrors = deserialize(data.data(), data.size(), errors);
+    const Node* attrib = withErrors->child(0)->child(1)->child(0)->child(0);
+    CPPUNIT_ASSERT_EQUAL(Node::AttributeNode, attrib->nodetype());
+    errors.error("test", attrib);
+    CPPUNIT_ASSERT(message.find("2:5") != std::string::npos);
+
+    // trees without locations resolve to 0:0
+
+    const std::string noLocations = serialized(*tree);
+    openvdb::ax::Logger none;
+    const Tree::ConstPtr unlocated = deserialize(noLocations.data(), noLocations.size(), none);
+    visitTogether(unlocated.get(), unlocated.get(), [&](const Node* a, const Node*) {
+        CPPUNIT_ASSERT(none.getNodeLocation(a) == openvdb::ax::Logger::CodeLocation(0, 0));
+    });
+}
+
+void TestSerialize::testInvalidData()
+{
+    const Tree::ConstPtr tree =
+        parse("int a = 1; if (@b > a) { @c = func(a, \"str\"); }");
+    const std::string data = serialized(*tree);
+
+    // empty or non AST data
+
+    CPPUNIT_ASSERT_THROW(deserialize(nullptr, 0), openvdb::IoError);
+    CPPUNIT_ASSERT_THROW(deserialize("AX", 2), openvdb::IoError);
+    const std::string text = "int a = 1;";
+    CPPUNIT_ASSERT_THROW(deserialize(text.data(), text.size()), openvdb::IoError);
+
+    // mismatching version
+
+    std::string version = data;
+    const uint32_t next = SerializeVersion + 1;
+    std::memcpy(&version[4], &next, sizeof(uint32_t));
+    CPPUNIT_ASSERT_THROW(deserialize(version.data(), version.size()), openvdb::IoError);
+
+    // truncated and trailing data
+
+    for (size_t i = 0; i < data.size(); ++i) {
+        CPPUNIT_ASSERT_THROW(deserialize(data.data(), i), openvdb::IoError);
+    }
+    const std::string trailing = data + '\0';
+    CPPUNIT_ASSERT_THROW(deserialize(trailing.data(), trailing.size()), openvdb::IoError);
+
+    // corrupt data either throws or produces a valid tree
+
+    for (size_t i = 20; i < data.size(); ++i) {
+        std::string corrupt = data;
+        corrupt[i] = static_cast<char>(corrupt[i] ^ 0x5A);
+        try {
+            const Tree::ConstPtr result = deserialize(corrupt.data(), corrupt.size());
+            CPPUNIT_ASSERT(result);
+        }
+        catch (const openvdb::IoError&) {}
+    }
+
+    // trees up to the maximum depth round trip, deeper trees are rejected
+    // when written rather than overflowing the stack when read. The tree and
+    // block add two levels and the value a third
+
+    Expression* expression = new Value<int32_t>(1);
+    for (uint32_t i = 0; i < MaxSerializedDepth - 3; ++i) {
+        expression = new UnaryOperator(expression, OperatorToken::MINUS);
+    }
+    const Tree limit(new Block(expression->copy()));
+    const std::string limitData = serialized(limit);
+    const Tree::ConstPtr limitRead = deserialize(limitData.data(), limitData.size());
+    CPPUNIT_ASSERT(limitRead);
+    CPPUNIT_ASSERT_EQUAL(limitData, serialized(*limitRead));
+
+    expression = new UnaryOperator(expression, OperatorToken::MINUS);
+    const Tree deep(new Block(expression));
+    std::ostringstream deepData(std::ios_base::binary);
+    CPPUNIT_ASSERT_THROW(serialize(deep, deepData), openvdb::IoError);
+}
+
+// Copyright (c) 2015-2020 DNEG
+// All rights reserved. This software is distributed under the
+// Mozilla Public License 2.0 ( http://www.mozilla.org/MPL/2.0/ )
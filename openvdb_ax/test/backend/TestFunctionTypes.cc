@@ -153,6 +153,8 @@ public:
     CPPUNIT_TEST(testFunctionCall);
     // Test Function::match
     CPPUNIT_TEST(testFunctionMatch);
+    // Test Function::writesToArgument
+    CPPUNIT_TEST(testFunctionWritesToArgument);
     // Test derived CFunctions, mainly CFunction::create and CFunction::types
     CPPUNIT_TEST(testCFunctions);
     // Test C constant folding
@@ -169,6 +171,7 @@ public:
     void testFunctionCreate();
     void testFunctionCall();
     void testFunctionMatch();
+    void testFunctionWritesToArgument();
     void testCFunctions();
     void testCFunctionCF();
     void testIRFunctions();
@@ -1988,6 +1991,52 @@ TestFunctionTypes::testIRFunctions()
     CPPUNIT_ASSERT_EQUAL(&(BaseFunction->getEntryBlock()), B.GetInsertBlock());
 }
 
+void
+TestFunctionTypes::testFunctionWritesToArgument()
+{
+    using openvdb::ax::codegen::Function;
+    using openvdb::ax::codegen::CFunctionSRet;
+
+    unittest_util::LLVMState state;
+    llvm::LLVMContext& C = state.context();
+
+    llvm::Type* vec3f = llvm::ArrayType::get(llvm::Type::getFloatTy(C), 3);
+    llvm::Type* f32 = llvm::Type::getFloatTy(C);
+
+    // scalars are passed by value, pointers may be written to
+
+    Function::Ptr test(new TestFunction({f32, vec3f->getPointerTo(), vec3f->getPointerTo()},
+        llvm::Type::getVoidTy(C), "ax.test"));
+    CPPUNIT_ASSERT(!test->writesToArgument(0, C));
+    CPPUNIT_ASSERT(test->writesToArgument(1, C));
+    CPPUNIT_ASSERT(test->writesToArgument(2, C));
+    CPPUNIT_ASSERT(!test->writesToArgument(3, C));
+
+    test->setParamAttributes(1, {llvm::Attribute::ReadOnly});
+    CPPUNIT_ASSERT(!test->writesToArgument(1, C));
+    CPPUNIT_ASSERT(test->writesToArgument(2, C));
+
+    test->setParamAttributes(2, {llvm::Attribute::NoAlias});
+    CPPUNIT_ASSERT(test->writesToArgument(2, C));
+
+    test->setFnAttributes({llvm::Attribute::ReadOnly});
+    CPPUNIT_ASSERT(!test->writesToArgument(2, C));
+    test->setFnAttributes({llvm::Attribute::ReadNone});
+    CPPUNIT_ASSERT(!test->writesToArgument(2, C));
+
+    // SRET arguments are not part of the AX signature
+
+    static auto csret = [](float(*)[3], float(*)[3]) {};
+    test.reset(new CFunctionSRet<void(float(*)[3], float(*)[3])>
+        ("ax.c.test", (void(*)(float(*)[3], float(*)[3]))(csret)));
+    CPPUNIT_ASSERT(test->writesToArgument(0, C));
+    CPPUNIT_ASSERT(!test->writesToArgument(1, C));
+
+    test->setParamAttributes(0, {llvm::Attribute::WriteOnly});
+    test->setParamAttributes(1, {llvm::Attribute::ReadOnly});
+    CPPUNIT_ASSERT(!test->writesToArgument(0, C));
+}
+
 void
 TestFunctionTypes::testSRETFunctions()
 {
@@ -30,6 +30,7 @@
 
 #include <openvdb_ax/compiler/Compiler.h>
 #include <openvdb_ax/compiler/PointExecutable.h>
+#include <openvdb_ax/compiler/VolumeExecutable.h>
 
 #include <openvdb/points/PointDataGrid.h>
 #include <openvdb/points/PointConversion.h>
@@ -40,6 +41,10 @@
 
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
 class TestPointExecutable : public CppUnit::TestCase
 {
 public:
@@ -48,12 +53,30 @@ public:
     CPPUNIT_TEST(testConstructionDestruction);
     CPPUNIT_TEST(testCreateMissingAttributes);
     CPPUNIT_TEST(testGroupExecution);
+    CPPUNIT_TEST(testSpatialOrdering);
+    CPPUNIT_TEST(testAttributeLayouts);
+    CPPUNIT_TEST(testExternalLookups);
+    CPPUNIT_TEST(testObjectBundle);
+    CPPUNIT_TEST(testSnippetFusion);
+    CPPUNIT_TEST(testReductions);
+    CPPUNIT_TEST(testNeighbourQueries);
+    CPPUNIT_TEST(testVolumeSampling);
+    CPPUNIT_TEST(testRasterization);
     CPPUNIT_TEST(testCompilerCases);
     CPPUNIT_TEST_SUITE_END();
 
     void testConstructionDestruction();
     void testCreateMissingAttributes();
     void testGroupExecution();
+    void testSpatialOrdering();
+    void testAttributeLayouts();
+    void testExternalLookups();
+    void testObjectBundle();
+    void testSnippetFusion();
+    void testReductions();
+    void testNeighbourQueries();
+    void testVolumeSampling();
+    void testRasterization();
     void testCompilerCases();
 };
 
@@ -212,6 +235,656 @@ TestPointExecutable::testGroupExecution()
     checkValues(1);
 }
 
+void
+TestPointExecutable::testSpatialOrdering()
+{
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(0.1);
+
+    // a single point in each of many leaf nodes, spanning negative and
+    // positive coordinates
+    std::vector<openvdb::Vec3d> positions;
+    for (int i = -4; i <= 4; ++i) {
+        for (int j = -4; j <= 4; ++j) {
+            for (int k = -4; k <= 4; ++k) {
+                positions.emplace_back(double(i), double(j), double(k));
+            }
+        }
+    }
+
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index32(positions.size()), grid->tree().leafCount());
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>
+            ("@a = @P.x + @P.y + @P.z; if (@a > 0.0f) addtogroup(\"positive\");");
+    CPPUNIT_ASSERT(executable);
+
+    CPPUNIT_ASSERT(!executable->getSpatialOrdering());
+    executable->setSpatialOrdering(true);
+    CPPUNIT_ASSERT(executable->getSpatialOrdering());
+    executable->execute(*grid);
+
+    // check that the results, including the per leaf group data, were
+    // applied to the correct leaf nodes
+
+    auto leafIter = grid->tree().cbeginLeaf();
+    CPPUNIT_ASSERT(leafIter);
+    const auto& descriptor = leafIter->attributeSet().descriptor();
+    const size_t aIdx = descriptor.find("a");
+    CPPUNIT_ASSERT(aIdx != openvdb::points::AttributeSet::INVALID_POS);
+    CPPUNIT_ASSERT(descriptor.hasGroup("positive"));
+
+    for (; leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<float> handle(leafIter->constAttributeArray(aIdx));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> pHandle(leafIter->constAttributeArray("P"));
+        openvdb::points::GroupHandle group = leafIter->groupHandle("positive");
+        CPPUNIT_ASSERT(handle.size() == 1);
+
+        const openvdb::Vec3d pos = defaultTransform->indexToWorld(
+            pHandle.get(0) + leafIter->beginIndexOn().getCoord().asVec3s());
+        const float expected = float(pos.x() + pos.y() + pos.z());
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, handle.get(0), 1e-4f);
+        CPPUNIT_ASSERT_EQUAL(expected > 0.0f, group.get(0));
+    }
+}
+
+void
+TestPointExecutable::testAttributeLayouts()
+{
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+
+    // several points in a single leaf node
+    std::vector<openvdb::Vec3d> positions;
+    for (int i = 0; i < 4; ++i) positions.emplace_back(double(i), 0.0, 0.0);
+
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index32(1), grid->tree().leafCount());
+
+    // attributes which are accessed directly (uncompressed, uniform and
+    // strided) and through their handles (compressed)
+    openvdb::points::appendAttribute<float>(grid->tree(), "a", 1.0f);
+    openvdb::points::appendAttribute<float, openvdb::points::TruncateCodec>
+        (grid->tree(), "h", 2.0f);
+    openvdb::points::appendAttribute<openvdb::Vec3f>(grid->tree(), "v");
+    openvdb::points::appendAttribute<int>(grid->tree(), "s", 0, /*stride*/2);
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>
+            ("@b = @a + @h; @h = @a * 3.0f; v@v += @a; i@s += 1;");
+    CPPUNIT_ASSERT(executable);
+    executable->execute(*grid);
+
+    auto leafIter = grid->tree().cbeginLeaf();
+    CPPUNIT_ASSERT(leafIter);
+
+    // "a" is only read so should remain uniform
+    CPPUNIT_ASSERT(leafIter->constAttributeArray("a").isUniform());
+
+    openvdb::points::AttributeHandle<float> a(leafIter->constAttributeArray("a"));
+    openvdb::points::AttributeHandle<float> b(leafIter->constAttributeArray("b"));
+    openvdb::points::AttributeHandle<float> h(leafIter->constAttributeArray("h"));
+    openvdb::points::AttributeHandle<openvdb::Vec3f> v(leafIter->constAttributeArray("v"));
+    openvdb::points::AttributeHandle<int> s(leafIter->constAttributeArray("s"));
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index(2), s.stride());
+
+    for (openvdb::Index i = 0; i < openvdb::Index(positions.size()); ++i) {
+        CPPUNIT_ASSERT_EQUAL(1.0f, a.get(i));
+        CPPUNIT_ASSERT_EQUAL(3.0f, b.get(i));
+        CPPUNIT_ASSERT_EQUAL(3.0f, h.get(i));
+        CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f(1.0f), v.get(i));
+        CPPUNIT_ASSERT_EQUAL(1, s.get(i, 0));
+        CPPUNIT_ASSERT_EQUAL(0, s.get(i, 1));
+    }
+}
+
+void
+TestPointExecutable::testExternalLookups()
+{
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+
+    std::vector<openvdb::Vec3d> positions;
+    for (int i = 0; i < 8; ++i) positions.emplace_back(double(i), 0.0, 0.0);
+
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+
+    openvdb::ax::CustomData::Ptr data = openvdb::ax::CustomData::create();
+    data->insertData("scale", openvdb::TypedMetadata<float>(2.0f).copy());
+    data->insertData("dir", openvdb::TypedMetadata<openvdb::Vec3f>(openvdb::Vec3f(1,2,3)).copy());
+    // external() returns zero for data of a different type
+    data->insertData("count", openvdb::TypedMetadata<int32_t>(3).copy());
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>
+            ("@a = external(\"scale\") * @P.x + external(\"count\") + external(\"missing\");"
+             "v@v = externalv(\"dir\") * $scale + externalv(\"missingv\");", data);
+    CPPUNIT_ASSERT(executable);
+
+    // lookups of missing data are not rewritten, so are not inserted into
+    // the custom data
+    CPPUNIT_ASSERT(!data->getData("missing"));
+    CPPUNIT_ASSERT(!data->getData("missingv"));
+
+    // values are read at execution time
+    data->insertData("scale", openvdb::TypedMetadata<float>(3.0f).copy());
+    executable->execute(*grid);
+
+    for (auto leafIter = grid->tree().cbeginLeaf(); leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<float> a(leafIter->constAttributeArray("a"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> v(leafIter->constAttributeArray("v"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> p(leafIter->constAttributeArray("P"));
+        for (auto iter = leafIter->beginIndexOn(); iter; ++iter) {
+            const openvdb::Vec3d pos = defaultTransform->indexToWorld(
+                p.get(*iter) + iter.getCoord().asVec3s());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(float(pos.x()) * 3.0f, a.get(*iter), 1e-5f);
+            CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f(3,6,9), v.get(*iter));
+        }
+    }
+
+    CPPUNIT_ASSERT(!data->getData("missing"));
+    CPPUNIT_ASSERT(!data->getData("missingv"));
+}
+
+void
+TestPointExecutable::testObjectBundle()
+{
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+
+    std::vector<openvdb::Vec3d> positions;
+    for (int i = 0; i < 8; ++i) positions.emplace_back(double(i), 0.0, 0.0);
+
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::Logger logger([](const std::string&) {});
+
+    openvdb::ax::ObjectBundle::Ptr bundle =
+        compiler->compileObject<openvdb::ax::PointExecutable>
+            ("@a = @P.x * $scale; v@v = externalv(\"dir\");", logger);
+    CPPUNIT_ASSERT(bundle);
+    CPPUNIT_ASSERT(bundle->type() == openvdb::ax::ObjectBundle::ExecutableType::POINTS);
+
+    std::stringstream stream(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    bundle->write(stream);
+    const openvdb::ax::ObjectBundle::ConstPtr read = openvdb::ax::ObjectBundle::read(stream);
+    CPPUNIT_ASSERT(read);
+    CPPUNIT_ASSERT_EQUAL(bundle->object(), read->object());
+
+    openvdb::ax::CustomData::Ptr data = openvdb::ax::CustomData::create();
+    data->insertData("scale", openvdb::TypedMetadata<float>(2.0f).copy());
+    data->insertData("dir", openvdb::TypedMetadata<openvdb::Vec3f>(openvdb::Vec3f(1,2,3)).copy());
+
+    openvdb::ax::PointExecutable::Ptr executable =
+        openvdb::ax::PointExecutable::load(*read, data);
+    CPPUNIT_ASSERT(executable);
+    executable->execute(*grid);
+
+    for (auto leafIter = grid->tree().cbeginLeaf(); leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<float> a(leafIter->constAttributeArray("a"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> v(leafIter->constAttributeArray("v"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> p(leafIter->constAttributeArray("P"));
+        for (auto iter = leafIter->beginIndexOn(); iter; ++iter) {
+            const openvdb::Vec3d pos = defaultTransform->indexToWorld(
+                p.get(*iter) + iter.getCoord().asVec3s());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(float(pos.x()) * 2.0f, a.get(*iter), 1e-5f);
+            CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f(1,2,3), v.get(*iter));
+        }
+    }
+
+    CPPUNIT_ASSERT_THROW(openvdb::ax::VolumeExecutable::load(*read),
+        openvdb::AXExecutionError);
+
+    // bundles without a syntax tree can't find their neighbour queries and are
+    // rejected. The tree follows the magic, version, type, triple and variants
+    {
+        size_t offset = 9 + sizeof(uint64_t) + read->triple().size() + sizeof(uint64_t);
+        for (const auto& variant : read->variants()) {
+            offset += sizeof(uint64_t) + variant.cpu().size() +
+                sizeof(uint64_t) + variant.features().size() + sizeof(uint64_t);
+            for (const auto& binding : variant.bindings()) {
+                offset += 2 * sizeof(uint64_t) + binding.first.size() + binding.second.size();
+            }
+            offset += sizeof(uint64_t) + variant.object().size();
+        }
+
+        std::string bytes = stream.str();
+        uint64_t size;
+        std::memcpy(&size, bytes.data() + offset, sizeof(uint64_t));
+        const uint64_t empty = 0;
+        bytes.replace(offset, sizeof(uint64_t) + size,
+            reinterpret_cast<const char*>(&empty), sizeof(uint64_t));
+
+        std::stringstream treeless(bytes);
+        const openvdb::ax::ObjectBundle::ConstPtr notree =
+            openvdb::ax::ObjectBundle::read(treeless);
+        CPPUNIT_ASSERT(!notree->tree());
+        CPPUNIT_ASSERT_THROW(openvdb::ax::PointExecutable::load(*notree, data),
+            openvdb::AXExecutionError);
+    }
+}
+
+void
+TestPointExecutable::testSnippetFusion()
+{
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+
+    std::vector<openvdb::Vec3d> positions;
+    for (int i = 0; i < 8; ++i) positions.emplace_back(double(i), 0.0, 0.0);
+
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::Logger logger([](const std::string&) {});
+
+    // each snippet declares its own locals and the return only ends the first
+    const std::vector<openvdb::ax::ast::Tree::ConstPtr> snippets {
+        openvdb::ax::ast::parse("@a = @P.x; if (@P.x > 3) { return; } @b = 1;", logger),
+        openvdb::ax::ast::parse("int i = 2; @c = @a * i; @b += 1;", logger),
+        openvdb::ax::ast::parse("int i = 3; @a = @c + i;", logger)
+    };
+
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>(snippets, logger);
+    CPPUNIT_ASSERT(executable);
+    CPPUNIT_ASSERT(!logger.hasError());
+    executable->execute(*grid);
+
+    for (auto leafIter = grid->tree().cbeginLeaf(); leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<float> a(leafIter->constAttributeArray("a"));
+        openvdb::points::AttributeHandle<float> b(leafIter->constAttributeArray("b"));
+        openvdb::points::AttributeHandle<float> c(leafIter->constAttributeArray("c"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> p(leafIter->constAttributeArray("P"));
+        for (auto iter = leafIter->beginIndexOn(); iter; ++iter) {
+            const float x = float(defaultTransform->indexToWorld(
+                p.get(*iter) + iter.getCoord().asVec3s()).x());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0f * x + 3.0f, a.get(*iter), 1e-5f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(x > 3.0f ? 1.0f : 2.0f, b.get(*iter), 1e-5f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0f * x, c.get(*iter), 1e-5f);
+        }
+    }
+
+    // returns from within loops can only be fused into the last snippet
+    logger.clear();
+    const std::vector<openvdb::ax::ast::Tree::ConstPtr> loops {
+        openvdb::ax::ast::parse("for (int i = 0; i < 2; ++i) { return; }", logger),
+        openvdb::ax::ast::parse("@a = 1;", logger)
+    };
+    CPPUNIT_ASSERT(!compiler->compile<openvdb::ax::PointExecutable>(loops, logger));
+    CPPUNIT_ASSERT(logger.hasError());
+
+    logger.clear();
+    const std::vector<openvdb::ax::ast::Tree::ConstPtr> last { loops[1], loops[0] };
+    CPPUNIT_ASSERT(compiler->compile<openvdb::ax::PointExecutable>(last, logger));
+
+    // points deleted by a snippet are skipped by the snippets after it, as
+    // if they had already been removed
+    logger.clear();
+    const std::vector<openvdb::ax::ast::Tree::ConstPtr> deletes {
+        openvdb::ax::ast::parse("@d = 1.0f; if (@P.x > 3) { deletepoint(); @d = 10.0f; }", logger),
+        openvdb::ax::ast::parse("@d += 1.0f;", logger)
+    };
+    executable = compiler->compile<openvdb::ax::PointExecutable>(deletes, logger);
+    CPPUNIT_ASSERT(executable);
+    CPPUNIT_ASSERT(!logger.hasError());
+
+    grid = openvdb::points::createPointDataGrid
+        <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+            (positions, *defaultTransform);
+    executable->execute(*grid);
+
+    for (auto leafIter = grid->tree().cbeginLeaf(); leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<float> d(leafIter->constAttributeArray("d"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> p(leafIter->constAttributeArray("P"));
+        openvdb::points::GroupHandle dead = leafIter->groupHandle("dead");
+        for (auto iter = leafIter->beginIndexOn(); iter; ++iter) {
+            const float x = float(defaultTransform->indexToWorld(
+                p.get(*iter) + iter.getCoord().asVec3s()).x());
+            CPPUNIT_ASSERT_EQUAL(x > 3.0f, dead.get(*iter));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(x > 3.0f ? 10.0f : 2.0f, d.get(*iter), 1e-5f);
+        }
+    }
+
+    // neighbour queries only see values from before execution, so can't
+    // query attributes or positions written by an earlier snippet
+    logger.clear();
+    const std::vector<openvdb::ax::ast::Tree::ConstPtr> queries {
+        openvdb::ax::ast::parse("@w = 1.0f;", logger),
+        openvdb::ax::ast::parse("@P.x += 1.0f;", logger),
+        openvdb::ax::ast::parse("@avg = nearpointaverage(\"w\", @P, 1.5f);", logger),
+        openvdb::ax::ast::parse("i@count = nearpointcount(@P, 1.5f);", logger),
+        openvdb::ax::ast::parse("@avg = nearpointaverage(\"a\", @P, 1.5f);", logger)
+    };
+    for (const auto& chain : {
+            std::vector<openvdb::ax::ast::Tree::ConstPtr> { queries[0], queries[2] },
+            std::vector<openvdb::ax::ast::Tree::ConstPtr> { queries[1], queries[3] },
+            std::vector<openvdb::ax::ast::Tree::ConstPtr> { queries[1], queries[4] } }) {
+        logger.clear();
+        CPPUNIT_ASSERT(!compiler->compile<openvdb::ax::PointExecutable>(chain, logger));
+        CPPUNIT_ASSERT(logger.hasError());
+    }
+
+    // queries of attributes which are only written by later snippets, or by
+    // the querying snippet itself, are the same as sequential execution
+    for (const auto& chain : {
+            std::vector<openvdb::ax::ast::Tree::ConstPtr> { queries[0], queries[4] },
+            std::vector<openvdb::ax::ast::Tree::ConstPtr> { queries[2], queries[0] },
+            std::vector<openvdb::ax::ast::Tree::ConstPtr> { queries[3], queries[1] } }) {
+        logger.clear();
+        CPPUNIT_ASSERT(compiler->compile<openvdb::ax::PointExecutable>(chain, logger));
+        CPPUNIT_ASSERT(!logger.hasError());
+    }
+
+    CPPUNIT_ASSERT_THROW(compiler->compile<openvdb::ax::VolumeExecutable>
+        (snippets, logger), openvdb::AXCompilerError);
+}
+
+void
+TestPointExecutable::testReductions()
+{
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+
+    // spread the points over multiple leaf nodes to exercise multiple threads
+    std::vector<openvdb::Vec3d> positions;
+    for (int i = 0; i < 64; ++i) positions.emplace_back(double(i), double(-i), 0.0);
+
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::Logger logger([](const std::string&) {});
+    openvdb::ax::CustomData::Ptr data = openvdb::ax::CustomData::create();
+
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>(
+            "reduceadd(\"count\", 1);"
+            "reduceadd(\"sum\", @P.x);"
+            "reducemin(\"min\", @P);"
+            "reducemax(\"max\", @P);", logger, data);
+    CPPUNIT_ASSERT(executable);
+    executable->execute(*grid);
+
+    auto count = data->getData<openvdb::TypedMetadata<int32_t>>("count");
+    auto sum = data->getData<openvdb::TypedMetadata<float>>("sum");
+    auto min = data->getData<openvdb::TypedMetadata<openvdb::Vec3f>>("min");
+    auto max = data->getData<openvdb::TypedMetadata<openvdb::Vec3f>>("max");
+    CPPUNIT_ASSERT(count && sum && min && max);
+    CPPUNIT_ASSERT_EQUAL(64, count->value());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2016.0f, sum->value(), 1e-3f);
+    CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f(0.0f, -63.0f, 0.0f), min->value());
+    CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f(63.0f, 0.0f, 0.0f), max->value());
+
+    // results accumulate into existing data across executions
+    executable->execute(*grid);
+    count = data->getData<openvdb::TypedMetadata<int32_t>>("count");
+    CPPUNIT_ASSERT_EQUAL(128, count->value());
+
+    // existing data of a different type can not be reduced into
+    data->insertData("mismatch", openvdb::TypedMetadata<float>(0.0f).copy());
+    executable = compiler->compile<openvdb::ax::PointExecutable>
+        ("reduceadd(\"mismatch\", 1);", logger, data);
+    CPPUNIT_ASSERT(executable);
+    CPPUNIT_ASSERT_THROW(executable->execute(*grid), openvdb::AXExecutionError);
+
+    // the same reduction can not be used with different operations
+    executable = compiler->compile<openvdb::ax::PointExecutable>
+        ("reduceadd(\"conflict\", 1); reducemax(\"conflict\", 1);", logger, data);
+    CPPUNIT_ASSERT(executable);
+    CPPUNIT_ASSERT_THROW(executable->execute(*grid), openvdb::AXExecutionError);
+}
+
+void
+TestPointExecutable::testNeighbourQueries()
+{
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+
+    // a line of points spanning multiple leaf nodes, one point per voxel
+    std::vector<openvdb::Vec3d> positions;
+    for (int i = 0; i < 64; ++i) positions.emplace_back(double(i), 0.0, 0.0);
+
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::Logger logger([](const std::string&) {});
+
+    compiler->compile<openvdb::ax::PointExecutable>("@w = @P.x;")->execute(*grid);
+
+    // queries see the values from before execution, regardless of any writes
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>(
+            "i@count = nearpointcount(@P, 1.5f);"
+            "@avg = nearpointaverage(\"w\", @P, 1.5f);"
+            "v@centroid = nearpointaveragev(\"P\", @P, 1.5f);"
+            "@w = 0.0f; @P.x += 100.0f;", logger);
+    CPPUNIT_ASSERT(executable);
+    executable->execute(*grid);
+
+    for (auto leafIter = grid->tree().cbeginLeaf(); leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<int32_t> count(leafIter->constAttributeArray("count"));
+        openvdb::points::AttributeHandle<float> avg(leafIter->constAttributeArray("avg"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f>
+            centroid(leafIter->constAttributeArray("centroid"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> p(leafIter->constAttributeArray("P"));
+        for (auto iter = leafIter->beginIndexOn(); iter; ++iter) {
+            const float x = float(defaultTransform->indexToWorld(
+                p.get(*iter) + iter.getCoord().asVec3s()).x()) - 100.0f;
+            const bool end = (x < 0.5f || x > 62.5f);
+            const float expected = end ? (x < 0.5f ? 0.5f : 62.5f) : x;
+            CPPUNIT_ASSERT_EQUAL(end ? 2 : 3, count.get(*iter));
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected, avg.get(*iter), 1e-4f);
+            CPPUNIT_ASSERT(openvdb::math::isApproxEqual(openvdb::Vec3f(expected, 0.0f, 0.0f),
+                centroid.get(*iter), openvdb::Vec3f(1e-4f)));
+        }
+    }
+
+    // attribute names must be string literals
+    CPPUNIT_ASSERT(!compiler->compile<openvdb::ax::PointExecutable>
+        ("string s = \"w\"; @avg = nearpointaverage(s, @P, 1.0f);", logger));
+    CPPUNIT_ASSERT(logger.hasError());
+
+    // queried attributes must exist
+    executable = compiler->compile<openvdb::ax::PointExecutable>
+        ("@avg = nearpointaverage(\"missing\", @P, 1.0f);", logger);
+    CPPUNIT_ASSERT(executable);
+    CPPUNIT_ASSERT_THROW(executable->execute(*grid), openvdb::AXExecutionError);
+
+    // neighbour queries are only available to points
+    CPPUNIT_ASSERT_THROW(compiler->compile<openvdb::ax::VolumeExecutable>
+        ("@a = nearpointcount(getvoxelpws(), 1.0f);"), openvdb::AXCompilerError);
+}
+
+void
+TestPointExecutable::testVolumeSampling()
+{
+    // a float volume with a voxel size of 0.5 whose values are twice the
+    // world space x coordinate, and a constant vector volume
+    openvdb::FloatGrid::Ptr density = openvdb::FloatGrid::create();
+    density->setName("density");
+    density->setTransform(openvdb::math::Transform::createLinearTransform(0.5));
+    openvdb::FloatGrid::Accessor accessor = density->getAccessor();
+    for (int i = 0; i < 20; ++i) {
+        for (int j = 0; j < 20; ++j) {
+            for (int k = 0; k < 20; ++k) {
+                accessor.setValue(openvdb::Coord(i, j, k), float(i));
+            }
+        }
+    }
+
+    openvdb::Vec3SGrid::Ptr velocity = openvdb::Vec3SGrid::create();
+    velocity->setName("velocity");
+    velocity->fill(openvdb::CoordBBox(openvdb::Coord(0), openvdb::Coord(9)),
+        openvdb::Vec3s(1.0f, 2.0f, 3.0f));
+
+    const openvdb::GridCPtrVec volumes = { density, velocity };
+
+    const std::vector<openvdb::Vec3d> positions = {
+        openvdb::Vec3d(2.3, 1.1, 1.7),
+        openvdb::Vec3d(4.6, 3.2, 2.4),
+        openvdb::Vec3d(6.1, 5.9, 7.3)
+    };
+
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>(
+            "@linear = volumesample(\"density\", @P);"
+            "@quadratic = volumesample(\"density\", @P, 2);"
+            "@nearest = volumesample(\"density\", @P, 0);"
+            "@missing = volumesample(\"missing\", @P);"
+            "v@vel = volumesamplev(\"velocity\", @P);"
+            "v@grad = volumegradient(\"density\", @P);");
+    CPPUNIT_ASSERT(executable);
+    executable->execute(*grid, volumes);
+
+    size_t count = 0;
+    for (auto leafIter = grid->tree().cbeginLeaf(); leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<float> linear(leafIter->constAttributeArray("linear"));
+        openvdb::points::AttributeHandle<float> quadratic(leafIter->constAttributeArray("quadratic"));
+        openvdb::points::AttributeHandle<float> nearest(leafIter->constAttributeArray("nearest"));
+        openvdb::points::AttributeHandle<float> missing(leafIter->constAttributeArray("missing"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> vel(leafIter->constAttributeArray("vel"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> grad(leafIter->constAttributeArray("grad"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> p(leafIter->constAttributeArray("P"));
+        for (auto iter = leafIter->beginIndexOn(); iter; ++iter, ++count) {
+            const float x = float(defaultTransform->indexToWorld(
+                p.get(*iter) + iter.getCoord().asVec3s()).x());
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0f * x, linear.get(*iter), 1e-4f);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0f * x, quadratic.get(*iter), 1e-4f);
+            CPPUNIT_ASSERT_EQUAL(std::floor(2.0f * x + 0.5f), nearest.get(*iter));
+            CPPUNIT_ASSERT_EQUAL(0.0f, missing.get(*iter));
+            CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f(1.0f, 2.0f, 3.0f), vel.get(*iter));
+            CPPUNIT_ASSERT(openvdb::math::isApproxEqual(openvdb::Vec3f(2.0f, 0.0f, 0.0f),
+                grad.get(*iter), openvdb::Vec3f(1e-4f)));
+        }
+    }
+    CPPUNIT_ASSERT_EQUAL(positions.size(), count);
+
+    // without volumes, samples are zero
+    executable->execute(*grid);
+    for (auto leafIter = grid->tree().cbeginLeaf(); leafIter; ++leafIter) {
+        openvdb::points::AttributeHandle<float> linear(leafIter->constAttributeArray("linear"));
+        openvdb::points::AttributeHandle<openvdb::Vec3f> grad(leafIter->constAttributeArray("grad"));
+        for (auto iter = leafIter->beginIndexOn(); iter; ++iter) {
+            CPPUNIT_ASSERT_EQUAL(0.0f, linear.get(*iter));
+            CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f::zero(), grad.get(*iter));
+        }
+    }
+
+    // volume sampling is only available to points
+    CPPUNIT_ASSERT_THROW(compiler->compile<openvdb::ax::VolumeExecutable>
+        ("@a = volumesample(\"density\", getvoxelpws());"), openvdb::AXCompilerError);
+}
+
+void
+TestPointExecutable::testRasterization()
+{
+    const std::vector<openvdb::Vec3d> positions = {
+        openvdb::Vec3d(0.0, 0.0, 0.0),
+        openvdb::Vec3d(5.0, 5.0, 5.0),
+        openvdb::Vec3d(5.0, 5.0, 5.0),
+        openvdb::Vec3d(2.5, 0.0, 0.0)
+    };
+
+    openvdb::math::Transform::Ptr defaultTransform =
+        openvdb::math::Transform::createLinearTransform(1.0);
+    openvdb::points::PointDataGrid::Ptr grid =
+        openvdb::points::createPointDataGrid
+            <openvdb::points::NullCodec, openvdb::points::PointDataGrid>
+                (positions, *defaultTransform);
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::PointExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::PointExecutable>(
+            "rasterize(\"density\", @P, 1.0f);"
+            "vec3f v = {1.0f, 2.0f, 3.0f};"
+            "rasterize(\"vel\", @P, v);");
+    CPPUNIT_ASSERT(executable);
+
+    // without output grids, rasterize has no effect
+    executable->execute(*grid);
+
+    openvdb::GridPtrVec rasterized;
+    executable->execute(*grid, openvdb::GridCPtrVec(), rasterized);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), rasterized.size());
+
+    openvdb::FloatGrid::Ptr density;
+    openvdb::Vec3SGrid::Ptr vel;
+    for (const auto& output : rasterized) {
+        if (output->getName() == "density") density = openvdb::gridPtrCast<openvdb::FloatGrid>(output);
+        if (output->getName() == "vel") vel = openvdb::gridPtrCast<openvdb::Vec3SGrid>(output);
+    }
+    CPPUNIT_ASSERT(density);
+    CPPUNIT_ASSERT(vel);
+    CPPUNIT_ASSERT(density->transform() == *defaultTransform);
+
+    CPPUNIT_ASSERT_EQUAL(1.0f, density->tree().getValue(openvdb::Coord(0, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(2.0f, density->tree().getValue(openvdb::Coord(5, 5, 5)));
+    CPPUNIT_ASSERT_EQUAL(0.5f, density->tree().getValue(openvdb::Coord(2, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(0.5f, density->tree().getValue(openvdb::Coord(3, 0, 0)));
+
+    // only voxels with a non zero weight are activated
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index64(4), density->tree().activeVoxelCount());
+
+    // the values rasterized are conserved
+    float sum = 0.0f;
+    for (auto iter = density->tree().cbeginValueOn(); iter; ++iter) sum += *iter;
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(4.0f, sum, 1e-6f);
+    openvdb::Vec3f vsum(0.0f);
+    for (auto iter = vel->tree().cbeginValueOn(); iter; ++iter) vsum += *iter;
+    CPPUNIT_ASSERT(openvdb::math::isApproxEqual(openvdb::Vec3f(4.0f, 8.0f, 12.0f),
+        vsum, openvdb::Vec3f(1e-6f)));
+
+    // existing grids are accumulated into
+    executable->execute(*grid, openvdb::GridCPtrVec(), rasterized);
+    CPPUNIT_ASSERT_EQUAL(size_t(2), rasterized.size());
+    CPPUNIT_ASSERT_EQUAL(2.0f, density->tree().getValue(openvdb::Coord(0, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(4.0f, density->tree().getValue(openvdb::Coord(5, 5, 5)));
+
+    // existing grids must be of the rasterized type
+    openvdb::GridPtrVec mismatch = { openvdb::FloatGrid::create() };
+    mismatch.front()->setName("vel");
+    CPPUNIT_ASSERT_THROW(executable->execute(*grid, openvdb::GridCPtrVec(), mismatch),
+        openvdb::AXExecutionError);
+
+    // rasterization is only available to points
+    CPPUNIT_ASSERT_THROW(compiler->compile<openvdb::ax::VolumeExecutable>
+        ("rasterize(\"density\", getvoxelpws(), 1.0f);"), openvdb::AXCompilerError);
+}
+
 void
 TestPointExecutable::testCompilerCases()
 {
@@ -28,12 +28,86 @@
 //
 ///////////////////////////////////////////////////////////////////////////
 
+#include <openvdb_ax/codegen/Functions.h>
+#include <openvdb_ax/codegen/FunctionTypes.h>
+#include <openvdb_ax/codegen/VolumeComputeGenerator.h>
 #include <openvdb_ax/compiler/Compiler.h>
+#include <openvdb_ax/compiler/PointExecutable.h>
 #include <openvdb_ax/compiler/VolumeExecutable.h>
+#include <openvdb_ax/math/OpenSimplexNoise.h>
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/Triple.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/Support/Host.h>
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+/// @brief  The CPU features of the host, as reported to the AX compiler
+inline llvm::StringMap<bool> hostFeatures()
+{
+    llvm::StringMap<bool> features;
+    llvm::sys::getHostCPUFeatures(features);
+    return features;
+}
+
+/// @brief  Whether an object bundle still calls the C binding of a function
+inline bool hasBinding(const openvdb::ax::ObjectBundle& bundle, const std::string& name)
+{
+    for (const auto& binding : bundle.bindings()) {
+        if (binding.first == name) return true;
+    }
+    return false;
+}
+
+inline bool hostHasFeature(const std::string& feature)
+{
+    const llvm::StringMap<bool> features = hostFeatures();
+    const auto iter = features.find(feature);
+    return iter != features.end() && iter->second;
+}
+
+inline bool hostIsX86()
+{
+    return llvm::Triple(llvm::sys::getProcessTriple()).getArch() == llvm::Triple::x86_64;
+}
+
+/// @brief  Execute a volume executable over the first 64 voxels along the x
+///   axis of a new FloatGrid for each of the given names. The voxels of the
+///   first grid are set from their x coordinate with the given function and
+///   those of the others are zero. Returns the grids once executed.
+inline std::vector<openvdb::FloatGrid::Ptr>
+executeRow(const openvdb::ax::VolumeExecutable& executable,
+    const std::vector<std::string>& names,
+    const std::function<float(int)>& input)
+{
+    openvdb::GridPtrVec grids;
+    std::vector<openvdb::FloatGrid::Ptr> result;
+    for (const std::string& name : names) {
+        openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create();
+        grid->setName(name);
+        for (int i = 0; i < 64; ++i) {
+            grid->tree().setValueOn(openvdb::Coord(i, 0, 0), result.empty() ? input(i) : 0.0f);
+        }
+        grids.emplace_back(grid);
+        result.emplace_back(grid);
+    }
+    executable.execute(grids);
+    return result;
+}
+
+}
 
 class TestVolumeExecutable : public CppUnit::TestCase
 {
@@ -43,12 +117,30 @@ public:
     CPPUNIT_TEST(testConstructionDestruction);
     CPPUNIT_TEST(testCreateMissingGrids);
     CPPUNIT_TEST(testTreeExecutionLevel);
+    CPPUNIT_TEST(testRefinement);
+    CPPUNIT_TEST(testMultipleGrids);
+    CPPUNIT_TEST(testDeferredReads);
+    CPPUNIT_TEST(testTargetCPU);
+    CPPUNIT_TEST(testFoldCBindings);
+    CPPUNIT_TEST(testFastMath);
+    CPPUNIT_TEST(testVectorLibrary);
+    CPPUNIT_TEST(testObjectBundle);
+    CPPUNIT_TEST(testReductions);
     CPPUNIT_TEST(testCompilerCases);
     CPPUNIT_TEST_SUITE_END();
 
     void testConstructionDestruction();
     void testCreateMissingGrids();
     void testTreeExecutionLevel();
+    void testRefinement();
+    void testMultipleGrids();
+    void testDeferredReads();
+    void testTargetCPU();
+    void testFoldCBindings();
+    void testFastMath();
+    void testVectorLibrary();
+    void testObjectBundle();
+    void testReductions();
     void testCompilerCases();
 };
 
@@ -209,6 +301,724 @@ TestVolumeExecutable::testTreeExecutionLevel()
     CPPUNIT_ASSERT_THROW(executable->setTreeExecutionLevel(4), openvdb::RuntimeError);
 }
 
+void
+TestVolumeExecutable::testRefinement()
+{
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::VolumeExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::VolumeExecutable>
+            ("if (getcoordx() >= 36) @a += 1.0f;");
+    CPPUNIT_ASSERT(executable);
+    executable->setTreeExecutionLevel(1);
+
+    CPPUNIT_ASSERT(!executable->getRefinement());
+    CPPUNIT_ASSERT_EQUAL(0.0, executable->getRefinementThreshold());
+    CPPUNIT_ASSERT_THROW(executable->setRefinementThreshold(-1.0), openvdb::RuntimeError);
+
+    // a block of 8x8x8 tiles, the values of which step from 0 to 1 within
+    // the tiles at x = 32
+    const openvdb::CoordBBox bbox(openvdb::Coord(0), openvdb::Coord(63));
+    auto create = [&bbox]() {
+        openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create();
+        grid->setName("a");
+        grid->tree().fill(bbox, 0.0f, /*active*/true);
+        CPPUNIT_ASSERT_EQUAL(openvdb::Index32(0), grid->tree().leafCount());
+        CPPUNIT_ASSERT_EQUAL(openvdb::Index64(512), grid->tree().activeTileCount());
+        return grid;
+    };
+
+    // without refinement, each tile takes the value of its origin
+    openvdb::FloatGrid::Ptr grid = create();
+    executable->execute(*grid);
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index32(0), grid->tree().leafCount());
+    CPPUNIT_ASSERT_EQUAL(0.0f, grid->tree().getValue(openvdb::Coord(36, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(1.0f, grid->tree().getValue(openvdb::Coord(40, 0, 0)));
+
+    // the tiles at x = 32 and x = 40 vary and are refined to voxels. Refined
+    // tiles are restored before they are executed again
+    executable->setRefinement(true);
+    executable->setRefinementThreshold(0.5);
+    grid = create();
+    executable->execute(*grid);
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index32(2 * 8 * 8), grid->tree().leafCount());
+    CPPUNIT_ASSERT(!grid->tree().probeConstLeaf(openvdb::Coord(24, 0, 0)));
+    CPPUNIT_ASSERT(grid->tree().probeConstLeaf(openvdb::Coord(32, 0, 0)));
+    CPPUNIT_ASSERT(grid->tree().probeConstLeaf(openvdb::Coord(40, 0, 0)));
+    CPPUNIT_ASSERT(!grid->tree().probeConstLeaf(openvdb::Coord(48, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(bbox.volume(), grid->tree().activeVoxelCount());
+    for (auto iter = bbox.begin(); iter; ++iter) {
+        const float expected = (*iter).x() >= 36 ? 1.0f : 0.0f;
+        CPPUNIT_ASSERT_EQUAL(expected, grid->tree().getValue(*iter));
+    }
+
+    // the variation is below the threshold, expect the coarse result
+    executable->setRefinementThreshold(2.0);
+    grid = create();
+    executable->execute(*grid);
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index32(0), grid->tree().leafCount());
+    CPPUNIT_ASSERT_EQUAL(0.0f, grid->tree().getValue(openvdb::Coord(36, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(1.0f, grid->tree().getValue(openvdb::Coord(40, 0, 0)));
+
+    // the variation of vectors is the length of their difference
+    executable = compiler->compile<openvdb::ax::VolumeExecutable>
+        ("if (getcoordx() >= 36) v@v = {3.0f, 4.0f, 0.0f};");
+    CPPUNIT_ASSERT(executable);
+    executable->setTreeExecutionLevel(1);
+    executable->setRefinement(true);
+
+    for (const double threshold : { 4.5, 5.5 }) {
+        executable->setRefinementThreshold(threshold);
+        openvdb::Vec3fGrid vectors;
+        vectors.setName("v");
+        vectors.tree().fill(bbox, openvdb::Vec3f::zero(), /*active*/true);
+        executable->execute(vectors);
+        CPPUNIT_ASSERT_EQUAL(openvdb::Index32(threshold < 5.0 ? 2 * 8 * 8 : 0),
+            vectors.tree().leafCount());
+        CPPUNIT_ASSERT_EQUAL(threshold < 5.0 ? openvdb::Vec3f(3.0f, 4.0f, 0.0f) :
+            openvdb::Vec3f::zero(), vectors.tree().getValue(openvdb::Coord(36, 0, 0)));
+    }
+
+    // values without a measure of variation can't be refined
+    executable = compiler->compile<openvdb::ax::VolumeExecutable>("bool@b = true;");
+    CPPUNIT_ASSERT(executable);
+    executable->setTreeExecutionLevel(1);
+    executable->setRefinement(true);
+
+    openvdb::BoolGrid bools;
+    bools.setName("b");
+    bools.tree().fill(bbox, false, /*active*/true);
+    CPPUNIT_ASSERT_THROW(executable->execute(bools), openvdb::AXExecutionError);
+}
+
+
+void
+TestVolumeExecutable::testMultipleGrids()
+{
+    // Test execution over many writeable grids. Grids which are only written
+    // to are executed concurrently, whilst @self is read and written and is
+    // processed on its own
+
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+
+    std::string code;
+    const size_t count = 24;
+    for (size_t i = 0; i < count; ++i) {
+        code += "f@grid" + std::to_string(i) + " = " + std::to_string(i) + ".0f + @source;\n";
+    }
+    code += "f@self += 1.0f;\n";
+
+    openvdb::ax::VolumeExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::VolumeExecutable>(code);
+    CPPUNIT_ASSERT(executable);
+
+    openvdb::GridPtrVec grids;
+    openvdb::FloatGrid::Ptr source = openvdb::FloatGrid::create();
+    source->setName("source");
+    source->tree().setValueOn(openvdb::Coord(0), 1.0f);
+    grids.emplace_back(source);
+
+    openvdb::FloatGrid::Ptr self = openvdb::FloatGrid::create();
+    self->setName("self");
+    grids.emplace_back(self);
+
+    for (size_t i = 0; i < count; ++i) {
+        openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create();
+        grid->setName("grid" + std::to_string(i));
+        // give each grid a different topology
+        for (int j = 0; j <= int(i); ++j) {
+            grid->tree().setValueOn(openvdb::Coord(0, 0, j * 8), -1.0f);
+        }
+        grids.emplace_back(grid);
+    }
+
+    for (int j = 0; j < 8; ++j) {
+        self->tree().setValueOn(openvdb::Coord(j * 8), float(j));
+    }
+
+    // default, automatic grain size
+    CPPUNIT_ASSERT_EQUAL(size_t(1), executable->getGrainSize());
+    executable->execute(grids);
+
+    for (const size_t grain : { size_t(0), size_t(1) }) {
+        executable->setGrainSize(grain);
+        executable->execute(grids);
+    }
+
+    // with spatial ordering
+    executable->setSpatialOrdering(true);
+    executable->execute(grids);
+
+    CPPUNIT_ASSERT_EQUAL(count + 2, grids.size());
+
+    for (size_t i = 0; i < count; ++i) {
+        openvdb::FloatGrid::Ptr grid =
+            openvdb::gridPtrCast<openvdb::FloatGrid>(grids[i + 2]);
+        CPPUNIT_ASSERT(grid);
+        CPPUNIT_ASSERT_EQUAL(openvdb::Index64(i + 1), grid->tree().activeVoxelCount());
+        // only the origin overlaps the source volume
+        CPPUNIT_ASSERT_EQUAL(float(i) + 1.0f, grid->tree().getValue(openvdb::Coord(0)));
+        for (int j = 1; j <= int(i); ++j) {
+            CPPUNIT_ASSERT_EQUAL(float(i), grid->tree().getValue(openvdb::Coord(0, 0, j * 8)));
+        }
+    }
+
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index64(8), self->tree().activeVoxelCount());
+    for (int j = 0; j < 8; ++j) {
+        CPPUNIT_ASSERT_EQUAL(float(j) + 4.0f, self->tree().getValue(openvdb::Coord(j * 8)));
+    }
+}
+
+
+void
+TestVolumeExecutable::testDeferredReads()
+{
+    // @a is only read within a branch, so is read at the start of that
+    // branch rather than for every voxel
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::VolumeExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::VolumeExecutable>
+            ("if (@b > 0.0f) { @c = @a; } else { @c = -@b; }");
+    CPPUNIT_ASSERT(executable);
+
+    openvdb::FloatGrid::Ptr a = openvdb::FloatGrid::create();
+    openvdb::FloatGrid::Ptr b = openvdb::FloatGrid::create();
+    openvdb::FloatGrid::Ptr c = openvdb::FloatGrid::create();
+    a->setName("a");
+    b->setName("b");
+    c->setName("c");
+    for (int i = 0; i < 64; ++i) {
+        const openvdb::Coord ijk(i, 0, 0);
+        a->tree().setValueOn(ijk, float(i));
+        b->tree().setValueOn(ijk, i % 2 ? 1.0f : -2.0f);
+        c->tree().setValueOn(ijk, -5.0f);
+    }
+
+    openvdb::GridPtrVec grids { a, b, c };
+    executable->execute(grids);
+
+    // the branch is taken for odd voxels, which read @a
+    for (int i = 0; i < 64; ++i) {
+        const openvdb::Coord ijk(i, 0, 0);
+        CPPUNIT_ASSERT_EQUAL(i % 2 ? float(i) : 2.0f, c->tree().getValue(ijk));
+        CPPUNIT_ASSERT_EQUAL(float(i), a->tree().getValue(ijk));
+    }
+}
+
+void
+TestVolumeExecutable::testTargetCPU()
+{
+    using TargetCPU = openvdb::ax::CompilerOptions::TargetCPU;
+
+    const std::string code = "@a = sqrt(@a) * 2.0f + float(getcoord().x);";
+
+    for (const TargetCPU target :
+        { TargetCPU::HOST, TargetCPU::GENERIC, TargetCPU::AVX2, TargetCPU::AVX512 }) {
+
+        openvdb::ax::CompilerOptions opts;
+        opts.mTargetCPU = target;
+        openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create(opts);
+
+        // instruction set extensions which are unavailable on this machine
+        // must be rejected, and must compile and execute otherwise
+        bool supported = true;
+        if (target == TargetCPU::AVX2 || target == TargetCPU::AVX512) {
+            supported = hostIsX86();
+            for (const char* feature : { "avx", "avx2", "bmi", "bmi2", "f16c",
+                    "fma", "lzcnt", "movbe", "popcnt" }) {
+                supported &= hostHasFeature(feature);
+            }
+        }
+        if (target == TargetCPU::AVX512) {
+            for (const char* feature :
+                { "avx512f", "avx512cd", "avx512bw", "avx512dq", "avx512vl" }) {
+                supported &= hostHasFeature(feature);
+            }
+        }
+
+        if (!supported) {
+            CPPUNIT_ASSERT_THROW(compiler->compile<openvdb::ax::VolumeExecutable>(code),
+                openvdb::AXCompilerError);
+            continue;
+        }
+
+        openvdb::ax::VolumeExecutable::Ptr executable =
+            compiler->compile<openvdb::ax::VolumeExecutable>(code);
+        CPPUNIT_ASSERT(executable);
+
+        const auto grids = executeRow(*executable, { "a" },
+            [](const int i) { return float(i * i); });
+
+        for (int i = 0; i < 64; ++i) {
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(float(i * 3),
+                grids[0]->tree().getValue(openvdb::Coord(i, 0, 0)), 1e-5f);
+        }
+    }
+}
+
+
+void
+TestVolumeExecutable::testFoldCBindings()
+{
+    // the arguments of these C bindings only become constant after llvm
+    // optimisation, at which point they are folded by the compiler
+    const std::string code = "double a = 1.0; float b = 0.5f; "
+        "@c = float(cosh(a)) + sinh(b) + tanh(float(cosh(a)));";
+    const float expected = float(std::cosh(1.0)) + std::sinh(0.5f) +
+        std::tanh(float(std::cosh(1.0)));
+
+    for (const bool fold : { false, true }) {
+        openvdb::ax::CompilerOptions opts;
+        opts.mFunctionOptions.mConstantFoldCBindings = fold;
+        opts.mFunctionOptions.mPrioritiseIR = false;
+        openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create(opts);
+
+        openvdb::ax::VolumeExecutable::Ptr executable =
+            compiler->compile<openvdb::ax::VolumeExecutable>(code);
+        CPPUNIT_ASSERT(executable);
+
+        openvdb::FloatGrid grid;
+        grid.setName("c");
+        grid.tree().setValueOn(openvdb::Coord(0));
+
+        executable->execute(grid);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(expected,
+            grid.tree().getValue(openvdb::Coord(0)), 1e-6f);
+
+        // the bindings of an object bundle are the C functions which are
+        // still called by the optimised module
+        openvdb::ax::Logger logger([](const std::string&) {});
+        openvdb::ax::ObjectBundle::Ptr bundle =
+            compiler->compileObject<openvdb::ax::VolumeExecutable>(code, logger);
+        CPPUNIT_ASSERT(bundle);
+        for (const std::string name : { "cosh", "sinh", "tanh" }) {
+            CPPUNIT_ASSERT_EQUAL(!fold, hasBinding(*bundle, name));
+        }
+    }
+
+    // bindings which don't support constant folding are still called, even
+    // when their arguments are constant
+
+    openvdb::ax::CompilerOptions opts;
+    opts.mFunctionOptions.mConstantFoldCBindings = true;
+    opts.mFunctionOptions.mPrioritiseIR = false;
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create(opts);
+
+    openvdb::ax::codegen::FunctionRegistry::UniquePtr registry =
+        openvdb::ax::codegen::createDefaultRegistry(&opts.mFunctionOptions);
+    registry->insert("nofoldcosh",
+        [](const openvdb::ax::codegen::FunctionOptions&) {
+            return openvdb::ax::codegen::FunctionBuilder("nofoldcosh")
+                .addSignature<double(double)>((double(*)(double))(std::cosh))
+                .setArgumentNames({"arg"})
+                .setConstantFold(false)
+                .setPreferredImpl(openvdb::ax::codegen::FunctionBuilder::C)
+                .setDocumentation("cosh, which is never constant folded")
+                .get();
+        });
+    compiler->setFunctionRegistry(std::move(registry));
+
+    openvdb::ax::Logger logger([](const std::string&) {});
+    openvdb::ax::ObjectBundle::Ptr bundle =
+        compiler->compileObject<openvdb::ax::VolumeExecutable>
+            ("double a = 1.0; @c = float(nofoldcosh(a)) + float(cosh(a));", logger);
+    CPPUNIT_ASSERT(bundle);
+    CPPUNIT_ASSERT(hasBinding(*bundle, "nofoldcosh"));
+    CPPUNIT_ASSERT(!hasBinding(*bundle, "cosh"));
+
+    openvdb::ax::VolumeExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::VolumeExecutable>
+            ("double a = 1.0; @c = float(nofoldcosh(a)) + float(cosh(a));");
+    CPPUNIT_ASSERT(executable);
+
+    openvdb::FloatGrid grid;
+    grid.setName("c");
+    grid.tree().setValueOn(openvdb::Coord(0));
+
+    executable->execute(grid);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0f * float(std::cosh(1.0)),
+        grid.tree().getValue(openvdb::Coord(0)), 1e-6f);
+}
+
+
+void
+TestVolumeExecutable::testFastMath()
+{
+    using FastMath = openvdb::ax::CompilerOptions::FastMath;
+
+    const std::string code = "float sum = 0.0f;"
+        "for (int i = 0; i < 16; ++i) sum += @a * float(i) + 0.5f;"
+        "@b = sum / 16.0f;";
+
+    for (const FastMath level :
+        { FastMath::NONE, FastMath::CONTRACT, FastMath::RELAXED, FastMath::FAST }) {
+
+        openvdb::ax::CompilerOptions opts;
+        opts.mFastMath = level;
+        openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create(opts);
+
+        openvdb::ax::VolumeExecutable::Ptr executable =
+            compiler->compile<openvdb::ax::VolumeExecutable>(code);
+        CPPUNIT_ASSERT(executable);
+
+        // the flags of the level are applied to the floating point operations
+        // of the kernel, which its execution engine keeps once compiled
+
+        llvm::ExecutionEngine* engine =
+            const_cast<llvm::ExecutionEngine*>(executable->mExecutionEngine.get());
+        const llvm::Function* kernel = engine->FindFunctionNamed(
+            openvdb::ax::codegen::VolumeKernel::getDefaultName());
+        CPPUNIT_ASSERT(kernel);
+
+        size_t operations = 0, flagged = 0;
+        for (const llvm::Instruction& inst : llvm::instructions(*kernel)) {
+            if (!llvm::isa<llvm::FPMathOperator>(&inst)) continue;
+            ++operations;
+            const llvm::FastMathFlags flags = inst.getFastMathFlags();
+            switch (level) {
+                case FastMath::NONE : flagged += flags.any(); break;
+                case FastMath::CONTRACT :
+                    flagged += flags.allowContract() && !flags.allowReassoc(); break;
+                case FastMath::RELAXED :
+                    flagged += flags.allowContract() && flags.allowReassoc() &&
+                        flags.approxFunc() && flags.noSignedZeros() &&
+                        !flags.noNaNs(); break;
+                case FastMath::FAST : flagged += flags.isFast(); break;
+            }
+        }
+        CPPUNIT_ASSERT(operations > 0);
+        if (level == FastMath::NONE) CPPUNIT_ASSERT_EQUAL(size_t(0), flagged);
+        else                         CPPUNIT_ASSERT(flagged > 0);
+
+        CPPUNIT_ASSERT_EQUAL(level == FastMath::RELAXED || level == FastMath::FAST,
+            kernel->getFnAttribute("no-signed-zeros-fp-math").getValueAsString() == "true");
+        CPPUNIT_ASSERT_EQUAL(level == FastMath::FAST,
+            kernel->getFnAttribute("unsafe-fp-math").getValueAsString() == "true");
+
+        const auto grids = executeRow(*executable, { "a", "b" },
+            [](const int i) { return float(i) * 0.1f; });
+
+        // the sum of 0..15 is 120
+        for (int i = 0; i < 64; ++i) {
+            const float expected = (float(i) * 0.1f * 120.0f + 8.0f) / 16.0f;
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected,
+                grids[1]->tree().getValue(openvdb::Coord(i, 0, 0)), 1e-4f);
+        }
+    }
+}
+
+
+void
+TestVolumeExecutable::testVectorLibrary()
+{
+    using VectorLibrary = openvdb::ax::CompilerOptions::VectorLibrary;
+
+    // reductions over loops of math calls, vectorized with reassociation.
+    // Values of @a past 8192 exercise the scalar fallback of sin and cos.
+    // simplexnoise is vectorized with its batched C binding
+    const std::string code = "float s = 0.0f; float e = 0.0f; float l = 0.0f; double n = 0.0;"
+        "for (int i = 0; i < 32; ++i) {"
+        "    float x = @a + float(i);"
+        "    s += sin(x) + cos(x);"
+        "    e += exp(x * 0.001f) + exp2(x * 0.001f);"
+        "    float y = fabs(x) + 1.0f;"
+        "    l += log(y) + log2(y) + log10(y);"
+        "    n += simplexnoise(x * 0.01f, float(i) * 0.1f, 1.0f);"
+        "}"
+        "@s = s; @e = e; @l = l; @n = float(n);";
+
+    for (const VectorLibrary lib : { VectorLibrary::NONE, VectorLibrary::AX }) {
+        openvdb::ax::CompilerOptions opts;
+        opts.mFastMath = openvdb::ax::CompilerOptions::FastMath::RELAXED;
+        opts.mVectorLibrary = lib;
+        openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create(opts);
+
+        openvdb::ax::VolumeExecutable::Ptr executable =
+            compiler->compile<openvdb::ax::VolumeExecutable>(code);
+        CPPUNIT_ASSERT(executable);
+
+        // the vectorized math calls are mapped to the 4, 8 or 16 wide variants
+        // of the library, depending on the target. Unused variants are
+        // removed, so any which remain in the module kept by the execution
+        // engine are called by the kernel
+
+        llvm::ExecutionEngine* engine =
+            const_cast<llvm::ExecutionEngine*>(executable->mExecutionEngine.get());
+        bool vectorized = false;
+        for (const std::string name : { "sin", "cos", "exp", "exp2", "log", "log2", "log10" }) {
+            for (const std::string width : { "v4f32", "v8f32", "v16f32" }) {
+                vectorized |= engine->FindFunctionNamed("ax." + name + "." + width) != nullptr;
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(lib == VectorLibrary::AX, vectorized);
+
+        const auto grids = executeRow(*executable, { "a", "s", "e", "l", "n" },
+            [](const int i) { return (float(i) - 32.0f) * 313.7f; });
+        const openvdb::FloatGrid::Ptr& a = grids[0];
+        const openvdb::FloatGrid::Ptr& s = grids[1];
+        const openvdb::FloatGrid::Ptr& e = grids[2];
+        const openvdb::FloatGrid::Ptr& l = grids[3];
+        const openvdb::FloatGrid::Ptr& n = grids[4];
+
+        const OSN::OSNoise gen;
+        for (int i = 0; i < 64; ++i) {
+            const openvdb::Coord ijk(i, 0, 0);
+            double es = 0.0, ee = 0.0, el = 0.0, en = 0.0;
+            for (int j = 0; j < 32; ++j) {
+                const float x = a->tree().getValue(ijk) + float(j);
+                const float y = std::fabs(x) + 1.0f;
+                es += std::sin(x) + std::cos(x);
+                ee += std::exp(x * 0.001f) + std::exp2(x * 0.001f);
+                el += std::log(y) + std::log2(y) + std::log10(y);
+                en += (gen.eval<double>(x * 0.01f, float(j) * 0.1f, 1.0f) + 1.0) * 0.5;
+            }
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(es, s->tree().getValue(ijk), 1e-4);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(ee, e->tree().getValue(ijk), 1e-5 * ee);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(el, l->tree().getValue(ijk), 1e-5 * el);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(float(en), n->tree().getValue(ijk), 1e-5);
+        }
+    }
+}
+
+
+void
+TestVolumeExecutable::testObjectBundle()
+{
+    // use C bindings and external variables, which are both bound when
+    // the object code is loaded
+    const std::string code = "@b = float(cosh(double(@a))) * $scale + external(\"offset\");";
+
+    openvdb::ax::CompilerOptions opts;
+    opts.mFunctionOptions.mPrioritiseIR = false;
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create(opts);
+    openvdb::ax::Logger logger([](const std::string&) {});
+
+    openvdb::ax::ObjectBundle::Ptr bundle =
+        compiler->compileObject<openvdb::ax::VolumeExecutable>(code, logger);
+    CPPUNIT_ASSERT(bundle);
+    CPPUNIT_ASSERT(bundle->type() == openvdb::ax::ObjectBundle::ExecutableType::VOLUMES);
+    CPPUNIT_ASSERT(bundle->tree());
+    CPPUNIT_ASSERT(bundle->attributeRegistry());
+    CPPUNIT_ASSERT(!bundle->object().empty());
+    CPPUNIT_ASSERT(!bundle->bindings().empty());
+    CPPUNIT_ASSERT_EQUAL(size_t(2), bundle->externals().size());
+
+    // compilation errors are reported to the logger
+
+    CPPUNIT_ASSERT(!compiler->compileObject<openvdb::ax::VolumeExecutable>("i;", logger));
+    CPPUNIT_ASSERT(logger.hasError());
+
+    // write and read
+
+    std::stringstream stream(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+    bundle->write(stream);
+    const openvdb::ax::ObjectBundle::ConstPtr read = openvdb::ax::ObjectBundle::read(stream);
+    CPPUNIT_ASSERT(read);
+    CPPUNIT_ASSERT(read->type() == bundle->type());
+    CPPUNIT_ASSERT_EQUAL(bundle->triple(), read->triple());
+    CPPUNIT_ASSERT_EQUAL(bundle->cpu(), read->cpu());
+    CPPUNIT_ASSERT_EQUAL(bundle->features(), read->features());
+    CPPUNIT_ASSERT_EQUAL(bundle->object(), read->object());
+    CPPUNIT_ASSERT(bundle->externals() == read->externals());
+    CPPUNIT_ASSERT(bundle->bindings() == read->bindings());
+    CPPUNIT_ASSERT(read->tree());
+    CPPUNIT_ASSERT(openvdb::ax::ast::callsFunction(*read->tree(), "cosh"));
+    CPPUNIT_ASSERT(read->attributeRegistry()->isReadable("a", openvdb::ax::ast::tokens::FLOAT));
+    CPPUNIT_ASSERT(read->attributeRegistry()->isWritable("b", openvdb::ax::ast::tokens::FLOAT));
+
+    std::stringstream invalid("not a bundle");
+    CPPUNIT_ASSERT_THROW(openvdb::ax::ObjectBundle::read(invalid), openvdb::IoError);
+    std::stringstream truncated(stream.str().substr(0, stream.str().size() / 2));
+    CPPUNIT_ASSERT_THROW(openvdb::ax::ObjectBundle::read(truncated), openvdb::IoError);
+
+    // sizes larger than the remaining data are rejected before allocating,
+    // here the length of the triple which follows the magic, version and type
+    {
+        std::string bytes = stream.str();
+        const uint64_t size = std::numeric_limits<uint64_t>::max() / 2;
+        bytes.replace(9, sizeof(uint64_t), reinterpret_cast<const char*>(&size), sizeof(uint64_t));
+        std::stringstream oversized(bytes);
+        CPPUNIT_ASSERT_THROW(openvdb::ax::ObjectBundle::read(oversized), openvdb::IoError);
+    }
+
+    // load and execute, comparing to the JIT compiled executable
+
+    openvdb::ax::CustomData::Ptr data = openvdb::ax::CustomData::create();
+    data->insertData("scale", openvdb::TypedMetadata<float>(2.0f).copy());
+
+    openvdb::ax::VolumeExecutable::Ptr loaded =
+        openvdb::ax::VolumeExecutable::load(*read, data);
+    CPPUNIT_ASSERT(loaded);
+    openvdb::ax::VolumeExecutable::Ptr compiled =
+        compiler->compile<openvdb::ax::VolumeExecutable>(code, data);
+    CPPUNIT_ASSERT(compiled);
+
+    // values are read at execution time
+    data->insertData("offset", openvdb::TypedMetadata<float>(0.5f).copy());
+
+    for (const openvdb::ax::VolumeExecutable::Ptr& executable : { loaded, compiled }) {
+        const auto grids = executeRow(*executable, { "a", "b" },
+            [](const int i) { return float(i) * 0.025f; });
+
+        for (int i = 0; i < 64; ++i) {
+            const float expected = float(std::cosh(double(float(i) * 0.025f))) * 2.0f + 0.5f;
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(expected,
+                grids[1]->tree().getValue(openvdb::Coord(i, 0, 0)), 1e-5f);
+        }
+    }
+
+    // loaded executables create custom data if none is provided
+
+    CPPUNIT_ASSERT(openvdb::ax::VolumeExecutable::load(*read));
+
+    // mismatching custom data and executable types throw
+
+    openvdb::ax::CustomData::Ptr invalidData = openvdb::ax::CustomData::create();
+    invalidData->insertData("scale", openvdb::TypedMetadata<int32_t>(2).copy());
+    CPPUNIT_ASSERT_THROW(openvdb::ax::VolumeExecutable::load(*read, invalidData),
+        openvdb::AXExecutionError);
+    CPPUNIT_ASSERT_THROW(openvdb::ax::PointExecutable::load(*read),
+        openvdb::AXExecutionError);
+
+    // bundles which require a CPU feature the host lacks are rejected on load
+
+    std::string missing;
+    for (const auto& feature : hostFeatures()) {
+        if (!feature.second) { missing = feature.first().str(); break; }
+    }
+    if (!missing.empty()) {
+        // replace the features of the only variant of the bundle, which
+        // follow the magic, version, type, triple, variant count and cpu
+        CPPUNIT_ASSERT_EQUAL(size_t(1), bundle->variants().size());
+        const std::string bytes = stream.str();
+        const size_t offset = 9 + sizeof(uint64_t) + bundle->triple().size() +
+            sizeof(uint64_t) + sizeof(uint64_t) + bundle->cpu().size();
+        const std::string features = "+" + missing;
+        const uint64_t size = features.size();
+        std::string modified = bytes.substr(0, offset);
+        modified.append(reinterpret_cast<const char*>(&size), sizeof(uint64_t));
+        modified += features;
+        modified += bytes.substr(offset + sizeof(uint64_t) + bundle->features().size());
+
+        std::stringstream crafted(modified,
+            std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        const openvdb::ax::ObjectBundle::ConstPtr unsupported =
+            openvdb::ax::ObjectBundle::read(crafted);
+        CPPUNIT_ASSERT_EQUAL(features, unsupported->features());
+        CPPUNIT_ASSERT_THROW(openvdb::ax::VolumeExecutable::load(*unsupported, data),
+            openvdb::AXExecutionError);
+    }
+
+    // object code can be compiled for CPUs the host does not support, which
+    // only fails once loaded. The extensions of the target are recorded
+
+    if (hostIsX86()) {
+        openvdb::ax::CompilerOptions avx512;
+        avx512.mTargetCPU = openvdb::ax::CompilerOptions::TargetCPU::AVX512;
+        avx512.mFunctionOptions.mPrioritiseIR = false;
+        openvdb::ax::ObjectBundle::Ptr target =
+            openvdb::ax::Compiler::create(avx512)->
+                compileObject<openvdb::ax::VolumeExecutable>(code, logger);
+        CPPUNIT_ASSERT(target);
+        CPPUNIT_ASSERT(target->features().find("+avx512f") != std::string::npos);
+        CPPUNIT_ASSERT(target->features().find("+avx2") != std::string::npos);
+
+        bool supported = true;
+        for (const char* feature :
+            { "avx512f", "avx512cd", "avx512bw", "avx512dq", "avx512vl" }) {
+            supported &= hostHasFeature(feature);
+        }
+        if (supported) {
+            CPPUNIT_ASSERT(openvdb::ax::VolumeExecutable::load(*target, data));
+        }
+        else {
+            CPPUNIT_ASSERT_THROW(openvdb::ax::VolumeExecutable::load(*target, data),
+                openvdb::AXExecutionError);
+        }
+
+        // a variant is compiled for each object target and the one with the
+        // most features which the host supports is loaded
+
+        openvdb::ax::CompilerOptions variants;
+        variants.mTargetCPU = openvdb::ax::CompilerOptions::TargetCPU::GENERIC;
+        variants.mObjectTargets = {
+            openvdb::ax::CompilerOptions::TargetCPU::AVX2,
+            openvdb::ax::CompilerOptions::TargetCPU::AVX512,
+            openvdb::ax::CompilerOptions::TargetCPU::GENERIC
+        };
+        variants.mFunctionOptions.mPrioritiseIR = false;
+        openvdb::ax::ObjectBundle::Ptr multi =
+            openvdb::ax::Compiler::create(variants)->
+                compileObject<openvdb::ax::VolumeExecutable>(code, logger);
+        CPPUNIT_ASSERT(multi);
+        CPPUNIT_ASSERT_EQUAL(size_t(3), multi->variants().size());
+        CPPUNIT_ASSERT_EQUAL(std::string("skylake-avx512"), multi->variants()[0].cpu());
+        CPPUNIT_ASSERT_EQUAL(std::string("haswell"), multi->variants()[1].cpu());
+        CPPUNIT_ASSERT_EQUAL(std::string("x86-64"), multi->variants()[2].cpu());
+
+        std::stringstream multistream(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+        multi->write(multistream);
+        const openvdb::ax::ObjectBundle::ConstPtr multiread =
+            openvdb::ax::ObjectBundle::read(multistream);
+        CPPUNIT_ASSERT_EQUAL(size_t(3), multiread->variants().size());
+        for (size_t i = 0; i < 3; ++i) {
+            CPPUNIT_ASSERT_EQUAL(multi->variants()[i].cpu(), multiread->variants()[i].cpu());
+            CPPUNIT_ASSERT_EQUAL(multi->variants()[i].object(), multiread->variants()[i].object());
+        }
+
+        bool avx2 = true;
+        for (const char* feature :
+            { "avx", "avx2", "bmi", "bmi2", "f16c", "fma", "lzcnt", "movbe", "popcnt" }) {
+            avx2 &= hostHasFeature(feature);
+        }
+        const std::string expected =
+            (supported && avx2) ? "skylake-avx512" : (avx2 ? "haswell" : "x86-64");
+        CPPUNIT_ASSERT_EQUAL(expected, multiread->hostVariant().cpu());
+        CPPUNIT_ASSERT(openvdb::ax::VolumeExecutable::load(*multiread, data));
+    }
+}
+
+void
+TestVolumeExecutable::testReductions()
+{
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::CustomData::Ptr data = openvdb::ax::CustomData::create();
+
+    openvdb::ax::VolumeExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::VolumeExecutable>(
+            "reduceadd(\"count\", 1);"
+            "reduceadd(\"sum\", @density);"
+            "reducemin(\"min\", @density);"
+            "reducemin(\"minz\", getcoordz());"
+            "reducemax(\"max\", getvoxelpws());", data);
+    CPPUNIT_ASSERT(executable);
+
+    // one active voxel in each of many leaf nodes
+    openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create();
+    grid->setName("density");
+    for (int i = 0; i < 64; ++i) {
+        grid->tree().setValueOn(openvdb::Coord(i * 8, 0, -i * 8), float(i));
+    }
+
+    executable->execute(*grid);
+
+    auto count = data->getData<openvdb::TypedMetadata<int32_t>>("count");
+    auto sum = data->getData<openvdb::TypedMetadata<float>>("sum");
+    auto min = data->getData<openvdb::TypedMetadata<float>>("min");
+    auto minz = data->getData<openvdb::TypedMetadata<int32_t>>("minz");
+    auto max = data->getData<openvdb::TypedMetadata<openvdb::Vec3f>>("max");
+    CPPUNIT_ASSERT(count && sum && min && minz && max);
+    CPPUNIT_ASSERT_EQUAL(64, count->value());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2016.0f, sum->value(), 1e-3f);
+    CPPUNIT_ASSERT_EQUAL(0.0f, min->value());
+    CPPUNIT_ASSERT_EQUAL(-504, minz->value());
+    CPPUNIT_ASSERT_EQUAL(openvdb::Vec3f(504.0f, 0.0f, 0.0f), max->value());
+
+    // results accumulate into existing data across executions
+    openvdb::GridPtrVec grids { grid };
+    executable->execute(grids);
+    count = data->getData<openvdb::TypedMetadata<int32_t>>("count");
+    CPPUNIT_ASSERT_EQUAL(128, count->value());
+}
 
 void
 TestVolumeExecutable::testCompilerCases()
@@ -45,8 +45,10 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
 #include <functional>
 #include <random>
+#include <vector>
 
 using namespace openvdb::points;
 using namespace openvdb::ax;
@@ -890,54 +892,110 @@ TestStandardFunctions::print()
     std::cout.rdbuf(sbuf);
 }
 
-void
-TestStandardFunctions::rand()
+namespace {
+
+// Reference implementations of the counter based generators used by rand()
+// and rand32() (see codegen/StandardFunctions.cc)
+
+inline uint64_t mixKey(uint64_t z)
 {
-    std::mt19937_64 engine;
-    std::uniform_real_distribution<double> uniform(0.0,1.0);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return (z ^ (z >> 31)) | 1;
+}
 
-    size_t hash = std::hash<double>()(2.0);
-    engine.seed(hash);
+inline uint64_t seedToKey(const double seed)
+{
+    uint64_t bits = 0;
+    if (seed != 0.0) std::memcpy(&bits, &seed, sizeof(double));
+    return mixKey(bits);
+}
+
+inline uint64_t coordToKey(const openvdb::Coord& ijk, const uint64_t index = 0)
+{
+    uint64_t key = index * 0xd6e8feb86659fd93ULL;
+    key ^= uint64_t(uint32_t(ijk.x())) * 0x9e3779b97f4a7c15ULL;
+    key ^= uint64_t(uint32_t(ijk.y())) * 0xc2b2ae3d27d4eb4fULL;
+    key ^= uint64_t(uint32_t(ijk.z())) * 0x165667b19e3779f9ULL;
+    return mixKey(key);
+}
 
-    const double expected1 = uniform(engine);
+inline uint64_t swapHalves(const uint64_t x) { return (x >> 32) | (x << 32); }
 
-    hash = std::hash<double>()(3.0);
-    engine.seed(hash);
+inline double squares64(const uint64_t counter, const uint64_t key)
+{
+    const uint64_t y = counter * key, z = y + key;
+    uint64_t x = swapHalves(y * y + y);
+    x = swapHalves(x * x + z);
+    x = swapHalves(x * x + y);
+    const uint64_t t = x * x + z;
+    x = swapHalves(t);
+    return double((t ^ ((x * x + y) >> 32)) >> 11) * std::ldexp(1.0, -53);
+}
 
-    const double expected2 = uniform(engine);
-    const double expected3 = uniform(engine);
+inline double squares32(const uint64_t counter, const uint64_t key)
+{
+    const uint64_t y = counter * key, z = y + key;
+    uint64_t x = swapHalves(y * y + y);
+    x = swapHalves(x * x + z);
+    x = swapHalves(x * x + y);
+    return double((x * x + z) >> 32) * std::ldexp(1.0, -32);
+}
 
-    mHarness.addAttributes<double>({"test0", "test1", "test2", "test3"},
-        {expected1, expected1, expected2, expected3});
-    testFunctionOptions(mHarness, "rand");
 }
 
 void
-TestStandardFunctions::rand32()
+TestStandardFunctions::rand()
 {
-    auto hashToSeed = [](size_t hash) ->
-        std::mt19937::result_type
-    {
-        unsigned int seed = 0;
-        do {
-            seed ^= (uint32_t) hash;
-        } while (hash >>= sizeof(uint32_t) * 8);
-        return std::mt19937::result_type(seed);
-    };
+    const double expected1 = squares64(0, seedToKey(2.0));
+    const double expected2 = squares64(0, seedToKey(3.0));
+    const double expected3 = squares64(1, seedToKey(3.0));
 
-    std::mt19937 engine;
-    std::uniform_real_distribution<double> uniform(0.0,1.0);
+    mHarness.addAttributes<double>({"test0", "test1", "test2", "test3"},
+        {expected1, expected1, expected2, expected3});
+    testFunctionOptions(mHarness, "rand");
 
-    size_t hash = std::hash<double>()(2.0);
-    engine.seed(hashToSeed(hash));
+    // Unseeded calls are keyed by the element being processed, so produce the
+    // same results regardless of how execution is threaded
 
-    const double expected1 = uniform(engine);
+    Compiler compiler;
+    VolumeExecutable::Ptr executable =
+        compiler.compile<VolumeExecutable>("@a = rand(); @b = rand();");
+
+    openvdb::GridPtrVec grids[2];
+    for (size_t grain : { size_t(0), size_t(1) }) {
+        openvdb::DoubleGrid::Ptr a = openvdb::DoubleGrid::create();
+        openvdb::DoubleGrid::Ptr b = openvdb::DoubleGrid::create();
+        a->setName("a");
+        b->setName("b");
+        a->denseFill(openvdb::CoordBBox({-20,-20,-20}, {20,20,20}), 0.0, true);
+        b->topologyUnion(*a);
+        grids[grain] = { a, b };
+        executable->setGrainSize(grain);
+        executable->execute(grids[grain]);
+    }
 
-    hash = std::hash<double>()(3.0);
-    engine.seed(hashToSeed(hash));
+    const auto& a0 = static_cast<const openvdb::DoubleGrid&>(*grids[0][0]).tree();
+    const auto& b0 = static_cast<const openvdb::DoubleGrid&>(*grids[0][1]).tree();
+    const auto& a1 = static_cast<const openvdb::DoubleGrid&>(*grids[1][0]).tree();
+    const auto& b1 = static_cast<const openvdb::DoubleGrid&>(*grids[1][1]).tree();
+
+    for (auto iter = a0.cbeginValueOn(); iter; ++iter) {
+        const openvdb::Coord& ijk = iter.getCoord();
+        const uint64_t key = coordToKey(ijk);
+        CPPUNIT_ASSERT_EQUAL(squares64(0, key), *iter);
+        CPPUNIT_ASSERT_EQUAL(squares64(1, key), b0.getValue(ijk));
+        CPPUNIT_ASSERT_EQUAL(*iter, a1.getValue(ijk));
+        CPPUNIT_ASSERT_EQUAL(b0.getValue(ijk), b1.getValue(ijk));
+    }
+}
 
-    const double expected2 = uniform(engine);
-    const double expected3 = uniform(engine);
+void
+TestStandardFunctions::rand32()
+{
+    const double expected1 = squares32(0, seedToKey(2.0));
+    const double expected2 = squares32(0, seedToKey(3.0));
+    const double expected3 = squares32(1, seedToKey(3.0));
 
     mHarness.addAttributes<double>({"test0", "test1", "test2", "test3"},
         {expected1, expected1, expected2, expected3});
@@ -975,6 +1033,23 @@ TestStandardFunctions::simplexnoise()
     mHarness.addAttribute<double>("noise4", (noise4 + 1.0) * 0.5);
 
     testFunctionOptions(mHarness, "simplexnoise");
+
+    // the batched evaluation used by vectorized calls is exact. Use three
+    // full blocks of 16 positions and a partial block, spanning lattice
+    // cells with negative and integer coordinates
+
+    const int64_t n = 16 * 3 + 5;
+    std::vector<double> x(n), y(n), z(n), batch(n);
+    for (int64_t i = 0; i < n; ++i) {
+        x[i] = double(i) * 0.37 - 9.0;
+        y[i] = double(i % 7) - 3.0;
+        z[i] = double(i * i) * 0.011 - 2.5;
+    }
+
+    noiseGenerator.evalBatch<double>(x.data(), y.data(), z.data(), batch.data(), n);
+    for (int64_t i = 0; i < n; ++i) {
+        CPPUNIT_ASSERT_EQUAL(noiseGenerator.eval<double>(x[i], y[i], z[i]), batch[i]);
+    }
 }
 
 void
@@ -55,6 +55,7 @@ public:
     CPPUNIT_TEST(getvoxelpws);
     CPPUNIT_TEST(ingroupOrder);
     CPPUNIT_TEST(ingroup);
+    CPPUNIT_TEST(setactive);
     CPPUNIT_TEST(testValidContext);
     CPPUNIT_TEST_SUITE_END();
 
@@ -64,6 +65,7 @@ public:
     void getvoxelpws();
     void ingroupOrder();
     void ingroup();
+    void setactive();
     void testValidContext();
 };
 
@@ -391,6 +393,47 @@ TestVDBFunctions::ingroup()
     }
 }
 
+void
+TestVDBFunctions::setactive()
+{
+    openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create();
+    grid->setName("a");
+    openvdb::FloatGrid::Accessor accessor = grid->getAccessor();
+    accessor.setValueOn(openvdb::Coord(0, 0, 0), 0.0f);
+    accessor.setValueOn(openvdb::Coord(1, 0, 0), 1.0f);
+    accessor.setValueOn(openvdb::Coord(100, 0, 0), 0.0f);
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index32(2), grid->tree().leafCount());
+
+    const std::string code = unittest_util::loadText("test/snippets/vdb_functions/setactive");
+    openvdb::ax::run(code.c_str(), *grid);
+
+    // zero valued voxels should have been deactivated but still be written to
+    CPPUNIT_ASSERT(!grid->tree().isValueOn(openvdb::Coord(0, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(1.0f, grid->tree().getValue(openvdb::Coord(0, 0, 0)));
+    CPPUNIT_ASSERT(grid->tree().isValueOn(openvdb::Coord(1, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(2.0f, grid->tree().getValue(openvdb::Coord(1, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index64(1), grid->tree().activeVoxelCount());
+
+    // the second leaf is now entirely inactive and should have been pruned
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index32(1), grid->tree().leafCount());
+    CPPUNIT_ASSERT(!grid->tree().isValueOn(openvdb::Coord(100, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(grid->background(), grid->tree().getValue(openvdb::Coord(100, 0, 0)));
+
+    // test re-activation of inactive voxels
+    openvdb::ax::Compiler::UniquePtr compiler = openvdb::ax::Compiler::create();
+    openvdb::ax::VolumeExecutable::Ptr executable =
+        compiler->compile<openvdb::ax::VolumeExecutable>("setactive(true); f@a = 3.0f;");
+    CPPUNIT_ASSERT(executable);
+    executable->setValueIterator(openvdb::ax::VolumeExecutable::IterType::OFF);
+    executable->execute(*grid);
+
+    CPPUNIT_ASSERT(grid->tree().isValueOn(openvdb::Coord(0, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(3.0f, grid->tree().getValue(openvdb::Coord(0, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(2.0f, grid->tree().getValue(openvdb::Coord(1, 0, 0)));
+    CPPUNIT_ASSERT_EQUAL(openvdb::Index64(openvdb::FloatTree::LeafNodeType::NUM_VOXELS),
+        grid->tree().activeVoxelCount());
+}
+
 void
 TestVDBFunctions::testValidContext()
 {